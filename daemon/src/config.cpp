@@ -0,0 +1,227 @@
+#include "config.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace radxa {
+
+namespace {
+
+std::string trim(const std::string &s) {
+    size_t b = s.find_first_not_of(" \t\r");
+    size_t e = s.find_last_not_of(" \t\r");
+    return b == std::string::npos ? std::string() : s.substr(b, e - b + 1);
+}
+
+bool parse_uint(const std::string &s, unsigned &out) {
+    try {
+        size_t pos;
+        unsigned long v = std::stoul(s, &pos);
+        if (pos != s.size())
+            return false;
+        out = static_cast<unsigned>(v);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+bool parse_int(const std::string &s, int &out) {
+    try {
+        size_t pos;
+        out = std::stoi(s, &pos);
+        return pos == s.size();
+    } catch (...) {
+        return false;
+    }
+}
+
+// "45:64 55:128 65:192 75:255" -> steps sorted by temperature
+bool parse_curve(const std::string &s, std::vector<FanStep> &curve) {
+    std::istringstream in(s);
+    std::string item;
+
+    curve.clear();
+    while (in >> item) {
+        size_t colon = item.find(':');
+        FanStep step;
+        if (colon == std::string::npos ||
+            !parse_int(item.substr(0, colon), step.temp_c) ||
+            !parse_int(item.substr(colon + 1), step.pwm) ||
+            step.pwm < 0 || step.pwm > 255)
+            return false;
+        curve.push_back(step);
+    }
+    std::sort(curve.begin(), curve.end(),
+              [](const FanStep &a, const FanStep &b) { return a.temp_c < b.temp_c; });
+    return !curve.empty();
+}
+
+} // namespace
+
+const Profile *Config::find_profile(const std::string &name) const {
+    for (const auto &p : profiles)
+        if (p.name == name)
+            return &p;
+    return nullptr;
+}
+
+bool load_config(const std::string &path, Config &config, std::string &error) {
+    std::ifstream in(path);
+    std::string line, section;
+    int lineno = 0;
+
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    // Same steps as fan_control.sh thermal mode unless configured
+    config.fan.curve = { { 0, 64 }, { 45, 128 }, { 55, 192 }, { 65, 255 } };
+
+    while (std::getline(in, line)) {
+        lineno++;
+        size_t hash = line.find('#');
+        if (hash != std::string::npos)
+            line.erase(hash);
+        line = trim(line);
+        if (line.empty())
+            continue;
+
+        if (line.front() == '[') {
+            if (line.back() != ']') {
+                error = path + ":" + std::to_string(lineno) + ": bad section";
+                return false;
+            }
+            section = trim(line.substr(1, line.size() - 2));
+            if (section.rfind("profile ", 0) == 0) {
+                Profile p;
+                p.name = trim(section.substr(8));
+                config.profiles.push_back(p);
+            } else if (section.rfind("rule ", 0) == 0) {
+                WorkloadRule r;
+                r.name = trim(section.substr(5));
+                config.rules.push_back(r);
+            }
+            continue;
+        }
+
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            error = path + ":" + std::to_string(lineno) + ": expected key = value";
+            return false;
+        }
+        std::string key = trim(line.substr(0, eq));
+        std::string value = trim(line.substr(eq + 1));
+        bool ok = true;
+
+        if (section.empty()) {
+            if (key == "socket")
+                config.socket_path = value;
+            else if (key == "telemetry_file")
+                config.telemetry_file = value;
+            else if (key == "telemetry_interval_ms")
+                ok = parse_uint(value, config.telemetry_interval_ms) &&
+                     config.telemetry_interval_ms >= 100;
+            else if (key == "default_profile")
+                config.default_profile = value;
+            else
+                ok = false;
+        } else if (section == "paths") {
+            Paths &p = config.paths;
+            if (key == "cpu_overclock") p.cpu_overclock = value;
+            else if (key == "ram_overclock") p.ram_overclock = value;
+            else if (key == "fan_control") p.fan_control = value;
+            else if (key == "npu_device") p.npu_device = value;
+            else if (key == "cpufreq_boost") p.cpufreq_boost = value;
+            else if (key == "fan_pwm") p.fan_pwm = value;
+            else if (key == "temperature") p.temperature = value;
+            else if (key == "watchdog") p.watchdog = value;
+            else if (key == "lkg_file") p.lkg_file = value;
+            else ok = false;
+        } else if (section == "fan") {
+            FanConfig &f = config.fan;
+            if (key == "mode") {
+                if (value == "auto") {
+                    f.automatic = true;
+                } else {
+                    f.automatic = false;
+                    ok = parse_int(value, f.manual_pwm) && f.manual_pwm >= 0 && f.manual_pwm <= 255;
+                }
+            } else if (key == "curve") {
+                ok = parse_curve(value, f.curve);
+            } else if (key == "hysteresis") {
+                ok = parse_int(value, f.hysteresis_c) && f.hysteresis_c >= 0;
+            } else if (key == "poll_ms") {
+                ok = parse_uint(value, f.poll_ms) && f.poll_ms >= 100;
+            } else if (key == "shutdown_pwm") {
+                f.shutdown_auto = value == "auto";
+                if (!f.shutdown_auto)
+                    ok = parse_int(value, f.shutdown_pwm) && f.shutdown_pwm >= 0 && f.shutdown_pwm <= 255;
+            } else {
+                ok = false;
+            }
+        } else if (section.rfind("profile ", 0) == 0) {
+            if (key != "boost" && key != "cpu" && key != "ddr" && key != "llm" && key != "fan")
+                ok = false;
+            else
+                config.profiles.back().settings.emplace_back(key, value);
+        } else if (section == "workload") {
+            WorkloadConfig &w = config.workload;
+            if (key == "enabled")
+                w.enabled = value == "yes" || value == "true" || value == "1";
+            else if (key == "idle_profile")
+                w.idle_profile = value;
+            else if (key == "revert_delay_ms")
+                ok = parse_uint(value, w.revert_delay_ms);
+            else
+                ok = false;
+        } else if (section == "try") {
+            TryConfig &t = config.try_;
+            if (key == "timeout_s")
+                ok = parse_uint(value, t.timeout_s) && t.timeout_s > 0;
+            else if (key == "watchdog_timeout_s")
+                ok = parse_uint(value, t.watchdog_timeout_s) && t.watchdog_timeout_s >= 2;
+            else
+                ok = false;
+        } else if (section.rfind("rule ", 0) == 0) {
+            WorkloadRule &r = config.rules.back();
+            if (key == "binary") r.binary = value;
+            else if (key == "cmdline") r.cmdline = value;
+            else if (key == "cgroup") r.cgroup = value;
+            else if (key == "profile") r.profile = value;
+            else if (key == "priority") ok = parse_int(value, r.priority);
+            else ok = false;
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            error = path + ":" + std::to_string(lineno) + ": invalid '" + key + "' in [" + section + "]";
+            return false;
+        }
+    }
+
+    if (!config.default_profile.empty() && !config.find_profile(config.default_profile)) {
+        error = "default_profile '" + config.default_profile + "' is not defined";
+        return false;
+    }
+    if (!config.workload.idle_profile.empty() && !config.find_profile(config.workload.idle_profile)) {
+        error = "idle_profile '" + config.workload.idle_profile + "' is not defined";
+        return false;
+    }
+    for (const auto &r : config.rules) {
+        if (r.binary.empty() && r.cmdline.empty() && r.cgroup.empty()) {
+            error = "rule '" + r.name + "' matches nothing";
+            return false;
+        }
+        if (!config.find_profile(r.profile)) {
+            error = "rule '" + r.name + "' uses undefined profile '" + r.profile + "'";
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace radxa
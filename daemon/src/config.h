@@ -0,0 +1,90 @@
+// radxa-perfd configuration (/etc/radxa-perfd.conf)
+//
+// INI-style: global keys, a [paths] section, a [fan] section, one
+// [profile NAME] section per performance profile, a [workload] section,
+// one [rule NAME] section per workload rule and a [try] section.
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace radxa {
+
+struct FanStep {
+    int temp_c;     // At or above this temperature...
+    int pwm;        // ...run the fan at this duty (0-255)
+};
+
+struct FanConfig {
+    bool automatic = true;
+    int manual_pwm = 255;
+    std::vector<FanStep> curve;
+    int hysteresis_c = 2;
+    unsigned poll_ms = 2000;    // Fallback when fan_control is not loaded
+    bool shutdown_auto = true;  // Hand the fan back to thermal control on exit
+    int shutdown_pwm = 255;
+};
+
+struct Paths {
+    std::string cpu_overclock = "/sys/kernel/cpu_overclock";
+    std::string ram_overclock = "/sys/kernel/ram_overclock";
+    std::string fan_control = "/sys/kernel/fan_control";
+    std::string npu_device = "/sys/devices/platform/soc@3000000/3600000.npu";
+    std::string cpufreq_boost = "/sys/devices/system/cpu/cpufreq/boost";
+    std::string fan_pwm = "/sys/devices/platform/pwm-fan/hwmon/hwmon8/pwm1";
+    std::string temperature = "/sys/class/thermal/thermal_zone0/temp";
+    std::string watchdog = "/dev/watchdog";
+    std::string lkg_file = "/etc/modprobe.d/radxa-overclock-lkg.conf";
+};
+
+// Speculative profiles ("try NAME"): reverted by the modules unless
+// committed in time, and backed by the hardware watchdog against hangs
+struct TryConfig {
+    unsigned timeout_s = 30;
+    unsigned watchdog_timeout_s = 10;
+};
+
+struct Profile {
+    std::string name;
+    // Ordered (key, value) writes; keys: boost, cpu, ddr, llm, fan
+    std::vector<std::pair<std::string, std::string>> settings;
+};
+
+// Workload rule: while a matching process runs, its profile is applied.
+// Empty match fields are wildcards; at least one must be set.
+struct WorkloadRule {
+    std::string name;
+    std::string binary;     // comm or basename of /proc/PID/exe
+    std::string cmdline;    // substring of the command line
+    std::string cgroup;     // substring of /proc/PID/cgroup
+    std::string profile;
+    int priority = 0;       // Highest priority among running matches wins
+};
+
+struct WorkloadConfig {
+    bool enabled = false;
+    std::string idle_profile;           // Falls back to default_profile
+    unsigned revert_delay_ms = 2000;    // Debounce restarts before reverting
+};
+
+struct Config {
+    std::string socket_path = "/run/radxa-perfd.sock";
+    std::string telemetry_file;         // Prometheus textfile, empty = off
+    unsigned telemetry_interval_ms = 5000;
+    std::string default_profile;
+    Paths paths;
+    FanConfig fan;
+    std::vector<Profile> profiles;
+    WorkloadConfig workload;
+    std::vector<WorkloadRule> rules;
+    TryConfig try_;
+
+    const Profile *find_profile(const std::string &name) const;
+};
+
+// Returns false and fills error on parse failure
+bool load_config(const std::string &path, Config &config, std::string &error);
+
+} // namespace radxa
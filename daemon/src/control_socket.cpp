@@ -0,0 +1,121 @@
+#include "control_socket.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace radxa {
+
+namespace {
+constexpr size_t kMaxLine = 1024;
+}
+
+ControlSocket::ControlSocket(EventLoop &loop, CommandHandler handler)
+    : loop_(loop), handler_(std::move(handler)) {}
+
+ControlSocket::~ControlSocket() {
+    for (auto &c : clients_) {
+        loop_.remove(c.first);
+        close(c.first);
+    }
+    if (listen_fd_ >= 0) {
+        loop_.remove(listen_fd_);
+        close(listen_fd_);
+        unlink(path_.c_str());
+    }
+}
+
+bool ControlSocket::listen(const std::string &path) {
+    struct sockaddr_un addr = {};
+
+    if (path.size() >= sizeof(addr.sun_path))
+        return false;
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        perror("radxa-perfd: socket");
+        return false;
+    }
+
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path.c_str(), path.size());
+    unlink(path.c_str());
+    if (bind(listen_fd_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0 ||
+        ::listen(listen_fd_, 8) < 0) {
+        fprintf(stderr, "radxa-perfd: bind %s: %s\n", path.c_str(), strerror(errno));
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+    chmod(path.c_str(), 0660);
+    path_ = path;
+
+    return loop_.add(listen_fd_, EPOLLIN, [this](uint32_t) { accept_clients(); });
+}
+
+void ControlSocket::accept_clients() {
+    for (;;) {
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+        clients_[fd] = std::string();
+        loop_.add(fd, EPOLLIN | EPOLLRDHUP, [this, fd](uint32_t ev) { handle_client(fd, ev); });
+    }
+}
+
+void ControlSocket::close_client(int fd) {
+    loop_.remove(fd);
+    clients_.erase(fd);
+    close(fd);
+}
+
+void ControlSocket::handle_client(int fd, uint32_t events) {
+    char buf[512];
+    std::string &pending = clients_[fd];
+
+    for (;;) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n > 0) {
+            pending.append(buf, static_cast<size_t>(n));
+            continue;
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+            events |= EPOLLHUP;
+        }
+        break;
+    }
+
+    size_t nl;
+    while ((nl = pending.find('\n')) != std::string::npos) {
+        std::string line = pending.substr(0, nl);
+        pending.erase(0, nl + 1);
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line == "quit") {
+            close_client(fd);
+            return;
+        }
+
+        bool ok = true;
+        std::string reply = handler_(line, ok);
+        if (!reply.empty() && reply.back() != '\n')
+            reply += '\n';
+        reply += ok ? "ok\n" : "error\n";
+        // Replies are small; a client that doesn't read gets dropped
+        if (send(fd, reply.data(), reply.size(), MSG_NOSIGNAL | MSG_DONTWAIT) !=
+            static_cast<ssize_t>(reply.size())) {
+            close_client(fd);
+            return;
+        }
+    }
+
+    if (pending.size() > kMaxLine || (events & (EPOLLHUP | EPOLLRDHUP | EPOLLERR)))
+        close_client(fd);
+}
+
+} // namespace radxa
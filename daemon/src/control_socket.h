@@ -0,0 +1,36 @@
+// Local control socket: line-based commands over a SOCK_STREAM UNIX socket.
+// Each command line gets its reply text followed by an "ok" or "error" line.
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+#include "event_loop.h"
+
+namespace radxa {
+
+class ControlSocket {
+public:
+    // Returns the reply body; set ok=false to report an error
+    using CommandHandler = std::function<std::string(const std::string &line, bool &ok)>;
+
+    ControlSocket(EventLoop &loop, CommandHandler handler);
+    ~ControlSocket();
+
+    bool listen(const std::string &path);
+
+private:
+    void accept_clients();
+    void handle_client(int fd, uint32_t events);
+    void close_client(int fd);
+
+    EventLoop &loop_;
+    CommandHandler handler_;
+    std::string path_;
+    int listen_fd_ = -1;
+    std::unordered_map<int, std::string> clients_;  // fd -> partial input
+};
+
+} // namespace radxa
@@ -0,0 +1,450 @@
+#include "daemon.h"
+
+#include <csignal>
+#include <cstdlib>
+#include <cstdio>
+#include <sstream>
+#include <unistd.h>
+
+#include "sd_notify.h"
+#include "sysfs.h"
+
+namespace radxa {
+
+namespace {
+
+// Kernel module behind each setting that can be tried speculatively
+const char *try_module(const std::string &key) {
+    if (key == "cpu")
+        return "cpu_overclock";
+    if (key == "ddr")
+        return "ram_overclock";
+    if (key == "llm")
+        return "llm_unified_overclock";
+    return nullptr;
+}
+
+} // namespace
+
+Daemon::Daemon(std::string config_path, Config config)
+    : config_path_(std::move(config_path)), config_(std::move(config)),
+      fan_(loop_, config_), telemetry_(config_) {}
+
+std::string Daemon::setting_path(const std::string &key) const {
+    if (key == "boost")
+        return config_.paths.cpufreq_boost;
+    if (key == "cpu")
+        return config_.paths.cpu_overclock + "/overclock";
+    if (key == "ddr")
+        return config_.paths.ram_overclock + "/ram_overclock";
+    if (key == "llm")
+        return config_.paths.npu_device + "/llm_overclock";
+    return std::string();
+}
+
+// try/commit/lkg/try_state: next to the control file, prefixed with llm_
+// on the NPU device like the rest of llm_unified_overclock's files
+std::string Daemon::try_path(const std::string &key, const std::string &file) const {
+    if (key == "cpu")
+        return config_.paths.cpu_overclock + "/" + file;
+    if (key == "ddr")
+        return config_.paths.ram_overclock + "/" + file;
+    if (key == "llm")
+        return config_.paths.npu_device + "/llm_" + file;
+    return std::string();
+}
+
+// What cpu_overclock actually set, "E,P" in MHz like the setting. Under
+// cpufreq it rounds a rate between operating points down to one.
+std::string Daemon::applied_cpu() const {
+    std::string out;
+
+    for (const char *cluster : { "efficiency", "performance" }) {
+        SysfsFile file(config_.paths.cpu_overclock + "/" + cluster + "/target_freq_hz");
+        long hz = 0;
+
+        if (!file.ok() || !file.read_long(hz))
+            return std::string();
+        out += (out.empty() ? "" : ",") + std::to_string(hz / 1000000);
+    }
+    return out;
+}
+
+bool Daemon::apply_setting(const std::string &key, const std::string &value) {
+    if (key == "fan") {
+        if (value == "auto") {
+            fan_.set_auto();
+            return true;
+        }
+        return fan_.set_manual(std::atoi(value.c_str()));
+    }
+    if (!sysfs_write(setting_path(key), value))
+        return false;
+    if (key == "cpu")
+        fprintf(stderr, "radxa-perfd: cpu %s applied as %s\n", value.c_str(), applied_cpu().c_str());
+    return true;
+}
+
+bool Daemon::apply_profile(const std::string &name, std::string &error) {
+    const Profile *profile = config_.find_profile(name);
+
+    if (!profile) {
+        error = "unknown profile " + name;
+        return false;
+    }
+
+    // Settings are applied in config order; keep going on errors so a
+    // missing module does not leave the remaining domains untouched
+    bool ok = true;
+    for (const auto &setting : profile->settings) {
+        if (!apply_setting(setting.first, setting.second)) {
+            error += setting.first + " ";
+            ok = false;
+        }
+    }
+
+    active_profile_ = name;
+    sd_notify(("STATUS=profile " + name).c_str());
+    fprintf(stderr, "radxa-perfd: applied profile %s%s\n", name.c_str(), ok ? "" : " (partially)");
+    if (!ok)
+        error = "failed to apply: " + error;
+    return ok;
+}
+
+// Speculative profile: the overclock modules apply it through their "try"
+// files and revert on their own unless "commit" follows in time. The
+// watchdog stays armed meanwhile, so a hang resets the board and the
+// modules come back up with the last-known-good setting from lkg_file.
+bool Daemon::try_profile(const std::string &name, unsigned timeout_s, std::string &error) {
+    const Profile *profile = config_.find_profile(name);
+
+    if (!profile) {
+        error = "unknown profile " + name;
+        return false;
+    }
+    if (!try_profile_.empty()) {
+        error = "profile " + try_profile_ + " is still being tried, commit it first";
+        return false;
+    }
+
+    // Armed before anything changes
+    unsigned wd_s = watchdog_.arm(config_.paths.watchdog, config_.try_.watchdog_timeout_s);
+    if (wd_s)
+        loop_.set_timer(watchdog_timer_, wd_s * 1000 / 2);
+    else
+        fprintf(stderr, "radxa-perfd: no hardware watchdog, a hang during the try needs a power cycle\n");
+
+    bool ok = true;
+    for (const auto &setting : profile->settings) {
+        const char *module = try_module(setting.first);
+
+        // boost and fan are not overclocks, they need no safety net
+        if (!module) {
+            if (!apply_setting(setting.first, setting.second)) {
+                error += setting.first + " ";
+                ok = false;
+            }
+            continue;
+        }
+        sysfs_write(std::string("/sys/module/") + module + "/parameters/try_timeout_s",
+                    std::to_string(timeout_s));
+        if (sysfs_write(try_path(setting.first, "try"), setting.second)) {
+            try_keys_.push_back(setting.first);
+            if (setting.first == "cpu")
+                fprintf(stderr, "radxa-perfd: trying cpu %s as %s\n", setting.second.c_str(),
+                        applied_cpu().c_str());
+        } else {
+            error += setting.first + " ";
+            ok = false;
+        }
+    }
+
+    if (try_keys_.empty()) {
+        end_try();
+        error = ok ? "profile " + name + " has no cpu, ddr or llm setting"
+                   : "failed to apply: " + error;
+        return false;
+    }
+
+    try_profile_ = name;
+    // The modules revert by themselves; this only disarms after them
+    loop_.set_oneshot(try_timer_, timeout_s * 1000 + 1000);
+    sd_notify(("STATUS=trying profile " + name).c_str());
+    fprintf(stderr, "radxa-perfd: trying profile %s for %us%s\n", name.c_str(), timeout_s,
+            ok ? "" : " (partially)");
+    if (!ok)
+        error = "failed to apply: " + error;
+    return ok;
+}
+
+bool Daemon::commit_try(std::string &error) {
+    bool ok = true;
+
+    if (try_profile_.empty()) {
+        error = "nothing to commit";
+        return false;
+    }
+
+    for (const auto &key : try_keys_) {
+        if (!sysfs_write(try_path(key, "commit"), "1")) {
+            error += key + " ";
+            ok = false;
+        }
+    }
+
+    if (!ok) {
+        error = "commit failed (already reverted?): " + error;
+    } else {
+        active_profile_ = try_profile_;
+        sd_notify(("STATUS=profile " + active_profile_).c_str());
+        fprintf(stderr, "radxa-perfd: committed profile %s\n", active_profile_.c_str());
+        if (!write_lkg_file()) {
+            error = "committed, but " + config_.paths.lkg_file + " was not written";
+            ok = false;
+        }
+    }
+    end_try();
+    return ok;
+}
+
+void Daemon::end_try() {
+    watchdog_.disarm();
+    loop_.set_timer(watchdog_timer_, 0);
+    loop_.set_oneshot(try_timer_, 0);
+    try_profile_.clear();
+    try_keys_.clear();
+}
+
+// modprobe options with every module's committed setting, written
+// atomically so a reset mid-write leaves the previous file
+bool Daemon::write_lkg_file() {
+    const std::string &path = config_.paths.lkg_file;
+    std::string tmp = path + ".tmp";
+    FILE *f = fopen(tmp.c_str(), "w");
+
+    if (!f) {
+        perror(("radxa-perfd: " + tmp).c_str());
+        return false;
+    }
+
+    fprintf(f, "# Last-known-good overclock settings, written by radxa-perfd on commit\n");
+    for (const char *key : { "cpu", "ddr", "llm" }) {
+        SysfsFile lkg(try_path(key, "lkg"));
+        std::string value;
+
+        if (lkg.ok() && lkg.read(value) && !value.empty())
+            fprintf(f, "options %s lkg=%s\n", try_module(key), value.c_str());
+    }
+
+    bool ok = fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), path.c_str()) < 0) {
+        perror(("radxa-perfd: " + path).c_str());
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::string Daemon::status() {
+    std::ostringstream out;
+
+    out << "profile " << (active_profile_.empty() ? "-" : active_profile_) << "\n";
+    if (!try_profile_.empty())
+        out << "try " << try_profile_ << " pending" << (watchdog_.armed() ? " watchdog" : "") << "\n";
+    out << "fan " << (fan_.automatic() ? "auto" : "manual") << " pwm=" << fan_.pwm()
+        << " temp_mc=" << fan_.temp_mc() << "\n";
+    if (workload_) {
+        const WorkloadRule *rule = workload_->active();
+        out << "workload " << (rule ? rule->name : "idle") << " tracked=" << workload_->tracked() << "\n";
+    } else {
+        out << "workload off\n";
+    }
+    out << telemetry_.format_status(telemetry_.collect());
+    return out.str();
+}
+
+std::string Daemon::handle_command(const std::string &line, bool &ok) {
+    std::istringstream in(line);
+    std::string cmd, arg;
+
+    in >> cmd >> arg;
+    if (cmd == "status") {
+        return status();
+    } else if (cmd == "profiles") {
+        std::string out;
+        for (const auto &p : config_.profiles)
+            out += p.name + "\n";
+        return out;
+    } else if (cmd == "profile") {
+        std::string error;
+        ok = apply_profile(arg, error);
+        return error;
+    } else if (cmd == "try") {
+        unsigned timeout_s = config_.try_.timeout_s;
+        std::string seconds, error;
+        if (in >> seconds) {
+            char *end;
+            unsigned long v = strtoul(seconds.c_str(), &end, 10);
+            if (*end != '\0' || v == 0) {
+                ok = false;
+                return "usage: try NAME [SECONDS]";
+            }
+            timeout_s = static_cast<unsigned>(v);
+        }
+        ok = try_profile(arg, timeout_s, error);
+        return error;
+    } else if (cmd == "commit") {
+        std::string error;
+        ok = commit_try(error);
+        return error;
+    } else if (cmd == "fan") {
+        if (arg == "auto") {
+            fan_.set_auto();
+            return std::string();
+        }
+        char *end;
+        long pwm = strtol(arg.c_str(), &end, 10);
+        ok = !arg.empty() && *end == '\0' && fan_.set_manual(static_cast<int>(pwm));
+        return ok ? std::string() : "usage: fan auto|0-255";
+    } else if (cmd == "workload") {
+        if (arg == "off") {
+            workload_.reset();
+            return std::string();
+        }
+        if (arg == "on") {
+            ok = workload_ || start_workload();
+            return ok ? std::string() : "proc connector unavailable (needs CAP_NET_ADMIN)";
+        }
+        ok = false;
+        return "usage: workload on|off";
+    } else if (cmd == "reload") {
+        reload();
+        return std::string();
+    }
+
+    ok = false;
+    return "commands: status, profiles, profile NAME, try NAME [SECONDS], commit, fan auto|PWM, "
+           "workload on|off, reload, quit";
+}
+
+void Daemon::export_telemetry() {
+    if (config_.telemetry_file.empty())
+        return;
+    telemetry_.write_textfile(config_.telemetry_file, telemetry_.collect(),
+                              active_profile_, fan_.pwm(), fan_.temp_mc());
+}
+
+void Daemon::on_workload(const WorkloadRule *rule) {
+    std::string name, error;
+
+    if (rule) {
+        name = rule->profile;
+        fprintf(stderr, "radxa-perfd: workload %s started\n", rule->name.c_str());
+    } else {
+        name = config_.workload.idle_profile.empty() ? config_.default_profile
+                                                     : config_.workload.idle_profile;
+        fprintf(stderr, "radxa-perfd: workload finished\n");
+    }
+    if (name.empty() || name == active_profile_)
+        return;
+    if (!apply_profile(name, error))
+        fprintf(stderr, "radxa-perfd: %s\n", error.c_str());
+}
+
+bool Daemon::start_workload() {
+    if (config_.rules.empty())
+        return false;
+
+    workload_ = std::make_unique<ProcWatcher>(loop_, [this](const WorkloadRule *rule) {
+        on_workload(rule);
+    });
+    if (!workload_->start(config_.rules, config_.workload.revert_delay_ms)) {
+        workload_.reset();
+        return false;
+    }
+    return true;
+}
+
+void Daemon::reload() {
+    Config fresh;
+    std::string error;
+
+    sd_notify("RELOADING=1");
+    if (!load_config(config_path_, fresh, error)) {
+        fprintf(stderr, "radxa-perfd: reload failed, keeping old config: %s\n", error.c_str());
+    } else {
+        // Paths, socket and telemetry period need a restart; the rest is live
+        config_.profiles = fresh.profiles;
+        config_.default_profile = fresh.default_profile;
+        config_.telemetry_file = fresh.telemetry_file;
+        config_.fan = fresh.fan;
+        fan_.reconfigure(config_.fan);
+        config_.try_ = fresh.try_;
+        config_.workload = fresh.workload;
+        config_.rules = fresh.rules;
+        workload_.reset();
+        if (config_.workload.enabled)
+            start_workload();
+        fprintf(stderr, "radxa-perfd: configuration reloaded\n");
+    }
+    sd_notify("READY=1");
+}
+
+int Daemon::run() {
+    if (!loop_.ok())
+        return 1;
+
+    loop_.add_signals({ SIGTERM, SIGINT, SIGHUP }, [this](int sig) {
+        if (sig == SIGHUP)
+            reload();
+        else
+            loop_.stop();
+    });
+
+    if (!fan_.start())
+        fprintf(stderr, "radxa-perfd: fan policy disabled\n");
+
+    try_timer_ = loop_.add_timer(0, [this]() {
+        fprintf(stderr, "radxa-perfd: profile %s not committed, reverted\n", try_profile_.c_str());
+        end_try();
+        sd_notify(("STATUS=profile " + active_profile_).c_str());
+    });
+    watchdog_timer_ = loop_.add_timer(0, [this]() { watchdog_.ping(); });
+
+    control_ = std::make_unique<ControlSocket>(loop_, [this](const std::string &line, bool &ok) {
+        return handle_command(line, ok);
+    });
+    if (!control_->listen(config_.socket_path))
+        return 1;
+
+    if (!config_.default_profile.empty()) {
+        std::string error;
+        if (!apply_profile(config_.default_profile, error))
+            fprintf(stderr, "radxa-perfd: %s\n", error.c_str());
+    }
+
+    // After the default profile so a workload already running wins
+    if (config_.workload.enabled && !start_workload())
+        fprintf(stderr, "radxa-perfd: workload switching disabled\n");
+
+    if (!config_.telemetry_file.empty())
+        loop_.add_timer(config_.telemetry_interval_ms, [this]() { export_telemetry(); });
+
+    unsigned wd_ms = sd_watchdog_interval_ms();
+    if (wd_ms)
+        loop_.add_timer(wd_ms, []() { sd_notify("WATCHDOG=1"); });
+
+    sd_notify("READY=1");
+    int ret = loop_.run();
+
+    sd_notify("STOPPING=1");
+    // A pending try still reverts in the kernel, only the watchdog goes
+    end_try();
+    workload_.reset();
+    fan_.shutdown();
+    control_.reset();
+    return ret;
+}
+
+} // namespace radxa
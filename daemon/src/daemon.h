@@ -0,0 +1,62 @@
+// radxa-perfd: owns profile application, fan policy, workload-driven
+// profile switching, speculative profiles and telemetry export
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "control_socket.h"
+#include "event_loop.h"
+#include "fan_policy.h"
+#include "hw_watchdog.h"
+#include "proc_watcher.h"
+#include "telemetry.h"
+
+namespace radxa {
+
+class Daemon {
+public:
+    Daemon(std::string config_path, Config config);
+
+    int run();
+
+    bool apply_profile(const std::string &name, std::string &error);
+    bool apply_setting(const std::string &key, const std::string &value);
+    const std::string &active_profile() const { return active_profile_; }
+
+private:
+    std::string handle_command(const std::string &line, bool &ok);
+    std::string status();
+    void export_telemetry();
+    void reload();
+    bool start_workload();
+    void on_workload(const WorkloadRule *rule);
+    std::string setting_path(const std::string &key) const;
+    std::string try_path(const std::string &key, const std::string &file) const;
+    std::string applied_cpu() const;
+    bool try_profile(const std::string &name, unsigned timeout_s, std::string &error);
+    bool commit_try(std::string &error);
+    void end_try();
+    bool write_lkg_file();
+
+    std::string config_path_;
+    Config config_;
+    EventLoop loop_;
+    FanPolicy fan_;
+    Telemetry telemetry_;
+    std::unique_ptr<ControlSocket> control_;
+    std::unique_ptr<ProcWatcher> workload_;
+    std::string active_profile_;
+
+    // Pending "try": profile, the domains written speculatively, timers
+    HwWatchdog watchdog_;
+    std::string try_profile_;
+    std::vector<std::string> try_keys_;
+    int try_timer_ = -1;
+    int watchdog_timer_ = -1;
+};
+
+} // namespace radxa
@@ -0,0 +1,138 @@
+#include "event_loop.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace radxa {
+
+EventLoop::EventLoop() {
+    epfd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd_ < 0)
+        perror("radxa-perfd: epoll_create1");
+}
+
+EventLoop::~EventLoop() {
+    for (int fd : owned_fds_)
+        close(fd);
+    if (epfd_ >= 0)
+        close(epfd_);
+}
+
+bool EventLoop::add(int fd, uint32_t events, Handler handler) {
+    struct epoll_event ev = {};
+    ev.events = events;
+    ev.data.fd = fd;
+
+    if (epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        fprintf(stderr, "radxa-perfd: epoll_ctl(%d): %s\n", fd, strerror(errno));
+        return false;
+    }
+    handlers_[fd] = std::move(handler);
+    return true;
+}
+
+void EventLoop::remove(int fd) {
+    epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+    handlers_.erase(fd);
+}
+
+int EventLoop::add_timer(unsigned interval_ms, std::function<void()> cb) {
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (tfd < 0) {
+        perror("radxa-perfd: timerfd_create");
+        return -1;
+    }
+
+    owned_fds_.push_back(tfd);
+    set_timer(tfd, interval_ms);
+    add(tfd, EPOLLIN, [tfd, cb = std::move(cb)](uint32_t) {
+        uint64_t expirations;
+        if (read(tfd, &expirations, sizeof(expirations)) == sizeof(expirations))
+            cb();
+    });
+    return tfd;
+}
+
+void EventLoop::set_timer(int tfd, unsigned interval_ms) {
+    struct itimerspec its = {};
+
+    its.it_interval.tv_sec = interval_ms / 1000;
+    its.it_interval.tv_nsec = (interval_ms % 1000) * 1000000L;
+    its.it_value = its.it_interval;
+    timerfd_settime(tfd, 0, &its, nullptr);
+}
+
+void EventLoop::set_oneshot(int tfd, unsigned delay_ms) {
+    struct itimerspec its = {};
+
+    its.it_value.tv_sec = delay_ms / 1000;
+    its.it_value.tv_nsec = (delay_ms % 1000) * 1000000L;
+    timerfd_settime(tfd, 0, &its, nullptr);
+}
+
+void EventLoop::remove_timer(int tfd) {
+    auto it = std::find(owned_fds_.begin(), owned_fds_.end(), tfd);
+
+    if (it == owned_fds_.end())
+        return;
+    remove(tfd);
+    owned_fds_.erase(it);
+    close(tfd);
+}
+
+bool EventLoop::add_signals(std::initializer_list<int> sigs, std::function<void(int)> cb) {
+    sigset_t mask;
+
+    sigemptyset(&mask);
+    for (int sig : sigs)
+        sigaddset(&mask, sig);
+    if (sigprocmask(SIG_BLOCK, &mask, nullptr) < 0)
+        return false;
+
+    int sfd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (sfd < 0) {
+        perror("radxa-perfd: signalfd");
+        return false;
+    }
+
+    owned_fds_.push_back(sfd);
+    return add(sfd, EPOLLIN, [sfd, cb = std::move(cb)](uint32_t) {
+        struct signalfd_siginfo si;
+        while (read(sfd, &si, sizeof(si)) == sizeof(si))
+            cb(static_cast<int>(si.ssi_signo));
+    });
+}
+
+int EventLoop::run() {
+    struct epoll_event events[16];
+
+    running_ = true;
+    while (running_) {
+        int n = epoll_wait(epfd_, events, 16, -1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("radxa-perfd: epoll_wait");
+            return -1;
+        }
+
+        for (int i = 0; i < n && running_; i++) {
+            // Handlers may remove fds, so look each one up at dispatch time
+            auto it = handlers_.find(events[i].data.fd);
+            if (it == handlers_.end())
+                continue;
+            Handler handler = it->second;
+            handler(events[i].events);
+        }
+    }
+    return 0;
+}
+
+} // namespace radxa
@@ -0,0 +1,51 @@
+// Minimal epoll event loop: fds, periodic timers (timerfd) and signals
+// (signalfd) all dispatched from one thread that sleeps in epoll_wait().
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <unordered_map>
+#include <vector>
+
+namespace radxa {
+
+class EventLoop {
+public:
+    using Handler = std::function<void(uint32_t events)>;
+
+    EventLoop();
+    ~EventLoop();
+    EventLoop(const EventLoop &) = delete;
+    EventLoop &operator=(const EventLoop &) = delete;
+
+    bool ok() const { return epfd_ >= 0; }
+
+    // Watch a caller-owned fd
+    bool add(int fd, uint32_t events, Handler handler);
+    void remove(int fd);
+
+    // Periodic timer (interval 0: created disarmed); the returned timerfd
+    // is owned by the loop
+    int add_timer(unsigned interval_ms, std::function<void()> cb);
+    void set_timer(int tfd, unsigned interval_ms);
+    // Fire once after delay_ms (0 disarms)
+    void set_oneshot(int tfd, unsigned delay_ms);
+    // Stop watching a timer from add_timer() and close it
+    void remove_timer(int tfd);
+
+    // Blocks the signals and delivers them through a signalfd
+    bool add_signals(std::initializer_list<int> sigs, std::function<void(int)> cb);
+
+    int run();
+    void stop() { running_ = false; }
+
+private:
+    int epfd_ = -1;
+    bool running_ = false;
+    std::unordered_map<int, Handler> handlers_;
+    std::vector<int> owned_fds_;
+};
+
+} // namespace radxa
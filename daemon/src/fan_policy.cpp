@@ -0,0 +1,108 @@
+#include "fan_policy.h"
+
+#include <cstdio>
+#include <sys/epoll.h>
+
+namespace radxa {
+
+FanPolicy::FanPolicy(EventLoop &loop, const Config &config)
+    : loop_(loop), paths_(config.paths), fan_(config.fan), automatic_(config.fan.automatic) {}
+
+bool FanPolicy::start() {
+    std::string module_temp = paths_.fan_control + "/temperature_mc";
+
+    use_module_ = sysfs_exists(module_temp);
+    temp_file_ = SysfsFile(use_module_ ? module_temp : paths_.temperature);
+    if (!temp_file_.ok()) {
+        fprintf(stderr, "radxa-perfd: no temperature source (%s)\n", temp_file_.path().c_str());
+        return false;
+    }
+
+    if (use_module_) {
+        // fan_control notifies on every 1°C step: sleep until it does
+        read_temperature();
+        loop_.add(temp_file_.fd(), EPOLLPRI | EPOLLERR, [this](uint32_t) { update(); });
+    } else {
+        loop_.add_timer(fan_.poll_ms, [this]() { update(); });
+    }
+
+    if (automatic_)
+        update();
+    else
+        write_pwm(fan_.manual_pwm);
+    return true;
+}
+
+bool FanPolicy::read_temperature() {
+    long value;
+
+    if (!temp_file_.read_long(value))
+        return false;
+    temp_mc_ = static_cast<int>(value);
+    return true;
+}
+
+int FanPolicy::level_for(int temp_c) const {
+    int level = 0;
+
+    for (size_t i = 0; i < fan_.curve.size(); i++)
+        if (temp_c >= fan_.curve[i].temp_c)
+            level = static_cast<int>(i);
+    return level;
+}
+
+void FanPolicy::update() {
+    if (!read_temperature() || !automatic_ || fan_.curve.empty())
+        return;
+
+    int temp_c = temp_mc_ / 1000;
+    int level = level_for(temp_c);
+
+    // Step down only once we are hysteresis below the current step
+    if (level_ >= 0 && level < level_ &&
+        temp_c > fan_.curve[level_].temp_c - fan_.hysteresis_c)
+        return;
+
+    if (level != level_) {
+        level_ = level;
+        write_pwm(fan_.curve[level].pwm);
+    }
+}
+
+bool FanPolicy::write_pwm(int pwm) {
+    if (pwm == pwm_)
+        return true;
+
+    bool ok = use_module_ ? sysfs_write(paths_.fan_control + "/fan_speed", std::to_string(pwm))
+                          : sysfs_write(paths_.fan_pwm, std::to_string(pwm));
+    if (ok)
+        pwm_ = pwm;
+    return ok;
+}
+
+void FanPolicy::set_auto() {
+    automatic_ = true;
+    level_ = -1;
+    update();
+}
+
+bool FanPolicy::set_manual(int pwm) {
+    if (pwm < 0 || pwm > 255)
+        return false;
+    automatic_ = false;
+    return write_pwm(pwm);
+}
+
+// The board may stay overclocked after we exit: leave the fan to
+// fan_control's thermal mode, or at full speed when nothing else would
+// follow the temperature
+void FanPolicy::shutdown() {
+    automatic_ = false;
+    if (fan_.shutdown_auto && use_module_) {
+        sysfs_write(paths_.fan_control + "/fan_speed", "thermal");
+        return;
+    }
+    write_pwm(fan_.shutdown_auto ? 255 : fan_.shutdown_pwm);
+}
+
+} // namespace radxa
@@ -0,0 +1,44 @@
+// Fan policy: temperature curve with hysteresis, driven by fan_control's
+// temperature_mc notifications (or a slow timer when the module is absent).
+
+#pragma once
+
+#include "config.h"
+#include "event_loop.h"
+#include "sysfs.h"
+
+namespace radxa {
+
+class FanPolicy {
+public:
+    FanPolicy(EventLoop &loop, const Config &config);
+
+    bool start();
+    void reconfigure(const FanConfig &fan) { fan_ = fan; level_ = -1; update(); }
+
+    void set_auto();
+    bool set_manual(int pwm);
+    void shutdown();
+
+    bool automatic() const { return automatic_; }
+    int pwm() const { return pwm_; }
+    int temp_mc() const { return temp_mc_; }
+
+private:
+    void update();
+    bool read_temperature();
+    bool write_pwm(int pwm);
+    int level_for(int temp_c) const;
+
+    EventLoop &loop_;
+    Paths paths_;
+    FanConfig fan_;
+    SysfsFile temp_file_;
+    bool use_module_ = false;
+    bool automatic_ = true;
+    int level_ = -1;
+    int pwm_ = -1;
+    int temp_mc_ = 0;
+};
+
+} // namespace radxa
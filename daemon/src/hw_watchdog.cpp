@@ -0,0 +1,45 @@
+#include "hw_watchdog.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/watchdog.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace radxa {
+
+unsigned HwWatchdog::arm(const std::string &path, unsigned timeout_s) {
+    int timeout = static_cast<int>(timeout_s);
+
+    if (fd_ >= 0)
+        disarm();
+
+    // Fails with EBUSY if systemd's RuntimeWatchdogSec already owns it
+    fd_ = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd_ < 0) {
+        fprintf(stderr, "radxa-perfd: open %s: %s\n", path.c_str(), strerror(errno));
+        return 0;
+    }
+    if (ioctl(fd_, WDIOC_SETTIMEOUT, &timeout) < 0)
+        ioctl(fd_, WDIOC_GETTIMEOUT, &timeout);
+    ping();
+    return timeout > 0 ? static_cast<unsigned>(timeout) : timeout_s;
+}
+
+void HwWatchdog::ping() {
+    if (fd_ >= 0)
+        ioctl(fd_, WDIOC_KEEPALIVE, 0);
+}
+
+void HwWatchdog::disarm() {
+    if (fd_ < 0)
+        return;
+    if (write(fd_, "V", 1) != 1)
+        fprintf(stderr, "radxa-perfd: watchdog magic close failed, board may reset\n");
+    close(fd_);
+    fd_ = -1;
+}
+
+} // namespace radxa
@@ -0,0 +1,30 @@
+// Hardware watchdog (/dev/watchdog) held open while a speculative
+// overclock is pending: if the board hangs the pings stop and it resets.
+
+#pragma once
+
+#include <string>
+
+namespace radxa {
+
+class HwWatchdog {
+public:
+    HwWatchdog() = default;
+    ~HwWatchdog() { disarm(); }
+    HwWatchdog(const HwWatchdog &) = delete;
+    HwWatchdog &operator=(const HwWatchdog &) = delete;
+
+    // Opening the device starts the countdown; returns the timeout the
+    // driver actually uses (it may round), 0 on failure
+    unsigned arm(const std::string &path, unsigned timeout_s);
+    void ping();
+    // Magic close: stops the watchdog instead of letting it fire
+    void disarm();
+
+    bool armed() const { return fd_ >= 0; }
+
+private:
+    int fd_ = -1;
+};
+
+} // namespace radxa
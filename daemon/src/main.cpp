@@ -0,0 +1,40 @@
+// radxa-perfd - event-driven performance/fan control daemon
+//
+// Replaces the polling bash loops (fan_control.sh, performance_control.sh)
+// with a single process that sleeps in epoll_wait() until a module event,
+// a timer or a control-socket command arrives.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "config.h"
+#include "daemon.h"
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-c CONFIG]\n"
+                    "  -c CONFIG   configuration file (default /etc/radxa-perfd.conf)\n", prog);
+}
+
+int main(int argc, char **argv) {
+    std::string config_path = "/etc/radxa-perfd.conf";
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+            config_path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    radxa::Config config;
+    std::string error;
+    if (!radxa::load_config(config_path, config, error)) {
+        fprintf(stderr, "radxa-perfd: %s\n", error.c_str());
+        return 1;
+    }
+
+    radxa::Daemon daemon(config_path, config);
+    return daemon.run();
+}
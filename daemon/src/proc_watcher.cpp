@@ -0,0 +1,268 @@
+#include "proc_watcher.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace radxa {
+
+namespace {
+
+// Small /proc reads: no iostreams, one open/read/close each
+bool read_proc(pid_t pid, const char *file, std::string &out, size_t max = 4096) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/%s", static_cast<int>(pid), file);
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    out.resize(max);
+    ssize_t n = read(fd, &out[0], max);
+    close(fd);
+    if (n < 0)
+        return false;
+    out.resize(static_cast<size_t>(n));
+    while (!out.empty() && out.back() == '\n')
+        out.pop_back();
+    return true;
+}
+
+std::string exe_basename(pid_t pid) {
+    char path[64], target[512];
+    snprintf(path, sizeof(path), "/proc/%d/exe", static_cast<int>(pid));
+
+    ssize_t n = readlink(path, target, sizeof(target) - 1);
+    if (n <= 0)
+        return std::string();
+    target[n] = '\0';
+    const char *slash = strrchr(target, '/');
+    return slash ? slash + 1 : target;
+}
+
+} // namespace
+
+ProcWatcher::ProcWatcher(EventLoop &loop, ChangeHandler handler)
+    : loop_(loop), handler_(std::move(handler)) {}
+
+ProcWatcher::~ProcWatcher() {
+    if (revert_timer_ >= 0)
+        loop_.remove_timer(revert_timer_);
+    if (sock_ >= 0) {
+        loop_.remove(sock_);
+        close(sock_);
+    }
+}
+
+bool ProcWatcher::start(const std::vector<WorkloadRule> &rules, unsigned revert_delay_ms) {
+    struct sockaddr_nl sa = {};
+
+    rules_ = rules;
+    revert_delay_ms_ = revert_delay_ms;
+
+    // Needs CAP_NET_ADMIN
+    sock_ = socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+    if (sock_ < 0) {
+        perror("radxa-perfd: proc connector socket");
+        return false;
+    }
+
+    sa.nl_family = AF_NETLINK;
+    sa.nl_groups = CN_IDX_PROC;
+    sa.nl_pid = 0;
+    if (bind(sock_, reinterpret_cast<struct sockaddr *>(&sa), sizeof(sa)) < 0) {
+        perror("radxa-perfd: proc connector bind");
+        close(sock_);
+        sock_ = -1;
+        return false;
+    }
+
+    // nlmsghdr + cn_msg + op; cn_msg ends in a flexible array, so lay it out by hand
+    alignas(struct nlmsghdr) char msg[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op))];
+    auto *nlh = reinterpret_cast<struct nlmsghdr *>(msg);
+    auto *cn = static_cast<struct cn_msg *>(NLMSG_DATA(nlh));
+    enum proc_cn_mcast_op op = PROC_CN_MCAST_LISTEN;
+
+    memset(msg, 0, sizeof(msg));
+    nlh->nlmsg_len = NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(op));
+    nlh->nlmsg_pid = static_cast<__u32>(getpid());
+    nlh->nlmsg_type = NLMSG_DONE;
+    cn->id.idx = CN_IDX_PROC;
+    cn->id.val = CN_VAL_PROC;
+    cn->len = sizeof(op);
+    memcpy(cn->data, &op, sizeof(op));
+    if (send(sock_, msg, nlh->nlmsg_len, 0) < 0) {
+        perror("radxa-perfd: proc connector subscribe");
+        close(sock_);
+        sock_ = -1;
+        return false;
+    }
+
+    revert_timer_ = loop_.add_timer(0, [this]() {
+        if (tracked_.empty() && active_) {
+            active_ = nullptr;
+            handler_(nullptr);
+        }
+    });
+    loop_.add(sock_, EPOLLIN, [this](uint32_t) { handle_events(); });
+
+    // Workloads that were already running before we started
+    rescan();
+    return true;
+}
+
+int ProcWatcher::match(pid_t pid) const {
+    std::string comm, exe, cmdline, cgroup;
+    bool have_comm = false, have_exe = false, have_cmdline = false, have_cgroup = false;
+
+    for (size_t i = 0; i < rules_.size(); i++) {
+        const WorkloadRule &r = rules_[i];
+
+        if (!r.binary.empty()) {
+            if (!have_comm)
+                have_comm = read_proc(pid, "comm", comm, 64);
+            // comm is truncated to 15 chars, so also try the exe name
+            if (comm != r.binary && comm != r.binary.substr(0, 15)) {
+                if (!have_exe) {
+                    exe = exe_basename(pid);
+                    have_exe = true;
+                }
+                if (exe != r.binary)
+                    continue;
+            }
+        }
+        if (!r.cmdline.empty()) {
+            if (!have_cmdline) {
+                have_cmdline = read_proc(pid, "cmdline", cmdline);
+                for (auto &c : cmdline)
+                    if (c == '\0')
+                        c = ' ';
+            }
+            if (cmdline.find(r.cmdline) == std::string::npos)
+                continue;
+        }
+        if (!r.cgroup.empty()) {
+            if (!have_cgroup)
+                have_cgroup = read_proc(pid, "cgroup", cgroup);
+            if (cgroup.find(r.cgroup) == std::string::npos)
+                continue;
+        }
+        return static_cast<int>(i);
+    }
+    return -1;
+}
+
+void ProcWatcher::on_exec(pid_t pid) {
+    int rule = match(pid);
+
+    // An exec may also turn a tracked process into something else
+    if (rule < 0) {
+        if (tracked_.erase(pid))
+            reevaluate();
+        return;
+    }
+    tracked_[pid] = rule;
+    reevaluate();
+}
+
+void ProcWatcher::on_exit(pid_t pid) {
+    if (tracked_.erase(pid))
+        reevaluate();
+}
+
+void ProcWatcher::rescan() {
+    DIR *dir = opendir("/proc");
+    struct dirent *de;
+
+    tracked_.clear();
+    if (dir) {
+        while ((de = readdir(dir)) != nullptr) {
+            char *end;
+            long pid = strtol(de->d_name, &end, 10);
+            if (*end != '\0' || pid <= 0)
+                continue;
+            int rule = match(static_cast<pid_t>(pid));
+            if (rule >= 0)
+                tracked_[static_cast<pid_t>(pid)] = rule;
+        }
+        closedir(dir);
+    }
+    reevaluate();
+}
+
+void ProcWatcher::reevaluate() {
+    const WorkloadRule *best = nullptr;
+    int best_index = -1;
+
+    for (const auto &t : tracked_) {
+        const WorkloadRule &r = rules_[static_cast<size_t>(t.second)];
+        if (!best || r.priority > best->priority ||
+            (r.priority == best->priority && t.second < best_index)) {
+            best = &r;
+            best_index = t.second;
+        }
+    }
+
+    if (best) {
+        loop_.set_oneshot(revert_timer_, 0);
+        if (best != active_) {
+            active_ = best;
+            handler_(best);
+        }
+    } else if (active_) {
+        // Debounce: a server restarting should not bounce the clocks
+        if (revert_delay_ms_)
+            loop_.set_oneshot(revert_timer_, revert_delay_ms_);
+        else {
+            active_ = nullptr;
+            handler_(nullptr);
+        }
+    }
+}
+
+void ProcWatcher::handle_events() {
+    alignas(struct nlmsghdr) char buf[4096];
+
+    for (;;) {
+        ssize_t len = recv(sock_, buf, sizeof(buf), 0);
+        if (len < 0) {
+            if (errno == ENOBUFS) {
+                // Overrun: we lost events, rebuild state from /proc
+                rescan();
+                continue;
+            }
+            return;
+        }
+
+        for (struct nlmsghdr *nlh = reinterpret_cast<struct nlmsghdr *>(buf);
+             NLMSG_OK(nlh, static_cast<unsigned>(len)); nlh = NLMSG_NEXT(nlh, len)) {
+            if (nlh->nlmsg_type == NLMSG_NOOP || nlh->nlmsg_type == NLMSG_ERROR)
+                continue;
+
+            auto *cn = static_cast<struct cn_msg *>(NLMSG_DATA(nlh));
+            auto *ev = reinterpret_cast<struct proc_event *>(cn->data);
+
+            switch (ev->what) {
+            case proc_event::PROC_EVENT_EXEC:
+                on_exec(ev->event_data.exec.process_tgid);
+                break;
+            case proc_event::PROC_EVENT_EXIT:
+                // Thread exits are reported too; only the leader ends the process
+                if (ev->event_data.exit.process_pid == ev->event_data.exit.process_tgid)
+                    on_exit(ev->event_data.exit.process_tgid);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
+
+} // namespace radxa
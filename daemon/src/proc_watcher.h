@@ -0,0 +1,48 @@
+// Workload watcher: subscribes to exec/exit events from the netlink proc
+// connector and reports which workload rule (if any) should be in effect.
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <sys/types.h>
+#include <unordered_map>
+#include <vector>
+
+#include "config.h"
+#include "event_loop.h"
+
+namespace radxa {
+
+class ProcWatcher {
+public:
+    // Called with the winning rule, or nullptr when no workload is running
+    using ChangeHandler = std::function<void(const WorkloadRule *rule)>;
+
+    ProcWatcher(EventLoop &loop, ChangeHandler handler);
+    ~ProcWatcher();
+
+    bool start(const std::vector<WorkloadRule> &rules, unsigned revert_delay_ms);
+
+    const WorkloadRule *active() const { return active_; }
+    size_t tracked() const { return tracked_.size(); }
+
+private:
+    void handle_events();
+    void on_exec(pid_t pid);
+    void on_exit(pid_t pid);
+    void rescan();
+    void reevaluate();
+    int match(pid_t pid) const;
+
+    EventLoop &loop_;
+    ChangeHandler handler_;
+    std::vector<WorkloadRule> rules_;
+    unsigned revert_delay_ms_ = 0;
+    int sock_ = -1;
+    int revert_timer_ = -1;
+    std::unordered_map<pid_t, int> tracked_;    // pid -> rule index
+    const WorkloadRule *active_ = nullptr;
+};
+
+} // namespace radxa
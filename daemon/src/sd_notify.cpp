@@ -0,0 +1,48 @@
+#include "sd_notify.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <stddef.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace radxa {
+
+void sd_notify(const char *state) {
+    const char *path = getenv("NOTIFY_SOCKET");
+    struct sockaddr_un addr = {};
+    size_t len;
+
+    if (!path || !*path)
+        return;
+    len = strlen(path);
+    if (len >= sizeof(addr.sun_path))
+        return;
+
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path, len);
+    if (addr.sun_path[0] == '@')    // Abstract namespace
+        addr.sun_path[0] = '\0';
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return;
+    sendto(fd, state, strlen(state), MSG_NOSIGNAL,
+           reinterpret_cast<struct sockaddr *>(&addr),
+           static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + len));
+    close(fd);
+}
+
+unsigned sd_watchdog_interval_ms() {
+    const char *usec = getenv("WATCHDOG_USEC");
+    const char *pid = getenv("WATCHDOG_PID");
+
+    if (!usec)
+        return 0;
+    if (pid && strtol(pid, nullptr, 10) != getpid())
+        return 0;
+    return static_cast<unsigned>(strtoull(usec, nullptr, 10) / 2000);
+}
+
+} // namespace radxa
@@ -0,0 +1,14 @@
+// systemd readiness/watchdog notification without linking libsystemd
+
+#pragma once
+
+namespace radxa {
+
+// Sends a state string ("READY=1", "STATUS=...") to $NOTIFY_SOCKET.
+// No-op when not started by systemd.
+void sd_notify(const char *state);
+
+// Half of $WATCHDOG_USEC in ms, or 0 when the watchdog is not enabled
+unsigned sd_watchdog_interval_ms();
+
+} // namespace radxa
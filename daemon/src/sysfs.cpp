@@ -0,0 +1,87 @@
+#include "sysfs.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace radxa {
+
+SysfsFile::SysfsFile(const std::string &path) : path_(path) {
+    fd_ = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+}
+
+SysfsFile::~SysfsFile() {
+    if (fd_ >= 0)
+        close(fd_);
+}
+
+SysfsFile::SysfsFile(SysfsFile &&other) noexcept : path_(std::move(other.path_)), fd_(other.fd_) {
+    other.fd_ = -1;
+}
+
+SysfsFile &SysfsFile::operator=(SysfsFile &&other) noexcept {
+    if (this != &other) {
+        if (fd_ >= 0)
+            close(fd_);
+        path_ = std::move(other.path_);
+        fd_ = other.fd_;
+        other.fd_ = -1;
+    }
+    return *this;
+}
+
+ssize_t SysfsFile::read_raw(void *buf, size_t len) const {
+    if (fd_ < 0)
+        return -1;
+    return pread(fd_, buf, len, 0);
+}
+
+bool SysfsFile::read(std::string &out) const {
+    char buf[256];
+    ssize_t n = read_raw(buf, sizeof(buf) - 1);
+
+    if (n < 0)
+        return false;
+    while (n > 0 && (buf[n - 1] == '\n' || buf[n - 1] == ' '))
+        n--;
+    out.assign(buf, static_cast<size_t>(n));
+    return true;
+}
+
+bool SysfsFile::read_long(long &value) const {
+    std::string s;
+    char *end;
+
+    if (!read(s) || s.empty())
+        return false;
+    errno = 0;
+    value = strtol(s.c_str(), &end, 10);
+    return errno == 0 && end != s.c_str();
+}
+
+bool sysfs_exists(const std::string &path) {
+    return access(path.c_str(), F_OK) == 0;
+}
+
+bool sysfs_write(const std::string &path, const std::string &value) {
+    int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "radxa-perfd: open %s: %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    ssize_t n = write(fd, value.data(), value.size());
+    int err = errno;
+    close(fd);
+    if (n != static_cast<ssize_t>(value.size())) {
+        fprintf(stderr, "radxa-perfd: write '%s' > %s: %s\n",
+                value.c_str(), path.c_str(), strerror(err));
+        return false;
+    }
+    return true;
+}
+
+} // namespace radxa
@@ -0,0 +1,38 @@
+// Sysfs access without forking: attributes are opened once and re-read
+// with pread(), writes go straight through write(2).
+
+#pragma once
+
+#include <string>
+#include <sys/types.h>
+
+namespace radxa {
+
+class SysfsFile {
+public:
+    SysfsFile() = default;
+    explicit SysfsFile(const std::string &path);
+    ~SysfsFile();
+    SysfsFile(SysfsFile &&other) noexcept;
+    SysfsFile &operator=(SysfsFile &&other) noexcept;
+    SysfsFile(const SysfsFile &) = delete;
+    SysfsFile &operator=(const SysfsFile &) = delete;
+
+    bool ok() const { return fd_ >= 0; }
+    int fd() const { return fd_; }
+    const std::string &path() const { return path_; }
+
+    // Re-reading from offset 0 also re-arms sysfs_notify() for poll()
+    bool read(std::string &out) const;
+    bool read_long(long &value) const;
+    ssize_t read_raw(void *buf, size_t len) const;
+
+private:
+    std::string path_;
+    int fd_ = -1;
+};
+
+bool sysfs_exists(const std::string &path);
+bool sysfs_write(const std::string &path, const std::string &value);
+
+} // namespace radxa
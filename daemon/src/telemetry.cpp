@@ -0,0 +1,120 @@
+#include "telemetry.h"
+
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+#include "../../src/radxa_overclock_uapi.h"
+
+namespace radxa {
+
+const char *domain_name(uint32_t domain) {
+    switch (domain) {
+    case RADXA_OC_DOMAIN_CPU_E: return "cpu_e";
+    case RADXA_OC_DOMAIN_CPU_P: return "cpu_p";
+    case RADXA_OC_DOMAIN_DDR:   return "ddr";
+    case RADXA_OC_DOMAIN_NPU:   return "npu";
+    case RADXA_OC_DOMAIN_GPU:   return "gpu";
+    case RADXA_OC_DOMAIN_FAN:   return "fan";
+    default:                    return "unknown";
+    }
+}
+
+Telemetry::Telemetry(const Config &config) {
+    paths_ = {
+        config.paths.cpu_overclock + "/snapshot",
+        config.paths.ram_overclock + "/snapshot",
+        config.paths.npu_device + "/llm_snapshot",
+        config.paths.fan_control + "/snapshot",
+    };
+    files_.resize(paths_.size());
+}
+
+std::vector<DomainSample> Telemetry::collect() {
+    std::vector<DomainSample> samples;
+    char buf[512];
+
+    for (size_t i = 0; i < paths_.size(); i++) {
+        // Modules may be loaded after us, keep retrying the open
+        if (!files_[i].ok())
+            files_[i] = SysfsFile(paths_[i]);
+        if (!files_[i].ok())
+            continue;
+
+        ssize_t n = files_[i].read_raw(buf, sizeof(buf));
+        struct radxa_oc_snapshot_header hdr;
+        if (n < static_cast<ssize_t>(sizeof(hdr))) {
+            files_[i] = SysfsFile();    // Module went away
+            continue;
+        }
+        memcpy(&hdr, buf, sizeof(hdr));
+        if (hdr.magic != RADXA_OC_SNAPSHOT_MAGIC || hdr.version < 1 ||
+            hdr.domain_size < sizeof(struct radxa_oc_domain_state))
+            continue;
+
+        // Newer modules may append fields: honour header/domain sizes
+        for (unsigned d = 0; d < hdr.nr_domains; d++) {
+            size_t off = hdr.header_size + d * static_cast<size_t>(hdr.domain_size);
+            struct radxa_oc_domain_state st;
+            if (off + sizeof(st) > static_cast<size_t>(n))
+                break;
+            memcpy(&st, buf + off, sizeof(st));
+            samples.push_back({ st.domain, st.flags, st.cur_freq_hz, st.target_freq_hz,
+                                st.voltage_uv, st.temp_mc });
+        }
+    }
+    return samples;
+}
+
+std::string Telemetry::format_status(const std::vector<DomainSample> &samples) const {
+    std::string out;
+    char line[192];
+
+    for (const auto &s : samples) {
+        snprintf(line, sizeof(line),
+                 "%s cur=%llu target=%llu voltage_uv=%u temp_mc=%d overclocked=%d\n",
+                 domain_name(s.domain),
+                 static_cast<unsigned long long>(s.cur_freq_hz),
+                 static_cast<unsigned long long>(s.target_freq_hz),
+                 s.voltage_uv, s.temp_mc,
+                 (s.flags & RADXA_OC_F_OVERCLOCKED) ? 1 : 0);
+        out += line;
+    }
+    return out;
+}
+
+bool Telemetry::write_textfile(const std::string &path, const std::vector<DomainSample> &samples,
+                               const std::string &profile, int fan_pwm, int temp_mc) const {
+    std::string tmp = path + ".tmp";
+    FILE *f = fopen(tmp.c_str(), "we");
+
+    if (!f)
+        return false;
+
+    fprintf(f, "# TYPE radxa_freq_hz gauge\n");
+    for (const auto &s : samples)
+        if (s.domain != RADXA_OC_DOMAIN_FAN)
+            fprintf(f, "radxa_freq_hz{domain=\"%s\"} %llu\n", domain_name(s.domain),
+                    static_cast<unsigned long long>(s.cur_freq_hz));
+    fprintf(f, "# TYPE radxa_target_freq_hz gauge\n");
+    for (const auto &s : samples)
+        if (s.domain != RADXA_OC_DOMAIN_FAN)
+            fprintf(f, "radxa_target_freq_hz{domain=\"%s\"} %llu\n", domain_name(s.domain),
+                    static_cast<unsigned long long>(s.target_freq_hz));
+    fprintf(f, "# TYPE radxa_voltage_uv gauge\n");
+    for (const auto &s : samples)
+        if (s.voltage_uv)
+            fprintf(f, "radxa_voltage_uv{domain=\"%s\"} %u\n", domain_name(s.domain), s.voltage_uv);
+    fprintf(f, "# TYPE radxa_fan_pwm gauge\nradxa_fan_pwm %d\n", fan_pwm);
+    fprintf(f, "# TYPE radxa_temperature_mc gauge\nradxa_temperature_mc %d\n", temp_mc);
+    fprintf(f, "# TYPE radxa_profile gauge\nradxa_profile{name=\"%s\"} 1\n", profile.c_str());
+
+    bool ok = fclose(f) == 0;
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace radxa
@@ -0,0 +1,41 @@
+// Telemetry: reads the modules' binary snapshot attributes (one pread per
+// module) and exports them as text for the control socket and as a
+// Prometheus textfile for node_exporter.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "sysfs.h"
+
+namespace radxa {
+
+struct DomainSample {
+    uint32_t domain;
+    uint32_t flags;
+    uint64_t cur_freq_hz;
+    uint64_t target_freq_hz;
+    uint32_t voltage_uv;
+    int32_t temp_mc;
+};
+
+const char *domain_name(uint32_t domain);
+
+class Telemetry {
+public:
+    explicit Telemetry(const Config &config);
+
+    std::vector<DomainSample> collect();
+    std::string format_status(const std::vector<DomainSample> &samples) const;
+    bool write_textfile(const std::string &path, const std::vector<DomainSample> &samples,
+                        const std::string &profile, int fan_pwm, int temp_mc) const;
+
+private:
+    std::vector<std::string> paths_;
+    std::vector<SysfsFile> files_;
+};
+
+} // namespace radxa
@@ -0,0 +1,74 @@
+/*
+ * libradxaperf - C ABI
+ *
+ * Frequency floors and state reads for the overclocking modules, without
+ * shelling out to "echo ... > llm_overclock". A handle is safe to share
+ * between threads. Functions returning int give 0 (or a count) on success
+ * and -errno on failure; the errno is the one the module's store returned.
+ *
+ * Writing the control files needs the same privileges as the echo did.
+ */
+
+#ifndef RADXAPERF_H
+#define RADXAPERF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Domain identifiers, the same as enum radxa_oc_domain */
+enum radxaperf_domain {
+    RADXAPERF_CPU_E = 0,
+    RADXAPERF_CPU_P = 1,
+    RADXAPERF_DDR   = 2,
+    RADXAPERF_NPU   = 3,
+    RADXAPERF_GPU   = 4,
+    RADXAPERF_FAN   = 5,    /* State only; cur/target hold PWM duty */
+};
+
+struct radxaperf_setting {
+    uint32_t domain;        /* enum radxaperf_domain */
+    uint64_t freq_hz;
+};
+
+struct radxaperf_state {
+    uint32_t domain;
+    int present;            /* Clock or device found */
+    int overclocked;
+    uint64_t cur_freq_hz;
+    uint64_t target_freq_hz;
+    uint32_t voltage_uv;    /* 0 if unmanaged */
+    int32_t temp_mc;        /* 0 if not applicable */
+};
+
+typedef struct radxaperf radxaperf;
+typedef struct radxaperf_boost radxaperf_boost;
+
+/* Default sysfs locations; NULL only on allocation failure */
+radxaperf *radxaperf_open(void);
+/* End the handle's boosts first */
+void radxaperf_close(radxaperf *perf);
+
+/* Up to max domains of every loaded module; returns the number filled */
+int radxaperf_read_state(radxaperf *perf, struct radxaperf_state *out, size_t max);
+
+/* Sets the rate a domain returns to once no boost holds it up */
+int radxaperf_apply(radxaperf *perf, const struct radxaperf_setting *settings, size_t n);
+
+/*
+ * Holds each domain at least at freq_hz until radxaperf_boost_end().
+ * Overlapping boosts combine to the highest floor. NULL on failure, with
+ * -errno in *err if err is not NULL.
+ */
+radxaperf_boost *radxaperf_boost_begin(radxaperf *perf, const struct radxaperf_setting *settings,
+                                       size_t n, int *err);
+void radxaperf_boost_end(radxaperf_boost *boost);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RADXAPERF_H */
@@ -0,0 +1,153 @@
+// libradxaperf - C++ API
+//
+// Typed access to the overclocking modules for programs that want a
+// faster clock for a stretch of work, e.g. an inference server during
+// prefill:
+//
+//     radxa::perf::Client perf;
+//     {
+//         auto boost = perf.boost(radxa::perf::Profile("prefill")
+//                                     .set(radxa::perf::Domain::Npu, 2520000000)
+//                                     .set(radxa::perf::Domain::Gpu, 1488000000));
+//         run_prefill();
+//     }   // Floors released here
+//
+// Boosts are floors: while any is held, a domain runs at the highest of
+// them and of its base rate (the last apply(), else what it ran at before
+// the first boost). When the last boost goes the domain returns to its
+// base; devfreq-driven DDR and GPU return to following their load. Under
+// cpufreq a CPU base is cpu_overclock's cap and the floors go to its
+// min_freq, so the governor cannot drop below them. Floors are combined
+// within the process only.
+
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace radxa {
+namespace perf {
+
+enum class Domain : uint32_t {
+    CpuE = 0,
+    CpuP = 1,
+    Ddr = 2,
+    Npu = 3,
+    Gpu = 4,
+    Fan = 5,    // State only
+};
+
+const char *domain_name(Domain domain);
+
+struct DomainState {
+    Domain domain;
+    bool present = false;
+    bool overclocked = false;
+    uint64_t cur_freq_hz = 0;
+    uint64_t target_freq_hz = 0;
+    uint32_t voltage_uv = 0;
+    int32_t temp_mc = 0;
+};
+
+// A rate per domain; domains left out are not touched
+class Profile {
+public:
+    Profile() = default;
+    explicit Profile(std::string name) : name_(std::move(name)) {}
+
+    Profile &set(Domain domain, uint64_t freq_hz);
+
+    const std::string &name() const { return name_; }
+    const std::map<Domain, uint64_t> &settings() const { return settings_; }
+
+private:
+    std::string name_;
+    std::map<Domain, uint64_t> settings_;
+};
+
+// Same defaults as radxa-perfd's [paths]
+struct Paths {
+    std::string cpu_overclock = "/sys/kernel/cpu_overclock";
+    std::string ram_overclock = "/sys/kernel/ram_overclock";
+    std::string fan_control = "/sys/kernel/fan_control";
+    std::string npu_device = "/sys/devices/platform/soc@3000000/3600000.npu";
+};
+
+class Client;
+
+// Holds its floors until destroyed or release()d
+class ScopedBoost {
+public:
+    ScopedBoost() = default;
+    ~ScopedBoost() { release(); }
+    ScopedBoost(ScopedBoost &&other) noexcept;
+    ScopedBoost &operator=(ScopedBoost &&other) noexcept;
+    ScopedBoost(const ScopedBoost &) = delete;
+    ScopedBoost &operator=(const ScopedBoost &) = delete;
+
+    // False if applying the floors failed; error() has the -errno
+    bool active() const { return client_ != nullptr; }
+    int error() const { return error_; }
+    void release();
+
+private:
+    friend class Client;
+    ScopedBoost(Client *client, uint64_t id, int error) : client_(client), id_(id), error_(error) {}
+
+    Client *client_ = nullptr;
+    uint64_t id_ = 0;
+    int error_ = 0;
+};
+
+// Thread-safe. Boosts must not outlive their client.
+class Client {
+public:
+    explicit Client(Paths paths = Paths());
+    ~Client();
+    Client(const Client &) = delete;
+    Client &operator=(const Client &) = delete;
+
+    // One pread() of each module's snapshot attribute, no clock-framework
+    // locks on the kernel side
+    std::vector<DomainState> state();
+    std::optional<DomainState> state(Domain domain);
+
+    // Sets the base rates; 0 or -errno of the first failing write
+    int apply(const Profile &profile);
+    std::future<int> apply_async(Profile profile);
+
+    ScopedBoost boost(const Profile &floors);
+
+private:
+    friend class ScopedBoost;
+
+    class Snapshots;
+    using Rates = std::map<Domain, uint64_t>;
+
+    void release(uint64_t id);
+    void capture_bases(const Rates &rates);
+    uint64_t floor_hz(Domain domain) const;
+    uint64_t effective_hz(Domain domain) const;
+    Rates effective(const Rates &domains) const;
+    Rates floor_rates(const Rates &domains) const;
+    uint64_t cpu_hz(Domain domain, bool direct) const;
+    int write(const Rates &before, const Rates &before_floors, bool force);
+
+    Paths paths_;
+    std::unique_ptr<Snapshots> snapshots_;
+    std::mutex lock_;                   // Everything below
+    Rates base_hz_;                     // 0: follow load (DDR, GPU), no cap (CPU)
+    Rates fallback_hz_;                 // For a base of 0 without devfreq
+    std::map<uint64_t, Rates> boosts_;
+    uint64_t next_id_ = 1;
+};
+
+} // namespace perf
+} // namespace radxa
@@ -0,0 +1,112 @@
+// C ABI over radxa::perf::Client; no exception crosses it
+
+#include "radxaperf.h"
+
+#include <cerrno>
+#include <new>
+
+#include "radxaperf.hpp"
+
+using radxa::perf::Client;
+using radxa::perf::Domain;
+using radxa::perf::Profile;
+using radxa::perf::ScopedBoost;
+
+struct radxaperf {
+    Client client;
+};
+
+struct radxaperf_boost {
+    ScopedBoost boost;
+};
+
+namespace {
+
+// -EINVAL for a domain that does not exist or cannot be set
+int to_profile(const struct radxaperf_setting *settings, size_t n, Profile &profile) {
+    for (size_t i = 0; i < n; i++) {
+        if (settings[i].domain > RADXAPERF_GPU)
+            return -EINVAL;
+        profile.set(static_cast<Domain>(settings[i].domain), settings[i].freq_hz);
+    }
+    return 0;
+}
+
+} // namespace
+
+extern "C" {
+
+radxaperf *radxaperf_open(void) {
+    // nothrow only covers the handle itself, not the strings Client copies
+    try {
+        return new radxaperf();
+    } catch (const std::bad_alloc &) {
+        return nullptr;
+    }
+}
+
+void radxaperf_close(radxaperf *perf) {
+    delete perf;
+}
+
+int radxaperf_read_state(radxaperf *perf, struct radxaperf_state *out, size_t max) {
+    try {
+        size_t n = 0;
+
+        for (const auto &s : perf->client.state()) {
+            if (n == max)
+                break;
+            out[n].domain = static_cast<uint32_t>(s.domain);
+            out[n].present = s.present;
+            out[n].overclocked = s.overclocked;
+            out[n].cur_freq_hz = s.cur_freq_hz;
+            out[n].target_freq_hz = s.target_freq_hz;
+            out[n].voltage_uv = s.voltage_uv;
+            out[n].temp_mc = s.temp_mc;
+            n++;
+        }
+        return static_cast<int>(n);
+    } catch (const std::bad_alloc &) {
+        return -ENOMEM;
+    }
+}
+
+int radxaperf_apply(radxaperf *perf, const struct radxaperf_setting *settings, size_t n) {
+    try {
+        Profile profile;
+        int ret = to_profile(settings, n, profile);
+
+        return ret ? ret : perf->client.apply(profile);
+    } catch (const std::bad_alloc &) {
+        return -ENOMEM;
+    }
+}
+
+radxaperf_boost *radxaperf_boost_begin(radxaperf *perf, const struct radxaperf_setting *settings,
+                                       size_t n, int *err) {
+    int ret;
+
+    try {
+        Profile profile;
+
+        ret = to_profile(settings, n, profile);
+        if (!ret) {
+            ScopedBoost boost = perf->client.boost(profile);
+
+            if (boost.active())
+                return new radxaperf_boost{ std::move(boost) };
+            ret = boost.error();
+        }
+    } catch (const std::bad_alloc &) {
+        ret = -ENOMEM;
+    }
+    if (err)
+        *err = ret;
+    return nullptr;
+}
+
+void radxaperf_boost_end(radxaperf_boost *boost) {
+    delete boost;
+}
+
+} // extern "C"
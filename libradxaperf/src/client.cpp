@@ -0,0 +1,368 @@
+#include "radxaperf.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../../src/radxa_overclock_uapi.h"
+
+namespace radxa {
+namespace perf {
+
+namespace {
+
+// 0 or -errno; the module's store() errno comes back from write(2)
+int write_file(const std::string &path, const std::string &value) {
+    int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -errno;
+
+    ssize_t n = ::write(fd, value.data(), value.size());
+    int err = n < 0 ? errno : EIO;
+    close(fd);
+    return n == static_cast<ssize_t>(value.size()) ? 0 : -err;
+}
+
+std::string mhz(uint64_t hz) {
+    return std::to_string(hz / 1000000);
+}
+
+// llm_overclock needs both of NPU and GPU whenever one of them changes
+void add_partner(std::map<Domain, uint64_t> &rates) {
+    if (rates.count(Domain::Npu) && !rates.count(Domain::Gpu))
+        rates[Domain::Gpu] = 0;
+    else if (rates.count(Domain::Gpu) && !rates.count(Domain::Npu))
+        rates[Domain::Npu] = 0;
+}
+
+} // namespace
+
+const char *domain_name(Domain domain) {
+    switch (domain) {
+    case Domain::CpuE: return "cpu_e";
+    case Domain::CpuP: return "cpu_p";
+    case Domain::Ddr:  return "ddr";
+    case Domain::Npu:  return "npu";
+    case Domain::Gpu:  return "gpu";
+    case Domain::Fan:  return "fan";
+    }
+    return "unknown";
+}
+
+Profile &Profile::set(Domain domain, uint64_t freq_hz) {
+    settings_[domain] = freq_hz;
+    return *this;
+}
+
+// The modules' snapshot attributes, kept open and re-read with pread()
+class Client::Snapshots {
+public:
+    explicit Snapshots(const Paths &paths)
+        : paths_{ paths.cpu_overclock + "/snapshot", paths.ram_overclock + "/snapshot",
+                  paths.npu_device + "/llm_snapshot", paths.fan_control + "/snapshot" } {
+        std::fill(std::begin(fds_), std::end(fds_), -1);
+    }
+
+    ~Snapshots() {
+        for (int fd : fds_)
+            if (fd >= 0)
+                close(fd);
+    }
+
+    std::vector<DomainState> read() {
+        std::lock_guard<std::mutex> guard(lock_);
+        std::vector<DomainState> states;
+        char buf[512];
+
+        for (size_t i = 0; i < kFiles; i++) {
+            // Modules may be loaded after us, keep retrying the open
+            if (fds_[i] < 0)
+                fds_[i] = open(paths_[i].c_str(), O_RDONLY | O_CLOEXEC);
+            if (fds_[i] < 0)
+                continue;
+
+            ssize_t n = pread(fds_[i], buf, sizeof(buf), 0);
+            struct radxa_oc_snapshot_header hdr;
+            if (n < static_cast<ssize_t>(sizeof(hdr))) {
+                close(fds_[i]);     // Module went away
+                fds_[i] = -1;
+                continue;
+            }
+            memcpy(&hdr, buf, sizeof(hdr));
+            if (hdr.magic != RADXA_OC_SNAPSHOT_MAGIC || hdr.version < 1 ||
+                hdr.domain_size < sizeof(struct radxa_oc_domain_state))
+                continue;
+
+            // Newer modules may append fields: honour header/domain sizes
+            for (unsigned d = 0; d < hdr.nr_domains; d++) {
+                size_t off = hdr.header_size + d * static_cast<size_t>(hdr.domain_size);
+                struct radxa_oc_domain_state st;
+                if (off + sizeof(st) > static_cast<size_t>(n))
+                    break;
+                memcpy(&st, buf + off, sizeof(st));
+
+                DomainState s;
+                s.domain = static_cast<Domain>(st.domain);
+                s.present = st.flags & RADXA_OC_F_PRESENT;
+                s.overclocked = st.flags & RADXA_OC_F_OVERCLOCKED;
+                s.cur_freq_hz = st.cur_freq_hz;
+                s.target_freq_hz = st.target_freq_hz;
+                s.voltage_uv = st.voltage_uv;
+                s.temp_mc = st.temp_mc;
+                states.push_back(s);
+            }
+        }
+        return states;
+    }
+
+private:
+    static constexpr size_t kFiles = 4;
+
+    std::string paths_[kFiles];
+    int fds_[kFiles];
+    std::mutex lock_;
+};
+
+ScopedBoost::ScopedBoost(ScopedBoost &&other) noexcept
+    : client_(other.client_), id_(other.id_), error_(other.error_) {
+    other.client_ = nullptr;
+}
+
+ScopedBoost &ScopedBoost::operator=(ScopedBoost &&other) noexcept {
+    if (this != &other) {
+        release();
+        client_ = other.client_;
+        id_ = other.id_;
+        error_ = other.error_;
+        other.client_ = nullptr;
+    }
+    return *this;
+}
+
+void ScopedBoost::release() {
+    if (client_)
+        client_->release(id_);
+    client_ = nullptr;
+}
+
+Client::Client(Paths paths) : paths_(std::move(paths)), snapshots_(new Snapshots(paths_)) {}
+
+Client::~Client() = default;
+
+std::vector<DomainState> Client::state() {
+    return snapshots_->read();
+}
+
+std::optional<DomainState> Client::state(Domain domain) {
+    for (const auto &s : snapshots_->read())
+        if (s.domain == domain)
+            return s;
+    return std::nullopt;
+}
+
+// Bases of domains seen for the first time: the module's target, or the
+// current rate if it has none. DDR and GPU start out following their load;
+// fallback_hz_ is for modules without devfreq, which reject "auto". A CPU
+// cluster under cpufreq has cpu_overclock's cap as its base, 0 if it has
+// none: its current rate is just what the governor picked at that moment.
+// That rate is the fallback for clusters the module clocks directly.
+void Client::capture_bases(const Rates &rates) {
+    std::vector<DomainState> states;
+
+    for (const auto &r : rates) {
+        if (base_hz_.count(r.first))
+            continue;
+        if (states.empty())
+            states = snapshots_->read();
+
+        uint64_t target = 0, hz = 0;
+        for (const auto &s : states) {
+            if (s.domain == r.first) {
+                target = s.target_freq_hz;
+                hz = target ? target : s.cur_freq_hz;
+            }
+        }
+        switch (r.first) {
+        case Domain::Ddr:
+        case Domain::Gpu:
+            base_hz_[r.first] = 0;
+            fallback_hz_[r.first] = hz;
+            break;
+        case Domain::CpuE:
+        case Domain::CpuP:
+            base_hz_[r.first] = target;
+            fallback_hz_[r.first] = hz;
+            break;
+        default:
+            base_hz_[r.first] = hz;
+            break;
+        }
+    }
+}
+
+uint64_t Client::floor_hz(Domain domain) const {
+    uint64_t hz = 0;
+
+    for (const auto &b : boosts_) {
+        auto floor = b.second.find(domain);
+        if (floor != b.second.end())
+            hz = std::max(hz, floor->second);
+    }
+    return hz;
+}
+
+uint64_t Client::effective_hz(Domain domain) const {
+    auto base = base_hz_.find(domain);
+
+    return std::max(base != base_hz_.end() ? base->second : 0, floor_hz(domain));
+}
+
+Client::Rates Client::effective(const Rates &domains) const {
+    Rates rates;
+
+    for (const auto &d : domains)
+        rates[d.first] = effective_hz(d.first);
+    return rates;
+}
+
+Client::Rates Client::floor_rates(const Rates &domains) const {
+    Rates rates;
+
+    for (const auto &d : domains)
+        rates[d.first] = floor_hz(d.first);
+    return rates;
+}
+
+// What to write to overclock for a cluster, 0 to leave it alone. Under
+// cpufreq that is a cap: the base, lifted while a floor is above it, and
+// no write at all without a base. A directly clocked cluster runs at it.
+uint64_t Client::cpu_hz(Domain domain, bool direct) const {
+    auto base = base_hz_.find(domain);
+    uint64_t hz = base != base_hz_.end() ? base->second : 0;
+
+    if (direct && !hz && fallback_hz_.count(domain))
+        hz = fallback_hz_.at(domain);
+    return hz || direct ? std::max(hz, floor_hz(domain)) : 0;
+}
+
+// Writes the domains of before whose effective rate or floor moved (all
+// of them with force). cpu_overclock takes "E,P" with 0 for a cluster to
+// leave alone; llm_unified_overclock always takes NPU and GPU together.
+int Client::write(const Rates &before, const Rates &before_floors, bool force) {
+    std::vector<Domain> changed;
+    int ret = 0, err;
+
+    for (const auto &b : before)
+        if (force || b.second != effective_hz(b.first) ||
+            before_floors.at(b.first) != floor_hz(b.first))
+            changed.push_back(b.first);
+    auto has = [&changed](Domain d) {
+        return std::find(changed.begin(), changed.end(), d) != changed.end();
+    };
+
+    // A cap alone raises nothing under cpufreq; the floors go to min_freq.
+    // Clusters clocked directly reject a floor there (older modules have no
+    // min_freq), they run at whatever overclock says.
+    if (has(Domain::CpuE) || has(Domain::CpuP)) {
+        err = write_file(paths_.cpu_overclock + "/min_freq",
+                         mhz(floor_hz(Domain::CpuE)) + "," + mhz(floor_hz(Domain::CpuP)));
+        bool direct = err == -EOPNOTSUPP || err == -ENOENT;
+
+        if (!err || direct) {
+            uint64_t e = has(Domain::CpuE) ? cpu_hz(Domain::CpuE, direct) : 0;
+            uint64_t p = has(Domain::CpuP) ? cpu_hz(Domain::CpuP, direct) : 0;
+
+            err = e || p ? write_file(paths_.cpu_overclock + "/overclock", mhz(e) + "," + mhz(p))
+                         : 0;
+        }
+        ret = err;
+    }
+
+    if (has(Domain::Ddr)) {
+        const std::string path = paths_.ram_overclock + "/ram_overclock";
+        uint64_t hz = effective_hz(Domain::Ddr);
+
+        err = write_file(path, hz ? mhz(hz) : "auto");
+        if (err && !hz && fallback_hz_.count(Domain::Ddr))
+            err = write_file(path, mhz(fallback_hz_.at(Domain::Ddr)));
+        ret = ret ? ret : err;
+    }
+
+    if (has(Domain::Npu) || has(Domain::Gpu)) {
+        const std::string path = paths_.npu_device + "/llm_overclock";
+        uint64_t npu = effective_hz(Domain::Npu);
+        uint64_t gpu = effective_hz(Domain::Gpu);
+
+        // No NPU rate means no llm_unified_overclock to write to
+        if (!npu)
+            return ret ? ret : -ENODEV;
+        err = write_file(path, mhz(npu) + "," + (gpu ? mhz(gpu) : "auto"));
+        if (err && !gpu && fallback_hz_.count(Domain::Gpu))
+            err = write_file(path, mhz(npu) + "," + mhz(fallback_hz_.at(Domain::Gpu)));
+        ret = ret ? ret : err;
+    }
+    return ret;
+}
+
+int Client::apply(const Profile &profile) {
+    Rates rates = profile.settings();
+
+    if (rates.count(Domain::Fan))
+        return -EINVAL;
+    add_partner(rates);
+
+    std::lock_guard<std::mutex> guard(lock_);
+    capture_bases(rates);
+    Rates before = effective(rates), before_floors = floor_rates(rates);
+    for (const auto &s : profile.settings())
+        base_hz_[s.first] = s.second;
+    return write(before, before_floors, true);
+}
+
+std::future<int> Client::apply_async(Profile profile) {
+    return std::async(std::launch::async, [this, profile = std::move(profile)]() {
+        return apply(profile);
+    });
+}
+
+ScopedBoost Client::boost(const Profile &floors) {
+    Rates rates = floors.settings();
+
+    if (rates.count(Domain::Fan))
+        return ScopedBoost(nullptr, 0, -EINVAL);
+    add_partner(rates);
+
+    std::lock_guard<std::mutex> guard(lock_);
+    capture_bases(rates);
+    Rates before = effective(rates), before_floors = floor_rates(rates);
+    uint64_t id = next_id_++;
+    boosts_[id] = floors.settings();
+
+    int ret = write(before, before_floors, false);
+    if (ret) {
+        // Put back whatever part of it did get through
+        Rates partial = effective(rates), partial_floors = floor_rates(rates);
+        boosts_.erase(id);
+        write(partial, partial_floors, false);
+        return ScopedBoost(nullptr, 0, ret);
+    }
+    return ScopedBoost(this, id, 0);
+}
+
+void Client::release(uint64_t id) {
+    std::lock_guard<std::mutex> guard(lock_);
+    auto it = boosts_.find(id);
+
+    if (it == boosts_.end())
+        return;
+    Rates rates = it->second;
+    add_partner(rates);
+    Rates before = effective(rates), before_floors = floor_rates(rates);
+    boosts_.erase(it);
+    write(before, before_floors, false);
+}
+
+} // namespace perf
+} // namespace radxa
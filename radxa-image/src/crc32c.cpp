@@ -0,0 +1,55 @@
+#include "crc32c.h"
+
+#include <cstring>
+
+namespace radxa {
+
+namespace {
+
+constexpr uint32_t kPoly = 0x82f63b78;     // Reflected
+
+struct Tables {
+    uint32_t t[8][256];
+
+    Tables() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = c & 1 ? (c >> 1) ^ kPoly : c >> 1;
+            t[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; i++)
+            for (int k = 1; k < 8; k++)
+                t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xff];
+    }
+};
+
+const Tables &tables() {
+    static const Tables tables;
+    return tables;
+}
+
+} // namespace
+
+uint32_t crc32c(const void *data, size_t len, uint32_t crc) {
+    const auto &t = tables().t;
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+
+    crc = ~crc;
+    while (len >= 8) {
+        uint64_t v;
+
+        memcpy(&v, p, sizeof(v));
+        v ^= crc;
+        crc = t[7][v & 0xff] ^ t[6][(v >> 8) & 0xff] ^ t[5][(v >> 16) & 0xff] ^
+              t[4][(v >> 24) & 0xff] ^ t[3][(v >> 32) & 0xff] ^ t[2][(v >> 40) & 0xff] ^
+              t[1][(v >> 48) & 0xff] ^ t[0][v >> 56];
+        p += 8;
+        len -= 8;
+    }
+    while (len--)
+        crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+} // namespace radxa
@@ -0,0 +1,13 @@
+// CRC-32C (Castagnoli), table-driven eight bytes at a time
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace radxa {
+
+// Continue a running checksum by passing the previous result as crc
+uint32_t crc32c(const void *data, size_t len, uint32_t crc = 0);
+
+} // namespace radxa
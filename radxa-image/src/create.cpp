@@ -0,0 +1,377 @@
+// Image creation: the calling thread reads chunks in order, skipping free
+// filesystem blocks, a pool of workers checksums and compresses them, and
+// one writer appends the frames in order and builds the index. At most
+// two chunks per worker are in flight, which bounds the memory used.
+
+#include "imaging.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <zstd.h>
+
+#include "crc32c.h"
+#include "disk.h"
+#include "ext4.h"
+#include "image_format.h"
+
+namespace radxa {
+
+namespace {
+
+struct Chunk {
+    uint64_t index;
+    uint32_t kind = image::kChunkData;
+    uint32_t crc = 0;
+    std::vector<char> data;         // Device bytes, then the frame
+};
+
+bool all_zero(const std::vector<char> &buf) {
+    return buf.empty() || (!buf[0] && !memcmp(buf.data(), buf.data() + 1, buf.size() - 1));
+}
+
+// Free ranges of every ext4 partition, sorted by offset. sync() first
+// gets delayed allocations onto the disk. The bitmaps are read through
+// the partition's own node: for a mounted filesystem that is its buffer
+// cache, which also has the allocations committed to the journal but not
+// yet written back.
+std::vector<Extent> map_free_space(const Disk &disk) {
+    std::vector<Extent> free;
+    std::vector<Partition> parts;
+    std::string error;
+
+    sync();
+    if (!read_partitions(disk, parts, error)) {
+        fprintf(stderr, "radxa-image: %s, copying everything\n", error.c_str());
+        return free;
+    }
+    if (parts.empty())
+        parts.push_back({ 0, 0, disk.size });  // A bare filesystem
+
+    for (const auto &p : parts) {
+        std::string name = p.number ? "partition " + std::to_string(p.number) : "filesystem";
+        uint64_t used = 0;
+
+        if (p.start + p.size > disk.size) {
+            fprintf(stderr, "radxa-image: %s: beyond the end of the disk, ignored\n", name.c_str());
+            continue;
+        }
+
+        std::string node = partition_node(disk, p.number);
+        int fd = node.empty() ? -1 : open(node.c_str(), O_RDONLY | O_CLOEXEC);
+        bool ok = fd >= 0 ? ext4_free_extents(fd, 0, p.size, p.start, free, used, error)
+                          : ext4_free_extents(disk.fd, p.start, p.size, p.start, free, used, error);
+        if (fd >= 0)
+            close(fd);
+
+        if (ok)
+            fprintf(stderr, "%s: ext4, %s of %s in use\n", name.c_str(), human_size(used).c_str(),
+                    human_size(p.size).c_str());
+        else
+            fprintf(stderr, "%s: %s, copied in full\n", name.c_str(), error.c_str());
+    }
+
+    std::sort(free.begin(), free.end(), [](const Extent &a, const Extent &b) {
+        return a.start < b.start;
+    });
+    return free;
+}
+
+// Free ranges within [start, start + len) into holes, relative to start;
+// true if they cover all of it
+bool free_in(const std::vector<Extent> &free, uint64_t start, uint64_t len,
+             std::vector<Extent> &holes) {
+    uint64_t covered = 0;
+
+    holes.clear();
+    auto it = std::upper_bound(free.begin(), free.end(), start, [](uint64_t s, const Extent &e) {
+        return s < e.start;
+    });
+    if (it != free.begin())
+        --it;
+    for (; it != free.end() && it->start < start + len; ++it) {
+        uint64_t s = std::max(it->start, start);
+        uint64_t e = std::min(it->start + it->length, start + len);
+        if (s < e) {
+            holes.push_back({ s - start, e - s });
+            covered += e - s;
+        }
+    }
+    return covered == len;
+}
+
+class Pipeline {
+public:
+    Pipeline(const CreateOptions &opts, const Disk &disk, int image_fd,
+             const std::vector<Extent> &free, unsigned threads)
+        : opts_(opts), disk_(disk), image_fd_(image_fd), free_(free), threads_(threads),
+          depth_(threads * 2 + 2),
+          nr_chunks_((disk.size + opts.chunk_size - 1) / opts.chunk_size),
+          index_(nr_chunks_), progress_("Imaging", disk.size) {}
+
+    // Fills the index; end is where the frames stop
+    bool run(std::vector<image::IndexEntry> &index, uint64_t &end, std::string &error) {
+        std::vector<std::thread> workers;
+
+        for (unsigned i = 0; i < threads_; i++)
+            workers.emplace_back(&Pipeline::worker, this);
+        std::thread writer(&Pipeline::writer, this);
+
+        reader();
+        for (auto &w : workers)
+            w.join();
+        writer.join();
+        progress_.finish();
+
+        if (failed_) {
+            error = error_;
+            return false;
+        }
+        index.swap(index_);
+        end = end_;
+        return true;
+    }
+
+private:
+    void fail(const std::string &msg) {
+        std::lock_guard<std::mutex> guard(lock_);
+        if (!failed_)
+            error_ = msg;
+        failed_ = true;
+        cv_.notify_all();
+    }
+
+    void reader() {
+        std::vector<Extent> holes;
+
+        for (uint64_t i = 0; i < nr_chunks_; i++) {
+            auto c = std::make_unique<Chunk>();
+            uint64_t start = i * opts_.chunk_size;
+            uint64_t len = std::min<uint64_t>(opts_.chunk_size, disk_.size - start);
+
+            {
+                std::unique_lock<std::mutex> lk(lock_);
+                cv_.wait(lk, [this] { return failed_ || in_flight_ < depth_; });
+                if (failed_)
+                    return;
+                in_flight_++;
+            }
+
+            c->index = i;
+            if (free_in(free_, start, len, holes)) {
+                c->kind = image::kChunkFree;
+            } else {
+                c->data.resize(len);
+                if (!read_full(disk_.fd, c->data.data(), len, start)) {
+                    fail(disk_.path + ": read at " + std::to_string(start) + ": " + strerror(errno));
+                    return;
+                }
+                // Keep the page cache for the programs running meanwhile
+                posix_fadvise(disk_.fd, start, len, POSIX_FADV_DONTNEED);
+                for (const auto &h : holes)
+                    memset(c->data.data() + h.start, 0, h.length);
+            }
+
+            std::lock_guard<std::mutex> guard(lock_);
+            if (c->kind == image::kChunkData)
+                todo_.push_back(std::move(c));
+            else
+                done_[i] = std::move(c);
+            cv_.notify_all();
+        }
+
+        std::lock_guard<std::mutex> guard(lock_);
+        reading_done_ = true;
+        cv_.notify_all();
+    }
+
+    void worker() {
+        ZSTD_CCtx *cctx = ZSTD_createCCtx();
+        std::vector<char> frame;
+
+        if (!cctx) {
+            fail("cannot create a zstd context");
+            return;
+        }
+        for (;;) {
+            std::unique_ptr<Chunk> c;
+            {
+                std::unique_lock<std::mutex> lk(lock_);
+                cv_.wait(lk, [this] { return failed_ || reading_done_ || !todo_.empty(); });
+                if (failed_ || todo_.empty())
+                    break;
+                c = std::move(todo_.front());
+                todo_.pop_front();
+            }
+
+            if (all_zero(c->data)) {
+                c->kind = image::kChunkZero;
+                c->data.clear();
+            } else {
+                c->crc = crc32c(c->data.data(), c->data.size());
+                frame.resize(ZSTD_compressBound(c->data.size()));
+                size_t n = ZSTD_compressCCtx(cctx, frame.data(), frame.size(), c->data.data(),
+                                             c->data.size(), opts_.level);
+                if (ZSTD_isError(n)) {
+                    fail(std::string("zstd: ") + ZSTD_getErrorName(n));
+                    break;
+                }
+                frame.resize(n);
+                c->data.swap(frame);
+            }
+
+            std::lock_guard<std::mutex> guard(lock_);
+            done_[c->index] = std::move(c);
+            cv_.notify_all();
+        }
+        ZSTD_freeCCtx(cctx);
+    }
+
+    void writer() {
+        uint64_t offset = sizeof(image::Header);
+
+        for (uint64_t i = 0; i < nr_chunks_; i++) {
+            std::unique_ptr<Chunk> c;
+            {
+                std::unique_lock<std::mutex> lk(lock_);
+                cv_.wait(lk, [this, i] { return failed_ || done_.count(i); });
+                if (failed_)
+                    return;
+                c = std::move(done_[i]);
+                done_.erase(i);
+            }
+
+            image::IndexEntry &e = index_[i];
+            e.kind = c->kind;
+            if (c->kind == image::kChunkData) {
+                if (!write_full(image_fd_, c->data.data(), c->data.size(), offset)) {
+                    fail(opts_.image + ": " + strerror(errno));
+                    return;
+                }
+                e.offset = offset;
+                e.stored_size = c->data.size();
+                e.crc = c->crc;
+                offset += c->data.size();
+            }
+
+            {
+                std::lock_guard<std::mutex> guard(lock_);
+                in_flight_--;
+                cv_.notify_all();
+            }
+            progress_.update(std::min(disk_.size, (i + 1) * opts_.chunk_size), offset);
+        }
+        end_ = offset;
+    }
+
+    const CreateOptions &opts_;
+    const Disk &disk_;
+    int image_fd_;
+    const std::vector<Extent> &free_;
+    unsigned threads_;
+    size_t depth_;
+    uint64_t nr_chunks_;
+    std::vector<image::IndexEntry> index_;
+    uint64_t end_ = 0;
+    Progress progress_;
+
+    std::mutex lock_;               // Everything below
+    std::condition_variable cv_;
+    std::deque<std::unique_ptr<Chunk>> todo_;
+    std::map<uint64_t, std::unique_ptr<Chunk>> done_;
+    size_t in_flight_ = 0;
+    bool reading_done_ = false;
+    bool failed_ = false;
+    std::string error_;
+};
+
+} // namespace
+
+int create_image(const CreateOptions &opts) {
+    auto t0 = std::chrono::steady_clock::now();
+    Disk disk;
+    std::string error;
+
+    if (!open_disk(opts.device, O_RDONLY, disk, error)) {
+        fprintf(stderr, "radxa-image: %s\n", error.c_str());
+        return 1;
+    }
+
+    std::vector<Extent> free;
+    if (!opts.full)
+        free = map_free_space(disk);
+    posix_fadvise(disk.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    int fd = open(opts.image.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "radxa-image: %s: %s\n", opts.image.c_str(), strerror(errno));
+        close_disk(disk);
+        return 1;
+    }
+
+    unsigned threads = opts.threads ? opts.threads : std::max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+    Pipeline pipeline(opts, disk, fd, free, threads);
+    std::vector<image::IndexEntry> index;
+    uint64_t end = 0;
+    bool ok = pipeline.run(index, end, error);
+
+    // The header goes last: an image cut short has no magic
+    image::Header hdr{};
+    image::Trailer trailer{};
+    size_t index_bytes = index.size() * sizeof(image::IndexEntry);
+    if (ok) {
+
+        trailer.index_offset = end;
+        trailer.nr_chunks = index.size();
+        trailer.index_crc = crc32c(index.data(), index_bytes);
+        memcpy(trailer.magic, image::kMagic, sizeof(trailer.magic));
+
+        memcpy(hdr.magic, image::kMagic, sizeof(hdr.magic));
+        hdr.version = image::kVersion;
+        hdr.header_size = sizeof(hdr);
+        hdr.device_size = disk.size;
+        hdr.chunk_size = opts.chunk_size;
+        hdr.sector_size = disk.sector_size;
+        hdr.nr_chunks = index.size();
+
+        ok = write_full(fd, index.data(), index_bytes, end) &&
+             write_full(fd, &trailer, sizeof(trailer), end + index_bytes) && !fsync(fd) &&
+             write_full(fd, &hdr, sizeof(hdr), 0) && !fsync(fd);
+        if (!ok)
+            error = opts.image + ": " + strerror(errno);
+    }
+    close(fd);
+    close_disk(disk);
+
+    if (!ok) {
+        fprintf(stderr, "radxa-image: %s\n", error.c_str());
+        unlink(opts.image.c_str());
+        return 1;
+    }
+
+    uint64_t counts[3] = {};
+    for (const auto &e : index)
+        counts[e.kind]++;
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    fprintf(stderr, "%s: %s stored in %s, %.1f s with %u threads\n", opts.image.c_str(),
+            human_size(disk.size).c_str(), human_size(end + index_bytes + sizeof(trailer)).c_str(), secs, threads);
+    fprintf(stderr, "  %llu chunks: %llu data, %llu zero, %llu free\n",
+            static_cast<unsigned long long>(index.size()),
+            static_cast<unsigned long long>(counts[image::kChunkData]),
+            static_cast<unsigned long long>(counts[image::kChunkZero]),
+            static_cast<unsigned long long>(counts[image::kChunkFree]));
+    return 0;
+}
+
+} // namespace radxa
@@ -0,0 +1,216 @@
+#include "disk.h"
+
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+namespace radxa {
+
+namespace {
+
+constexpr uint8_t kMbrProtective = 0xee;
+constexpr uint8_t kMbrExtendedChs = 0x05;
+constexpr uint8_t kMbrExtendedLba = 0x0f;
+constexpr uint32_t kMaxGptEntries = 1024;
+
+uint32_t le32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24;
+}
+
+uint64_t le64(const uint8_t *p) {
+    return le32(p) | static_cast<uint64_t>(le32(p + 4)) << 32;
+}
+
+std::string read_line(const std::string &path) {
+    char buf[64] = {};
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+        return "";
+    ssize_t n = ::read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0)
+        return "";
+    buf[strcspn(buf, "\n")] = '\0';
+    return buf;
+}
+
+bool read_gpt(const Disk &disk, uint32_t sector, std::vector<Partition> &parts,
+              std::string &error) {
+    std::vector<uint8_t> hdr(sector);
+
+    if (!read_full(disk.fd, hdr.data(), sector, sector) || memcmp(hdr.data(), "EFI PART", 8)) {
+        error = "protective MBR without a GPT header";
+        return false;
+    }
+
+    uint64_t entries_lba = le64(&hdr[72]);
+    uint32_t nr_entries = le32(&hdr[80]);
+    uint32_t entry_size = le32(&hdr[84]);
+    if (entry_size < 128 || entry_size > 4096 || nr_entries > kMaxGptEntries) {
+        error = "GPT header with an unexpected entry layout";
+        return false;
+    }
+
+    std::vector<uint8_t> entries(static_cast<size_t>(nr_entries) * entry_size);
+    if (!read_full(disk.fd, entries.data(), entries.size(), entries_lba * sector)) {
+        error = "cannot read the GPT entries: " + std::string(strerror(errno));
+        return false;
+    }
+
+    static const uint8_t unused[16] = {};
+    for (uint32_t i = 0; i < nr_entries; i++) {
+        const uint8_t *e = &entries[static_cast<size_t>(i) * entry_size];
+        uint64_t first = le64(e + 32), last = le64(e + 40);
+
+        if (!memcmp(e, unused, sizeof(unused)) || last < first)
+            continue;
+        parts.push_back({ static_cast<int>(i + 1), first * sector, (last - first + 1) * sector });
+    }
+    return true;
+}
+
+} // namespace
+
+bool read_full(int fd, void *buf, size_t len, uint64_t offset) {
+    char *p = static_cast<char *>(buf);
+
+    while (len) {
+        ssize_t n = pread(fd, p, len, offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            if (n == 0)
+                errno = EIO;    // Past the end
+            return false;
+        }
+        p += n;
+        len -= n;
+        offset += n;
+    }
+    return true;
+}
+
+bool write_full(int fd, const void *buf, size_t len, uint64_t offset) {
+    const char *p = static_cast<const char *>(buf);
+
+    while (len) {
+        ssize_t n = pwrite(fd, p, len, offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            if (n == 0)
+                errno = ENOSPC;
+            return false;
+        }
+        p += n;
+        len -= n;
+        offset += n;
+    }
+    return true;
+}
+
+bool open_disk(const std::string &path, int flags, Disk &disk, std::string &error) {
+    struct stat st;
+
+    disk.path = path;
+    disk.fd = open(path.c_str(), flags | O_CLOEXEC, 0644);
+    if (disk.fd < 0 || fstat(disk.fd, &st)) {
+        error = path + ": " + strerror(errno);
+        close_disk(disk);
+        return false;
+    }
+
+    disk.block = S_ISBLK(st.st_mode);
+    disk.rdev = st.st_rdev;
+    if (disk.block) {
+        int ssz = 0;
+
+        if (ioctl(disk.fd, BLKGETSIZE64, &disk.size)) {
+            error = path + ": " + strerror(errno);
+            close_disk(disk);
+            return false;
+        }
+        if (!ioctl(disk.fd, BLKSSZGET, &ssz) && ssz > 0)
+            disk.sector_size = ssz;
+    } else if (S_ISREG(st.st_mode)) {
+        disk.size = st.st_size;
+    } else {
+        error = path + ": not a block device or regular file";
+        close_disk(disk);
+        return false;
+    }
+    return true;
+}
+
+void close_disk(Disk &disk) {
+    if (disk.fd >= 0)
+        close(disk.fd);
+    disk.fd = -1;
+}
+
+bool read_partitions(const Disk &disk, std::vector<Partition> &parts, std::string &error) {
+    uint8_t mbr[512];
+
+    parts.clear();
+    if (disk.size < sizeof(mbr) || !read_full(disk.fd, mbr, sizeof(mbr), 0)) {
+        error = "cannot read the MBR";
+        return false;
+    }
+    if (mbr[510] != 0x55 || mbr[511] != 0xaa)
+        return true;    // Unpartitioned
+
+    for (int i = 0; i < 4; i++) {
+        const uint8_t *e = &mbr[446 + i * 16];
+
+        if (e[4] != kMbrProtective)
+            continue;
+        // An image file of a 4Kn disk has its GPT header at 4096
+        if (read_gpt(disk, disk.sector_size, parts, error))
+            return true;
+        return !disk.block && disk.sector_size == 512 && read_gpt(disk, 4096, parts, error);
+    }
+
+    for (int i = 0; i < 4; i++) {
+        const uint8_t *e = &mbr[446 + i * 16];
+        uint64_t first = le32(e + 8), count = le32(e + 12);
+
+        // The logical partitions are copied in full with their container
+        if (!e[4] || e[4] == kMbrExtendedChs || e[4] == kMbrExtendedLba || !count)
+            continue;
+        parts.push_back({ i + 1, first * disk.sector_size, count * disk.sector_size });
+    }
+    return true;
+}
+
+std::string partition_node(const Disk &disk, int number) {
+    if (!disk.block)
+        return "";
+
+    std::string sys = "/sys/dev/block/" + std::to_string(major(disk.rdev)) + ":" +
+                      std::to_string(minor(disk.rdev));
+    DIR *dir = opendir(sys.c_str());
+    if (!dir)
+        return "";
+
+    std::string node;
+    while (struct dirent *d = readdir(dir)) {
+        if (d->d_name[0] == '.')
+            continue;
+        std::string part = sys + "/" + d->d_name;
+        if (read_line(part + "/partition") == std::to_string(number)) {
+            node = std::string("/dev/") + d->d_name;
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+} // namespace radxa
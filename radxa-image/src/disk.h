@@ -0,0 +1,44 @@
+// Source and target devices: size, sector size and the partition table
+// (MBR or GPT) of a whole-disk device or a raw image file.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace radxa {
+
+struct Disk {
+    int fd = -1;
+    std::string path;
+    uint64_t size = 0;
+    uint32_t sector_size = 512;
+    bool block = false;         // Block device, else a regular file
+    dev_t rdev = 0;
+};
+
+struct Partition {
+    int number;                 // As in the kernel's pN / N suffix
+    uint64_t start;             // Bytes from the start of the disk
+    uint64_t size;
+};
+
+// flags as for open(2); regular files are created with O_CREAT
+bool open_disk(const std::string &path, int flags, Disk &disk, std::string &error);
+void close_disk(Disk &disk);
+
+// Primary MBR entries, or the GPT if the MBR is protective. Logical
+// partitions inside an extended one are not listed.
+bool read_partitions(const Disk &disk, std::vector<Partition> &parts, std::string &error);
+
+// Device node of a partition of a whole-disk block device, from sysfs;
+// empty if there is none
+std::string partition_node(const Disk &disk, int number);
+
+// pread()/pwrite() the whole range, retrying short transfers
+bool read_full(int fd, void *buf, size_t len, uint64_t offset);
+bool write_full(int fd, const void *buf, size_t len, uint64_t offset);
+
+} // namespace radxa
@@ -0,0 +1,222 @@
+#include "ext4.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "disk.h"
+
+namespace radxa {
+
+namespace {
+
+constexpr uint64_t kSuperblockOffset = 1024;
+constexpr uint16_t kMagic = 0xef53;
+
+constexpr uint32_t kCompatSparseSuper2 = 0x200;
+constexpr uint32_t kIncompatMetaBg = 0x10;
+constexpr uint32_t kIncompat64Bit = 0x80;
+constexpr uint32_t kRoCompatSparseSuper = 0x1;
+constexpr uint32_t kRoCompatGdtCsum = 0x10;
+constexpr uint32_t kRoCompatBigalloc = 0x200;
+constexpr uint32_t kRoCompatMetadataCsum = 0x400;
+
+constexpr uint16_t kGroupBlockUninit = 0x2;
+
+uint16_t le16(const uint8_t *p) {
+    return p[0] | p[1] << 8;
+}
+
+uint32_t le32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24;
+}
+
+struct Group {
+    uint64_t block_bitmap;
+    uint64_t inode_bitmap;
+    uint64_t inode_table;
+    uint16_t flags;
+};
+
+bool is_power_of(uint64_t n, uint64_t base) {
+    while (n > 1 && n % base == 0)
+        n /= base;
+    return n == 1;
+}
+
+// Groups with a superblock backup, and the group descriptors after it
+bool has_super(uint64_t group, bool sparse) {
+    return !sparse || group <= 1 || is_power_of(group, 3) || is_power_of(group, 5) ||
+           is_power_of(group, 7);
+}
+
+void set_bits(std::vector<uint8_t> &bitmap, uint64_t first, uint64_t count) {
+    for (uint64_t b = first; b < first + count; b++)
+        bitmap[b / 8] |= 1 << (b % 8);
+}
+
+// A group whose bitmap was never written: only the superblock backup,
+// the descriptors and the bitmaps/inode tables placed in it (of any group
+// under flex_bg) are in use, as in the kernel's ext4_init_block_bitmap()
+void uninit_bitmap(std::vector<uint8_t> &bitmap, uint64_t first, uint64_t count,
+                   uint64_t super_blocks, const std::vector<Extent> &meta) {
+    std::fill(bitmap.begin(), bitmap.end(), 0);
+    if (super_blocks)
+        set_bits(bitmap, 0, std::min(super_blocks, count));
+
+    // meta is sorted by start and does not overlap
+    auto it = std::lower_bound(meta.begin(), meta.end(), first, [](const Extent &e, uint64_t b) {
+        return e.start + e.length <= b;
+    });
+    for (; it != meta.end() && it->start < first + count; ++it) {
+        uint64_t s = std::max(it->start, first);
+        uint64_t e = std::min(it->start + it->length, first + count);
+        if (s < e)
+            set_bits(bitmap, s - first, e - s);
+    }
+}
+
+} // namespace
+
+bool ext4_free_extents(int fd, uint64_t fs_offset, uint64_t fs_size, uint64_t base,
+                       std::vector<Extent> &free, uint64_t &used_bytes, std::string &error) {
+    uint8_t sb[1024];
+
+    if (fs_size < kSuperblockOffset + sizeof(sb)) {
+        error = "too small for ext4";
+        return false;
+    }
+    if (!read_full(fd, sb, sizeof(sb), fs_offset + kSuperblockOffset)) {
+        error = std::string("cannot read the superblock: ") + strerror(errno);
+        return false;
+    }
+    if (le16(sb + 56) != kMagic) {
+        error = "no ext4 filesystem";
+        return false;
+    }
+
+    uint32_t compat = le32(sb + 92), incompat = le32(sb + 96), ro_compat = le32(sb + 100);
+    if (incompat & kIncompatMetaBg) {
+        error = "meta_bg is not supported";
+        return false;
+    }
+    if (ro_compat & kRoCompatBigalloc) {
+        error = "bigalloc is not supported";
+        return false;
+    }
+    if (compat & kCompatSparseSuper2) {
+        error = "sparse_super2 is not supported";
+        return false;
+    }
+
+    uint32_t log_block = le32(sb + 24);
+    if (log_block > 6) {
+        error = "unexpected block size";
+        return false;
+    }
+    uint64_t bs = 1024ULL << log_block;
+    bool is64 = incompat & kIncompat64Bit;
+    uint64_t blocks = le32(sb + 4) | (is64 ? static_cast<uint64_t>(le32(sb + 0x150)) << 32 : 0);
+    uint64_t first_data = le32(sb + 20);
+    uint64_t per_group = le32(sb + 32);
+    uint64_t inodes_per_group = le32(sb + 40);
+    uint64_t inode_size = le32(sb + 76) ? le16(sb + 88) : 128;
+    uint64_t reserved_gdt = le16(sb + 0xce);
+    uint64_t desc_size = is64 ? le16(sb + 0xfe) : 32;
+
+    if (!per_group || per_group % 8 || per_group > bs * 8 || desc_size < 32 || desc_size > bs ||
+        blocks <= first_data || blocks > fs_size / bs || !inode_size) {
+        error = "inconsistent superblock";
+        return false;
+    }
+
+    uint64_t nr_groups = (blocks - first_data + per_group - 1) / per_group;
+    uint64_t gdt_blocks = (nr_groups * desc_size + bs - 1) / bs;
+    std::vector<uint8_t> gdt(gdt_blocks * bs);
+    if (!read_full(fd, gdt.data(), gdt.size(), fs_offset + (first_data + 1) * bs)) {
+        error = std::string("cannot read the group descriptors: ") + strerror(errno);
+        return false;
+    }
+
+    uint64_t itable_blocks = (inodes_per_group * inode_size + bs - 1) / bs;
+    std::vector<Group> groups(nr_groups);
+    std::vector<Extent> meta;       // In blocks
+    for (uint64_t g = 0; g < nr_groups; g++) {
+        const uint8_t *d = &gdt[g * desc_size];
+        Group &grp = groups[g];
+        bool wide = desc_size >= 64;
+
+        grp.block_bitmap = le32(d) | (wide ? static_cast<uint64_t>(le32(d + 0x20)) << 32 : 0);
+        grp.inode_bitmap = le32(d + 4) | (wide ? static_cast<uint64_t>(le32(d + 0x24)) << 32 : 0);
+        grp.inode_table = le32(d + 8) | (wide ? static_cast<uint64_t>(le32(d + 0x28)) << 32 : 0);
+        grp.flags = le16(d + 0x12);
+        if (grp.block_bitmap >= blocks || grp.inode_bitmap >= blocks ||
+            grp.inode_table + itable_blocks > blocks) {
+            error = "group " + std::to_string(g) + " has a descriptor out of range";
+            return false;
+        }
+        meta.push_back({ grp.block_bitmap, 1 });
+        meta.push_back({ grp.inode_bitmap, 1 });
+        meta.push_back({ grp.inode_table, itable_blocks });
+    }
+    std::sort(meta.begin(), meta.end(), [](const Extent &a, const Extent &b) {
+        return a.start < b.start;
+    });
+
+    // BLOCK_UNINIT only means something with group descriptor checksums
+    bool uninit_valid = ro_compat & (kRoCompatGdtCsum | kRoCompatMetadataCsum);
+    bool sparse = ro_compat & kRoCompatSparseSuper;
+    std::vector<uint8_t> bitmap(bs);
+    uint64_t free_blocks = 0;
+    size_t first_new = free.size();
+
+    auto add_free = [&](uint64_t block, uint64_t count) {
+        uint64_t start = base + block * bs;
+
+        free_blocks += count;
+        if (free.size() > first_new && free.back().start + free.back().length == start)
+            free.back().length += count * bs;
+        else
+            free.push_back({ start, count * bs });
+    };
+
+    for (uint64_t g = 0; g < nr_groups; g++) {
+        uint64_t first = first_data + g * per_group;
+        uint64_t count = std::min(per_group, blocks - first);
+
+        if (uninit_valid && (groups[g].flags & kGroupBlockUninit)) {
+            uint64_t super = has_super(g, sparse) ? 1 + gdt_blocks + reserved_gdt : 0;
+            uninit_bitmap(bitmap, first, count, super, meta);
+        } else if (!read_full(fd, bitmap.data(), bs, fs_offset + groups[g].block_bitmap * bs)) {
+            error = "cannot read the bitmap of group " + std::to_string(g) + ": " + strerror(errno);
+            free.resize(first_new);
+            return false;
+        }
+
+        uint64_t run = 0;
+        for (uint64_t b = 0; b < count;) {
+            if (b % 8 == 0 && b + 8 <= count && (bitmap[b / 8] == 0 || bitmap[b / 8] == 0xff)) {
+                if (bitmap[b / 8]) {
+                    if (b > run)
+                        add_free(first + run, b - run);
+                    run = b + 8;
+                }
+                b += 8;
+                continue;
+            }
+            if (bitmap[b / 8] & (1 << (b % 8))) {
+                if (b > run)
+                    add_free(first + run, b - run);
+                run = b + 1;
+            }
+            b++;
+        }
+        if (count > run)
+            add_free(first + run, count - run);
+    }
+
+    used_bytes = (blocks - free_blocks) * bs;
+    return true;
+}
+
+} // namespace radxa
@@ -0,0 +1,26 @@
+// Free space of an ext4 filesystem, from its group descriptors and block
+// bitmaps. Blocks in use, metadata included, are never reported free;
+// anything the reader does not understand makes it give up instead.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace radxa {
+
+struct Extent {
+    uint64_t start;             // Bytes
+    uint64_t length;
+};
+
+// The filesystem is read through fd, its first byte at fs_offset (0 for a
+// partition's own device node); extents are returned relative to base,
+// the partition's offset on the disk. Appends to free in ascending order.
+// False, with the reason in error, if there is no ext4 filesystem or one
+// this reader cannot map.
+bool ext4_free_extents(int fd, uint64_t fs_offset, uint64_t fs_size, uint64_t base,
+                       std::vector<Extent> &free, uint64_t &used_bytes, std::string &error);
+
+} // namespace radxa
@@ -0,0 +1,63 @@
+// The .rximg format
+//
+//     Header | chunk frames ... | Index (one IndexEntry per chunk) | Trailer
+//
+// The device is cut into chunk_size pieces (the last may be shorter). A
+// chunk is one zstd frame, or takes no space when it holds only zeros or
+// only blocks the filesystem does not use. Free blocks inside a stored
+// chunk are stored as zeros. The trailer finds the index, and the index
+// every frame, so chunks can be read and restored in any order.
+//
+// Integers are little-endian, as on every machine this runs on.
+
+#pragma once
+
+#include <cstdint>
+
+namespace radxa {
+namespace image {
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "the structs below are written as-is");
+
+constexpr char kMagic[8] = { 'R', 'X', 'I', 'M', 'G', '\r', '\n', 0x1a };
+constexpr uint32_t kVersion = 1;
+
+enum ChunkKind : uint32_t {
+    kChunkData = 0,             // A zstd frame
+    kChunkZero = 1,             // All zeros; written out on restore
+    kChunkFree = 2,             // Free filesystem blocks only; skipped on restore
+};
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t device_size;
+    uint32_t chunk_size;
+    uint32_t sector_size;
+    uint64_t nr_chunks;
+    uint8_t reserved[24];
+};
+
+struct IndexEntry {
+    uint64_t offset;            // Of the frame in the image; 0 unless data
+    uint32_t stored_size;
+    uint32_t kind;              // ChunkKind
+    uint32_t crc;               // crc32c of the chunk as restored (data only)
+    uint32_t reserved;
+};
+
+struct Trailer {
+    uint64_t index_offset;
+    uint64_t nr_chunks;
+    uint32_t index_crc;         // crc32c of the index entries
+    uint32_t reserved;
+    char magic[8];
+};
+
+static_assert(sizeof(Header) == 64, "Header layout");
+static_assert(sizeof(IndexEntry) == 24, "IndexEntry layout");
+static_assert(sizeof(Trailer) == 32, "Trailer layout");
+
+} // namespace image
+} // namespace radxa
@@ -0,0 +1,49 @@
+// Image creation and restore. Each returns the process exit status and
+// prints its own errors.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace radxa {
+
+struct CreateOptions {
+    std::string device;
+    std::string image;
+    unsigned threads = 0;           // 0: one per online CPU
+    int level = 3;                  // zstd level
+    uint32_t chunk_size = 4 << 20;
+    bool full = false;              // Copy free filesystem blocks too
+};
+
+struct RestoreOptions {
+    std::string image;
+    std::string target;             // Empty: verify only
+    unsigned threads = 0;
+    bool zero_free = false;         // Write zeros over free blocks
+};
+
+int create_image(const CreateOptions &opts);
+int restore_image(const RestoreOptions &opts);
+int print_info(const std::string &image);
+
+// "1.5 GiB"
+std::string human_size(uint64_t bytes);
+
+// One progress line on stderr, redrawn at most every 500 ms and only on
+// a terminal
+class Progress {
+public:
+    Progress(const char *verb, uint64_t total);
+    void update(uint64_t done, uint64_t stored);
+    void finish();
+
+private:
+    const char *verb_;
+    uint64_t total_;
+    bool tty_;
+    int64_t last_ms_ = 0;
+};
+
+} // namespace radxa
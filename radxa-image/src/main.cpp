@@ -0,0 +1,117 @@
+// radxa-image - sparse, parallel disk imaging
+//
+// Replaces "dd | gzip" for SD card backups: free ext4 blocks are neither
+// read nor stored, chunks are compressed with zstd on every core, and the
+// image is indexed so restores decompress in parallel and write only what
+// is needed.
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sched.h>
+#include <string>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+#include "imaging.h"
+
+// linux/ioprio.h is not in every libc's headers
+constexpr int kIoprioWhoProcess = 1;
+constexpr int kIoprioClassIdle = 3;
+constexpr int kIoprioClassShift = 13;
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s create [OPTIONS] DEVICE IMAGE\n"
+            "       %s restore [OPTIONS] IMAGE TARGET\n"
+            "       %s verify [-j N] IMAGE\n"
+            "       %s info IMAGE\n"
+            "  -j N         worker threads (default: one per CPU)\n"
+            "  -l LEVEL     zstd level for create (default 3)\n"
+            "  -c MIB       chunk size for create (default 4)\n"
+            "  --full       create: also copy free filesystem blocks\n"
+            "  --zero-free  restore: write zeros over free blocks on a block device\n"
+            "  --idle       run at idle CPU and I/O priority\n",
+            prog, prog, prog, prog);
+}
+
+// Threads started afterwards inherit both
+static void go_idle() {
+    struct sched_param param = {};
+
+    if (sched_setscheduler(0, SCHED_IDLE, &param))
+        perror("radxa-image: SCHED_IDLE");
+    if (syscall(SYS_ioprio_set, kIoprioWhoProcess, 0, kIoprioClassIdle << kIoprioClassShift))
+        perror("radxa-image: idle I/O priority");
+}
+
+static bool parse_uint(const char *s, unsigned long max, unsigned long &out) {
+    char *end;
+
+    errno = 0;
+    out = strtoul(s, &end, 10);
+    return !errno && *s && !*end && out <= max;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::string cmd = argv[1];
+    radxa::CreateOptions create;
+    radxa::RestoreOptions restore;
+    std::vector<std::string> args;
+    unsigned long threads = 0;
+    bool idle = false;
+
+    for (int i = 2; i < argc; i++) {
+        unsigned long v;
+
+        if (!strcmp(argv[i], "-j") && i + 1 < argc && parse_uint(argv[i + 1], 1024, v) && v) {
+            threads = v;
+            i++;
+        } else if (!strcmp(argv[i], "-l") && i + 1 < argc && parse_uint(argv[i + 1], 22, v) && v) {
+            create.level = v;
+            i++;
+        } else if (!strcmp(argv[i], "-c") && i + 1 < argc && parse_uint(argv[i + 1], 64, v) && v) {
+            create.chunk_size = v << 20;
+            i++;
+        } else if (!strcmp(argv[i], "--full")) {
+            create.full = true;
+        } else if (!strcmp(argv[i], "--zero-free")) {
+            restore.zero_free = true;
+        } else if (!strcmp(argv[i], "--idle")) {
+            idle = true;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 2;
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+
+    if (idle)
+        go_idle();
+    create.threads = restore.threads = threads;
+
+    if (cmd == "create" && args.size() == 2) {
+        create.device = args[0];
+        create.image = args[1];
+        return radxa::create_image(create);
+    }
+    if ((cmd == "restore" && args.size() == 2) || (cmd == "verify" && args.size() == 1)) {
+        restore.image = args[0];
+        if (args.size() == 2)
+            restore.target = args[1];
+        return radxa::restore_image(restore);
+    }
+    if (cmd == "info" && args.size() == 1)
+        return radxa::print_info(args[0]);
+
+    usage(argv[0]);
+    return 2;
+}
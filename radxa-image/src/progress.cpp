@@ -0,0 +1,43 @@
+#include "imaging.h"
+
+#include <chrono>
+#include <cstdio>
+#include <unistd.h>
+
+namespace radxa {
+
+std::string human_size(uint64_t bytes) {
+    static const char *const units[] = { "B", "KiB", "MiB", "GiB", "TiB" };
+    double v = bytes;
+    int u = 0;
+    char buf[32];
+
+    while (v >= 1024 && u < 4) {
+        v /= 1024;
+        u++;
+    }
+    snprintf(buf, sizeof(buf), u ? "%.1f %s" : "%.0f %s", v, units[u]);
+    return buf;
+}
+
+Progress::Progress(const char *verb, uint64_t total)
+    : verb_(verb), total_(total), tty_(isatty(STDERR_FILENO)) {}
+
+void Progress::update(uint64_t done, uint64_t stored) {
+    using namespace std::chrono;
+    int64_t now = duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+
+    if (!tty_ || now - last_ms_ < 500)
+        return;
+    last_ms_ = now;
+    fprintf(stderr, "\r%s %5.1f%%  %s of %s, %s in the image   ", verb_,
+            total_ ? 100.0 * done / total_ : 100.0, human_size(done).c_str(),
+            human_size(total_).c_str(), human_size(stored).c_str());
+}
+
+void Progress::finish() {
+    if (tty_ && last_ms_)
+        fputc('\n', stderr);
+}
+
+} // namespace radxa
@@ -0,0 +1,315 @@
+// Restore and verify: the index says where every chunk goes, so workers
+// take chunks in any order, decompress and check them and pwrite() them
+// straight to their offset.
+
+#include "imaging.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <mutex>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <zstd.h>
+
+#include "crc32c.h"
+#include "disk.h"
+#include "image_format.h"
+
+namespace radxa {
+
+namespace {
+
+struct ImageFile {
+    int fd = -1;
+    image::Header hdr{};
+    std::vector<image::IndexEntry> index;
+
+    ~ImageFile() {
+        if (fd >= 0)
+            close(fd);
+    }
+};
+
+bool open_image(const std::string &path, ImageFile &img, std::string &error) {
+    struct stat st;
+    image::Trailer trailer;
+
+    img.fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (img.fd < 0 || fstat(img.fd, &st)) {
+        error = path + ": " + strerror(errno);
+        return false;
+    }
+
+    uint64_t size = st.st_size;
+    if (size < sizeof(img.hdr) + sizeof(trailer) || !read_full(img.fd, &img.hdr, sizeof(img.hdr), 0) ||
+        !read_full(img.fd, &trailer, sizeof(trailer), size - sizeof(trailer)) ||
+        memcmp(img.hdr.magic, image::kMagic, sizeof(image::kMagic)) ||
+        memcmp(trailer.magic, image::kMagic, sizeof(image::kMagic))) {
+        error = path + ": not a complete radxa-image file";
+        return false;
+    }
+    if (img.hdr.version != image::kVersion) {
+        error = path + ": format version " + std::to_string(img.hdr.version) + " is not supported";
+        return false;
+    }
+
+    const image::Header &h = img.hdr;
+    uint64_t index_bytes = trailer.nr_chunks * sizeof(image::IndexEntry);
+    if (!h.chunk_size || h.header_size < sizeof(h) || trailer.nr_chunks != h.nr_chunks ||
+        h.nr_chunks != (h.device_size + h.chunk_size - 1) / h.chunk_size ||
+        trailer.index_offset < h.header_size ||
+        trailer.index_offset + index_bytes != size - sizeof(trailer)) {
+        error = path + ": inconsistent header";
+        return false;
+    }
+
+    img.index.resize(h.nr_chunks);
+    if (!read_full(img.fd, img.index.data(), index_bytes, trailer.index_offset)) {
+        error = path + ": " + strerror(errno);
+        return false;
+    }
+    if (crc32c(img.index.data(), index_bytes) != trailer.index_crc) {
+        error = path + ": index checksum mismatch";
+        return false;
+    }
+
+    size_t bound = ZSTD_compressBound(h.chunk_size);
+    for (uint64_t i = 0; i < h.nr_chunks; i++) {
+        const image::IndexEntry &e = img.index[i];
+
+        if (e.kind > image::kChunkFree ||
+            (e.kind == image::kChunkData &&
+             (e.offset < h.header_size || e.stored_size > bound ||
+              e.offset + e.stored_size > trailer.index_offset))) {
+            error = path + ": bad index entry for chunk " + std::to_string(i);
+            return false;
+        }
+    }
+    return true;
+}
+
+// BLKZEROOUT lets the device do it, where it can
+bool write_zeros(const Disk &target, const std::vector<char> &zeros, uint64_t start, uint64_t len) {
+    uint64_t range[2] = { start, len };
+
+    if (!ioctl(target.fd, BLKZEROOUT, range))
+        return true;
+    return write_full(target.fd, zeros.data(), len, start);
+}
+
+class Restorer {
+public:
+    Restorer(const ImageFile &img, const Disk *target, bool zero_free, unsigned threads)
+        : img_(img), target_(target), zero_free_(zero_free), threads_(threads),
+          progress_(target ? "Restoring" : "Verifying", img.hdr.device_size) {}
+
+    bool run(std::string &error) {
+        std::vector<std::thread> workers;
+
+        for (unsigned i = 0; i < threads_; i++)
+            workers.emplace_back(&Restorer::worker, this);
+
+        {
+            std::unique_lock<std::mutex> lk(lock_);
+            while (!cv_.wait_for(lk, std::chrono::milliseconds(200),
+                                 [this] { return finished_ == threads_; }))
+                progress_.update(done_bytes_, written_bytes_);
+        }
+        for (auto &w : workers)
+            w.join();
+        progress_.update(done_bytes_, written_bytes_);
+        progress_.finish();
+
+        error = error_;
+        return !failed_;
+    }
+
+private:
+    void fail(const std::string &msg) {
+        std::lock_guard<std::mutex> guard(lock_);
+        if (!failed_)
+            error_ = msg;
+        failed_ = true;
+    }
+
+    bool restore_chunk(uint64_t i, ZSTD_DCtx *dctx, std::vector<char> &frame,
+                       std::vector<char> &buf, const std::vector<char> &zeros) {
+        const image::Header &h = img_.hdr;
+        const image::IndexEntry &e = img_.index[i];
+        uint64_t start = i * h.chunk_size;
+        uint64_t len = std::min<uint64_t>(h.chunk_size, h.device_size - start);
+        std::string chunk = "chunk " + std::to_string(i);
+
+        if (e.kind != image::kChunkData) {
+            // A regular file target is all holes already
+            bool zero = e.kind == image::kChunkZero || zero_free_;
+            if (!target_ || !target_->block || !zero)
+                return true;
+            if (!write_zeros(*target_, zeros, start, len)) {
+                fail(target_->path + ": " + strerror(errno));
+                return false;
+            }
+            written_bytes_ += len;
+            return true;
+        }
+
+        frame.resize(e.stored_size);
+        if (!read_full(img_.fd, frame.data(), frame.size(), e.offset)) {
+            fail(chunk + ": " + strerror(errno));
+            return false;
+        }
+        size_t n = ZSTD_decompressDCtx(dctx, buf.data(), len, frame.data(), frame.size());
+        if (ZSTD_isError(n) || n != len) {
+            fail(chunk + ": " + (ZSTD_isError(n) ? ZSTD_getErrorName(n) : "short frame"));
+            return false;
+        }
+        if (crc32c(buf.data(), len) != e.crc) {
+            fail(chunk + ": checksum mismatch");
+            return false;
+        }
+        if (target_) {
+            if (!write_full(target_->fd, buf.data(), len, start)) {
+                fail(target_->path + ": " + strerror(errno));
+                return false;
+            }
+            written_bytes_ += len;
+        }
+        return true;
+    }
+
+    void worker() {
+        ZSTD_DCtx *dctx = ZSTD_createDCtx();
+        std::vector<char> frame, buf(img_.hdr.chunk_size);
+        std::vector<char> zeros(target_ && target_->block ? img_.hdr.chunk_size : 0);
+
+        if (!dctx)
+            fail("cannot create a zstd context");
+        while (dctx) {
+            uint64_t i = next_++;
+
+            if (i >= img_.index.size() || failed_)
+                break;
+            if (!restore_chunk(i, dctx, frame, buf, zeros))
+                break;
+            done_bytes_ += std::min<uint64_t>(img_.hdr.chunk_size,
+                                              img_.hdr.device_size - i * img_.hdr.chunk_size);
+        }
+        ZSTD_freeDCtx(dctx);
+
+        std::lock_guard<std::mutex> guard(lock_);
+        finished_++;
+        cv_.notify_all();
+    }
+
+    const ImageFile &img_;
+    const Disk *target_;
+    bool zero_free_;
+    unsigned threads_;
+    Progress progress_;
+    std::atomic<uint64_t> next_{ 0 };
+    std::atomic<uint64_t> done_bytes_{ 0 };
+    std::atomic<uint64_t> written_bytes_{ 0 };
+    std::atomic<bool> failed_{ false };
+
+    std::mutex lock_;               // Everything below
+    std::condition_variable cv_;
+    unsigned finished_ = 0;
+    std::string error_;
+};
+
+} // namespace
+
+int restore_image(const RestoreOptions &opts) {
+    ImageFile img;
+    Disk target;
+    std::string error;
+
+    if (!open_image(opts.image, img, error)) {
+        fprintf(stderr, "radxa-image: %s\n", error.c_str());
+        return 1;
+    }
+
+    bool verify = opts.target.empty();
+    if (!verify) {
+        if (!open_disk(opts.target, O_WRONLY | O_CREAT, target, error)) {
+            fprintf(stderr, "radxa-image: %s\n", error.c_str());
+            return 1;
+        }
+        // Old contents would show through the chunks that are skipped
+        if (!target.block && (ftruncate(target.fd, 0) || ftruncate(target.fd, img.hdr.device_size))) {
+            fprintf(stderr, "radxa-image: %s: %s\n", opts.target.c_str(), strerror(errno));
+            close_disk(target);
+            return 1;
+        }
+        if (target.block && target.size < img.hdr.device_size) {
+            fprintf(stderr, "radxa-image: %s: %s is smaller than the image's %s\n",
+                    opts.target.c_str(), human_size(target.size).c_str(),
+                    human_size(img.hdr.device_size).c_str());
+            close_disk(target);
+            return 1;
+        }
+    }
+
+    unsigned threads = opts.threads ? opts.threads : std::max(1L, sysconf(_SC_NPROCESSORS_ONLN));
+    Restorer restorer(img, verify ? nullptr : &target, opts.zero_free, threads);
+    bool ok = restorer.run(error);
+    if (ok && !verify && fsync(target.fd)) {
+        error = opts.target + ": " + strerror(errno);
+        ok = false;
+    }
+    close_disk(target);
+
+    if (!ok) {
+        fprintf(stderr, "radxa-image: %s\n", error.c_str());
+        return 1;
+    }
+    if (verify)
+        fprintf(stderr, "%s: all %llu chunks check out\n", opts.image.c_str(),
+                static_cast<unsigned long long>(img.index.size()));
+    else
+        fprintf(stderr, "%s: restored %s\n", opts.target.c_str(),
+                human_size(img.hdr.device_size).c_str());
+    return 0;
+}
+
+int print_info(const std::string &path) {
+    ImageFile img;
+    std::string error;
+
+    if (!open_image(path, img, error)) {
+        fprintf(stderr, "radxa-image: %s\n", error.c_str());
+        return 1;
+    }
+
+    uint64_t counts[3] = {}, stored = 0;
+    for (const auto &e : img.index) {
+        counts[e.kind]++;
+        stored += e.stored_size;
+    }
+    uint64_t data = counts[image::kChunkData] * img.hdr.chunk_size;
+
+    printf("device size:  %s (%llu bytes, %u-byte sectors)\n", human_size(img.hdr.device_size).c_str(),
+           static_cast<unsigned long long>(img.hdr.device_size), img.hdr.sector_size);
+    printf("chunk size:   %s\n", human_size(img.hdr.chunk_size).c_str());
+    printf("chunks:       %llu data, %llu zero, %llu free\n",
+           static_cast<unsigned long long>(counts[image::kChunkData]),
+           static_cast<unsigned long long>(counts[image::kChunkZero]),
+           static_cast<unsigned long long>(counts[image::kChunkFree]));
+    printf("stored:       %s", human_size(stored).c_str());
+    if (stored)
+        printf(" (%.2fx on the data chunks)", static_cast<double>(data) / stored);
+    printf("\n");
+    return 0;
+}
+
+} // namespace radxa
@@ -12,6 +12,16 @@ SD_DEVICE="/dev/mmcblk0"
 USB_DEVICE="/dev/sda"
 IMAGE_FILE="/home/radxa/radxa_overclocked_system_$(date +%Y%m%d_%H%M%S).img"
 
+# radxa-image skips free ext4 blocks and compresses on every core; without
+# it, fall back to dd | gzip
+RADXA_IMAGE=$(command -v radxa-image || echo "$(dirname "$0")/../radxa-image/radxa-image")
+if [ -x "$RADXA_IMAGE" ]; then
+    IMAGE_OUT="$IMAGE_FILE.rximg"
+else
+    RADXA_IMAGE=""
+    IMAGE_OUT="$IMAGE_FILE.gz"
+fi
+
 echo "📊 CLONING OPTIONS:"
 echo "------------------"
 echo "1. Direct clone SD → USB (for immediate use)"
@@ -142,12 +152,18 @@ if [ "$MODE" = "image_only" ] || [ "$MODE" = "both" ]; then
     echo ""
     echo "📁 CREATING DOWNLOADABLE IMAGE FILE:"
     echo "-----------------------------------"
-    echo "Creating: $IMAGE_FILE"
-    echo "This will take 15-30 minutes..."
+    echo "Creating: $IMAGE_OUT"
     echo ""
     
-    # Create compressed image with progress
-    sudo dd if=$SD_DEVICE bs=4M status=progress | gzip -c > "$IMAGE_FILE.gz"
+    # Create compressed image with progress; --idle leaves the CPUs and the
+    # card to whatever else is running
+    if [ -n "$RADXA_IMAGE" ]; then
+        sudo "$RADXA_IMAGE" create --idle "$SD_DEVICE" "$IMAGE_OUT"
+    else
+        echo "radxa-image not found (make -C radxa-image), using dd | gzip"
+        echo "This will take 15-30 minutes..."
+        sudo dd if=$SD_DEVICE bs=4M status=progress | gzip -c > "$IMAGE_OUT"
+    fi
     
     if [ $? -eq 0 ]; then
         echo ""
@@ -155,14 +171,22 @@ if [ "$MODE" = "image_only" ] || [ "$MODE" = "both" ]; then
         
         # Calculate sizes
         original_size=$(numfmt --to=iec $sd_size)
-        compressed_size=$(ls -lh "$IMAGE_FILE.gz" | awk '{print $5}')
+        compressed_size=$(ls -lh "$IMAGE_OUT" | awk '{print $5}')
         
         echo "📊 Image Details:"
         echo "  Original size: $original_size"
         echo "  Compressed size: $compressed_size"
-        echo "  Location: $IMAGE_FILE.gz"
+        echo "  Location: $IMAGE_OUT"
         echo ""
         
+        if [ -n "$RADXA_IMAGE" ]; then
+            RESTORE_USB="sudo radxa-image restore $(basename "$IMAGE_OUT") /dev/sdX"
+            RESTORE_SD="sudo radxa-image restore $(basename "$IMAGE_OUT") /dev/mmcblkX"
+        else
+            RESTORE_USB="gunzip -c $(basename "$IMAGE_OUT") | sudo dd of=/dev/sdX bs=4M status=progress"
+            RESTORE_SD="gunzip -c $(basename "$IMAGE_OUT") | sudo dd of=/dev/mmcblkX bs=4M status=progress"
+        fi
+        
         # Create restoration instructions
         cat > "${IMAGE_FILE%.img}_RESTORE_INSTRUCTIONS.txt" << EOF
 🚀 RADXA OVERCLOCKED SYSTEM IMAGE 🚀
@@ -178,11 +202,11 @@ This image contains your complete overclocked Radxa system:
 ========================
 
 1. FLASH TO USB DRIVE:
-   gunzip -c $(basename "$IMAGE_FILE.gz") | sudo dd of=/dev/sdX bs=4M status=progress
+   $RESTORE_USB
    (Replace /dev/sdX with your USB device)
 
 2. OR FLASH TO SD CARD:
-   gunzip -c $(basename "$IMAGE_FILE.gz") | sudo dd of=/dev/mmcblkX bs=4M status=progress
+   $RESTORE_SD
    (Replace /dev/mmcblkX with your SD device)
 
 3. BOOT AND ENJOY:
@@ -252,8 +276,8 @@ echo ""
 
 if [ "$MODE" = "image_only" ] || [ "$MODE" = "both" ]; then
     echo "📁 DOWNLOADABLE IMAGE:"
-    echo "  File: $IMAGE_FILE.gz"
-    echo "  Size: $(ls -lh "$IMAGE_FILE.gz" | awk '{print $5}')"
+    echo "  File: $IMAGE_OUT"
+    echo "  Size: $(ls -lh "$IMAGE_OUT" | awk '{print $5}')"
     echo "  Instructions: ${IMAGE_FILE%.img}_RESTORE_INSTRUCTIONS.txt"
     echo ""
 fi
@@ -280,7 +304,7 @@ fi
 
 if [ "$MODE" = "image_only" ] || [ "$MODE" = "both" ]; then
     echo "FOR IMAGE BACKUP:"
-    echo "1. Copy .gz file to safe location"
+    echo "1. Copy the image file to a safe location"
     echo "2. Use anytime to restore system"
     echo "3. Flash to any USB/SD device"
     echo "4. Share your overclocked system!"
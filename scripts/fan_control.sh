@@ -5,6 +5,7 @@
 
 FAN_PWM_PATH="/sys/devices/platform/pwm-fan/hwmon/hwmon8/pwm1"
 TEMP_PATH="/sys/class/thermal/thermal_zone0/temp"
+FAN_MODULE_PATH="/sys/kernel/fan_control"
 
 # Check if fan control is available
 if [ ! -f "$FAN_PWM_PATH" ]; then
@@ -56,6 +57,15 @@ show_status() {
 }
 
 thermal_control() {
+    # The kernel controller also pre-spins the fan when the overclocking
+    # modules step the clocks up, before the temperature follows
+    if [ -f "$FAN_MODULE_PATH/fan_speed" ]; then
+        echo "thermal" | sudo tee "$FAN_MODULE_PATH/fan_speed" > /dev/null
+        echo "🌡️ Thermal control handed to the fan_control module (with feed-forward)"
+        echo "Feed-forward: $(cat "$FAN_MODULE_PATH/ff_pwm_per_w") PWM/W, held $(cat "$FAN_MODULE_PATH/ff_hold_ms") ms"
+        return
+    fi
+    
     echo "🌡️ Starting thermal-based fan control..."
     echo "Press Ctrl+C to stop"
     
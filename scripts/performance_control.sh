@@ -7,18 +7,27 @@ echo "🚀 RADXA PERFORMANCE CONTROL CENTER 🚀"
 echo "========================================"
 echo ""
 
+NPU_SYSFS="/sys/devices/platform/soc@3000000/3600000.npu"
+
 # Get current system status
 get_current_status() {
     local cpu_e_freq=$(cat /sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq 2>/dev/null || echo "0")
     local cpu_p_freq=$(cat /sys/devices/system/cpu/cpu6/cpufreq/scaling_cur_freq 2>/dev/null || echo "0")
-    local npu_freq=$(grep "NPU:" /sys/devices/platform/soc@3000000/3600000.npu/llm_overclock 2>/dev/null | awk '{print $2}' || echo "Unknown")
-    local gpu_freq=$(grep "GPU:" /sys/devices/platform/soc@3000000/3600000.npu/llm_overclock 2>/dev/null | awk '{print $2}' || echo "Unknown")
+    local npu_freq="Unknown" gpu_freq="Unknown" hz
+    
+    # One value per file - read with the shell builtin, no grep/awk pipelines
+    if read -r hz < "$NPU_SYSFS/llm_npu/cur_freq_hz" 2>/dev/null; then
+        npu_freq=$((hz / 1000000))
+    fi
+    if read -r hz < "$NPU_SYSFS/llm_gpu/cur_freq_hz" 2>/dev/null; then
+        gpu_freq=$((hz / 1000000))
+    fi
     
     # Check CPU overclock module status
     local cpu_oc_status="Standard"
-    if [ -f "/sys/kernel/cpu_overclock/overclock" ]; then
-        local cpu_oc_e=$(grep "CPU_E:" /sys/kernel/cpu_overclock/overclock 2>/dev/null | awk '{print $2}')
-        if [ "$cpu_oc_e" -gt "1794" ] 2>/dev/null; then
+    if read -r hz < /sys/kernel/cpu_overclock/efficiency/cur_freq_hz 2>/dev/null; then
+        local cpu_oc_e=$((hz / 1000000))
+        if [ "$cpu_oc_e" -gt "1794" ]; then
             cpu_oc_status="🔥 OVERCLOCKED to ${cpu_oc_e}MHz"
         fi
     fi
@@ -46,6 +55,8 @@ apply_profile() {
             echo "🔥 Applying EXTREME performance profile..."
             # Set CPU to overclocked frequencies
             if [ -f "/sys/kernel/cpu_overclock/overclock" ]; then
+                # Above-stock CPU points are registered as cpufreq boost OPPs
+                echo 1 | sudo tee /sys/devices/system/cpu/cpufreq/boost > /dev/null 2>&1
                 echo "2080,0" | sudo tee /sys/kernel/cpu_overclock/overclock > /dev/null
                 echo "✅ CPU overclocked to 2080MHz"
             fi
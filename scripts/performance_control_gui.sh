@@ -81,6 +81,7 @@ apply_profile() {
         # Enable performance mode for memory
         echo performance | sudo tee /sys/devices/platform/a020000.dmcfreq/devfreq/a020000.dmcfreq/governor > /dev/null 2>&1
     else
+        # ram_overclock's bandwidth governor raises the floor when traffic needs it
         echo powersave | sudo tee /sys/devices/platform/a020000.dmcfreq/devfreq/a020000.dmcfreq/governor > /dev/null 2>&1
     fi
     
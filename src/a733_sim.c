@@ -0,0 +1,649 @@
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/platform_device.h>
+#include <linux/clk-provider.h>
+#include <linux/clkdev.h>
+#include <linux/cpumask.h>
+#include <linux/delay.h>
+#include <linux/hwmon.h>
+#include <linux/regulator/driver.h>
+#include <linux/regulator/machine.h>
+#include <linux/thermal.h>
+#include <linux/workqueue.h>
+#include <linux/sysfs.h>
+#include <linux/kobject.h>
+#include <linux/slab.h>
+
+#include "radxa_energy_model.h"
+
+// Stand-in for the A733 board: the devices, clocks, rails, thermal zone
+// and fan the overclocking modules look up, modeled closely enough that
+// the modules load unchanged and their transition latency and governor
+// behavior can be benchmarked on any Linux machine.
+
+#define MODULE_NAME "a733_sim"
+#define SIM_DEVICE_NAME "a733-sim"
+#define NPU_DEVICE_NAME "3600000.npu"
+#define GPU_DEVICE_NAME "1800000.gpu"
+#define DMC_DEVICE_NAME "a020000.dmcfreq"
+#define FAN_DEVICE_NAME "pwm-fan"
+
+// Divider clocks hang off a fixed peripheral PLL
+#define SIM_PERIPH_HZ 2400000000UL
+
+// AXP-style DCDC: 10 mV steps from 500 mV
+#define SIM_MIN_UV 500000
+#define SIM_MAX_UV 1540000
+#define SIM_STEP_UV 10000
+
+// The NPU has no rail of its own the modules scale
+#define SIM_NPU_UV 900000
+
+static unsigned int pll_step_khz = 24000;
+module_param(pll_step_khz, uint, 0444);
+MODULE_PARM_DESC(pll_step_khz, "PLL output granularity; rates round down to it");
+
+static unsigned int pll_lock_us = 100;
+module_param(pll_lock_us, uint, 0644);
+MODULE_PARM_DESC(pll_lock_us, "Time a PLL takes to relock after a rate change");
+
+static unsigned int ramp_uv_per_us = 2500;
+module_param(ramp_uv_per_us, uint, 0444);
+MODULE_PARM_DESC(ramp_uv_per_us, "Voltage slew rate of the rails, uV/us");
+
+static int first_p_cpu = 6;
+module_param(first_p_cpu, int, 0444);
+MODULE_PARM_DESC(first_p_cpu, "First CPU of the performance cluster (0: a single cluster)");
+
+static char *thermal_zone = "cpu-thermal";
+module_param(thermal_zone, charp, 0444);
+MODULE_PARM_DESC(thermal_zone, "Name of the simulated thermal zone");
+
+static unsigned int load_pct = 50;
+module_param(load_pct, uint, 0644);
+MODULE_PARM_DESC(load_pct, "Activity factor applied to the dynamic power, percent");
+
+static unsigned int static_mw = 400;
+module_param(static_mw, uint, 0644);
+MODULE_PARM_DESC(static_mw, "Leakage and uncore power, mW");
+
+static int ambient_mc = 25000;
+module_param(ambient_mc, int, 0644);
+MODULE_PARM_DESC(ambient_mc, "Ambient temperature, millidegrees C");
+
+static unsigned int rth_still = 9000;
+module_param(rth_still, uint, 0644);
+MODULE_PARM_DESC(rth_still, "Thermal resistance with the fan off, millidegrees C/W");
+
+static unsigned int rth_fan = 3500;
+module_param(rth_fan, uint, 0644);
+MODULE_PARM_DESC(rth_fan, "Thermal resistance with the fan at full speed, millidegrees C/W");
+
+static unsigned int tau_ms = 30000;
+module_param(tau_ms, uint, 0644);
+MODULE_PARM_DESC(tau_ms, "Thermal time constant of SoC and heatsink");
+
+static unsigned int tick_ms = 100;
+module_param(tick_ms, uint, 0444);
+MODULE_PARM_DESC(tick_ms, "Step of the thermal model");
+
+enum sim_clk_id {
+    SIM_CLK_CPU_E,
+    SIM_CLK_CPU_P,
+    SIM_CLK_DDR,
+    SIM_CLK_NPU,
+    SIM_CLK_NPU_BUS,
+    SIM_CLK_NPU_REG,
+    SIM_CLK_GPU,
+    SIM_CLK_GPU_BUS,
+    NR_SIM_CLKS,
+};
+
+struct sim_clk_desc {
+    const char *name;
+    unsigned long hz;               // Rate at load, the stock maximum
+    unsigned long min_hz, max_hz;
+    bool pll;                       // Else a divider of SIM_PERIPH_HZ
+};
+
+static const struct sim_clk_desc sim_clk_descs[NR_SIM_CLKS] = {
+    [SIM_CLK_CPU_E]   = { "sim-pll-cpu-e", 1794000000UL, 408000000UL, 3000000000UL, true },
+    [SIM_CLK_CPU_P]   = { "sim-pll-cpu-p", 2002000000UL, 408000000UL, 3000000000UL, true },
+    [SIM_CLK_DDR]     = { "sim-pll-ddr",   1800000000UL, 192000000UL, 2808000000UL, true },
+    [SIM_CLK_NPU]     = { "sim-pll-npu",   1008000000UL, 192000000UL, 2520000000UL, true },
+    [SIM_CLK_NPU_BUS] = { "sim-npu-bus",    600000000UL,  75000000UL, 1200000000UL, false },
+    [SIM_CLK_NPU_REG] = { "sim-npu-reg",    300000000UL,  75000000UL,  600000000UL, false },
+    [SIM_CLK_GPU]     = { "sim-pll-gpu",    840000000UL, 192000000UL, 1800000000UL, true },
+    [SIM_CLK_GPU_BUS] = { "sim-gpu-bus",    600000000UL,  75000000UL, 1200000000UL, false },
+};
+
+struct sim_clk {
+    struct clk_hw hw;
+    const struct sim_clk_desc *desc;
+    unsigned long rate;             // Set under the clk prepare lock
+};
+
+#define to_sim_clk(_hw) container_of(_hw, struct sim_clk, hw)
+
+enum sim_rail_id {
+    SIM_RAIL_CPU,
+    SIM_RAIL_DRAM,
+    SIM_RAIL_GPU_SYS,
+    NR_SIM_RAILS,
+};
+
+// Consumer names as the modules ask for them: regulator_get(NULL, ...),
+// and the mali supply of the GPU's OPP table
+static struct regulator_consumer_supply cpu_supplies[] = {
+    REGULATOR_SUPPLY("cpu", NULL),
+};
+
+static struct regulator_consumer_supply dram_supplies[] = {
+    REGULATOR_SUPPLY("vdd-dram", NULL),
+};
+
+static struct regulator_consumer_supply gpu_sys_supplies[] = {
+    REGULATOR_SUPPLY("vdd-gpu-sys", NULL),
+    REGULATOR_SUPPLY("mali", GPU_DEVICE_NAME),
+};
+
+#define SIM_RAIL_INIT(_name, _supplies)                                     \
+    {                                                                       \
+        .constraints = {                                                    \
+            .name = _name,                                                  \
+            .min_uV = SIM_MIN_UV,                                           \
+            .max_uV = SIM_MAX_UV,                                           \
+            .valid_ops_mask = REGULATOR_CHANGE_VOLTAGE,                     \
+            .always_on = 1,                                                 \
+        },                                                                  \
+        .num_consumer_supplies = ARRAY_SIZE(_supplies),                     \
+        .consumer_supplies = _supplies,                                     \
+    }
+
+static struct regulator_init_data sim_rail_init[NR_SIM_RAILS] = {
+    [SIM_RAIL_CPU]     = SIM_RAIL_INIT("vdd-cpu", cpu_supplies),
+    [SIM_RAIL_DRAM]    = SIM_RAIL_INIT("vdd-dram", dram_supplies),
+    [SIM_RAIL_GPU_SYS] = SIM_RAIL_INIT("vdd-gpu-sys", gpu_sys_supplies),
+};
+
+static const unsigned int sim_rail_boot_uv[NR_SIM_RAILS] = {
+    [SIM_RAIL_CPU]     = 900000,
+    [SIM_RAIL_DRAM]    = 1100000,
+    [SIM_RAIL_GPU_SYS] = 900000,
+};
+
+struct sim_rail {
+    struct regulator_desc desc;
+    struct regulator_dev *rdev;
+    unsigned int sel;
+};
+
+// What draws power: a clock at the voltage of a rail (-1: SIM_NPU_UV),
+// with the modules' default coefficients in uW/MHz/V^2
+struct sim_load {
+    int clk;
+    int rail;
+    unsigned int coeff;
+};
+
+static const struct sim_load sim_loads[] = {
+    { SIM_CLK_CPU_E, SIM_RAIL_CPU, 120 },       // Per CPU
+    { SIM_CLK_CPU_P, SIM_RAIL_CPU, 480 },       // Per CPU
+    { SIM_CLK_DDR, SIM_RAIL_DRAM, 150 },
+    { SIM_CLK_NPU, -1, 1500 },
+    { SIM_CLK_GPU, SIM_RAIL_GPU_SYS, 1200 },
+};
+
+struct a733_sim_data {
+    struct platform_device *sim_pdev;
+    struct platform_device *npu_pdev;
+    struct platform_device *gpu_pdev;
+    struct platform_device *dmc_pdev;
+    struct platform_device *fan_pdev;
+    struct sim_clk clk[NR_SIM_CLKS];
+    struct clk_lookup **lookups;
+    int nr_lookups;
+    struct sim_rail rail[NR_SIM_RAILS];
+    struct thermal_zone_device *tz;
+    struct device *hwmon;
+    struct kobject *kobj;
+    struct delayed_work tick_work;
+    unsigned int nr_cpus[2];        // Efficiency, performance
+    unsigned int fan_pwm;
+    unsigned long power_mw;
+    int temp_mc;
+};
+
+static struct a733_sim_data *g_sim;
+
+// PLLs step in multiples of their reference, dividers in integer
+// fractions of the peripheral PLL; both round down
+static unsigned long sim_clk_round(const struct sim_clk_desc *d, unsigned long rate) {
+    unsigned long step = pll_step_khz * 1000UL;
+
+    rate = clamp(rate, d->min_hz, d->max_hz);
+    if (!d->pll)
+        return SIM_PERIPH_HZ / DIV_ROUND_UP(SIM_PERIPH_HZ, rate);
+    if (step)
+        rate -= rate % step;
+    return max(rate, d->min_hz);
+}
+
+static unsigned long sim_clk_recalc_rate(struct clk_hw *hw, unsigned long parent_rate) {
+    return to_sim_clk(hw)->rate;
+}
+
+static int sim_clk_determine_rate(struct clk_hw *hw, struct clk_rate_request *req) {
+    req->rate = sim_clk_round(to_sim_clk(hw)->desc, req->rate);
+    return 0;
+}
+
+// The output is gated while the PLL relocks; a divider switches at once
+static int sim_clk_set_rate(struct clk_hw *hw, unsigned long rate, unsigned long parent_rate) {
+    struct sim_clk *sc = to_sim_clk(hw);
+    unsigned int lock_us = READ_ONCE(pll_lock_us);
+
+    if (sc->desc->pll && rate != sc->rate && lock_us)
+        fsleep(lock_us);
+    WRITE_ONCE(sc->rate, rate);
+    return 0;
+}
+
+static const struct clk_ops sim_clk_ops = {
+    .recalc_rate = sim_clk_recalc_rate,
+    .determine_rate = sim_clk_determine_rate,
+    .set_rate = sim_clk_set_rate,
+};
+
+static int sim_rail_get_voltage_sel(struct regulator_dev *rdev) {
+    struct sim_rail *r = rdev_get_drvdata(rdev);
+
+    return READ_ONCE(r->sel);
+}
+
+static int sim_rail_set_voltage_sel(struct regulator_dev *rdev, unsigned int sel) {
+    struct sim_rail *r = rdev_get_drvdata(rdev);
+
+    WRITE_ONCE(r->sel, sel);
+    return 0;
+}
+
+// The core waits out set_voltage_time_sel after each change
+static const struct regulator_ops sim_rail_ops = {
+    .list_voltage = regulator_list_voltage_linear,
+    .map_voltage = regulator_map_voltage_linear,
+    .get_voltage_sel = sim_rail_get_voltage_sel,
+    .set_voltage_sel = sim_rail_set_voltage_sel,
+    .set_voltage_time_sel = regulator_set_voltage_time_sel,
+};
+
+static unsigned int sim_rail_uv(int rail) {
+    if (rail < 0)
+        return SIM_NPU_UV;
+    return SIM_MIN_UV + READ_ONCE(g_sim->rail[rail].sel) * SIM_STEP_UV;
+}
+
+static unsigned long sim_power_mw(void) {
+    unsigned long mw = 0;
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(sim_loads); i++) {
+        const struct sim_load *l = &sim_loads[i];
+        unsigned long p = radxa_em_power_mw(l->coeff, READ_ONCE(g_sim->clk[l->clk].rate),
+                                            sim_rail_uv(l->rail));
+
+        if (l->clk == SIM_CLK_CPU_E || l->clk == SIM_CLK_CPU_P)
+            p *= g_sim->nr_cpus[l->clk - SIM_CLK_CPU_E];
+        mw += p;
+    }
+    return READ_ONCE(static_mw) + mw * min(READ_ONCE(load_pct), 100U) / 100;
+}
+
+// First-order model: the temperature approaches ambient + P * Rth with
+// time constant tau_ms, Rth falling linearly with the fan's duty cycle
+static void sim_tick_work(struct work_struct *work) {
+    unsigned int pwm = READ_ONCE(g_sim->fan_pwm);
+    long still = READ_ONCE(rth_still), fan = READ_ONCE(rth_fan);
+    long rth = still - (still - fan) * (long)pwm / 255;
+    unsigned long mw = sim_power_mw();
+    long target = READ_ONCE(ambient_mc) + (long)mw * rth / 1000;
+    long tau = max(READ_ONCE(tau_ms), tick_ms);
+    long t = g_sim->temp_mc;
+
+    t += DIV_ROUND_CLOSEST((target - t) * (long)tick_ms, tau);
+    WRITE_ONCE(g_sim->power_mw, mw);
+    WRITE_ONCE(g_sim->temp_mc, t);
+    schedule_delayed_work(&g_sim->tick_work, msecs_to_jiffies(tick_ms));
+}
+
+static int sim_get_temp(struct thermal_zone_device *tz, int *temp) {
+    *temp = READ_ONCE(g_sim->temp_mc);
+    return 0;
+}
+
+static struct thermal_zone_device_ops sim_tz_ops = {
+    .get_temp = sim_get_temp,
+};
+
+// The pwm-fan hwmon interface, as far as fan_control uses it
+static ssize_t pwm1_show(struct device *dev, struct device_attribute *attr, char *buf) {
+    return sprintf(buf, "%u\n", READ_ONCE(g_sim->fan_pwm));
+}
+
+static ssize_t pwm1_store(struct device *dev, struct device_attribute *attr,
+                          const char *buf, size_t count) {
+    unsigned int val;
+
+    if (kstrtouint(buf, 0, &val) || val > 255)
+        return -EINVAL;
+    WRITE_ONCE(g_sim->fan_pwm, val);
+    return count;
+}
+
+static DEVICE_ATTR_RW(pwm1);
+
+static struct attribute *sim_fan_attrs[] = {
+    &dev_attr_pwm1.attr,
+    NULL,
+};
+ATTRIBUTE_GROUPS(sim_fan);
+
+static ssize_t power_mw_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%lu\n", READ_ONCE(g_sim->power_mw));
+}
+
+static ssize_t temp_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%d\n", READ_ONCE(g_sim->temp_mc));
+}
+
+static struct kobj_attribute power_mw_attr = __ATTR_RO(power_mw);
+static struct kobj_attribute temp_attr = __ATTR_RO(temp);
+
+static struct attribute *a733_sim_attrs[] = {
+    &power_mw_attr.attr,
+    &temp_attr.attr,
+    NULL,
+};
+
+static const struct attribute_group a733_sim_group = {
+    .attrs = a733_sim_attrs,
+};
+
+static void unregister_devices(void) {
+    struct platform_device **pdevs[] = {
+        &g_sim->fan_pdev, &g_sim->dmc_pdev, &g_sim->gpu_pdev, &g_sim->npu_pdev, &g_sim->sim_pdev,
+    };
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(pdevs); i++) {
+        if (!IS_ERR_OR_NULL(*pdevs[i]))
+            platform_device_unregister(*pdevs[i]);
+        *pdevs[i] = NULL;
+    }
+}
+
+// Named like the board's, at /sys/devices/platform/<name>
+static int register_devices(void) {
+    struct {
+        struct platform_device **pdev;
+        const char *name;
+    } devs[] = {
+        { &g_sim->sim_pdev, SIM_DEVICE_NAME },
+        { &g_sim->npu_pdev, NPU_DEVICE_NAME },
+        { &g_sim->gpu_pdev, GPU_DEVICE_NAME },
+        { &g_sim->dmc_pdev, DMC_DEVICE_NAME },
+        { &g_sim->fan_pdev, FAN_DEVICE_NAME },
+    };
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(devs); i++) {
+        *devs[i].pdev = platform_device_register_simple(devs[i].name, PLATFORM_DEVID_NONE, NULL, 0);
+        if (IS_ERR(*devs[i].pdev)) {
+            int ret = PTR_ERR(*devs[i].pdev);
+
+            pr_err("A733_SIM: Could not register %s: %d\n", devs[i].name, ret);
+            unregister_devices();
+            return ret;
+        }
+    }
+    return 0;
+}
+
+static void unregister_clocks(void) {
+    int i;
+
+    for (i = 0; i < g_sim->nr_lookups; i++)
+        clkdev_drop(g_sim->lookups[i]);
+    kfree(g_sim->lookups);
+    g_sim->lookups = NULL;
+    g_sim->nr_lookups = 0;
+
+    for (i = 0; i < NR_SIM_CLKS; i++) {
+        if (!g_sim->clk[i].desc)
+            continue;
+        clk_hw_unregister(&g_sim->clk[i].hw);
+        g_sim->clk[i].desc = NULL;
+    }
+}
+
+static int add_lookup(enum sim_clk_id id, const char *con_id, const char *dev_id) {
+    struct clk_lookup *cl = clkdev_hw_create(&g_sim->clk[id].hw, con_id, "%s", dev_id);
+
+    if (!cl)
+        return -ENOMEM;
+    g_sim->lookups[g_sim->nr_lookups++] = cl;
+    return 0;
+}
+
+// Lookups stand in for the device tree's clocks properties: cpuN (no
+// con_id) for clk_get(get_cpu_device(N), NULL), the NPU's core/bus/reg,
+// and for the GPU a core clock that also answers NULL, "gpu" and "core"
+static int register_clocks(void) {
+    char cpu_name[16];
+    int i, cpu, ret;
+
+    for (i = 0; i < NR_SIM_CLKS; i++) {
+        struct sim_clk *sc = &g_sim->clk[i];
+        struct clk_init_data init = {
+            .name = sim_clk_descs[i].name,
+            .ops = &sim_clk_ops,
+        };
+
+        sc->desc = &sim_clk_descs[i];
+        sc->rate = sc->desc->hz;
+        sc->hw.init = &init;
+        ret = clk_hw_register(NULL, &sc->hw);
+        if (ret) {
+            sc->desc = NULL;
+            goto err;
+        }
+    }
+
+    // One per CPU, DDR, three for the NPU and two for the GPU
+    g_sim->lookups = kcalloc(nr_cpu_ids + 6, sizeof(*g_sim->lookups), GFP_KERNEL);
+    if (!g_sim->lookups) {
+        ret = -ENOMEM;
+        goto err;
+    }
+
+    for_each_possible_cpu(cpu) {
+        bool perf = cpu >= first_p_cpu && first_p_cpu > 0;
+
+        snprintf(cpu_name, sizeof(cpu_name), "cpu%d", cpu);
+        ret = add_lookup(perf ? SIM_CLK_CPU_P : SIM_CLK_CPU_E, NULL, cpu_name);
+        if (ret)
+            goto err;
+        g_sim->nr_cpus[perf]++;
+    }
+
+    ret = add_lookup(SIM_CLK_DDR, NULL, DMC_DEVICE_NAME);
+    if (!ret)
+        ret = add_lookup(SIM_CLK_NPU, "core", NPU_DEVICE_NAME);
+    if (!ret)
+        ret = add_lookup(SIM_CLK_NPU_BUS, "bus", NPU_DEVICE_NAME);
+    if (!ret)
+        ret = add_lookup(SIM_CLK_NPU_REG, "reg", NPU_DEVICE_NAME);
+    if (!ret)
+        ret = add_lookup(SIM_CLK_GPU, NULL, GPU_DEVICE_NAME);
+    if (!ret)
+        ret = add_lookup(SIM_CLK_GPU_BUS, "bus", GPU_DEVICE_NAME);
+    if (ret)
+        goto err;
+    return 0;
+
+err:
+    pr_err("A733_SIM: Could not register the clocks: %d\n", ret);
+    unregister_clocks();
+    return ret;
+}
+
+static void unregister_rails(void) {
+    int i;
+
+    for (i = 0; i < NR_SIM_RAILS; i++) {
+        if (!IS_ERR_OR_NULL(g_sim->rail[i].rdev))
+            regulator_unregister(g_sim->rail[i].rdev);
+        g_sim->rail[i].rdev = NULL;
+    }
+}
+
+static int register_rails(void) {
+    int i;
+
+    for (i = 0; i < NR_SIM_RAILS; i++) {
+        struct sim_rail *r = &g_sim->rail[i];
+        struct regulator_config config = {
+            .dev = &g_sim->sim_pdev->dev,
+            .init_data = &sim_rail_init[i],
+            .driver_data = r,
+        };
+
+        r->desc.name = sim_rail_init[i].constraints.name;
+        r->desc.id = i;
+        r->desc.type = REGULATOR_VOLTAGE;
+        r->desc.owner = THIS_MODULE;
+        r->desc.ops = &sim_rail_ops;
+        r->desc.min_uV = SIM_MIN_UV;
+        r->desc.uV_step = SIM_STEP_UV;
+        r->desc.n_voltages = (SIM_MAX_UV - SIM_MIN_UV) / SIM_STEP_UV + 1;
+        r->desc.ramp_delay = ramp_uv_per_us;
+        r->sel = (sim_rail_boot_uv[i] - SIM_MIN_UV) / SIM_STEP_UV;
+
+        r->rdev = regulator_register(&r->desc, &config);
+        if (IS_ERR(r->rdev)) {
+            int ret = PTR_ERR(r->rdev);
+
+            pr_err("A733_SIM: Could not register %s: %d\n", r->desc.name, ret);
+            unregister_rails();
+            return ret;
+        }
+    }
+    return 0;
+}
+
+static int __init a733_sim_init(void) {
+    struct device *dev;
+    int ret;
+
+    pr_info("A733_SIM: Loading simulated A733 platform...\n");
+
+    // Next to the real devices the modules would find half of each
+    dev = bus_find_device_by_name(&platform_bus_type, NULL, NPU_DEVICE_NAME);
+    if (dev) {
+        put_device(dev);
+        pr_err("A733_SIM: %s already exists, not simulating on a real board\n", NPU_DEVICE_NAME);
+        return -EEXIST;
+    }
+
+    g_sim = kzalloc(sizeof(*g_sim), GFP_KERNEL);
+    if (!g_sim)
+        return -ENOMEM;
+    g_sim->temp_mc = ambient_mc;
+    tick_ms = max(tick_ms, 10U);
+    INIT_DELAYED_WORK(&g_sim->tick_work, sim_tick_work);
+
+    ret = register_devices();
+    if (ret)
+        goto err_free;
+    ret = register_clocks();
+    if (ret)
+        goto err_devices;
+    ret = register_rails();
+    if (ret)
+        goto err_clocks;
+
+    g_sim->tz = thermal_zone_device_register(thermal_zone, 0, 0, g_sim, &sim_tz_ops, NULL, 0, 0);
+    if (IS_ERR(g_sim->tz)) {
+        ret = PTR_ERR(g_sim->tz);
+        pr_err("A733_SIM: Could not register thermal zone %s: %d\n", thermal_zone, ret);
+        goto err_rails;
+    }
+    thermal_zone_device_enable(g_sim->tz);
+
+    g_sim->hwmon = hwmon_device_register_with_groups(&g_sim->fan_pdev->dev, "pwmfan", g_sim,
+                                                     sim_fan_groups);
+    if (IS_ERR(g_sim->hwmon)) {
+        ret = PTR_ERR(g_sim->hwmon);
+        pr_err("A733_SIM: Could not register the fan: %d\n", ret);
+        goto err_tz;
+    }
+
+    g_sim->kobj = kobject_create_and_add(MODULE_NAME, kernel_kobj);
+    if (!g_sim->kobj) {
+        ret = -ENOMEM;
+        goto err_hwmon;
+    }
+    ret = sysfs_create_group(g_sim->kobj, &a733_sim_group);
+    if (ret)
+        goto err_kobj;
+
+    sim_tick_work(&g_sim->tick_work.work);
+
+    pr_info("A733_SIM: %u efficiency + %u performance CPUs, PLL step %u kHz, relock %u us\n",
+            g_sim->nr_cpus[0], g_sim->nr_cpus[1], pll_step_khz, pll_lock_us);
+    pr_info("A733_SIM: Fan at /sys/devices/platform/%s/hwmon/%s/pwm1\n",
+            FAN_DEVICE_NAME, dev_name(g_sim->hwmon));
+    pr_info("A733_SIM: Model state at /sys/kernel/%s/\n", MODULE_NAME);
+    return 0;
+
+err_kobj:
+    kobject_put(g_sim->kobj);
+err_hwmon:
+    hwmon_device_unregister(g_sim->hwmon);
+err_tz:
+    thermal_zone_device_unregister(g_sim->tz);
+err_rails:
+    unregister_rails();
+err_clocks:
+    unregister_clocks();
+err_devices:
+    unregister_devices();
+err_free:
+    kfree(g_sim);
+    return ret;
+}
+
+// Unload the modules using the simulated platform first: their clk,
+// regulator and device references would be left dangling
+static void __exit a733_sim_exit(void) {
+    cancel_delayed_work_sync(&g_sim->tick_work);
+    sysfs_remove_group(g_sim->kobj, &a733_sim_group);
+    kobject_put(g_sim->kobj);
+    hwmon_device_unregister(g_sim->hwmon);
+    thermal_zone_device_unregister(g_sim->tz);
+    unregister_rails();
+    unregister_clocks();
+    unregister_devices();
+    kfree(g_sim);
+
+    pr_info("A733_SIM: Simulated platform removed\n");
+}
+
+module_init(a733_sim_init);
+module_exit(a733_sim_exit);
+
+MODULE_AUTHOR("Radxa Performance Team");
+MODULE_DESCRIPTION("Simulated A733 platform for running the overclocking modules off-board");
+MODULE_LICENSE("GPL v2");
+MODULE_VERSION("1.0");
@@ -6,31 +6,66 @@
 #include <linux/clk.h>
 #include <linux/clk-provider.h>
 #include <linux/cpufreq.h>
+#include <linux/pm_opp.h>
+#include <linux/pm_qos.h>
 #include <linux/sysfs.h>
 #include <linux/kobject.h>
 #include <linux/cpu.h>
+#include <linux/cpuhotplug.h>
 #include <linux/delay.h>
+#include <linux/mutex.h>
+#include <linux/seqlock.h>
 #include <linux/regulator/consumer.h>
+#include <linux/ktime.h>
+#include <linux/arch_topology.h>
+#include <linux/cpuset.h>
+#include <linux/workqueue.h>
+#include <linux/suspend.h>
+
+#include "radxa_overclock_uapi.h"
+#include "radxa_clk_watch.h"
+#include "radxa_cpu_clusters.h"
+#include "radxa_energy_model.h"
+#include "radxa_freq_stats.h"
+#include "radxa_overclock_hooks.h"
+#include "radxa_overclock_try.h"
 
 #define MODULE_NAME "cpu_overclock"
 #define MAX_FREQS 16
+#define CLUSTER_E 0
+#define CLUSTER_P 1
+#define NR_CLUSTERS 2
 
-struct cpu_overclock_data {
-    struct clk *cpu_clk_e;  // Efficiency cores clock
-    struct clk *cpu_clk_p;  // Performance cores clock
-    struct regulator *cpu_supply;
-    struct kobject *kobj;
-    unsigned long target_freq_e;
-    unsigned long target_freq_p;
-    bool overclocked;
-};
+// Used when cpufreq is not running and the OPP table cannot tell us
+#define STOCK_MAX_E_HZ 1794000000UL
+#define STOCK_MAX_P_HZ 2002000000UL
 
-static struct cpu_overclock_data *g_data;
+// Dynamic-power coefficients (uW/MHz/V^2) for the Energy Model
+static unsigned int e_power_coeff = 120;
+module_param(e_power_coeff, uint, 0444);
+MODULE_PARM_DESC(e_power_coeff, "Efficiency cluster dynamic-power coefficient, uW/MHz/V^2");
+
+static unsigned int p_power_coeff = 480;
+module_param(p_power_coeff, uint, 0444);
+MODULE_PARM_DESC(p_power_coeff, "Performance cluster dynamic-power coefficient, uW/MHz/V^2");
+
+// Last committed "E_MHZ,P_MHZ", applied at load (see radxa_overclock_try.h)
+static char *lkg;
+module_param(lkg, charp, 0444);
+MODULE_PARM_DESC(lkg, "Last-known-good setting, applied at load");
+
+static unsigned int try_timeout_s = 30;
+module_param(try_timeout_s, uint, 0644);
+MODULE_PARM_DESC(try_timeout_s, "Seconds a tried setting has to be committed");
+
+// What to do when someone else changes a cluster clock we set
+RADXA_CW_POLICY_PARAM(drift_policy);
+MODULE_PARM_DESC(drift_policy, "On external clock changes: log or reassert");
 
 // Custom frequency tables (beyond OPP limits)
 static unsigned long efficiency_freqs[] = {
     1200000000, 1404000000, 1512000000, 1608000000, 1704000000, 1794000000,
-    1900000000, 2000000000, 2100000000, 0  // Experimental frequencies
+    1900000000, 2000000000, 2080000000, 2100000000, 0  // Experimental frequencies
 };
 
 static unsigned long performance_freqs[] = {
@@ -38,10 +73,70 @@ static unsigned long performance_freqs[] = {
     2200000000, 2400000000, 2600000000, 0  // Experimental frequencies
 };
 
+struct cpu_cluster {
+    struct mutex lock;              // Serializes rate changes of the cluster
+    const char *name;
+    unsigned long *freqs;           // Extra frequencies, 0-terminated
+    int cpu;                        // First CPU of the cpufreq policy, -1 if none
+    cpumask_t cpus;                 // All CPUs of the policy
+    unsigned int power_coeff;
+    struct clk *clk;
+    unsigned long stock_max_hz;     // Highest OPP before ours were added
+    unsigned int scale_max_khz;     // Frequency the scheduler counts as 100%
+    unsigned long added[MAX_FREQS]; // OPPs registered by this module
+    int nr_added;
+    bool has_policy;                // Frequency is driven through cpufreq
+    struct freq_qos_request max_req;
+    struct freq_qos_request stall_req;  // mem_stall_governor's cap
+    struct freq_qos_request floor_req;  // mem_stall_governor's floor
+    struct freq_qos_request min_req;    // min_freq, e.g. libradxaperf's boosts
+    unsigned long min_freq;         // Hz, 0: no floor
+    struct notifier_block max_nb;   // Policy max moved, e.g. boost toggled
+    unsigned long target_freq;
+    int voltage_uv;                 // Voltage of the last requested point
+    unsigned int rate_misses;       // Applied rate differs from the request
+    struct radxa_freq_stats *stats; // Residency, only without cpufreq
+    struct radxa_clk_watch watch;   // External rate changes, only without cpufreq
+};
+
+// Applied state as the sysfs readers see it. They copy it under
+// state_lock instead of calling clk_get_rate(): the clk prepare lock is
+// global, and monitoring would stall DVFS on every clock in the system.
+struct cluster_state {
+    unsigned long cur_hz;           // Without cpufreq; cpufreq has its own
+    unsigned long target_hz;
+    int voltage_uv;
+    bool overclocked;
+};
+
+struct cpu_overclock_data {
+    struct cpu_cluster cluster[NR_CLUSTERS];
+    seqlock_t state_lock;
+    struct cluster_state state[NR_CLUSTERS];
+    unsigned long boot_capacity[NR_CPUS];   // cpu_scale before we touched it
+    bool rescale_capacity;
+    struct work_struct capacity_work;
+    struct regulator *cpu_supply;   // Only used without cpufreq
+    struct kobject *kobj;
+    struct kobject *stats_kobj;     // freq_stats/, one entry per direct cluster
+    struct notifier_block pm_nb;
+    enum cpuhp_state cpuhp_state;   // 0: no hotplug callback
+    struct work_struct restore_work;
+    unsigned long restore_pending;  // Clusters whose first CPU came back
+    struct radxa_oc_try try;
+};
+
+static struct cpu_overclock_data *g_data;
+
+// Told about every frequency this module applies (cpu_selftest)
+static BLOCKING_NOTIFIER_HEAD(cpu_overclock_chain);
+
+static const char * const cluster_names[NR_CLUSTERS] = { "efficiency", "performance" };
+
 // Voltage mapping for overclocking (experimental)
 static int get_voltage_for_freq(unsigned long freq_hz) {
     unsigned long freq_mhz = freq_hz / 1000000;
-    
+
     if (freq_mhz <= 1800) return 1100000;      // 1.1V
     else if (freq_mhz <= 2000) return 1150000; // 1.15V
     else if (freq_mhz <= 2200) return 1200000; // 1.2V
@@ -49,17 +144,145 @@ static int get_voltage_for_freq(unsigned long freq_hz) {
     else return 1300000;                       // 1.3V (extreme)
 }
 
-static int set_cpu_frequency(struct clk *clk, unsigned long freq, const char* cpu_type) {
+// Scheduler frequency invariance. cpu_scale (max capacity) was derived at
+// boot from capacity-dmips-mhz and the stock maximum frequency, and
+// arch_freq_scale (PELT) tracks cur/max. Both go stale once a cluster runs
+// above the stock maximum, or behind cpufreq's back.
+
+static unsigned int cluster_max_khz(struct cpu_cluster *cl) {
+    unsigned int max_khz = max(cl->stock_max_hz, cl->target_freq) / 1000;
+    struct cpufreq_policy *policy;
+
+    // Boost-aware: cpuinfo.max_freq includes boost points only while enabled
+    if (cl->has_policy) {
+        policy = cpufreq_cpu_get(cl->cpu);
+        if (policy) {
+            max_khz = policy->cpuinfo.max_freq;
+            cpufreq_cpu_put(policy);
+        }
+    }
+    return max_khz;
+}
+
+static void update_scale_max(void) {
+    int c;
+
+    for (c = 0; c < NR_CLUSTERS; c++)
+        g_data->cluster[c].scale_max_khz = cluster_max_khz(&g_data->cluster[c]);
+}
+
+// topology_set_cpu_scale() is not exported to modules; cpu_scale is
+static void set_cpu_scale(int cpu, unsigned long capacity) {
+    per_cpu(cpu_scale, cpu) = capacity;
+}
+
+// The scheduler copies capacities into its domains (asymmetry flags, root
+// domain maximum) when they are built. Rebuilding takes the hotplug and
+// cpuset locks, so it only happens from capacity_work or module init/exit.
+static void rebuild_sched_capacity(void) {
+#ifdef CONFIG_CPUSETS
+    void (*rebuild)(void) = symbol_get(rebuild_sched_domains);
+
+    if (rebuild) {
+        rebuild();
+        symbol_put(rebuild_sched_domains);
+        return;
+    }
+#endif
+    // Mainline 5.15 and the vendor kernels do not export it
+    pr_warn_once("CPU_OVERCLOCK: rebuild_sched_domains is not exported, capacity changes have no effect until the sched domains are rebuilt\n");
+}
+
+// Scale the boot capacities by each cluster's new maximum and normalise
+// the biggest CPU back to SCHED_CAPACITY_SCALE, as arch_topology does
+static void update_cpu_capacity(void) {
+    unsigned long biggest = 0;
+    bool changed = false;
+    int c, cpu;
+
+    update_scale_max();
+    if (!g_data->rescale_capacity)
+        return;
+
+    for (c = 0; c < NR_CLUSTERS; c++) {
+        struct cpu_cluster *cl = &g_data->cluster[c];
+
+        for_each_cpu(cpu, &cl->cpus)
+            biggest = max(biggest, (unsigned long)div_u64((u64)g_data->boot_capacity[cpu] *
+                          cl->scale_max_khz, cl->stock_max_hz / 1000));
+    }
+    if (!biggest)
+        return;
+
+    for (c = 0; c < NR_CLUSTERS; c++) {
+        struct cpu_cluster *cl = &g_data->cluster[c];
+
+        for_each_cpu(cpu, &cl->cpus) {
+            u64 cap = div_u64((u64)g_data->boot_capacity[cpu] * cl->scale_max_khz,
+                              cl->stock_max_hz / 1000);
+
+            cap = div_u64(cap << SCHED_CAPACITY_SHIFT, biggest);
+            if (cap != topology_get_cpu_scale(cpu)) {
+                set_cpu_scale(cpu, cap);
+                changed = true;
+            }
+        }
+    }
+    if (changed)
+        rebuild_sched_capacity();
+}
+
+// The rate publish_cluster() last read from the clock; 0 under cpufreq
+static unsigned long published_hz(struct cpu_cluster *cl) {
+    unsigned long hz;
+    unsigned int seq;
+
+    do {
+        seq = read_seqbegin(&g_data->state_lock);
+        hz = g_data->state[cl - g_data->cluster].cur_hz;
+    } while (read_seqretry(&g_data->state_lock, seq));
+    return hz;
+}
+
+// cpufreq keeps arch_freq_scale current for policy-driven clusters; do it
+// here for clusters whose clock we program ourselves. Call it after
+// publish_cluster().
+static void update_freq_scale(struct cpu_cluster *cl) {
+    unsigned long scale;
+    int cpu;
+
+    if (cl->has_policy || !cl->scale_max_khz)
+        return;
+    scale = min_t(unsigned long,
+                  ((published_hz(cl) / 1000) << SCHED_CAPACITY_SHIFT) / cl->scale_max_khz,
+                  SCHED_CAPACITY_SCALE);
+    for_each_cpu(cpu, &cl->cpus)
+        per_cpu(arch_freq_scale, cpu) = scale;
+}
+
+// Toggling boost updates cpuinfo.max_freq and then the policy's max QoS
+// request, so it shows up here. So do our own and the stall governor's
+// caps; capacity_work only rebuilds when a capacity actually changed.
+static int cpu_overclock_max_notify(struct notifier_block *nb, unsigned long max_khz,
+                                    void *data) {
+    schedule_work(&g_data->capacity_work);
+    return NOTIFY_OK;
+}
+
+// Fallback when no cpufreq policy covers the cluster: program the clock
+// directly. cpufreq is not around to overwrite it in that case.
+static int set_cpu_frequency(struct clk *clk, unsigned long freq, const char* cpu_type,
+                             int *voltage_uv) {
     int ret;
     unsigned long actual_freq;
-    
+
     if (!clk) {
         pr_err("CPU_OVERCLOCK: %s clock not available\n", cpu_type);
         return -EINVAL;
     }
-    
+
     pr_info("CPU_OVERCLOCK: Setting %s CPU to %lu MHz\n", cpu_type, freq / 1000000);
-    
+
     // Set voltage first if we have regulator
     if (g_data->cpu_supply) {
         int voltage = get_voltage_for_freq(freq);
@@ -68,191 +291,1345 @@ static int set_cpu_frequency(struct clk *clk, unsigned long freq, const char* cp
             pr_warn("CPU_OVERCLOCK: Failed to set voltage to %duV: %d\n", voltage, ret);
         } else {
             pr_info("CPU_OVERCLOCK: Set voltage to %duV\n", voltage);
+            *voltage_uv = voltage;
             msleep(10); // Allow voltage to stabilize
         }
     }
-    
+
     // Set frequency
     ret = clk_set_rate(clk, freq);
     if (ret) {
         pr_err("CPU_OVERCLOCK: Failed to set %s frequency: %d\n", cpu_type, ret);
         return ret;
     }
-    
+
     actual_freq = clk_get_rate(clk);
-    pr_info("CPU_OVERCLOCK: %s CPU frequency set to %lu MHz (requested %lu MHz)\n", 
+    pr_info("CPU_OVERCLOCK: %s CPU frequency set to %lu MHz (requested %lu MHz)\n",
             cpu_type, actual_freq / 1000000, freq / 1000000);
-    
+
     return 0;
 }
 
-// Sysfs interface for frequency control
-static ssize_t overclock_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
-    unsigned long freq_e = g_data->cpu_clk_e ? clk_get_rate(g_data->cpu_clk_e) : 0;
-    unsigned long freq_p = g_data->cpu_clk_p ? clk_get_rate(g_data->cpu_clk_p) : 0;
-    
-    return sprintf(buf, "CPU_E: %lu MHz\nCPU_P: %lu MHz\nOverclocked: %s\nAvailable E-core freqs: 1200,1404,1512,1608,1704,1794,1900,2000,2100\nAvailable P-core freqs: 1512,1608,1704,1800,1896,2002,2200,2400,2600\nUsage: echo 'E_FREQ,P_FREQ' > overclock (frequencies in MHz)\n",
-           freq_e / 1000000, freq_p / 1000000, g_data->overclocked ? "YES" : "NO");
+// Cap the cluster at freq through cpufreq. The governor (schedutil or
+// performance) picks the actual operating point and the OPP core handles
+// the voltage, so the setting survives governor updates.
+static int set_cluster_limit(struct cpu_cluster *cl, unsigned long freq) {
+    struct cpufreq_policy *policy;
+    unsigned int max_khz;
+    int ret;
+
+    policy = cpufreq_cpu_get(cl->cpu);
+    if (!policy)
+        return -ENODEV;
+    max_khz = policy->cpuinfo.max_freq;
+    cpufreq_cpu_put(policy);
+
+    // Boost points stay out of cpuinfo until boost is switched on
+    if (freq / 1000 > max_khz) {
+        cl->rate_misses++;
+        pr_warn("CPU_OVERCLOCK: %s cluster limited to %u MHz, %lu MHz needs "
+                "/sys/devices/system/cpu/cpufreq/boost enabled\n",
+                cl->name, max_khz / 1000, freq / 1000000);
+        sysfs_notify(g_data->kobj, cl->name, "rate_misses");
+    }
+
+    ret = freq_qos_update_request(&cl->max_req, freq / 1000);
+    if (ret < 0) {
+        pr_err("CPU_OVERCLOCK: Failed to update %s frequency limit: %d\n", cl->name, ret);
+        return ret;
+    }
+
+    pr_info("CPU_OVERCLOCK: %s cluster capped at %lu MHz via cpufreq\n",
+            cl->name, freq / 1000000);
+    return 0;
 }
 
-static ssize_t overclock_store(struct kobject *kobj, struct kobj_attribute *attr,
-                              const char *buf, size_t count) {
-    char *input, *token;
-    unsigned long freq_e = 0, freq_p = 0;
+// cpufreq only runs at its table's points, so a cap between two of them
+// is the lower one. Round to it so target_freq_hz reports that rate.
+static unsigned long cluster_opp_floor(struct cpu_cluster *cl, unsigned long freq) {
+    struct device *cpu_dev = get_cpu_device(cl->cpu);
+    struct dev_pm_opp *opp;
+    unsigned long opp_hz = freq;
+
+    opp = dev_pm_opp_find_freq_floor(cpu_dev, &opp_hz);
+    if (IS_ERR(opp))
+        return freq;
+    dev_pm_opp_put(opp);
+    if (opp_hz != freq)
+        pr_info("CPU_OVERCLOCK: %lu MHz is not a %s cluster OPP, using %lu MHz\n",
+                freq / 1000000, cl->name, opp_hz / 1000000);
+    return opp_hz;
+}
+
+static int cluster_opp_voltage(struct cpu_cluster *cl, unsigned long freq) {
+    struct device *cpu_dev = get_cpu_device(cl->cpu);
+    struct dev_pm_opp *opp;
+    int uv;
+
+    opp = dev_pm_opp_find_freq_exact(cpu_dev, freq, true);
+    if (IS_ERR(opp))
+        return get_voltage_for_freq(freq);
+    uv = dev_pm_opp_get_voltage(opp);
+    dev_pm_opp_put(opp);
+    return uv;
+}
+
+// Wake up poll()ers on the per-value files after a change was applied
+// and published
+static void notify_cluster_change(struct cpu_cluster *cl, unsigned long requested) {
+    // Under cpufreq the request is a ceiling, not an exact rate
+    if (!cl->has_policy) {
+        unsigned long actual = published_hz(cl);
+
+        // Tolerate PLL rounding, flag anything beyond 1%
+        if (abs((long)(actual - requested)) > requested / 100) {
+            cl->rate_misses++;
+            pr_warn("CPU_OVERCLOCK: %s cluster runs at %lu MHz, requested %lu MHz\n",
+                    cl->name, actual / 1000000, requested / 1000000);
+            sysfs_notify(g_data->kobj, cl->name, "rate_misses");
+        }
+    }
+
+    sysfs_notify(g_data->kobj, cl->name, "cur_freq_hz");
+    sysfs_notify(g_data->kobj, cl->name, "target_freq_hz");
+    sysfs_notify(g_data->kobj, cl->name, "voltage_uv");
+}
+
+// Tell fan_control what the step will cost before it happens, assuming
+// every CPU of the cluster busy
+static void cluster_feed_forward(struct cpu_cluster *cl, unsigned long freq) {
+    unsigned long old = cl->target_freq;
+
+    if (!old)
+        old = cl->has_policy ? cpufreq_quick_get(cl->cpu) * 1000UL : published_hz(cl);
+
+    if (cl->cpu < 0 || !old)
+        return;
+    radxa_fan_feed_forward(radxa_em_power_delta(em_cpu_get(cl->cpu), old, freq) *
+                           (long)cpumask_weight(&cl->cpus));
+}
+
+// The ceiling cpufreq actually enforces: our cap may be above what boost
+// allows, and the stall governor or thermal may hold it lower
+static unsigned long policy_max_hz(struct cpu_cluster *cl) {
+    struct cpufreq_policy *policy = cpufreq_cpu_get(cl->cpu);
+    unsigned long khz;
+
+    if (!policy)
+        return 0;
+    khz = min_t(unsigned long, policy->cpuinfo.max_freq,
+                freq_qos_read_value(&policy->constraints, FREQ_QOS_MAX));
+    cpufreq_cpu_put(policy);
+    return khz * 1000;
+}
+
+// Called by the writer after every change, with the cluster lock held.
+// Overclocked is what the cluster runs at, not what was asked for: a clock
+// someone else took back to stock is not overclocked. Under cpufreq the
+// effective policy maximum counts, so a cap above stock with boost off is
+// not overclocked either.
+static void publish_cluster(struct cpu_cluster *cl) {
+    struct cluster_state st = {};
+    unsigned long hz;
+
+    st.cur_hz = cl->clk && !cl->has_policy ? clk_get_rate(cl->clk) : 0;
+    st.target_hz = cl->target_freq;
+    st.voltage_uv = cl->voltage_uv;
+    if (cl->has_policy)
+        hz = min(cl->target_freq ? cl->target_freq : ULONG_MAX, policy_max_hz(cl));
+    else
+        hz = cl->clk ? st.cur_hz : cl->target_freq;
+    st.overclocked = hz > cl->stock_max_hz;
+
+    write_seqlock(&g_data->state_lock);
+    g_data->state[cl - g_data->cluster] = st;
+    write_sequnlock(&g_data->state_lock);
+}
+
+// A consistent copy of both clusters; readers never block the writers
+static void read_state(struct cluster_state *st) {
+    unsigned int seq;
+    int c;
+
+    do {
+        seq = read_seqbegin(&g_data->state_lock);
+        memcpy(st, g_data->state, sizeof(g_data->state));
+    } while (read_seqretry(&g_data->state_lock, seq));
+
+    for (c = 0; c < NR_CLUSTERS; c++)
+        if (g_data->cluster[c].has_policy)
+            st[c].cur_hz = cpufreq_quick_get(g_data->cluster[c].cpu) * 1000UL;
+}
+
+static void notify_overclocked(void) {
+    sysfs_notify(g_data->kobj, NULL, "overclocked");
+}
+
+// Also where a policy maximum that moved (boost toggled, another cap)
+// reaches the overclocked flag
+static void capacity_workfn(struct work_struct *work) {
+    int c;
+
+    update_cpu_capacity();
+    for (c = 0; c < NR_CLUSTERS; c++) {
+        struct cpu_cluster *cl = &g_data->cluster[c];
+
+        if (!cl->has_policy)
+            continue;
+        mutex_lock(&cl->lock);
+        publish_cluster(cl);
+        mutex_unlock(&cl->lock);
+    }
+    if (g_data->kobj)
+        notify_overclocked();
+}
+
+static int apply_cluster_freq(struct cpu_cluster *cl, unsigned long freq) {
+    struct cpu_overclock_event ev;
     int ret;
-    
-    input = kstrndup(buf, count, GFP_KERNEL);
-    if (!input)
-        return -ENOMEM;
-    
-    // Parse "E_FREQ,P_FREQ" format
-    token = strsep(&input, ",");
-    if (token) {
-        ret = kstrtoul(token, 10, &freq_e);
+
+    mutex_lock(&cl->lock);
+    if (cl->has_policy)
+        freq = cluster_opp_floor(cl, freq);
+    cluster_feed_forward(cl, freq);
+    if (cl->has_policy) {
+        ret = set_cluster_limit(cl, freq);
+        if (ret)
+            goto out;
+        cl->voltage_uv = cluster_opp_voltage(cl, freq);
+    } else {
+        radxa_cw_begin(&cl->watch);
+        ret = set_cpu_frequency(cl->clk, freq, cl->name, &cl->voltage_uv);
+        radxa_cw_end(&cl->watch, ret ? 0 : freq);
         if (ret) {
-            pr_err("CPU_OVERCLOCK: Invalid efficiency core frequency\n");
-            kfree(input);
-            return ret;
+            radxa_fs_failed(cl->stats);
+            goto out;
         }
-        freq_e *= 1000000; // Convert MHz to Hz
     }
-    
-    if (input) {
-        ret = kstrtoul(input, 10, &freq_p);
+
+    cl->target_freq = freq;
+    publish_cluster(cl);
+    if (!cl->has_policy)
+        radxa_fs_update(cl->stats, published_hz(cl));
+    update_scale_max();
+    if (g_data->rescale_capacity)
+        schedule_work(&g_data->capacity_work);
+    update_freq_scale(cl);
+    notify_cluster_change(cl, freq);
+    sysfs_notify(g_data->kobj, cl->name, "freq_scale");
+    sysfs_notify(g_data->kobj, cl->name, "capacity");
+out:
+    mutex_unlock(&cl->lock);
+    if (ret)
+        return ret;
+
+    // Listeners may call back in, e.g. cpu_overclock_step_down()
+    ev.cpu = cl->cpu;
+    ev.freq_hz = freq;
+    blocking_notifier_call_chain(&cpu_overclock_chain, CPU_OVERCLOCK_APPLIED, &ev);
+    return 0;
+}
+
+// Sysfs interface for frequency control
+static ssize_t overclock_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    struct cpu_cluster *e = &g_data->cluster[CLUSTER_E];
+    struct cpu_cluster *p = &g_data->cluster[CLUSTER_P];
+    struct cluster_state st[NR_CLUSTERS];
+    ssize_t len;
+    int c, i;
+
+    read_state(st);
+    len = sprintf(buf, "CPU_E: %lu MHz\nCPU_P: %lu MHz\nOverclocked: %s\nBoost: %s\n",
+                  st[CLUSTER_E].cur_hz / 1000000, st[CLUSTER_P].cur_hz / 1000000,
+                  st[CLUSTER_E].overclocked || st[CLUSTER_P].overclocked ? "YES" : "NO",
+                  (e->has_policy || p->has_policy) && cpufreq_boost_enabled() ?
+                  "enabled" : "disabled");
+
+    for (c = 0; c < NR_CLUSTERS; c++) {
+        len += sprintf(buf + len, "Available %c-core freqs:", c == CLUSTER_E ? 'E' : 'P');
+        for (i = 0; g_data->cluster[c].freqs[i]; i++)
+            len += sprintf(buf + len, "%s%lu", i ? "," : " ",
+                           g_data->cluster[c].freqs[i] / 1000000);
+        len += sprintf(buf + len, "\n");
+    }
+
+    len += sprintf(buf + len, "Usage: echo 'E_FREQ,P_FREQ' > overclock (frequencies in MHz)\n");
+    return len;
+}
+
+static int apply_overclock_setting(const char *buf) {
+    char *input, *cursor, *token;
+    unsigned long freq[NR_CLUSTERS] = { 0, 0 };
+    int c, ret = 0;
+
+    input = kstrdup(buf, GFP_KERNEL);
+    if (!input)
+        return -ENOMEM;
+
+    // Parse "E_FREQ,P_FREQ" format; strsep moves cursor, input is freed
+    cursor = input;
+    for (c = 0; c < NR_CLUSTERS && (token = strsep(&cursor, ",")); c++) {
+        ret = kstrtoul(strim(token), 10, &freq[c]);
         if (ret) {
-            pr_err("CPU_OVERCLOCK: Invalid performance core frequency\n");
-            kfree(input);
-            return ret;
+            pr_err("CPU_OVERCLOCK: Invalid %s core frequency\n", cluster_names[c]);
+            break;
         }
-        freq_p *= 1000000; // Convert MHz to Hz
+        freq[c] *= 1000000; // Convert MHz to Hz
     }
-    
+
     kfree(input);
-    
-    if (freq_e == 0 && freq_p == 0) {
+    if (ret)
+        return ret;
+
+    if (freq[CLUSTER_E] == 0 && freq[CLUSTER_P] == 0) {
         pr_err("CPU_OVERCLOCK: No valid frequencies provided\n");
         return -EINVAL;
     }
-    
+
     pr_info("CPU_OVERCLOCK: Attempting to set E-cores to %lu MHz, P-cores to %lu MHz\n",
-            freq_e / 1000000, freq_p / 1000000);
-    
+            freq[CLUSTER_E] / 1000000, freq[CLUSTER_P] / 1000000);
+
     // Apply frequencies
-    if (freq_e > 0 && g_data->cpu_clk_e) {
-        ret = set_cpu_frequency(g_data->cpu_clk_e, freq_e, "Efficiency");
-        if (ret) return ret;
-        g_data->target_freq_e = freq_e;
-    }
-    
-    if (freq_p > 0 && g_data->cpu_clk_p) {
-        ret = set_cpu_frequency(g_data->cpu_clk_p, freq_p, "Performance");
-        if (ret) return ret;
-        g_data->target_freq_p = freq_p;
-    }
-    
-    g_data->overclocked = (freq_e > 1794000000 || freq_p > 2002000000);
-    
+    for (c = 0; c < NR_CLUSTERS; c++) {
+        struct cpu_cluster *cl = &g_data->cluster[c];
+
+        if (!freq[c] || !cl->clk)
+            continue;
+        ret = apply_cluster_freq(cl, freq[c]);
+        if (ret)
+            return ret;
+    }
+
+    notify_overclocked();
+
     pr_info("CPU_OVERCLOCK: Frequencies applied successfully!\n");
-    return count;
+    return 0;
+}
+
+static ssize_t overclock_store(struct kobject *kobj, struct kobj_attribute *attr,
+                              const char *buf, size_t count) {
+    int ret = apply_overclock_setting(buf);
+
+    return ret ? ret : count;
 }
 
 static struct kobj_attribute overclock_attr = __ATTR(overclock, 0664, overclock_show, overclock_store);
 
-static int __init cpu_overclock_init(void) {
-    struct device_node *np;
+// Under cpufreq overclock is a ceiling: schedutil still picks anything
+// below it. min_freq is the matching floor, for programs that need the
+// clock up for a stretch of work. cpufreq keeps it under every cap.
+static ssize_t min_freq_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%lu,%lu\n", g_data->cluster[CLUSTER_E].min_freq / 1000000,
+                   g_data->cluster[CLUSTER_P].min_freq / 1000000);
+}
+
+static ssize_t min_freq_store(struct kobject *kobj, struct kobj_attribute *attr,
+                              const char *buf, size_t count) {
+    unsigned long freq[NR_CLUSTERS];
+    int c, ret;
+
+    // "E_FREQ,P_FREQ" in MHz; 0 drops that cluster's floor
+    if (sscanf(buf, "%lu,%lu", &freq[CLUSTER_E], &freq[CLUSTER_P]) != 2 ||
+        freq[CLUSTER_E] > INT_MAX / 1000 || freq[CLUSTER_P] > INT_MAX / 1000)
+        return -EINVAL;
+
+    for (c = 0; c < NR_CLUSTERS; c++) {
+        struct cpu_cluster *cl = &g_data->cluster[c];
+
+        if (!cl->clk)
+            continue;
+        // A clock we program directly runs at exactly what overclock says
+        if (!cl->has_policy) {
+            if (freq[c])
+                return -EOPNOTSUPP;
+            continue;
+        }
+        mutex_lock(&cl->lock);
+        ret = freq_qos_update_request(&cl->min_req,
+                                      freq[c] ? freq[c] * 1000 : FREQ_QOS_MIN_DEFAULT_VALUE);
+        if (ret >= 0)
+            cl->min_freq = freq[c] * 1000000;
+        mutex_unlock(&cl->lock);
+        if (ret < 0)
+            return ret;
+    }
+    return count;
+}
+
+static struct kobj_attribute min_freq_attr = __ATTR(min_freq, 0664, min_freq_show, min_freq_store);
+
+// Machine-readable interface: one value per file, grouped per cluster
+struct cluster_attribute {
+    struct kobj_attribute attr;
+    int cluster;
+};
+
+#define to_cluster(a) (&g_data->cluster[container_of(a, struct cluster_attribute, attr)->cluster])
+
+#define to_cluster_idx(a) (container_of(a, struct cluster_attribute, attr)->cluster)
+
+static ssize_t cur_freq_hz_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    struct cluster_state st[NR_CLUSTERS];
+
+    read_state(st);
+    return sprintf(buf, "%lu\n", st[to_cluster_idx(attr)].cur_hz);
+}
+
+static ssize_t target_freq_hz_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    struct cluster_state st[NR_CLUSTERS];
+
+    read_state(st);
+    return sprintf(buf, "%lu\n", st[to_cluster_idx(attr)].target_hz);
+}
+
+static ssize_t voltage_uv_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    struct cluster_state st[NR_CLUSTERS];
+
+    read_state(st);
+    return sprintf(buf, "%d\n", st[to_cluster_idx(attr)].voltage_uv);
+}
+
+static ssize_t rate_misses_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%u\n", to_cluster(attr)->rate_misses);
+}
+
+// Rate changes made behind our back, and who made the last one
+static ssize_t drift_count_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%u\n", radxa_cw_drift_count(&to_cluster(attr)->watch));
+}
+
+static ssize_t last_drift_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return radxa_cw_offender_show(&to_cluster(attr)->watch, buf);
+}
+
+// Perf states EAS sees for this cluster, to check the boost points made it
+static ssize_t em_states_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    int cpu = to_cluster(attr)->cpu;
+
+    return sprintf(buf, "%d\n", cpu >= 0 ? radxa_em_nr_states(get_cpu_device(cpu)) : 0);
+}
+
+// What the scheduler currently assumes, to check against cur_freq_hz
+static ssize_t freq_scale_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    int cpu = to_cluster(attr)->cpu;
+
+    return sprintf(buf, "%lu\n", cpu >= 0 ? topology_get_freq_scale(cpu) : 0);
+}
+
+static ssize_t capacity_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    int cpu = to_cluster(attr)->cpu;
+
+    return sprintf(buf, "%lu\n", cpu >= 0 ? topology_get_cpu_scale(cpu) : 0);
+}
+
+#define CLUSTER_ATTR_RO(_prefix, _name, _cluster)                           \
+    static struct cluster_attribute _prefix##_##_name##_attr = {            \
+        .attr = __ATTR(_name, 0444, _name##_show, NULL),                    \
+        .cluster = _cluster,                                                \
+    }
+
+CLUSTER_ATTR_RO(e, cur_freq_hz, CLUSTER_E);
+CLUSTER_ATTR_RO(e, target_freq_hz, CLUSTER_E);
+CLUSTER_ATTR_RO(e, voltage_uv, CLUSTER_E);
+CLUSTER_ATTR_RO(e, rate_misses, CLUSTER_E);
+CLUSTER_ATTR_RO(e, drift_count, CLUSTER_E);
+CLUSTER_ATTR_RO(e, last_drift, CLUSTER_E);
+CLUSTER_ATTR_RO(e, em_states, CLUSTER_E);
+CLUSTER_ATTR_RO(e, freq_scale, CLUSTER_E);
+CLUSTER_ATTR_RO(e, capacity, CLUSTER_E);
+CLUSTER_ATTR_RO(p, cur_freq_hz, CLUSTER_P);
+CLUSTER_ATTR_RO(p, target_freq_hz, CLUSTER_P);
+CLUSTER_ATTR_RO(p, voltage_uv, CLUSTER_P);
+CLUSTER_ATTR_RO(p, rate_misses, CLUSTER_P);
+CLUSTER_ATTR_RO(p, drift_count, CLUSTER_P);
+CLUSTER_ATTR_RO(p, last_drift, CLUSTER_P);
+CLUSTER_ATTR_RO(p, em_states, CLUSTER_P);
+CLUSTER_ATTR_RO(p, freq_scale, CLUSTER_P);
+CLUSTER_ATTR_RO(p, capacity, CLUSTER_P);
+
+static struct attribute *efficiency_attrs[] = {
+    &e_cur_freq_hz_attr.attr.attr,
+    &e_target_freq_hz_attr.attr.attr,
+    &e_voltage_uv_attr.attr.attr,
+    &e_rate_misses_attr.attr.attr,
+    &e_drift_count_attr.attr.attr,
+    &e_last_drift_attr.attr.attr,
+    &e_em_states_attr.attr.attr,
+    &e_freq_scale_attr.attr.attr,
+    &e_capacity_attr.attr.attr,
+    NULL,
+};
+
+static struct attribute *performance_attrs[] = {
+    &p_cur_freq_hz_attr.attr.attr,
+    &p_target_freq_hz_attr.attr.attr,
+    &p_voltage_uv_attr.attr.attr,
+    &p_rate_misses_attr.attr.attr,
+    &p_drift_count_attr.attr.attr,
+    &p_last_drift_attr.attr.attr,
+    &p_em_states_attr.attr.attr,
+    &p_freq_scale_attr.attr.attr,
+    &p_capacity_attr.attr.attr,
+    NULL,
+};
+
+static const struct attribute_group efficiency_group = {
+    .name = "efficiency",
+    .attrs = efficiency_attrs,
+};
+
+static const struct attribute_group performance_group = {
+    .name = "performance",
+    .attrs = performance_attrs,
+};
+
+static ssize_t overclocked_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    struct cluster_state st[NR_CLUSTERS];
+
+    read_state(st);
+    return sprintf(buf, "%d\n", st[CLUSTER_E].overclocked || st[CLUSTER_P].overclocked);
+}
+
+// Speculative settings: try, then commit before try_timeout_s runs out
+static ssize_t try_store(struct kobject *kobj, struct kobj_attribute *attr,
+                         const char *buf, size_t count) {
+    int ret = radxa_oc_try_start(&g_data->try, buf, try_timeout_s);
+
+    return ret ? ret : count;
+}
+
+static ssize_t commit_store(struct kobject *kobj, struct kobj_attribute *attr,
+                            const char *buf, size_t count) {
+    int ret = radxa_oc_try_commit(&g_data->try);
+
+    return ret ? ret : count;
+}
+
+static ssize_t try_state_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return radxa_oc_try_state_show(&g_data->try, buf);
+}
+
+static ssize_t lkg_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return radxa_oc_try_lkg_show(&g_data->try, buf);
+}
+
+static struct kobj_attribute overclocked_attr = __ATTR_RO(overclocked);
+static struct kobj_attribute try_attr = __ATTR_WO(try);
+static struct kobj_attribute commit_attr = __ATTR_WO(commit);
+static struct kobj_attribute try_state_attr = __ATTR_RO(try_state);
+static struct kobj_attribute lkg_attr = __ATTR_RO(lkg);
+
+static struct attribute *cpu_overclock_attrs[] = {
+    &overclocked_attr.attr,
+    &try_attr.attr,
+    &commit_attr.attr,
+    &try_state_attr.attr,
+    &lkg_attr.attr,
+    NULL,
+};
+
+static const struct attribute_group cpu_overclock_group = {
+    .attrs = cpu_overclock_attrs,
+};
+
+// Binary snapshot: header + one record per cluster in a single read
+struct cpu_overclock_snapshot {
+    struct radxa_oc_snapshot_header hdr;
+    struct radxa_oc_domain_state dom[NR_CLUSTERS];
+} __attribute__((packed));
+
+static ssize_t snapshot_read(struct file *filp, struct kobject *kobj,
+                             struct bin_attribute *attr, char *buf,
+                             loff_t off, size_t count) {
+    struct cpu_overclock_snapshot snap = {};
+    struct cluster_state st[NR_CLUSTERS];
+    int i;
+
+    snap.hdr.magic = RADXA_OC_SNAPSHOT_MAGIC;
+    snap.hdr.version = RADXA_OC_SNAPSHOT_VERSION;
+    snap.hdr.nr_domains = NR_CLUSTERS;
+    snap.hdr.header_size = sizeof(snap.hdr);
+    snap.hdr.domain_size = sizeof(snap.dom[0]);
+    snap.hdr.timestamp_ns = ktime_get_ns();
+
+    read_state(st);
+    for (i = 0; i < NR_CLUSTERS; i++) {
+        snap.dom[i].domain = i == CLUSTER_E ? RADXA_OC_DOMAIN_CPU_E : RADXA_OC_DOMAIN_CPU_P;
+        snap.dom[i].flags = g_data->cluster[i].clk ? RADXA_OC_F_PRESENT : 0;
+        if (st[i].overclocked)
+            snap.dom[i].flags |= RADXA_OC_F_OVERCLOCKED;
+        snap.dom[i].cur_freq_hz = st[i].cur_hz;
+        snap.dom[i].target_freq_hz = st[i].target_hz;
+        snap.dom[i].voltage_uv = st[i].voltage_uv;
+    }
+
+    return memory_read_from_buffer(buf, count, &off, &snap, sizeof(snap));
+}
+
+static struct bin_attribute snapshot_attr = __BIN_ATTR_RO(snapshot, sizeof(struct cpu_overclock_snapshot));
+
+// Find the cpufreq policies from the CPU topology. The policy with the
+// lower stock maximum is the efficiency cluster; with a single policy it
+// is used as the efficiency cluster only.
+static int discover_clusters(void) {
+    struct radxa_cpu_cluster found[NR_CLUSTERS];
+    int c, nr = radxa_discover_clusters(found, NR_CLUSTERS);
+
+    if (nr > NR_CLUSTERS)
+        pr_warn("CPU_OVERCLOCK: %d cpufreq policies, using the first %d\n", nr, NR_CLUSTERS);
+    for (c = 0; c < NR_CLUSTERS; c++) {
+        g_data->cluster[c].cpu = found[c].cpu;
+        cpumask_copy(&g_data->cluster[c].cpus, &found[c].cpus);
+    }
+    return min(nr, NR_CLUSTERS);
+}
+
+// Without cpufreq: group CPUs by clock, cpu0's clock being the
+// efficiency cluster
+static void discover_clusters_legacy(void) {
+    struct clk *clk_e = NULL, *clk_p = NULL;
+    int cpu;
+
+    g_data->cluster[CLUSTER_E].cpu = -1;
+    g_data->cluster[CLUSTER_P].cpu = -1;
+
+    for_each_possible_cpu(cpu) {
+        struct device *cpu_dev = get_cpu_device(cpu);
+        struct clk *clk = cpu_dev ? clk_get(cpu_dev, NULL) : ERR_PTR(-ENODEV);
+        int c;
+
+        if (IS_ERR(clk))
+            continue;
+        if (!clk_e || clk_is_match(clk, clk_e)) {
+            c = CLUSTER_E;
+            if (!clk_e) {
+                clk_e = clk;
+                clk = NULL;
+            }
+        } else if (!clk_p || clk_is_match(clk, clk_p)) {
+            c = CLUSTER_P;
+            if (!clk_p) {
+                clk_p = clk;
+                clk = NULL;
+            }
+        } else {
+            clk_put(clk);
+            continue;
+        }
+        if (clk)
+            clk_put(clk);
+
+        if (g_data->cluster[c].cpu < 0)
+            g_data->cluster[c].cpu = cpu;
+        cpumask_set_cpu(cpu, &g_data->cluster[c].cpus);
+    }
+    if (clk_e)
+        clk_put(clk_e);
+    if (clk_p)
+        clk_put(clk_p);
+}
+
+// Register the extra points on the policy's OPP table. Already present
+// frequencies (stock points) are left alone.
+static void cluster_add_opps(struct cpu_cluster *cl) {
+    struct device *cpu_dev = get_cpu_device(cl->cpu);
+    struct dev_pm_opp *opp;
+    unsigned long freq = ULONG_MAX;
+    int i, ret;
+
+    opp = dev_pm_opp_find_freq_floor(cpu_dev, &freq);
+    if (!IS_ERR(opp)) {
+        cl->stock_max_hz = freq;
+        dev_pm_opp_put(opp);
+    }
+
+    for (i = 0; cl->freqs[i] && cl->nr_added < MAX_FREQS; i++) {
+        opp = dev_pm_opp_find_freq_exact(cpu_dev, cl->freqs[i], true);
+        if (!IS_ERR(opp)) {
+            dev_pm_opp_put(opp);
+            continue;
+        }
+
+        ret = dev_pm_opp_add(cpu_dev, cl->freqs[i], get_voltage_for_freq(cl->freqs[i]));
+        if (ret) {
+            pr_warn("CPU_OVERCLOCK: Could not add %lu MHz OPP to cpu%d: %d\n",
+                    cl->freqs[i] / 1000000, cl->cpu, ret);
+            continue;
+        }
+        cl->added[cl->nr_added++] = cl->freqs[i];
+    }
+
+    pr_info("CPU_OVERCLOCK: %s cluster (cpu%d): stock max %lu MHz, %d OPPs added\n",
+            cl->name, cl->cpu, cl->stock_max_hz / 1000000, cl->nr_added);
+}
+
+static void cluster_remove_opps(struct cpu_cluster *cl) {
+    struct device *cpu_dev = get_cpu_device(cl->cpu);
+
+    while (cl->nr_added)
+        dev_pm_opp_remove(cpu_dev, cl->added[--cl->nr_added]);
+}
+
+// cpufreq-dt builds its frequency table once at probe time from the OPP
+// table, so rebind it to pick up (or drop) our points.
+static void reprobe_cpufreq_dt(void) {
+    struct device *dev;
+    int ret;
+
+    dev = bus_find_device_by_name(&platform_bus_type, NULL, "cpufreq-dt");
+    if (!dev) {
+        pr_warn("CPU_OVERCLOCK: cpufreq-dt not found, new OPPs not in cpufreq tables\n");
+        return;
+    }
+
+    device_release_driver(dev);
+    ret = device_attach(dev);
+    if (ret <= 0)
+        pr_err("CPU_OVERCLOCK: cpufreq-dt did not rebind: %d\n", ret);
+    put_device(dev);
+}
+
+// Flag the above-stock entries as boost frequencies and hook the cluster's
+// frequency cap into the policy
+static int cluster_attach_policy(struct cpu_cluster *cl) {
+    struct cpufreq_policy *policy;
+    struct cpufreq_frequency_table *pos;
+    int boost = 0, ret;
+
+    policy = cpufreq_cpu_get(cl->cpu);
+    if (!policy)
+        return -ENODEV;
+
+    down_write(&policy->rwsem);
+    cpufreq_for_each_valid_entry(pos, policy->freq_table) {
+        if ((unsigned long)pos->frequency * 1000 > cl->stock_max_hz) {
+            pos->flags |= CPUFREQ_BOOST_FREQ;
+            boost++;
+        }
+    }
+    // Recompute cpuinfo limits so boost points are hidden while boost is off
+    cpufreq_frequency_table_cpuinfo(policy, policy->freq_table);
+    up_write(&policy->rwsem);
+
+    ret = freq_qos_add_request(&policy->constraints, &cl->max_req, FREQ_QOS_MAX,
+                               FREQ_QOS_MAX_DEFAULT_VALUE);
+    if (ret >= 0) {
+        ret = freq_qos_add_request(&policy->constraints, &cl->stall_req, FREQ_QOS_MAX,
+                                   FREQ_QOS_MAX_DEFAULT_VALUE);
+        if (ret < 0)
+            freq_qos_remove_request(&cl->max_req);
+    }
+    if (ret >= 0) {
+        ret = freq_qos_add_request(&policy->constraints, &cl->floor_req, FREQ_QOS_MIN,
+                                   FREQ_QOS_MIN_DEFAULT_VALUE);
+        if (ret < 0) {
+            freq_qos_remove_request(&cl->stall_req);
+            freq_qos_remove_request(&cl->max_req);
+        }
+    }
+    if (ret >= 0) {
+        ret = freq_qos_add_request(&policy->constraints, &cl->min_req, FREQ_QOS_MIN,
+                                   FREQ_QOS_MIN_DEFAULT_VALUE);
+        if (ret < 0) {
+            freq_qos_remove_request(&cl->floor_req);
+            freq_qos_remove_request(&cl->stall_req);
+            freq_qos_remove_request(&cl->max_req);
+        }
+    }
+    cpufreq_cpu_put(policy);
+    if (ret < 0)
+        return ret;
+
+    if (boost) {
+        ret = cpufreq_enable_boost_support();
+        if (ret)
+            pr_warn("CPU_OVERCLOCK: Could not enable cpufreq boost support: %d\n", ret);
+    }
+    cpufreq_update_policy(cl->cpu);
+
+    cl->has_policy = true;
+    pr_info("CPU_OVERCLOCK: %s cluster: %d boost frequencies in cpufreq\n", cl->name, boost);
+    return 0;
+}
+
+static void cluster_detach_policy(struct cpu_cluster *cl) {
+    if (!cl->has_policy)
+        return;
+    freq_qos_remove_request(&cl->min_req);
+    cl->min_freq = 0;
+    freq_qos_remove_request(&cl->floor_req);
+    freq_qos_remove_request(&cl->stall_req);
+    freq_qos_remove_request(&cl->max_req);
+    cl->has_policy = false;
+}
+
+// Separate request from max_req so the stall cap never overwrites what
+// the user asked for; cpufreq applies the lower of the two
+int cpu_overclock_stall_cap(unsigned int cpu, unsigned long max_hz) {
+    int c, ret;
+
+    for (c = 0; c < NR_CLUSTERS; c++) {
+        struct cpu_cluster *cl = &g_data->cluster[c];
+
+        if (!cpumask_test_cpu(cpu, &cl->cpus))
+            continue;
+        if (!cl->has_policy)
+            return -ENODEV;
+        ret = freq_qos_update_request(&cl->stall_req,
+                                      max_hz ? max_hz / 1000 : FREQ_QOS_MAX_DEFAULT_VALUE);
+        return ret < 0 ? ret : 0;
+    }
+    return -ENODEV;
+}
+EXPORT_SYMBOL_GPL(cpu_overclock_stall_cap);
+
+// Compute-bound clusters: a minimum for cpufreq, still below every cap
+int cpu_overclock_stall_floor(unsigned int cpu, unsigned long min_hz) {
+    int c, ret;
+
+    for (c = 0; c < NR_CLUSTERS; c++) {
+        struct cpu_cluster *cl = &g_data->cluster[c];
+
+        if (!cpumask_test_cpu(cpu, &cl->cpus))
+            continue;
+        if (!cl->has_policy)
+            return -ENODEV;
+        ret = freq_qos_update_request(&cl->floor_req,
+                                      min_hz ? min_hz / 1000 : FREQ_QOS_MIN_DEFAULT_VALUE);
+        return ret < 0 ? ret : 0;
+    }
+    return -ENODEV;
+}
+EXPORT_SYMBOL_GPL(cpu_overclock_stall_floor);
+
+int cpu_overclock_register_notifier(struct notifier_block *nb) {
+    return blocking_notifier_chain_register(&cpu_overclock_chain, nb);
+}
+EXPORT_SYMBOL_GPL(cpu_overclock_register_notifier);
+
+int cpu_overclock_unregister_notifier(struct notifier_block *nb) {
+    return blocking_notifier_chain_unregister(&cpu_overclock_chain, nb);
+}
+EXPORT_SYMBOL_GPL(cpu_overclock_unregister_notifier);
+
+// Next point below the current target: the OPP table under cpufreq,
+// the extra frequency list otherwise
+static unsigned long cluster_lower_freq(struct cpu_cluster *cl, unsigned long cur) {
+    unsigned long best = 0;
+    int i;
+
+    if (cl->has_policy) {
+        struct dev_pm_opp *opp;
+        unsigned long freq = cur - 1;
+
+        opp = dev_pm_opp_find_freq_floor(get_cpu_device(cl->cpu), &freq);
+        if (IS_ERR(opp))
+            return 0;
+        dev_pm_opp_put(opp);
+        return freq;
+    }
+
+    for (i = 0; cl->freqs[i]; i++)
+        if (cl->freqs[i] < cur && cl->freqs[i] > best)
+            best = cl->freqs[i];
+    return best;
+}
+
+// Drop the cluster that contains cpu by one operating point, e.g. after a
+// failed self-test. Returns the new frequency in Hz.
+long cpu_overclock_step_down(unsigned int cpu) {
+    int c, ret;
+
+    for (c = 0; c < NR_CLUSTERS; c++) {
+        struct cpu_cluster *cl = &g_data->cluster[c];
+        unsigned long cur, lower;
+
+        if (!cpumask_test_cpu(cpu, &cl->cpus) || !cl->clk)
+            continue;
+        cur = cl->target_freq ? cl->target_freq : clk_get_rate(cl->clk);
+        lower = cluster_lower_freq(cl, cur);
+        if (!lower)
+            return -ERANGE;
+
+        pr_warn("CPU_OVERCLOCK: Stepping %s cluster down from %lu to %lu MHz\n",
+                cl->name, cur / 1000000, lower / 1000000);
+        ret = apply_cluster_freq(cl, lower);
+        if (ret)
+            return ret;
+        notify_overclocked();
+        return lower;
+    }
+    return -ENODEV;
+}
+EXPORT_SYMBOL_GPL(cpu_overclock_step_down);
+
+static void put_clusters(void) {
+    int c;
+
+    for (c = 0; c < NR_CLUSTERS; c++) {
+        struct cpu_cluster *cl = &g_data->cluster[c];
+
+        cluster_detach_policy(cl);
+        if (cl->clk)
+            clk_put(cl->clk);
+    }
+}
+
+static void remove_all_opps(void) {
+    bool added = false;
+    int c;
+
+    for (c = 0; c < NR_CLUSTERS; c++) {
+        added |= g_data->cluster[c].nr_added > 0;
+        cluster_remove_opps(&g_data->cluster[c]);
+    }
+    if (added)
+        reprobe_cpufreq_dt();
+}
+
+static int cpu_em_active_power(unsigned long *power, unsigned long *freq,
+                               struct device *dev) {
+    int c;
+
+    for (c = 0; c < NR_CLUSTERS; c++) {
+        struct cpu_cluster *cl = &g_data->cluster[c];
+
+        if (cl->cpu >= 0 && cpumask_test_cpu(dev->id, &cl->cpus))
+            return radxa_em_opp_power(dev, cl->power_coeff, power, freq);
+    }
+    return -ENODEV;
+}
+
+static struct em_data_callback cpu_em_cb = EM_DATA_CB(cpu_em_active_power);
+
+// Give EAS the full V/F table, boost points included. Runs once the OPPs
+// are final: a CPU perf domain cannot be replaced afterwards.
+static void cluster_register_em(struct cpu_cluster *cl) {
+    struct device *cpu_dev = get_cpu_device(cl->cpu);
     int ret;
-    
+
+    if (em_cpu_get(cl->cpu)) {
+        pr_warn("CPU_OVERCLOCK: %s cluster keeps its boot-time Energy Model (%d states)\n",
+                cl->name, radxa_em_nr_states(cpu_dev));
+        return;
+    }
+
+    ret = radxa_em_update(cpu_dev, &cpu_em_cb, &cl->cpus);
+    if (ret)
+        pr_warn("CPU_OVERCLOCK: %s cluster Energy Model registration failed: %d\n",
+                cl->name, ret);
+    else
+        pr_info("CPU_OVERCLOCK: %s cluster Energy Model: %d states\n",
+                cl->name, radxa_em_nr_states(cpu_dev));
+}
+
+static void sched_scale_init(void) {
+    unsigned int covered = 0;
+    int c, cpu, ret;
+
+    // Baseline for rescaling. Without capacity-dmips-mhz every CPU boots
+    // at SCHED_CAPACITY_SCALE and there is no uarch ratio to preserve.
+    for_each_possible_cpu(cpu) {
+        g_data->boot_capacity[cpu] = topology_get_cpu_scale(cpu);
+        if (g_data->boot_capacity[cpu] != SCHED_CAPACITY_SCALE)
+            g_data->rescale_capacity = true;
+    }
+    for (c = 0; c < NR_CLUSTERS; c++)
+        covered += cpumask_weight(&g_data->cluster[c].cpus);
+    if (covered != num_possible_cpus())
+        g_data->rescale_capacity = false;
+    if (!g_data->rescale_capacity)
+        pr_info("CPU_OVERCLOCK: No per-cluster capacities, cpu_scale left alone\n");
+
+    update_cpu_capacity();
+    for (c = 0; c < NR_CLUSTERS; c++)
+        if (g_data->cluster[c].clk)
+            update_freq_scale(&g_data->cluster[c]);
+
+    // A transition notifier would cost every policy its fast switch
+    for (c = 0; c < NR_CLUSTERS; c++) {
+        struct cpu_cluster *cl = &g_data->cluster[c];
+
+        if (!cl->has_policy)
+            continue;
+        cl->max_nb.notifier_call = cpu_overclock_max_notify;
+        ret = freq_qos_add_notifier(cl->max_req.qos, FREQ_QOS_MAX, &cl->max_nb);
+        if (ret) {
+            pr_warn("CPU_OVERCLOCK: %s cluster: no max QoS notifier: %d\n", cl->name, ret);
+            cl->max_nb.notifier_call = NULL;
+        }
+    }
+}
+
+static void sched_scale_exit(void) {
+    int c, cpu;
+
+    for (c = 0; c < NR_CLUSTERS; c++) {
+        struct cpu_cluster *cl = &g_data->cluster[c];
+
+        if (cl->max_nb.notifier_call)
+            freq_qos_remove_notifier(cl->max_req.qos, FREQ_QOS_MAX, &cl->max_nb);
+        cl->max_nb.notifier_call = NULL;
+    }
+    cancel_work_sync(&g_data->capacity_work);
+
+    if (g_data->rescale_capacity) {
+        for_each_possible_cpu(cpu)
+            set_cpu_scale(cpu, g_data->boot_capacity[cpu]);
+        rebuild_sched_capacity();
+    }
+}
+
+// cpufreq keeps time_in_state for the clusters it drives; count the
+// others here. Without stats the module works as before.
+static void freq_stats_init(void) {
+    int c;
+
+    for (c = 0; c < NR_CLUSTERS; c++) {
+        struct cpu_cluster *cl = &g_data->cluster[c];
+
+        if (cl->has_policy || !cl->clk)
+            continue;
+        if (!g_data->stats_kobj)
+            g_data->stats_kobj = kobject_create_and_add("freq_stats", g_data->kobj);
+        cl->stats = radxa_fs_create(g_data->stats_kobj, cl->name, published_hz(cl));
+        if (!cl->stats)
+            pr_warn("CPU_OVERCLOCK: No frequency statistics for %s cluster\n", cl->name);
+    }
+}
+
+static void freq_stats_exit(void) {
+    int c;
+
+    for (c = 0; c < NR_CLUSTERS; c++) {
+        radxa_fs_destroy(g_data->cluster[c].stats);
+        g_data->cluster[c].stats = NULL;
+    }
+    kobject_put(g_data->stats_kobj);
+}
+
+// Someone else moved a cluster clock we set directly
+static void cluster_drifted(struct radxa_clk_watch *w, unsigned long hz) {
+    struct cpu_cluster *cl = container_of(w, struct cpu_cluster, watch);
+
+    mutex_lock(&cl->lock);
+    radxa_fs_update(cl->stats, hz);
+    publish_cluster(cl);
+    update_freq_scale(cl);
+    mutex_unlock(&cl->lock);
+    notify_overclocked();
+    sysfs_notify(g_data->kobj, cl->name, "drift_count");
+    sysfs_notify(g_data->kobj, cl->name, "cur_freq_hz");
+}
+
+static int cluster_reassert(struct radxa_clk_watch *w, unsigned long hz) {
+    struct cpu_cluster *cl = container_of(w, struct cpu_cluster, watch);
+    int ret = apply_cluster_freq(cl, hz);
+
+    notify_overclocked();
+    return ret;
+}
+
+// Clusters under cpufreq change rate all the time, that is not drift
+static void drift_watch_init(void) {
+    int c;
+
+    for (c = 0; c < NR_CLUSTERS; c++) {
+        struct cpu_cluster *cl = &g_data->cluster[c];
+
+        if (cl->has_policy || !cl->clk)
+            continue;
+        cl->watch.drifted = cluster_drifted;
+        cl->watch.reassert = cluster_reassert;
+        if (radxa_cw_register(&cl->watch, cl->clk, cl->name, &drift_policy))
+            pr_warn("CPU_OVERCLOCK: Cannot watch %s cluster clock for changes\n", cl->name);
+    }
+}
+
+// Suspend and a cluster power-down reset the PLL behind the clock
+// framework's back. Put a directly driven cluster back at its target:
+// voltage first, then the clock. cpufreq restores its own clusters.
+static void restore_cluster(struct cpu_cluster *cl) {
+    int ret;
+
+    if (cl->has_policy || !cl->clk || !cl->target_freq)
+        return;
+    mutex_lock(&cl->lock);
+    if (g_data->cpu_supply)
+        regulator_sync_voltage(g_data->cpu_supply);
+    ret = radxa_cw_reprogram(&cl->watch, cl->clk, cl->target_freq);
+    if (ret) {
+        pr_err("CPU_OVERCLOCK: Failed to restore %s cluster to %lu MHz: %d\n",
+               cl->name, cl->target_freq / 1000000, ret);
+        radxa_fs_failed(cl->stats);
+    } else {
+        pr_info("CPU_OVERCLOCK: Restored %s cluster to %lu MHz\n",
+                cl->name, cl->target_freq / 1000000);
+    }
+    publish_cluster(cl);
+    radxa_fs_update(cl->stats, published_hz(cl));
+    update_freq_scale(cl);
+    notify_cluster_change(cl, cl->target_freq);
+    mutex_unlock(&cl->lock);
+}
+
+// Restore before the first request lands, not when someone notices
+static int cpu_overclock_pm_notify(struct notifier_block *nb, unsigned long action,
+                                   void *data) {
+    int c;
+
+    switch (action) {
+    case PM_POST_SUSPEND:
+    case PM_POST_HIBERNATION:
+    case PM_POST_RESTORE:
+        for (c = 0; c < NR_CLUSTERS; c++)
+            restore_cluster(&g_data->cluster[c]);
+        notify_overclocked();
+        break;
+    }
+    return NOTIFY_OK;
+}
+
+static void restore_workfn(struct work_struct *work) {
+    int c;
+
+    for (c = 0; c < NR_CLUSTERS; c++)
+        if (test_and_clear_bit(c, &g_data->restore_pending))
+            restore_cluster(&g_data->cluster[c]);
+    notify_overclocked();
+}
+
+// The first CPU of a cluster coming online means the whole cluster was
+// powered down. Restore from a work item, outside the hotplug lock.
+static int cpu_overclock_cpu_online(unsigned int cpu) {
+    int c, other, nr_online;
+
+    for (c = 0; c < NR_CLUSTERS; c++) {
+        struct cpu_cluster *cl = &g_data->cluster[c];
+
+        if (cl->has_policy || !cpumask_test_cpu(cpu, &cl->cpus))
+            continue;
+        nr_online = 0;
+        for_each_cpu_and(other, &cl->cpus, cpu_online_mask)
+            nr_online++;
+        if (nr_online == 1) {
+            set_bit(c, &g_data->restore_pending);
+            schedule_work(&g_data->restore_work);
+        }
+    }
+    return 0;
+}
+
+static void restore_init(void) {
+    int ret;
+
+    if (g_data->cluster[CLUSTER_E].has_policy && g_data->cluster[CLUSTER_P].has_policy)
+        return;
+    g_data->pm_nb.notifier_call = cpu_overclock_pm_notify;
+    register_pm_notifier(&g_data->pm_nb);
+    ret = cpuhp_setup_state_nocalls(CPUHP_AP_ONLINE_DYN, "cpu_overclock:online",
+                                    cpu_overclock_cpu_online, NULL);
+    if (ret < 0)
+        pr_warn("CPU_OVERCLOCK: No hotplug callback, clusters are not restored after power-down\n");
+    else
+        g_data->cpuhp_state = ret;
+}
+
+static void restore_exit(void) {
+    if (g_data->cpuhp_state)
+        cpuhp_remove_state_nocalls(g_data->cpuhp_state);
+    if (g_data->pm_nb.notifier_call)
+        unregister_pm_notifier(&g_data->pm_nb);
+    cancel_work_sync(&g_data->restore_work);
+}
+
+static int __init cpu_overclock_init(void) {
+    bool added = false;
+    int c, nr_policies, ret;
+
     pr_info("CPU_OVERCLOCK: Loading CPU overclocking module...\n");
-    
+
     g_data = kzalloc(sizeof(*g_data), GFP_KERNEL);
     if (!g_data)
         return -ENOMEM;
-    
+    INIT_WORK(&g_data->capacity_work, capacity_workfn);
+    INIT_WORK(&g_data->restore_work, restore_workfn);
+    radxa_oc_try_init(&g_data->try, apply_overclock_setting, "1794,2002", lkg);
+
+    g_data->cluster[CLUSTER_E].freqs = efficiency_freqs;
+    g_data->cluster[CLUSTER_E].stock_max_hz = STOCK_MAX_E_HZ;
+    g_data->cluster[CLUSTER_E].power_coeff = e_power_coeff;
+    g_data->cluster[CLUSTER_P].freqs = performance_freqs;
+    g_data->cluster[CLUSTER_P].stock_max_hz = STOCK_MAX_P_HZ;
+    g_data->cluster[CLUSTER_P].power_coeff = p_power_coeff;
+    seqlock_init(&g_data->state_lock);
+    for (c = 0; c < NR_CLUSTERS; c++) {
+        g_data->cluster[c].name = cluster_names[c];
+        mutex_init(&g_data->cluster[c].lock);
+    }
+
+    nr_policies = discover_clusters();
+    if (!nr_policies) {
+        pr_warn("CPU_OVERCLOCK: No cpufreq policies, programming clocks directly\n");
+        discover_clusters_legacy();
+    }
+
     // Try to find CPU clock sources
-    np = of_find_node_by_path("/cpus/cpu@0");
-    if (np) {
-        g_data->cpu_clk_e = of_clk_get(np, 0);
-        if (IS_ERR(g_data->cpu_clk_e)) {
-            pr_warn("CPU_OVERCLOCK: Could not get efficiency core clock\n");
-            g_data->cpu_clk_e = NULL;
-        } else {
-            pr_info("CPU_OVERCLOCK: Found efficiency core clock\n");
+    for (c = 0; c < NR_CLUSTERS; c++) {
+        struct cpu_cluster *cl = &g_data->cluster[c];
+        struct device *cpu_dev = cl->cpu >= 0 ? get_cpu_device(cl->cpu) : NULL;
+
+        if (!cpu_dev)
+            continue;
+        cl->clk = clk_get(cpu_dev, NULL);
+        if (IS_ERR(cl->clk)) {
+            pr_warn("CPU_OVERCLOCK: Could not get %s core clock\n", cl->name);
+            cl->clk = NULL;
+            continue;
         }
-        of_node_put(np);
-    }
-    
-    np = of_find_node_by_path("/cpus/cpu@6");
-    if (np) {
-        g_data->cpu_clk_p = of_clk_get(np, 0);
-        if (IS_ERR(g_data->cpu_clk_p)) {
-            pr_warn("CPU_OVERCLOCK: Could not get performance core clock\n");
-            g_data->cpu_clk_p = NULL;
-        } else {
-            pr_info("CPU_OVERCLOCK: Found performance core clock\n");
+        pr_info("CPU_OVERCLOCK: Found %s core clock (cpu%d)\n", cl->name, cl->cpu);
+
+        if (nr_policies) {
+            cluster_add_opps(cl);
+            added |= cl->nr_added > 0;
         }
-        of_node_put(np);
-    }
-    
-    // Try to get CPU voltage regulator
-    g_data->cpu_supply = regulator_get(NULL, "cpu");
-    if (IS_ERR(g_data->cpu_supply)) {
-        pr_warn("CPU_OVERCLOCK: Could not get CPU regulator\n");
-        g_data->cpu_supply = NULL;
-    } else {
-        pr_info("CPU_OVERCLOCK: Found CPU voltage regulator\n");
     }
-    
-    if (!g_data->cpu_clk_e && !g_data->cpu_clk_p) {
+
+    if (!g_data->cluster[CLUSTER_E].clk && !g_data->cluster[CLUSTER_P].clk) {
         pr_err("CPU_OVERCLOCK: No CPU clocks found!\n");
         ret = -ENODEV;
-        goto err_free;
+        goto err_clk;
     }
-    
+
+    if (added)
+        reprobe_cpufreq_dt();
+
+    for (c = 0; c < NR_CLUSTERS; c++) {
+        struct cpu_cluster *cl = &g_data->cluster[c];
+
+        if (!cl->clk || !nr_policies)
+            continue;
+        ret = cluster_attach_policy(cl);
+        if (ret) {
+            pr_warn("CPU_OVERCLOCK: %s cluster not under cpufreq (%d), using clock directly\n",
+                    cl->name, ret);
+            continue;
+        }
+        cluster_register_em(cl);
+    }
+
+    // The regulator is only needed for clusters we drive by hand
+    if (!g_data->cluster[CLUSTER_E].has_policy || !g_data->cluster[CLUSTER_P].has_policy) {
+        g_data->cpu_supply = regulator_get(NULL, "cpu");
+        if (IS_ERR(g_data->cpu_supply)) {
+            pr_warn("CPU_OVERCLOCK: Could not get CPU regulator\n");
+            g_data->cpu_supply = NULL;
+        } else {
+            pr_info("CPU_OVERCLOCK: Found CPU voltage regulator\n");
+        }
+    }
+
+    // sched_scale_init() takes the direct clusters' rate from here
+    for (c = 0; c < NR_CLUSTERS; c++)
+        publish_cluster(&g_data->cluster[c]);
+    sched_scale_init();
+
     // Create sysfs interface
     g_data->kobj = kobject_create_and_add("cpu_overclock", kernel_kobj);
     if (!g_data->kobj) {
         ret = -ENOMEM;
-        goto err_clk;
+        goto err_sched;
     }
-    
+
     ret = sysfs_create_file(g_data->kobj, &overclock_attr.attr);
     if (ret) {
         pr_err("CPU_OVERCLOCK: Failed to create sysfs file\n");
         goto err_kobj;
     }
-    
+
+    ret = sysfs_create_file(g_data->kobj, &min_freq_attr.attr);
+    if (ret)
+        goto err_file;
+
+    ret = sysfs_create_group(g_data->kobj, &cpu_overclock_group);
+    if (ret)
+        goto err_min_freq;
+    ret = sysfs_create_group(g_data->kobj, &efficiency_group);
+    if (ret)
+        goto err_group;
+    ret = sysfs_create_group(g_data->kobj, &performance_group);
+    if (ret)
+        goto err_group_e;
+    ret = sysfs_create_bin_file(g_data->kobj, &snapshot_attr);
+    if (ret)
+        goto err_group_p;
+
+    freq_stats_init();
+    drift_watch_init();
+    restore_init();
+    radxa_oc_try_restore(&g_data->try, g_data->kobj, "try_state");
+
     pr_info("CPU_OVERCLOCK: Module loaded successfully!\n");
     pr_info("CPU_OVERCLOCK: Control interface at /sys/kernel/cpu_overclock/overclock\n");
-    
+
     return 0;
-    
+
+err_group_p:
+    sysfs_remove_group(g_data->kobj, &performance_group);
+err_group_e:
+    sysfs_remove_group(g_data->kobj, &efficiency_group);
+err_group:
+    sysfs_remove_group(g_data->kobj, &cpu_overclock_group);
+err_min_freq:
+    sysfs_remove_file(g_data->kobj, &min_freq_attr.attr);
+err_file:
+    sysfs_remove_file(g_data->kobj, &overclock_attr.attr);
 err_kobj:
     kobject_put(g_data->kobj);
+    g_data->kobj = NULL;
+err_sched:
+    sched_scale_exit();
 err_clk:
-    if (g_data->cpu_clk_e) clk_put(g_data->cpu_clk_e);
-    if (g_data->cpu_clk_p) clk_put(g_data->cpu_clk_p);
+    put_clusters();
+    remove_all_opps();
     if (g_data->cpu_supply) regulator_put(g_data->cpu_supply);
-err_free:
     kfree(g_data);
     return ret;
 }
 
 static void __exit cpu_overclock_exit(void) {
+    int c;
+
     pr_info("CPU_OVERCLOCK: Unloading module...\n");
-    
+
     if (g_data) {
+        radxa_oc_try_exit(&g_data->try);
+        restore_exit();
+
+        for (c = 0; c < NR_CLUSTERS; c++)
+            radxa_cw_unregister(&g_data->cluster[c].watch);
+
         if (g_data->kobj) {
+            freq_stats_exit();
+            sysfs_remove_bin_file(g_data->kobj, &snapshot_attr);
+            sysfs_remove_group(g_data->kobj, &performance_group);
+            sysfs_remove_group(g_data->kobj, &efficiency_group);
+            sysfs_remove_group(g_data->kobj, &cpu_overclock_group);
+            sysfs_remove_file(g_data->kobj, &min_freq_attr.attr);
             sysfs_remove_file(g_data->kobj, &overclock_attr.attr);
             kobject_put(g_data->kobj);
+            g_data->kobj = NULL;    // capacity_work may still run
         }
-        
-        if (g_data->cpu_clk_e) clk_put(g_data->cpu_clk_e);
-        if (g_data->cpu_clk_p) clk_put(g_data->cpu_clk_p);
+
+        sched_scale_exit();
+        // QoS requests must go before cpufreq-dt rebinds and frees the policies
+        put_clusters();
+        remove_all_opps();
         if (g_data->cpu_supply) regulator_put(g_data->cpu_supply);
-        
+
         kfree(g_data);
     }
-    
+
     pr_info("CPU_OVERCLOCK: Module unloaded\n");
 }
 
@@ -262,4 +1639,4 @@ module_exit(cpu_overclock_exit);
 MODULE_AUTHOR("Radxa Performance Team");
 MODULE_DESCRIPTION("CPU Overclocking Module for A733 SoC");
 MODULE_LICENSE("GPL v2");
-MODULE_VERSION("1.0");
\ No newline at end of file
+MODULE_VERSION("1.0");
@@ -0,0 +1,41 @@
+/*
+ * RADXA OVERCLOCK - CPU SELF-TEST WORKLOADS
+ *
+ * Checksums with known answers, run by cpu_selftest on each core. The
+ * input is SELFTEST_WORDS words from a xorshift32 generator seeded with
+ * SELFTEST_SEED; the answers below were computed for exactly that input.
+ * All arithmetic is exact (integer, or floats that stay below 2^24), so
+ * any difference is a hardware error, not rounding.
+ *
+ * cpu_selftest_neon.c is built with the FP/SIMD registers enabled: only
+ * call it between kernel_neon_begin() and kernel_neon_end().
+ */
+
+#ifndef CPU_SELFTEST_H
+#define CPU_SELFTEST_H
+
+#include <linux/types.h>
+
+#define SELFTEST_WORDS          4096    // 16 KiB, stays in L1
+#define SELFTEST_SEED           0x2545f491
+#define SELFTEST_FMA_MUL        0x9e3779b1
+#define SELFTEST_HASH_BASIS     0x811c9dc5
+#define SELFTEST_HASH_PRIME     0x01000193
+
+#define SELFTEST_KAT_FMA        0x1bb460c3163b2853ULL
+#define SELFTEST_KAT_HASH       0x01a6c9712a0e620aULL
+
+// Four lane states into one checksum
+static inline u64 selftest_fold(u32 h0, u32 h1, u32 h2, u32 h3)
+{
+    return ((u64)(h0 ^ h2) << 32) | (h1 ^ h3);
+}
+
+// Blocks of 16 dependent FMAs on 10-bit operands per lane, each block's
+// sum hashed into the lane state
+u64 selftest_neon_fma(const u32 *buf, size_t words);
+
+// Multiply/xor-shift hash, four interleaved streams
+u64 selftest_neon_hash(const u32 *buf, size_t words);
+
+#endif /* CPU_SELFTEST_H */
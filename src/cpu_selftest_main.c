@@ -0,0 +1,719 @@
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/cpu.h>
+#include <linux/cpufreq.h>
+#include <linux/pm_qos.h>
+#include <linux/kthread.h>
+#include <linux/smpboot.h>
+#include <linux/workqueue.h>
+#include <linux/sched.h>
+#include <linux/vmalloc.h>
+#include <linux/log2.h>
+#include <linux/delay.h>
+#include <linux/sysfs.h>
+#include <linux/kobject.h>
+#include <asm/neon.h>
+
+#include "cpu_selftest.h"
+#include "radxa_overclock_hooks.h"
+#include "radxa_cpu_clusters.h"
+#include "radxa_tunable.h"
+
+#define MODULE_NAME "cpu_selftest"
+#define CLUSTER_E 0
+#define CLUSTER_P 1
+#define NR_CLUSTERS 2
+
+// Odd, so (i * stride) mod 2^n visits every word; jumps pages and sets
+#define CACHE_STRIDE 4099
+
+static unsigned int cache_kb = 2048;
+module_param(cache_kb, uint, 0444);
+MODULE_PARM_DESC(cache_kb, "Per-CPU buffer for the cache pattern test in KiB, larger than L2+L3 (default: 2048)");
+
+enum selftest_result {
+    RESULT_UNTESTED,
+    RESULT_PASS,
+    RESULT_FAIL,
+};
+
+static const char * const result_names[] = { "untested", "pass", "fail" };
+
+// Bits in selftest_cpu.flags
+#define SELFTEST_RUN        0   // Run now
+
+struct selftest_cpu {
+    unsigned long flags;
+    u32 *scratch;                   // Cache pattern buffer, cache_kb
+    size_t scratch_words;
+    u32 seed;                       // Cache pattern of the current run
+};
+
+struct selftest_cluster {
+    const char *name;
+    cpumask_t cpus;
+    int cpu;                        // First CPU of the cpufreq policy, -1 if none
+    struct freq_qos_request pin_req;    // Holds the cluster at its maximum while testing
+    unsigned int active;            // CPUs of the cluster currently testing
+    atomic_t seq;                   // Bumped on every cpu_overclock transition
+    struct mutex step_lock;
+    // Results
+    unsigned int runs;
+    unsigned int fma_errors;        // NEON FMA chain
+    unsigned int hash_errors;       // NEON integer hash
+    unsigned int scalar_errors;     // Same hash on the integer pipeline
+    unsigned int cache_errors;      // Words read back wrong
+    unsigned int step_downs;
+    enum selftest_result last_result;
+    unsigned int last_freq_khz;
+    int last_fail_cpu;
+};
+
+struct selftest_data {
+    struct selftest_cpu cpu[NR_CPUS];
+    struct selftest_cluster cluster[NR_CLUSTERS];
+    int nr_clusters;
+    u32 *input;                     // SELFTEST_WORDS, shared read-only
+    struct mutex lock;              // Results and pin requests
+    struct kobject *kobj;
+    unsigned int interval_ms;       // 0: only on demand and after transitions
+    unsigned int iterations;        // Passes over the input per run
+    unsigned int on_transition;
+    unsigned int auto_step_down;
+    struct delayed_work tick_work;  // Every interval_ms, if set
+    struct notifier_block transition_nb;
+    // Hooks into cpu_overclock, NULL if not loaded
+    int (*register_nb)(struct notifier_block *nb);
+    int (*unregister_nb)(struct notifier_block *nb);
+    long (*step_down)(unsigned int cpu);
+};
+
+static struct selftest_data *g_data;
+
+// smpboot parks these while their CPU is offline and rebinds them when it
+// comes back
+static DEFINE_PER_CPU(struct task_struct *, selftest_tasks);
+
+static const char * const cluster_names[NR_CLUSTERS] = { "efficiency", "performance" };
+
+// Clusters as cpu_overclock sees them
+static int discover_clusters(void) {
+    struct radxa_cpu_cluster found[NR_CLUSTERS];
+    int c, nr = min(radxa_discover_clusters(found, NR_CLUSTERS), NR_CLUSTERS);
+
+    for (c = 0; c < NR_CLUSTERS; c++) {
+        g_data->cluster[c].cpu = found[c].cpu;
+        cpumask_copy(&g_data->cluster[c].cpus, &found[c].cpus);
+    }
+    return nr;
+}
+
+static struct selftest_cluster *cluster_of(unsigned int cpu) {
+    int c;
+
+    for (c = 0; c < g_data->nr_clusters; c++)
+        if (cpumask_test_cpu(cpu, &g_data->cluster[c].cpus))
+            return &g_data->cluster[c];
+    return NULL;
+}
+
+// Workload input and scalar references
+
+static void fill_input(u32 *buf) {
+    u32 x = SELFTEST_SEED;
+    int i;
+
+    for (i = 0; i < SELFTEST_WORDS; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        buf[i] = x;
+    }
+}
+
+// Integer version of selftest_neon_fma(), only used to check the input
+static u64 ref_fma(const u32 *buf) {
+    u32 h[4] = { 1, 2, 3, 4 };
+    int i, k, l;
+
+    for (i = 0; i + 64 <= SELFTEST_WORDS; i += 64) {
+        u32 acc[4] = { 0, 0, 0, 0 };
+
+        for (k = 0; k < 16; k++)
+            for (l = 0; l < 4; l++) {
+                u32 v = buf[i + 4 * k + l];
+
+                acc[l] += (v & 0x3ff) * ((v >> 16) & 0x3ff);
+            }
+        for (l = 0; l < 4; l++)
+            h[l] = (h[l] ^ acc[l]) * SELFTEST_FMA_MUL;
+    }
+    return selftest_fold(h[0], h[1], h[2], h[3]);
+}
+
+// selftest_neon_hash() on the integer pipeline, run every pass
+static u64 ref_hash(const u32 *buf) {
+    u32 h[4];
+    int i, l;
+
+    for (l = 0; l < 4; l++)
+        h[l] = SELFTEST_HASH_BASIS + l;
+
+    for (i = 0; i + 4 <= SELFTEST_WORDS; i += 4)
+        for (l = 0; l < 4; l++) {
+            u32 t = h[l] ^ buf[i + l];
+
+            t *= SELFTEST_HASH_PRIME;
+            t ^= t >> 15;
+            t += t << 7;
+            h[l] = t;
+        }
+    return selftest_fold(h[0], h[1], h[2], h[3]);
+}
+
+// Module unload, or the CPU is going offline
+static bool selftest_interrupted(void) {
+    return kthread_should_stop() || kthread_should_park();
+}
+
+// Known-answer passes: NEON FMA, NEON hash, scalar hash
+static void run_kat(unsigned int *fma, unsigned int *hash, unsigned int *scalar) {
+    unsigned int i;
+
+    for (i = 0; i < READ_ONCE(g_data->iterations) && !selftest_interrupted(); i++) {
+        u64 f, h;
+
+        kernel_neon_begin();
+        f = selftest_neon_fma(g_data->input, SELFTEST_WORDS);
+        h = selftest_neon_hash(g_data->input, SELFTEST_WORDS);
+        kernel_neon_end();
+
+        *fma += f != SELFTEST_KAT_FMA;
+        *hash += h != SELFTEST_KAT_HASH;
+        *scalar += ref_hash(g_data->input) != SELFTEST_KAT_HASH;
+        cond_resched();
+    }
+}
+
+static inline u32 cache_pattern(size_t idx, u32 seed) {
+    return (u32)idx * SELFTEST_FMA_MUL ^ seed;
+}
+
+// Write the buffer in stride order and read it back linearly, then the
+// inverse pattern the other way round: every line goes through L2/L3
+// evictions and the DRAM path in both directions
+static unsigned int run_cache(struct selftest_cpu *sc) {
+    size_t n = sc->scratch_words, i, idx;
+    unsigned int errors = 0;
+    u32 seed = sc->seed;
+
+    for (i = 0; i < n; i++) {
+        idx = (i * CACHE_STRIDE) & (n - 1);
+        sc->scratch[idx] = cache_pattern(idx, seed);
+        if (!(i & 0xffff))
+            cond_resched();
+    }
+    for (i = 0; i < n; i++) {
+        errors += sc->scratch[i] != cache_pattern(i, seed);
+        sc->scratch[i] = ~cache_pattern(i, seed);
+        if (!(i & 0xffff))
+            cond_resched();
+    }
+    for (i = 0; i < n; i++) {
+        idx = (i * CACHE_STRIDE) & (n - 1);
+        errors += sc->scratch[idx] != ~cache_pattern(idx, seed);
+        if (!(i & 0xffff))
+            cond_resched();
+    }
+    return errors;
+}
+
+// Test at the highest frequency cpufreq allows right now, not whatever
+// the governor picked for a nice-19 thread
+static void cluster_pin(struct selftest_cluster *cl, bool pin) {
+    mutex_lock(&g_data->lock);
+    if (pin ? cl->active++ == 0 : --cl->active == 0)
+        if (freq_qos_request_active(&cl->pin_req))
+            freq_qos_update_request(&cl->pin_req,
+                                    pin ? FREQ_QOS_MAX_DEFAULT_VALUE : FREQ_QOS_MIN_DEFAULT_VALUE);
+    mutex_unlock(&g_data->lock);
+}
+
+static void step_down(struct selftest_cluster *cl, unsigned int cpu, int seq) {
+    long ret;
+
+    mutex_lock(&cl->step_lock);
+    // Other CPUs of the cluster may have failed at the same point: only
+    // step once per frequency
+    if (atomic_read(&cl->seq) == seq) {
+        ret = g_data->step_down(cpu);
+        if (ret > 0) {
+            cl->step_downs++;
+            sysfs_notify(g_data->kobj, cl->name, "step_downs");
+        } else {
+            pr_err("CPU_SELFTEST: %s cluster step-down failed: %ld\n", cl->name, ret);
+        }
+    }
+    mutex_unlock(&cl->step_lock);
+}
+
+static void selftest_run(struct selftest_cpu *sc, unsigned int cpu) {
+    struct selftest_cluster *cl = cluster_of(cpu);
+    unsigned int fma = 0, hash = 0, scalar = 0, cache = 0, freq_khz;
+    int seq;
+
+    if (!cl)
+        return;
+
+    seq = atomic_read(&cl->seq);
+    cluster_pin(cl, true);
+    msleep(10);         // cpufreq applies the new minimum from a work item
+    freq_khz = cpufreq_quick_get(cpu);
+
+    run_kat(&fma, &hash, &scalar);
+    if (sc->scratch && !selftest_interrupted())
+        cache = run_cache(sc);
+    sc->seed = sc->seed * SELFTEST_HASH_PRIME + 1;
+
+    cluster_pin(cl, false);
+
+    mutex_lock(&g_data->lock);
+    cl->runs++;
+    cl->fma_errors += fma;
+    cl->hash_errors += hash;
+    cl->scalar_errors += scalar;
+    cl->cache_errors += cache;
+    cl->last_freq_khz = freq_khz;
+    cl->last_result = fma + hash + scalar + cache ? RESULT_FAIL : RESULT_PASS;
+    if (cl->last_result == RESULT_FAIL)
+        cl->last_fail_cpu = cpu;
+    mutex_unlock(&g_data->lock);
+
+    sysfs_notify(g_data->kobj, cl->name, "last_result");
+    if (cl->last_result != RESULT_FAIL)
+        return;
+
+    pr_err("CPU_SELFTEST: cpu%u miscompares at %u MHz: fma %u, hash %u, scalar %u, cache %u\n",
+           cpu, freq_khz / 1000, fma, hash, scalar, cache);
+    sysfs_notify(g_data->kobj, cl->name, "miscompares");
+
+    if (READ_ONCE(g_data->auto_step_down) && g_data->step_down)
+        step_down(cl, cpu, seq);
+}
+
+// First time the thread runs on its CPU, so the pages come from its node
+static void selftest_setup(unsigned int cpu) {
+    struct selftest_cpu *sc = &g_data->cpu[cpu];
+
+    // Background work: only soaks up otherwise idle time
+    set_user_nice(current, MAX_NICE);
+    if (!cluster_of(cpu) || !sc->scratch_words)
+        return;
+    sc->scratch = vmalloc(sc->scratch_words * sizeof(u32));
+    if (!sc->scratch)
+        pr_warn("CPU_SELFTEST: cpu%u: no cache buffer, pattern test skipped\n", cpu);
+}
+
+static void selftest_cleanup(unsigned int cpu, bool online) {
+    struct selftest_cpu *sc = &g_data->cpu[cpu];
+
+    vfree(sc->scratch);
+    sc->scratch = NULL;
+}
+
+static int selftest_should_run(unsigned int cpu) {
+    return test_bit(SELFTEST_RUN, &g_data->cpu[cpu].flags);
+}
+
+static void selftest_fn(unsigned int cpu) {
+    struct selftest_cpu *sc = &g_data->cpu[cpu];
+
+    clear_bit(SELFTEST_RUN, &sc->flags);
+    selftest_run(sc, cpu);
+}
+
+static struct smp_hotplug_thread selftest_threads = {
+    .store              = &selftest_tasks,
+    .thread_should_run  = selftest_should_run,
+    .thread_fn          = selftest_fn,
+    .setup              = selftest_setup,
+    .cleanup            = selftest_cleanup,
+    .thread_comm        = "cpu_selftest/%u",
+};
+
+// A CPU that is offline now runs its test once it is back
+static void kick_cpus(const struct cpumask *cpus, int bit) {
+    int cpu;
+
+    for_each_cpu(cpu, cpus) {
+        struct task_struct *task;
+
+        if (!cluster_of(cpu))
+            continue;
+        set_bit(bit, &g_data->cpu[cpu].flags);
+        task = per_cpu(selftest_tasks, cpu);
+        if (task)
+            wake_up_process(task);
+    }
+}
+
+static void tick_workfn(struct work_struct *work) {
+    unsigned int interval = READ_ONCE(g_data->interval_ms);
+
+    if (!interval)
+        return;
+    kick_cpus(cpu_possible_mask, SELFTEST_RUN);
+    schedule_delayed_work(&g_data->tick_work, msecs_to_jiffies(interval));
+}
+
+// cpu_overclock applied a frequency: retest that cluster
+static int selftest_transition(struct notifier_block *nb, unsigned long event, void *data) {
+    struct cpu_overclock_event *ev = data;
+    struct selftest_cluster *cl;
+
+    if (event != CPU_OVERCLOCK_APPLIED)
+        return NOTIFY_DONE;
+    cl = cluster_of(ev->cpu);
+    if (!cl)
+        return NOTIFY_DONE;
+
+    atomic_inc(&cl->seq);
+    if (READ_ONCE(g_data->on_transition))
+        kick_cpus(&cl->cpus, SELFTEST_RUN);
+    return NOTIFY_OK;
+}
+
+static int start_threads(void) {
+    size_t words = rounddown_pow_of_two(max(cache_kb, 1U) * 1024 / sizeof(u32));
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+        struct selftest_cpu *sc = &g_data->cpu[cpu];
+
+        sc->scratch_words = cache_kb ? words : 0;
+        sc->seed = SELFTEST_SEED ^ cpu;
+    }
+    return smpboot_register_percpu_thread(&selftest_threads);
+}
+
+static void stop_threads(void) {
+    cancel_delayed_work_sync(&g_data->tick_work);
+    smpboot_unregister_percpu_thread(&selftest_threads);
+}
+
+static void add_pin_requests(void) {
+    int c;
+
+    for (c = 0; c < g_data->nr_clusters; c++) {
+        struct selftest_cluster *cl = &g_data->cluster[c];
+        struct cpufreq_policy *policy = cpufreq_cpu_get(cl->cpu);
+        int ret;
+
+        if (!policy)
+            continue;
+        ret = freq_qos_add_request(&policy->constraints, &cl->pin_req, FREQ_QOS_MIN,
+                                   FREQ_QOS_MIN_DEFAULT_VALUE);
+        if (ret < 0)
+            pr_warn("CPU_SELFTEST: %s cluster runs tests at the governor's frequency: %d\n",
+                    cl->name, ret);
+        cpufreq_cpu_put(policy);
+    }
+}
+
+static void remove_pin_requests(void) {
+    int c;
+
+    for (c = 0; c < g_data->nr_clusters; c++)
+        if (freq_qos_request_active(&g_data->cluster[c].pin_req))
+            freq_qos_remove_request(&g_data->cluster[c].pin_req);
+}
+
+// Sysfs interface: controls at the top, results per cluster
+static ssize_t run_store(struct kobject *kobj, struct kobj_attribute *attr,
+                         const char *buf, size_t count) {
+    int c;
+
+    if (sysfs_streq(buf, "all") || sysfs_streq(buf, "1")) {
+        kick_cpus(cpu_online_mask, SELFTEST_RUN);
+        return count;
+    }
+    for (c = 0; c < g_data->nr_clusters; c++) {
+        if (sysfs_streq(buf, g_data->cluster[c].name)) {
+            kick_cpus(&g_data->cluster[c].cpus, SELFTEST_RUN);
+            return count;
+        }
+    }
+    return -EINVAL;
+}
+
+static ssize_t miscompares_total_show(struct kobject *kobj, struct kobj_attribute *attr,
+                                      char *buf) {
+    unsigned int total = 0;
+    int c;
+
+    mutex_lock(&g_data->lock);
+    for (c = 0; c < g_data->nr_clusters; c++) {
+        struct selftest_cluster *cl = &g_data->cluster[c];
+
+        total += cl->fma_errors + cl->hash_errors + cl->scalar_errors + cl->cache_errors;
+    }
+    mutex_unlock(&g_data->lock);
+    return sprintf(buf, "%u\n", total);
+}
+
+// Restart the period from now; 0 lets the pending tick lapse
+static void interval_changed(unsigned int value) {
+    if (value)
+        mod_delayed_work(system_wq, &g_data->tick_work, msecs_to_jiffies(value));
+}
+
+RADXA_TUNABLE_ATTR_CB(interval_ms, 0, 86400000, interval_changed);
+RADXA_TUNABLE_ATTR(iterations, 1, 100000);
+RADXA_TUNABLE_ATTR(on_transition, 0, 1);
+RADXA_TUNABLE_ATTR(auto_step_down, 0, 1);
+
+static struct kobj_attribute run_attr = __ATTR_WO(run);
+static struct kobj_attribute miscompares_total_attr =
+    __ATTR(miscompares, 0444, miscompares_total_show, NULL);
+
+static struct attribute *selftest_attrs[] = {
+    &run_attr.attr,
+    &miscompares_total_attr.attr,
+    &interval_ms_attr.attr.attr,
+    &iterations_attr.attr.attr,
+    &on_transition_attr.attr.attr,
+    &auto_step_down_attr.attr.attr,
+    NULL,
+};
+
+static const struct attribute_group selftest_group = {
+    .attrs = selftest_attrs,
+};
+
+struct cluster_attribute {
+    struct kobj_attribute attr;
+    int cluster;
+};
+
+#define to_cluster(a) (&g_data->cluster[container_of(a, struct cluster_attribute, attr)->cluster])
+
+static ssize_t runs_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%u\n", to_cluster(attr)->runs);
+}
+
+static ssize_t miscompares_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    struct selftest_cluster *cl = to_cluster(attr);
+
+    return sprintf(buf, "fma %u\nhash %u\nscalar %u\ncache %u\n",
+                   cl->fma_errors, cl->hash_errors, cl->scalar_errors, cl->cache_errors);
+}
+
+static ssize_t last_result_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    struct selftest_cluster *cl = to_cluster(attr);
+
+    if (cl->last_result == RESULT_FAIL)
+        return sprintf(buf, "%s cpu%d %u\n", result_names[cl->last_result],
+                       cl->last_fail_cpu, cl->last_freq_khz);
+    return sprintf(buf, "%s\n", result_names[cl->last_result]);
+}
+
+static ssize_t last_freq_khz_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%u\n", to_cluster(attr)->last_freq_khz);
+}
+
+static ssize_t step_downs_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%u\n", to_cluster(attr)->step_downs);
+}
+
+#define CLUSTER_ATTR_RO(_prefix, _name, _cluster)                           \
+    static struct cluster_attribute _prefix##_##_name##_attr = {            \
+        .attr = __ATTR(_name, 0444, _name##_show, NULL),                    \
+        .cluster = _cluster,                                                \
+    }
+
+CLUSTER_ATTR_RO(e, runs, CLUSTER_E);
+CLUSTER_ATTR_RO(e, miscompares, CLUSTER_E);
+CLUSTER_ATTR_RO(e, last_result, CLUSTER_E);
+CLUSTER_ATTR_RO(e, last_freq_khz, CLUSTER_E);
+CLUSTER_ATTR_RO(e, step_downs, CLUSTER_E);
+CLUSTER_ATTR_RO(p, runs, CLUSTER_P);
+CLUSTER_ATTR_RO(p, miscompares, CLUSTER_P);
+CLUSTER_ATTR_RO(p, last_result, CLUSTER_P);
+CLUSTER_ATTR_RO(p, last_freq_khz, CLUSTER_P);
+CLUSTER_ATTR_RO(p, step_downs, CLUSTER_P);
+
+static struct attribute *efficiency_attrs[] = {
+    &e_runs_attr.attr.attr,
+    &e_miscompares_attr.attr.attr,
+    &e_last_result_attr.attr.attr,
+    &e_last_freq_khz_attr.attr.attr,
+    &e_step_downs_attr.attr.attr,
+    NULL,
+};
+
+static struct attribute *performance_attrs[] = {
+    &p_runs_attr.attr.attr,
+    &p_miscompares_attr.attr.attr,
+    &p_last_result_attr.attr.attr,
+    &p_last_freq_khz_attr.attr.attr,
+    &p_step_downs_attr.attr.attr,
+    NULL,
+};
+
+static const struct attribute_group efficiency_group = {
+    .name = "efficiency",
+    .attrs = efficiency_attrs,
+};
+
+static const struct attribute_group performance_group = {
+    .name = "performance",
+    .attrs = performance_attrs,
+};
+
+static const struct attribute_group *cluster_groups[NR_CLUSTERS] = {
+    &efficiency_group,
+    &performance_group,
+};
+
+static void put_hooks(void) {
+    if (g_data->register_nb) symbol_put(cpu_overclock_register_notifier);
+    if (g_data->unregister_nb) symbol_put(cpu_overclock_unregister_notifier);
+    if (g_data->step_down) symbol_put(cpu_overclock_step_down);
+}
+
+static int __init cpu_selftest_init(void) {
+    int c, ret;
+
+    pr_info("CPU_SELFTEST: Loading CPU self-test...\n");
+
+    g_data = kzalloc(sizeof(*g_data), GFP_KERNEL);
+    if (!g_data)
+        return -ENOMEM;
+
+    g_data->interval_ms = 0;
+    g_data->iterations = 1000;
+    g_data->on_transition = 1;
+    g_data->auto_step_down = 0;
+    interval_ms_attr.value = &g_data->interval_ms;
+    iterations_attr.value = &g_data->iterations;
+    on_transition_attr.value = &g_data->on_transition;
+    auto_step_down_attr.value = &g_data->auto_step_down;
+    mutex_init(&g_data->lock);
+    INIT_DELAYED_WORK(&g_data->tick_work, tick_workfn);
+
+    g_data->input = kmalloc_array(SELFTEST_WORDS, sizeof(u32), GFP_KERNEL);
+    if (!g_data->input) {
+        ret = -ENOMEM;
+        goto err_free;
+    }
+    fill_input(g_data->input);
+
+    // The answers are only worth something if this core agrees with them
+    // before anything runs fast
+    if (ref_fma(g_data->input) != SELFTEST_KAT_FMA ||
+        ref_hash(g_data->input) != SELFTEST_KAT_HASH) {
+        pr_err("CPU_SELFTEST: Reference checksums do not match the known answers\n");
+        ret = -EIO;
+        goto err_input;
+    }
+
+    g_data->nr_clusters = discover_clusters();
+    if (!g_data->nr_clusters) {
+        pr_err("CPU_SELFTEST: No cpufreq policies found\n");
+        ret = -ENODEV;
+        goto err_input;
+    }
+    for (c = 0; c < g_data->nr_clusters; c++) {
+        g_data->cluster[c].name = cluster_names[c];
+        mutex_init(&g_data->cluster[c].step_lock);
+    }
+    add_pin_requests();
+
+    g_data->kobj = kobject_create_and_add("cpu_selftest", kernel_kobj);
+    if (!g_data->kobj) {
+        ret = -ENOMEM;
+        goto err_pin;
+    }
+
+    ret = sysfs_create_group(g_data->kobj, &selftest_group);
+    if (ret)
+        goto err_kobj;
+    for (c = 0; c < g_data->nr_clusters; c++) {
+        ret = sysfs_create_group(g_data->kobj, cluster_groups[c]);
+        if (ret)
+            goto err_groups;
+    }
+
+    ret = start_threads();
+    if (ret) {
+        pr_err("CPU_SELFTEST: No test threads started: %d\n", ret);
+        cancel_delayed_work_sync(&g_data->tick_work);
+        goto err_groups;
+    }
+
+    // Runs on its own (periodic or on demand); with cpu_overclock loaded it
+    // also follows transitions and can step down
+    g_data->register_nb = symbol_get(cpu_overclock_register_notifier);
+    g_data->unregister_nb = symbol_get(cpu_overclock_unregister_notifier);
+    g_data->step_down = symbol_get(cpu_overclock_step_down);
+    if (g_data->register_nb && g_data->unregister_nb) {
+        g_data->transition_nb.notifier_call = selftest_transition;
+        g_data->register_nb(&g_data->transition_nb);
+    } else {
+        pr_warn("CPU_SELFTEST: cpu_overclock not loaded, no tests on transitions or step-down\n");
+    }
+
+    pr_info("CPU_SELFTEST: %d clusters, %u KiB cache pattern per CPU\n",
+            g_data->nr_clusters, cache_kb);
+    pr_info("CPU_SELFTEST: Control interface at /sys/kernel/cpu_selftest/\n");
+    return 0;
+
+err_groups:
+    while (--c >= 0)
+        sysfs_remove_group(g_data->kobj, cluster_groups[c]);
+    sysfs_remove_group(g_data->kobj, &selftest_group);
+err_kobj:
+    kobject_put(g_data->kobj);
+err_pin:
+    remove_pin_requests();
+err_input:
+    kfree(g_data->input);
+err_free:
+    kfree(g_data);
+    return ret;
+}
+
+static void __exit cpu_selftest_exit(void) {
+    int c;
+
+    pr_info("CPU_SELFTEST: Unloading module...\n");
+
+    if (g_data) {
+        if (g_data->register_nb && g_data->unregister_nb)
+            g_data->unregister_nb(&g_data->transition_nb);
+        stop_threads();
+        put_hooks();
+
+        if (g_data->kobj) {
+            for (c = 0; c < g_data->nr_clusters; c++)
+                sysfs_remove_group(g_data->kobj, cluster_groups[c]);
+            sysfs_remove_group(g_data->kobj, &selftest_group);
+            kobject_put(g_data->kobj);
+        }
+
+        remove_pin_requests();
+        kfree(g_data->input);
+        kfree(g_data);
+    }
+
+    pr_info("CPU_SELFTEST: Module unloaded\n");
+}
+
+module_init(cpu_selftest_init);
+module_exit(cpu_selftest_exit);
+
+MODULE_AUTHOR("Radxa Performance Team");
+MODULE_DESCRIPTION("Known-answer CPU self-test at the applied frequency for A733 SoC");
+MODULE_LICENSE("GPL v2");
+MODULE_VERSION("1.0");
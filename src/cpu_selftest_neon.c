@@ -0,0 +1,47 @@
+// NEON half of cpu_selftest, built without -mgeneral-regs-only
+#include <linux/types.h>
+#include <asm/neon-intrinsics.h>
+
+#include "cpu_selftest.h"
+
+static const u32 lane_index[4] = { 0, 1, 2, 3 };
+
+u64 selftest_neon_fma(const u32 *buf, size_t words) {
+    const uint32x4_t mask = vdupq_n_u32(0x3ff);
+    const uint32x4_t mul = vdupq_n_u32(SELFTEST_FMA_MUL);
+    uint32x4_t h = vaddq_u32(vld1q_u32(lane_index), vdupq_n_u32(1));
+    size_t i, k;
+
+    for (i = 0; i + 64 <= words; i += 64) {
+        float32x4_t acc = vdupq_n_f32(0.0f);
+
+        // 16 x 1023 x 1023 < 2^24: every partial sum is exact
+        for (k = 0; k < 16; k++) {
+            uint32x4_t v = vld1q_u32(buf + i + 4 * k);
+            float32x4_t a = vcvtq_f32_u32(vandq_u32(v, mask));
+            float32x4_t b = vcvtq_f32_u32(vandq_u32(vshrq_n_u32(v, 16), mask));
+
+            acc = vfmaq_f32(acc, a, b);
+        }
+        h = vmulq_u32(veorq_u32(h, vcvtq_u32_f32(acc)), mul);
+    }
+
+    return selftest_fold(vgetq_lane_u32(h, 0), vgetq_lane_u32(h, 1),
+                         vgetq_lane_u32(h, 2), vgetq_lane_u32(h, 3));
+}
+
+u64 selftest_neon_hash(const u32 *buf, size_t words) {
+    const uint32x4_t prime = vdupq_n_u32(SELFTEST_HASH_PRIME);
+    uint32x4_t h = vaddq_u32(vld1q_u32(lane_index), vdupq_n_u32(SELFTEST_HASH_BASIS));
+    size_t i;
+
+    for (i = 0; i + 4 <= words; i += 4) {
+        h = veorq_u32(h, vld1q_u32(buf + i));
+        h = vmulq_u32(h, prime);
+        h = veorq_u32(h, vshrq_n_u32(h, 15));
+        h = vaddq_u32(h, vshlq_n_u32(h, 7));
+    }
+
+    return selftest_fold(vgetq_lane_u32(h, 0), vgetq_lane_u32(h, 1),
+                         vgetq_lane_u32(h, 2), vgetq_lane_u32(h, 3));
+}
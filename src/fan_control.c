@@ -12,9 +12,24 @@
 #include <linux/slab.h>
 #include <linux/fs.h>
 #include <linux/uaccess.h>
+#include <linux/ktime.h>
+#include <linux/workqueue.h>
+#include <linux/spinlock.h>
+
+#include "radxa_overclock_uapi.h"
+#include "radxa_overclock_hooks.h"
 
 #define MODULE_NAME "fan_control"
-#define FAN_PWM_PATH "/sys/devices/platform/pwm-fan/hwmon/hwmon8/pwm1"
+
+// hwmon numbers follow probe order; the default is the stock image's
+static char *pwm_path = "/sys/devices/platform/pwm-fan/hwmon/hwmon8/pwm1";
+module_param(pwm_path, charp, 0444);
+MODULE_PARM_DESC(pwm_path, "PWM attribute of the fan's hwmon device");
+
+// Feed-forward only acts under thermal control, which is off by default
+static bool thermal;
+module_param(thermal, bool, 0444);
+MODULE_PARM_DESC(thermal, "Start under thermal control, with feed-forward (default: manual)");
 
 struct fan_control_data {
     struct kobject *kobj;
@@ -24,6 +39,19 @@ struct fan_control_data {
     bool thermal_control;
     int temp_threshold_low;
     int temp_threshold_high;
+    struct delayed_work monitor_work;
+    unsigned int poll_interval_ms;
+    int temp_alert;         // 0: below low, 1: between thresholds, 2: above high
+    int throttle_temp;      // °C at which we report the SoC as throttling
+    bool throttling;
+    int last_notified_mc;
+    // Feed-forward: extra PWM for power announced by the overclocking
+    // modules, held for ff_hold_ms and then halved every poll
+    spinlock_t ff_lock;
+    int ff_pwm;
+    unsigned long ff_until;         // jiffies
+    unsigned int ff_pwm_per_w;
+    unsigned int ff_hold_ms;
 };
 
 static struct fan_control_data *g_fan_data;
@@ -60,11 +88,14 @@ static int set_fan_speed(int speed) {
     if (speed < 0) speed = 0;
     if (speed > 255) speed = 255;
     
-    ret = write_sysfs_int(FAN_PWM_PATH, speed);
-    if (ret == 0) {
+    ret = write_sysfs_int(pwm_path, speed);
+    if (ret == 0 && g_fan_data->current_speed != speed) {
         g_fan_data->current_speed = speed;
-        pr_info("FAN_CONTROL: Fan speed set to %d (%.1f%%)\n", 
-                speed, (speed * 100.0) / 255.0);
+        // Thermal control and feed-forward decay change it every poll
+        pr_debug("FAN_CONTROL: Fan speed set to %d (%d.%d%%)\n", 
+                 speed, speed * 1000 / 255 / 10, speed * 1000 / 255 % 10);
+        if (g_fan_data->kobj)
+            sysfs_notify(g_fan_data->kobj, NULL, "speed");
     }
     
     return ret;
@@ -85,19 +116,42 @@ static int fan_reboot_notifier(struct notifier_block *nb, unsigned long action,
 }
 
 // Thermal-based fan control
-static int get_cpu_temperature(void) {
+static int get_cpu_temperature_mc(void) {
     struct thermal_zone_device *tz;
     int temp = 0;
     
     tz = thermal_zone_get_zone_by_name("cpu-thermal");
     if (!IS_ERR(tz)) {
         thermal_zone_get_temp(tz, &temp);
-        temp /= 1000; // Convert from millidegrees to degrees
     }
     
     return temp;
 }
 
+static int get_cpu_temperature(void) {
+    return get_cpu_temperature_mc() / 1000; // Convert from millidegrees to degrees
+}
+
+// Age the feed-forward term once its hold time is over; the thermal
+// curve has caught up with the new load by then
+static int feed_forward_pwm(void) {
+    unsigned long flags;
+    bool decayed = false;
+    int pwm;
+    
+    spin_lock_irqsave(&g_fan_data->ff_lock, flags);
+    if (g_fan_data->ff_pwm && time_after(jiffies, g_fan_data->ff_until)) {
+        g_fan_data->ff_pwm /= 2;
+        decayed = true;
+    }
+    pwm = g_fan_data->ff_pwm;
+    spin_unlock_irqrestore(&g_fan_data->ff_lock, flags);
+    
+    if (decayed)
+        sysfs_notify(g_fan_data->kobj, NULL, "ff_pwm");
+    return pwm;
+}
+
 static void adjust_fan_for_temperature(void) {
     int temp = get_cpu_temperature();
     int new_speed;
@@ -114,19 +168,103 @@ static void adjust_fan_for_temperature(void) {
     } else {
         new_speed = 255; // 100% - Maximum speed
     }
+    new_speed = min(new_speed + feed_forward_pwm(), 255);
     
     if (new_speed != g_fan_data->current_speed) {
-        pr_info("FAN_CONTROL: Temperature %d°C, adjusting fan to %d\n", temp, new_speed);
+        pr_debug("FAN_CONTROL: Temperature %d°C, adjusting fan to %d\n", temp, new_speed);
         set_fan_speed(new_speed);
     }
 }
 
+// Called by the overclocking modules before a frequency step: turn the
+// predicted power delta into PWM now, the monitor applies it right away.
+// Only acts under thermal control; a manual speed stays as it is.
+int fan_control_feed_forward(long delta_mw) {
+    unsigned long flags;
+    long pwm;
+    
+    if (!g_fan_data->thermal_control)
+        return 0;
+    
+    spin_lock_irqsave(&g_fan_data->ff_lock, flags);
+    pwm = g_fan_data->ff_pwm + delta_mw * (long)g_fan_data->ff_pwm_per_w / 1000;
+    g_fan_data->ff_pwm = clamp(pwm, 0L, 255L);
+    if (delta_mw > 0)
+        g_fan_data->ff_until = jiffies + msecs_to_jiffies(g_fan_data->ff_hold_ms);
+    spin_unlock_irqrestore(&g_fan_data->ff_lock, flags);
+    
+    sysfs_notify(g_fan_data->kobj, NULL, "ff_pwm");
+    mod_delayed_work(system_power_efficient_wq, &g_fan_data->monitor_work, 0);
+    return 0;
+}
+EXPORT_SYMBOL_GPL(fan_control_feed_forward);
+
+// Emit a KOBJ_CHANGE uevent so udev rules can react as well as poll()ers
+static void fan_thermal_uevent(const char *event, int temp_mc) {
+    char event_env[32], temp_env[32];
+    char *envp[] = { event_env, temp_env, NULL };
+    
+    snprintf(event_env, sizeof(event_env), "EVENT=%s", event);
+    snprintf(temp_env, sizeof(temp_env), "TEMPERATURE_MC=%d", temp_mc);
+    kobject_uevent_env(g_fan_data->kobj, KOBJ_CHANGE, envp);
+}
+
+// Periodic thermal monitor: drives thermal control and raises events
+// when the temperature crosses the configured thresholds
+static void fan_monitor_work(struct work_struct *work) {
+    int temp_mc = get_cpu_temperature_mc();
+    int temp = temp_mc / 1000;
+    int alert;
+    bool throttling;
+    
+    if (temp_mc > 0) {
+        if (g_fan_data->thermal_control)
+            adjust_fan_for_temperature();
+        
+        if (abs(temp_mc - g_fan_data->last_notified_mc) >= 1000) {
+            g_fan_data->last_notified_mc = temp_mc;
+            sysfs_notify(g_fan_data->kobj, NULL, "temperature_mc");
+        }
+        
+        if (temp < g_fan_data->temp_threshold_low)
+            alert = 0;
+        else if (temp < g_fan_data->temp_threshold_high)
+            alert = 1;
+        else
+            alert = 2;
+        
+        if (alert != g_fan_data->temp_alert) {
+            pr_info("FAN_CONTROL: Temperature %d°C, alert level %d -> %d\n",
+                    temp, g_fan_data->temp_alert, alert);
+            g_fan_data->temp_alert = alert;
+            sysfs_notify(g_fan_data->kobj, NULL, "temp_alert");
+            fan_thermal_uevent("temp_alert", temp_mc);
+        }
+        
+        // 2°C hysteresis so we don't flap around the throttle point
+        throttling = g_fan_data->throttling ?
+                     temp > g_fan_data->throttle_temp - 2 :
+                     temp >= g_fan_data->throttle_temp;
+        if (throttling != g_fan_data->throttling) {
+            pr_info("FAN_CONTROL: Thermal throttle %s at %d°C\n",
+                    throttling ? "engaged" : "released", temp);
+            g_fan_data->throttling = throttling;
+            sysfs_notify(g_fan_data->kobj, NULL, "throttling");
+            fan_thermal_uevent(throttling ? "throttle_on" : "throttle_off", temp_mc);
+        }
+    }
+    
+    queue_delayed_work(system_power_efficient_wq, &g_fan_data->monitor_work,
+                       msecs_to_jiffies(g_fan_data->poll_interval_ms));
+}
+
 // Sysfs interface for fan control
 static ssize_t fan_speed_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
     int temp = get_cpu_temperature();
-    return sprintf(buf, "Fan Speed: %d/255 (%.1f%%)\nTemperature: %d°C\nThermal Control: %s\nTemp Thresholds: %d°C - %d°C\nUsage:\n  echo SPEED > fan_speed (0-255)\n  echo thermal > fan_speed (enable thermal control)\n  echo manual > fan_speed (disable thermal control)\n",
+    int permille = g_fan_data->current_speed * 1000 / 255;  // no FPU in the kernel
+    return sprintf(buf, "Fan Speed: %d/255 (%d.%d%%)\nTemperature: %d°C\nThermal Control: %s\nTemp Thresholds: %d°C - %d°C\nUsage:\n  echo SPEED > fan_speed (0-255)\n  echo thermal > fan_speed (enable thermal control)\n  echo manual > fan_speed (disable thermal control)\n",
            g_fan_data->current_speed, 
-           (g_fan_data->current_speed * 100.0) / 255.0,
+           permille / 10, permille % 10,
            temp,
            g_fan_data->thermal_control ? "ON" : "OFF",
            g_fan_data->temp_threshold_low,
@@ -147,10 +285,12 @@ static ssize_t fan_speed_store(struct kobject *kobj, struct kobj_attribute *attr
     if (strcmp(command, "thermal") == 0) {
         g_fan_data->thermal_control = true;
         adjust_fan_for_temperature();
+        sysfs_notify(g_fan_data->kobj, NULL, "thermal_control");
         pr_info("FAN_CONTROL: Thermal control enabled\n");
         return count;
     } else if (strcmp(command, "manual") == 0) {
         g_fan_data->thermal_control = false;
+        sysfs_notify(g_fan_data->kobj, NULL, "thermal_control");
         pr_info("FAN_CONTROL: Manual control enabled\n");
         return count;
     } else if (strcmp(command, "off") == 0) {
@@ -179,6 +319,206 @@ static ssize_t fan_speed_store(struct kobject *kobj, struct kobj_attribute *attr
 
 static struct kobj_attribute fan_speed_attr = __ATTR(fan_speed, 0664, fan_speed_show, fan_speed_store);
 
+// Machine-readable interface: one value per file
+static ssize_t speed_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%d\n", g_fan_data->current_speed);
+}
+
+static ssize_t temperature_mc_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%d\n", get_cpu_temperature_mc());
+}
+
+static ssize_t thermal_control_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%d\n", g_fan_data->thermal_control ? 1 : 0);
+}
+
+static ssize_t temp_alert_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%d\n", g_fan_data->temp_alert);
+}
+
+static ssize_t throttling_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%d\n", g_fan_data->throttling ? 1 : 0);
+}
+
+static ssize_t throttle_temp_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%d\n", g_fan_data->throttle_temp);
+}
+
+static ssize_t throttle_temp_store(struct kobject *kobj, struct kobj_attribute *attr,
+                                   const char *buf, size_t count) {
+    int value;
+    int ret;
+    
+    ret = kstrtoint(buf, 10, &value);
+    if (ret)
+        return ret;
+    if (value <= 0 || value > 125)
+        return -EINVAL;
+    
+    g_fan_data->throttle_temp = value;
+    return count;
+}
+
+static ssize_t poll_interval_ms_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%u\n", g_fan_data->poll_interval_ms);
+}
+
+static ssize_t poll_interval_ms_store(struct kobject *kobj, struct kobj_attribute *attr,
+                                      const char *buf, size_t count) {
+    unsigned int value;
+    int ret;
+    
+    ret = kstrtouint(buf, 10, &value);
+    if (ret)
+        return ret;
+    if (value < 50 || value > 60000)
+        return -EINVAL;
+    
+    g_fan_data->poll_interval_ms = value;
+    mod_delayed_work(system_power_efficient_wq, &g_fan_data->monitor_work, 0);
+    return count;
+}
+
+static ssize_t ff_pwm_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%d\n", g_fan_data->ff_pwm);
+}
+
+static ssize_t ff_pwm_per_w_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%u\n", g_fan_data->ff_pwm_per_w);
+}
+
+static ssize_t ff_pwm_per_w_store(struct kobject *kobj, struct kobj_attribute *attr,
+                                  const char *buf, size_t count) {
+    unsigned int value;
+    int ret;
+    
+    ret = kstrtouint(buf, 10, &value);
+    if (ret)
+        return ret;
+    if (value > 255)
+        return -EINVAL;
+    
+    g_fan_data->ff_pwm_per_w = value;
+    return count;
+}
+
+static ssize_t ff_hold_ms_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%u\n", g_fan_data->ff_hold_ms);
+}
+
+static ssize_t ff_hold_ms_store(struct kobject *kobj, struct kobj_attribute *attr,
+                                const char *buf, size_t count) {
+    unsigned int value;
+    int ret;
+    
+    ret = kstrtouint(buf, 10, &value);
+    if (ret)
+        return ret;
+    if (value > 60000)
+        return -EINVAL;
+    
+    g_fan_data->ff_hold_ms = value;
+    return count;
+}
+
+static ssize_t temp_threshold_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf);
+static ssize_t temp_threshold_store(struct kobject *kobj, struct kobj_attribute *attr,
+                                    const char *buf, size_t count);
+
+static struct kobj_attribute speed_attr = __ATTR_RO(speed);
+static struct kobj_attribute temperature_mc_attr = __ATTR_RO(temperature_mc);
+static struct kobj_attribute thermal_control_attr = __ATTR_RO(thermal_control);
+static struct kobj_attribute temp_alert_attr = __ATTR_RO(temp_alert);
+static struct kobj_attribute throttling_attr = __ATTR_RO(throttling);
+static struct kobj_attribute throttle_temp_attr = __ATTR_RW(throttle_temp);
+static struct kobj_attribute poll_interval_ms_attr = __ATTR_RW(poll_interval_ms);
+static struct kobj_attribute ff_pwm_attr = __ATTR_RO(ff_pwm);
+static struct kobj_attribute ff_pwm_per_w_attr = __ATTR_RW(ff_pwm_per_w);
+static struct kobj_attribute ff_hold_ms_attr = __ATTR_RW(ff_hold_ms);
+static struct kobj_attribute temp_threshold_low_attr =
+    __ATTR(temp_threshold_low, 0664, temp_threshold_show, temp_threshold_store);
+static struct kobj_attribute temp_threshold_high_attr =
+    __ATTR(temp_threshold_high, 0664, temp_threshold_show, temp_threshold_store);
+
+static ssize_t temp_threshold_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    if (attr == &temp_threshold_low_attr)
+        return sprintf(buf, "%d\n", g_fan_data->temp_threshold_low);
+    return sprintf(buf, "%d\n", g_fan_data->temp_threshold_high);
+}
+
+static ssize_t temp_threshold_store(struct kobject *kobj, struct kobj_attribute *attr,
+                                    const char *buf, size_t count) {
+    int value;
+    int ret;
+    
+    ret = kstrtoint(buf, 10, &value);
+    if (ret)
+        return ret;
+    
+    if (attr == &temp_threshold_low_attr) {
+        if (value >= g_fan_data->temp_threshold_high)
+            return -EINVAL;
+        g_fan_data->temp_threshold_low = value;
+    } else {
+        if (value <= g_fan_data->temp_threshold_low)
+            return -EINVAL;
+        g_fan_data->temp_threshold_high = value;
+    }
+    
+    return count;
+}
+
+static struct attribute *fan_control_attrs[] = {
+    &speed_attr.attr,
+    &temperature_mc_attr.attr,
+    &thermal_control_attr.attr,
+    &temp_threshold_low_attr.attr,
+    &temp_threshold_high_attr.attr,
+    &temp_alert_attr.attr,
+    &throttling_attr.attr,
+    &throttle_temp_attr.attr,
+    &poll_interval_ms_attr.attr,
+    &ff_pwm_attr.attr,
+    &ff_pwm_per_w_attr.attr,
+    &ff_hold_ms_attr.attr,
+    NULL,
+};
+
+static const struct attribute_group fan_control_group = {
+    .attrs = fan_control_attrs,
+};
+
+// Binary snapshot of the fan domain in a single read
+struct fan_control_snapshot {
+    struct radxa_oc_snapshot_header hdr;
+    struct radxa_oc_domain_state dom;
+} __attribute__((packed));
+
+static ssize_t snapshot_read(struct file *filp, struct kobject *kobj,
+                             struct bin_attribute *attr, char *buf,
+                             loff_t off, size_t count) {
+    struct fan_control_snapshot snap = {};
+    
+    snap.hdr.magic = RADXA_OC_SNAPSHOT_MAGIC;
+    snap.hdr.version = RADXA_OC_SNAPSHOT_VERSION;
+    snap.hdr.nr_domains = 1;
+    snap.hdr.header_size = sizeof(snap.hdr);
+    snap.hdr.domain_size = sizeof(snap.dom);
+    snap.hdr.timestamp_ns = ktime_get_ns();
+    
+    snap.dom.domain = RADXA_OC_DOMAIN_FAN;
+    snap.dom.flags = RADXA_OC_F_PRESENT;
+    if (g_fan_data->thermal_control)
+        snap.dom.flags |= RADXA_OC_F_THERMAL_CTRL;
+    snap.dom.cur_freq_hz = g_fan_data->current_speed;
+    snap.dom.target_freq_hz = g_fan_data->current_speed;
+    snap.dom.temp_mc = get_cpu_temperature_mc();
+    
+    return memory_read_from_buffer(buf, count, &off, &snap, sizeof(snap));
+}
+
+static struct bin_attribute snapshot_attr = __BIN_ATTR_RO(snapshot, sizeof(struct fan_control_snapshot));
+
 static int __init fan_control_init(void) {
     int ret;
     
@@ -191,9 +531,15 @@ static int __init fan_control_init(void) {
     // Initialize defaults
     g_fan_data->current_speed = 255; // Start at max
     g_fan_data->max_speed = 255;
-    g_fan_data->thermal_control = false;
+    g_fan_data->thermal_control = thermal;
     g_fan_data->temp_threshold_low = 50;  // 50°C
     g_fan_data->temp_threshold_high = 75; // 75°C
+    g_fan_data->throttle_temp = 85;       // 85°C
+    g_fan_data->poll_interval_ms = 1000;
+    spin_lock_init(&g_fan_data->ff_lock);
+    g_fan_data->ff_pwm_per_w = 24;       // ~10% duty per watt
+    g_fan_data->ff_hold_ms = 5000;
+    INIT_DELAYED_WORK(&g_fan_data->monitor_work, fan_monitor_work);
     
     // Register reboot notifier to turn off fan on shutdown
     g_fan_data->reboot_notifier.notifier_call = fan_reboot_notifier;
@@ -216,9 +562,19 @@ static int __init fan_control_init(void) {
         goto err_kobj;
     }
     
+    ret = sysfs_create_group(g_fan_data->kobj, &fan_control_group);
+    if (ret)
+        goto err_file;
+    ret = sysfs_create_bin_file(g_fan_data->kobj, &snapshot_attr);
+    if (ret)
+        goto err_group;
+    
     // Set initial fan speed
     set_fan_speed(255);
     
+    // Start the thermal monitor
+    queue_delayed_work(system_power_efficient_wq, &g_fan_data->monitor_work, 0);
+    
     pr_info("FAN_CONTROL: Module loaded successfully!\n");
     pr_info("FAN_CONTROL: Control interface at /sys/kernel/fan_control/fan_speed\n");
     pr_info("FAN_CONTROL: Fan will automatically turn off on system shutdown\n");
@@ -226,6 +582,10 @@ static int __init fan_control_init(void) {
     
     return 0;
     
+err_group:
+    sysfs_remove_group(g_fan_data->kobj, &fan_control_group);
+err_file:
+    sysfs_remove_file(g_fan_data->kobj, &fan_speed_attr.attr);
 err_kobj:
     kobject_put(g_fan_data->kobj);
 err_notifier:
@@ -239,10 +599,14 @@ static void __exit fan_control_exit(void) {
     pr_info("FAN_CONTROL: Unloading module...\n");
     
     if (g_fan_data) {
+        cancel_delayed_work_sync(&g_fan_data->monitor_work);
+        
         // Turn off fan
         set_fan_speed(0);
         
         if (g_fan_data->kobj) {
+            sysfs_remove_bin_file(g_fan_data->kobj, &snapshot_attr);
+            sysfs_remove_group(g_fan_data->kobj, &fan_control_group);
             sysfs_remove_file(g_fan_data->kobj, &fan_speed_attr.attr);
             kobject_put(g_fan_data->kobj);
         }
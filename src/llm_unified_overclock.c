@@ -14,9 +14,79 @@
 #include <linux/device.h>
 #include <linux/clk.h>
 #include <linux/of.h>
+#include <linux/of_address.h>
+#include <linux/io.h>
+#include <linux/ktime.h>
+#include <linux/hrtimer.h>
+#include <linux/pm_domain.h>
+#include <linux/workqueue.h>
+#include <linux/pm_qos.h>
+#include <linux/pm_runtime.h>
+#include <linux/seqlock.h>
+#include <linux/suspend.h>
+
+#include "radxa_overclock_uapi.h"
+#include "radxa_clk_watch.h"
+#include "radxa_energy_model.h"
+#include "radxa_freq_stats.h"
+#include "radxa_overclock_try.h"
+#include "radxa_npu_clocks.h"
+#include "radxa_overclock_hooks.h"
 
 #define NPU_DEVICE_NAME "3600000.npu"
 #define GPU_DEVICE_NAME "1800000.gpu"
+#define NPU_STOCK_MAX_HZ 1008000000UL
+#define GPU_STOCK_MAX_HZ 840000000UL
+
+// Mali job-manager registers: a job slot reports ACTIVE while it runs work
+#define MALI_JS_BASE(n)     (0x1800 + (n) * 0x80)
+#define MALI_JS_STATUS      0x24
+#define MALI_JS_ACTIVE      0x08
+#define MALI_NR_JOB_SLOTS   3
+
+// Dynamic-power coefficients (uW/MHz/V^2) for the Energy Model
+static unsigned int npu_power_coeff = 1500;
+module_param(npu_power_coeff, uint, 0444);
+MODULE_PARM_DESC(npu_power_coeff, "NPU dynamic-power coefficient, uW/MHz/V^2");
+
+static unsigned int gpu_power_coeff = 1200;
+module_param(gpu_power_coeff, uint, 0444);
+MODULE_PARM_DESC(gpu_power_coeff, "GPU dynamic-power coefficient, uW/MHz/V^2");
+
+// Last committed "NPU_MHZ,GPU_MHZ" or preset, applied at load (see radxa_overclock_try.h)
+static char *lkg;
+module_param(lkg, charp, 0444);
+MODULE_PARM_DESC(lkg, "Last-known-good setting, applied at load");
+
+static unsigned int try_timeout_s = 30;
+module_param(try_timeout_s, uint, 0644);
+MODULE_PARM_DESC(try_timeout_s, "Seconds a tried setting has to be committed");
+
+// GPU devfreq: simple_ondemand on the busy time of the job slots
+static unsigned int gpu_poll_ms = 50;
+module_param(gpu_poll_ms, uint, 0444);
+MODULE_PARM_DESC(gpu_poll_ms, "GPU devfreq polling interval in ms");
+
+static unsigned int gpu_sample_us = 1000;
+module_param(gpu_sample_us, uint, 0444);
+MODULE_PARM_DESC(gpu_sample_us, "GPU busy sampling period in us");
+
+static unsigned int gpu_upthreshold = 70;
+module_param(gpu_upthreshold, uint, 0444);
+MODULE_PARM_DESC(gpu_upthreshold, "GPU load (%) above which the top frequency is used");
+
+static unsigned int gpu_downdifferential = 10;
+module_param(gpu_downdifferential, uint, 0444);
+MODULE_PARM_DESC(gpu_downdifferential, "Headroom (%) kept below gpu_upthreshold when scaling down");
+
+// NPU race-to-idle: runtime-suspend after this long without work, 0 = off
+static unsigned int npu_idle_gate_ms = 0;
+module_param(npu_idle_gate_ms, uint, 0444);
+MODULE_PARM_DESC(npu_idle_gate_ms, "Idle ms before the NPU drops to its floor and power-gates (0 = off)");
+
+// What to do when someone else changes the NPU or GPU clock we set
+RADXA_CW_POLICY_PARAM(drift_policy);
+MODULE_PARM_DESC(drift_policy, "On external clock changes: log or reassert");
 
 // EXTREME OVERCLOCKING FOR LLM PERFORMANCE
 static unsigned long llm_npu_freqs[] = {
@@ -37,71 +107,485 @@ static unsigned long llm_gpu_freqs[] = {
 
 static struct device *npu_device = NULL;
 static struct device *gpu_device = NULL;
-static struct clk *npu_clk = NULL;
+static struct clk *npu_clk = NULL;     // Core clock of npu_clks
 static struct clk *gpu_clk = NULL;
 
-// Unified GPU/NPU frequency control
-static int set_unified_frequency(unsigned long npu_freq, unsigned long gpu_freq)
+// NPU core, bus and reg clocks, moved together
+RADXA_NPU_CLOCKS(npu_clks);
+RADXA_NPU_RATIO_PARAM(npu_clk_ratios, npu_clks);
+MODULE_PARM_DESC(npu_clk_ratios, "NPU bus/reg rates per core band: core_mhz:bus_pct[:reg_pct],... or stock");
+
+// Last requested targets and the OPP voltages that go with them
+static unsigned long npu_target_freq = 0;
+static unsigned long gpu_target_freq = 0;
+static unsigned long npu_voltage_uv = 0;
+static unsigned long gpu_voltage_uv = 0;
+static unsigned int npu_rate_misses = 0;
+static unsigned int gpu_rate_misses = 0;
+static struct radxa_oc_try llm_try;
+
+// Residency of the clocks set here; the GPU only without a devfreq
+static struct kobject *llm_stats_kobj = NULL;
+static struct radxa_freq_stats *npu_stats = NULL;
+static struct radxa_freq_stats *gpu_stats = NULL;
+
+// External rate changes; the GPU only without a devfreq
+static struct radxa_clk_watch npu_watch;
+static struct radxa_clk_watch gpu_watch;
+
+static struct notifier_block llm_pm_nb;
+
+// Rate changes of each domain are serialized by its lock. The result is
+// published under llm_state_lock so the sysfs readers never call
+// clk_get_rate() and queue up on the clock framework's prepare lock.
+struct llm_domain_state {
+    unsigned long cur_hz;
+    unsigned long target_hz;
+    unsigned long voltage_uv;
+    unsigned long bus_hz;       // NPU only
+    unsigned long reg_hz;
+};
+
+static DEFINE_MUTEX(npu_rate_lock);
+static DEFINE_MUTEX(gpu_rate_lock);
+static DEFINE_SEQLOCK(llm_state_lock);
+static struct llm_domain_state npu_state;
+static struct llm_domain_state gpu_state;
+
+// NPU race-to-idle state
+static DEFINE_MUTEX(npu_gate_lock);
+static struct notifier_block npu_gate_nb;
+static bool npu_gate_on = false;
+static bool npu_saved_use_autosuspend;
+static int npu_saved_autosuspend_delay;
+static unsigned long npu_wake_hz = 0;      // Core rate before the last gating
+static struct work_struct npu_gate_work;   // Moves the clocks after a transition
+static bool npu_powered = true;            // As of the last notification
+static bool npu_wake_pending = false;      // Power-on not yet followed by the rate
+static ktime_t npu_wake_start;
+static u64 npu_wake_last_ns = 0;
+static u64 npu_wake_max_ns = 0;
+static unsigned int npu_gate_count = 0;
+
+// DEV_PM_QOS_MAX_FREQUENCY on the NPU (power_arbiter's cap)
+static struct notifier_block npu_max_qos_nb;
+static bool npu_max_qos_registered = false;
+
+// The devfreq driving the GPU: ours, or the GPU driver's (gpu_devfreq_ours
+// false), which only gets the floor request. The rest is only used with ours.
+static struct devfreq *gpu_devfreq = NULL;
+static bool gpu_devfreq_ours = false;
+static struct opp_table *gpu_opp_table = NULL;     // Holds the mali-supply regulator
+static struct dev_pm_qos_request gpu_floor_req;    // llm_overclock echo
+static struct devfreq_simple_ondemand_data gpu_ondemand_data;
+static struct clk *gpu_bus_clk = NULL;
+static unsigned long gpu_bus_stock_hz = 0;
+static unsigned long gpu_core_stock_hz = 0;
+static bool gpu_bus_scalable = false;
+static void __iomem *gpu_regs = NULL;
+static struct hrtimer gpu_sampler;
+static atomic_t gpu_busy_samples = ATOMIC_INIT(0);
+static ktime_t gpu_status_last;                    // Start of devfreq's window
+
+static unsigned long gpu_voltage_for_freq(unsigned long freq)
+{
+    unsigned long voltage = 900000 + (freq / 1000000 - 400) * 500; // Scale voltage
+    
+    if (freq < 400000000) voltage = 900000;
+    if (voltage > 1200000) voltage = 1200000; // Cap at 1.2V
+    return voltage;
+}
+
+static int llm_em_active_power(unsigned long *power, unsigned long *freq,
+                               struct device *dev)
+{
+    return radxa_em_opp_power(dev, dev == npu_device ? npu_power_coeff : gpu_power_coeff,
+                              power, freq);
+}
+
+static struct em_data_callback llm_em_cb = EM_DATA_CB(llm_em_active_power);
+
+// Rebuild the device's perf domain after its OPP table changed, so IPA
+// and devfreq cooling budget with the overclocked points
+static void update_energy_model(struct device *dev, const char *name)
+{
+    int ret = radxa_em_update(dev, &llm_em_cb, NULL);
+    
+    if (ret)
+        pr_warn("⚠️ %s Energy Model not registered: %d\n", name, ret);
+    else
+        pr_info("✅ %s Energy Model: %d states\n", name, radxa_em_nr_states(dev));
+}
+
+// Wake up poll()ers on the per-value files of one domain
+static void notify_domain_change(const char *group, struct clk *clk,
+                                 unsigned long requested, unsigned int *misses)
 {
+    unsigned long actual = clk_get_rate(clk);
+    
+    // Tolerate PLL rounding, flag anything beyond 1%
+    if (abs((long)(actual - requested)) > requested / 100) {
+        (*misses)++;
+        pr_warn("⚠️ %s runs at %luMHz, requested %luMHz\n",
+                group, actual/1000000, requested/1000000);
+        sysfs_notify(&npu_device->kobj, group, "rate_misses");
+    }
+    
+    sysfs_notify(&npu_device->kobj, group, "cur_freq_hz");
+    sysfs_notify(&npu_device->kobj, group, "target_freq_hz");
+    sysfs_notify(&npu_device->kobj, group, "voltage_uv");
+}
+
+// Domain lock held
+static void publish_npu(void)
+{
+    struct llm_domain_state st = {
+        .cur_hz = npu_clk ? clk_get_rate(npu_clk) : 0,
+        .target_hz = npu_target_freq,
+        .voltage_uv = npu_voltage_uv,
+        .bus_hz = radxa_npu_rate(&npu_clks, RADXA_NPU_CLK_BUS),
+        .reg_hz = radxa_npu_rate(&npu_clks, RADXA_NPU_CLK_REG),
+    };
+    
+    write_seqlock(&llm_state_lock);
+    npu_state = st;
+    write_sequnlock(&llm_state_lock);
+}
+
+static void publish_gpu(void)
+{
+    struct llm_domain_state st = {
+        .cur_hz = gpu_clk ? clk_get_rate(gpu_clk) : 0,
+        .target_hz = gpu_target_freq,
+        .voltage_uv = gpu_voltage_uv,
+    };
+    
+    write_seqlock(&llm_state_lock);
+    gpu_state = st;
+    write_sequnlock(&llm_state_lock);
+}
+
+static void read_domain_state(u32 domain, struct llm_domain_state *st)
+{
+    unsigned int seq;
+    
+    do {
+        seq = read_seqbegin(&llm_state_lock);
+        *st = domain == RADXA_OC_DOMAIN_NPU ? npu_state : gpu_state;
+    } while (read_seqretry(&llm_state_lock, seq));
+}
+
+// Power a move of clk to hz adds, per the device's Energy Model
+static long step_power_mw(struct device *dev, struct clk *clk, unsigned long hz)
+{
+    if (!clk || !hz)
+        return 0;
+    return radxa_em_power_delta(em_pd_get(dev), clk_get_rate(clk), hz);
+}
+
+// Highest NPU OPP within the max-frequency QoS constraint
+static unsigned long npu_capped_hz(unsigned long hz)
+{
+    s32 max_khz = dev_pm_qos_read_value(npu_device, DEV_PM_QOS_MAX_FREQUENCY);
+    unsigned long cap;
+    struct dev_pm_opp *opp;
+    
+    if (max_khz == PM_QOS_MAX_FREQUENCY_DEFAULT_VALUE || hz <= (unsigned long)max_khz * 1000)
+        return hz;
+    cap = (unsigned long)max_khz * 1000;
+    opp = dev_pm_opp_find_freq_floor(npu_device, &cap);
+    if (!IS_ERR(opp))
+        dev_pm_opp_put(opp);
+    return cap;
+}
+
+// All NPU core rate changes go through here, for the statistics and so
+// the drift watch can tell them from everyone else's
+static int __npu_apply_rate(unsigned long hz)
+{
+    int ret;
+    
+    radxa_cw_begin(&npu_watch);
+    ret = radxa_npu_set_rate(&npu_clks, hz);
+    radxa_cw_end(&npu_watch, ret ? 0 : hz);
+    if (ret)
+        radxa_fs_failed(npu_stats);
+    else
+        radxa_fs_update(npu_stats, clk_get_rate(npu_clk));
+    publish_npu();
+    return ret;
+}
+
+static int npu_apply_rate(unsigned long hz)
+{
+    int ret;
+    
+    mutex_lock(&npu_rate_lock);
+    ret = __npu_apply_rate(hz);
+    mutex_unlock(&npu_rate_lock);
+    return ret;
+}
+
+// Move the NPU back to the requested rate, or to fallback if none was
+// requested, within the current cap. npu_target_freq is read under the
+// lock its writers hold, so a concurrent llm_overclock write is either
+// fully before this or re-applies its own rate after it.
+static int npu_apply_target(unsigned long fallback)
+{
+    struct llm_domain_state st;
+    unsigned long hz;
     int ret = 0;
     
+    mutex_lock(&npu_rate_lock);
+    hz = npu_capped_hz(npu_target_freq ? npu_target_freq : fallback);
+    read_domain_state(RADXA_OC_DOMAIN_NPU, &st);
+    if (hz && st.cur_hz != hz)
+        ret = __npu_apply_rate(hz);
+    mutex_unlock(&npu_rate_lock);
+    return ret;
+}
+
+// Unified GPU/NPU frequency control. A domain takes on the new target and
+// voltage only once its clock change went through; the first error wins.
+static int set_unified_frequency(unsigned long npu_freq, unsigned long npu_uv,
+                                 unsigned long gpu_freq, unsigned long gpu_uv)
+{
+    unsigned long npu_req = npu_freq;
+    int ret = 0, npu_ret = 0;
+    
     pr_info("🚀 UNIFIED GPU/NPU OVERCLOCKING FOR LLMs! 🚀\n");
     pr_info("Target NPU: %luMHz, Target GPU: %luMHz\n", 
             npu_freq/1000000, gpu_freq/1000000);
     
+    // Pre-spin the fan before the step lands; under devfreq the GPU steps
+    // are devfreq's (ours announces them itself)
+    if (npu_clk)
+        npu_freq = npu_capped_hz(npu_freq);
+    radxa_fan_feed_forward(step_power_mw(npu_device, npu_clk, npu_freq) +
+                           (gpu_devfreq ? 0 : step_power_mw(gpu_device, gpu_clk, gpu_freq)));
+    
     // Set NPU frequency
     if (npu_clk) {
-        ret = clk_set_rate(npu_clk, npu_freq);
-        if (ret == 0) {
+        mutex_lock(&npu_rate_lock);
+        npu_ret = __npu_apply_rate(npu_freq);
+        if (npu_ret == 0) {
+            npu_target_freq = npu_req;
+            npu_voltage_uv = npu_uv;
+            publish_npu();
+        }
+        mutex_unlock(&npu_rate_lock);
+        if (npu_ret == 0) {
             unsigned long actual_npu = clk_get_rate(npu_clk);
-            pr_info("✅ NPU: %luMHz achieved\n", actual_npu/1000000);
+            pr_info("✅ NPU: %luMHz achieved (bus %luMHz, reg %luMHz)\n", actual_npu/1000000,
+                    radxa_npu_rate(&npu_clks, RADXA_NPU_CLK_BUS)/1000000,
+                    radxa_npu_rate(&npu_clks, RADXA_NPU_CLK_REG)/1000000);
+            notify_domain_change("llm_npu", npu_clk, npu_freq, &npu_rate_misses);
+            sysfs_notify(&npu_device->kobj, "llm_npu", "bus_freq_hz");
+            sysfs_notify(&npu_device->kobj, "llm_npu", "reg_freq_hz");
         } else {
-            pr_err("❌ NPU overclock failed: %d\n", ret);
+            pr_err("❌ NPU overclock failed: %d\n", npu_ret);
         }
     }
     
+    // Under devfreq, ours or the driver's, the GPU value is a floor; the
+    // governor goes higher
+    if (gpu_devfreq) {
+        ret = dev_pm_qos_update_request(&gpu_floor_req,
+                                        gpu_freq ? gpu_freq / 1000 : PM_QOS_MIN_FREQUENCY_DEFAULT_VALUE);
+        mutex_lock(&gpu_rate_lock);
+        // The voltage is devfreq's to report
+        if (ret >= 0)
+            gpu_target_freq = gpu_freq;
+        publish_gpu();
+        mutex_unlock(&gpu_rate_lock);
+        if (ret < 0) {
+            pr_err("❌ GPU floor update failed: %d\n", ret);
+        } else {
+            ret = 0;
+            if (gpu_freq)
+                pr_info("✅ GPU: floor %luMHz, load decides above\n", gpu_freq/1000000);
+            else
+                pr_info("✅ GPU: no floor, following load\n");
+        }
     // Set GPU frequency (attempt direct clock control)
-    if (gpu_clk) {
+    } else if (gpu_clk) {
+        mutex_lock(&gpu_rate_lock);
+        radxa_cw_begin(&gpu_watch);
         ret = clk_set_rate(gpu_clk, gpu_freq);
+        radxa_cw_end(&gpu_watch, ret ? 0 : gpu_freq);
         if (ret == 0) {
             unsigned long actual_gpu = clk_get_rate(gpu_clk);
             pr_info("✅ GPU: %luMHz achieved\n", actual_gpu/1000000);
+            radxa_fs_update(gpu_stats, actual_gpu);
+            gpu_target_freq = gpu_freq;
+            gpu_voltage_uv = gpu_uv;
         } else {
             pr_info("⚠️ GPU direct clock control failed: %d\n", ret);
+            radxa_fs_failed(gpu_stats);
         }
+        publish_gpu();
+        mutex_unlock(&gpu_rate_lock);
+        if (ret == 0)
+            notify_domain_change("llm_gpu", gpu_clk, gpu_freq, &gpu_rate_misses);
     } else {
         pr_info("⚠️ GPU clock not accessible - trying alternative method\n");
     }
     
+    return npu_ret ? npu_ret : ret;
+}
+
+static unsigned long npu_floor_hz(void)
+{
+    unsigned long freq = 0;
+    struct dev_pm_opp *opp = dev_pm_opp_find_freq_ceil(npu_device, &freq);
+    
+    if (IS_ERR(opp))
+        return 0;
+    dev_pm_opp_put(opp);
+    return freq;
+}
+
+// Runs after a domain transition and moves the clocks to match the state
+// the domain was last reported in: the lowest OPP once gated, the
+// requested rate once powered. Back-to-back transitions collapse into one
+// run. The wake latency runs from the power-on request to the boosted clock.
+static void npu_gate_workfn(struct work_struct *work)
+{
+    struct llm_domain_state st;
+    unsigned long floor;
+    u64 ns;
+    
+    if (!READ_ONCE(npu_powered)) {
+        read_domain_state(RADXA_OC_DOMAIN_NPU, &st);
+        floor = npu_floor_hz();
+        if (floor && floor < st.cur_hz)
+            npu_apply_rate(floor);
+        return;
+    }
+    
+    // A rate written while gated wins over the one from before
+    npu_apply_target(npu_wake_hz);
+    if (xchg(&npu_wake_pending, false)) {
+        ns = ktime_to_ns(ktime_sub(ktime_get(), npu_wake_start));
+        npu_wake_last_ns = ns;
+        if (ns > npu_wake_max_ns)
+            npu_wake_max_ns = ns;
+        sysfs_notify(&npu_device->kobj, "llm_npu", "wake_latency_us");
+    }
+}
+
+// Domain transitions of the NPU. genpd calls this with its own lock held,
+// so no clock or OPP calls here: those may sleep on locks that wait for
+// genpd. npu_gate_workfn does the rate changes.
+static int npu_gate_notify(struct notifier_block *nb, unsigned long action, void *data)
+{
+    struct llm_domain_state st;
+    
+    switch (action) {
+    case GENPD_NOTIFY_PRE_OFF:
+        read_domain_state(RADXA_OC_DOMAIN_NPU, &st);
+        npu_wake_hz = st.cur_hz;
+        break;
+    case GENPD_NOTIFY_OFF:
+        WRITE_ONCE(npu_powered, false);
+        queue_work(system_power_efficient_wq, &npu_gate_work);
+        npu_gate_count++;
+        sysfs_notify(&npu_device->kobj, "llm_npu", "gate_count");
+        break;
+    case GENPD_NOTIFY_PRE_ON:
+        npu_wake_start = ktime_get();
+        break;
+    case GENPD_NOTIFY_ON:
+        WRITE_ONCE(npu_powered, true);
+        WRITE_ONCE(npu_wake_pending, true);
+        queue_work(system_highpri_wq, &npu_gate_work);
+        break;
+    }
+    return NOTIFY_OK;
+}
+
+// Switch race-to-idle: autosuspend after ms of idle lets runtime PM gate
+// the domain. Only works if the NPU driver drops its runtime PM reference
+// between jobs.
+static int npu_idle_gate_set(unsigned int ms)
+{
+    int ret = 0;
+    
+    mutex_lock(&npu_gate_lock);
+    if (ms && !npu_gate_on) {
+        if (!npu_clk) {
+            ret = -ENODEV;
+            goto out;
+        }
+        INIT_WORK(&npu_gate_work, npu_gate_workfn);
+        npu_powered = true;
+        npu_wake_pending = false;
+        npu_gate_nb.notifier_call = npu_gate_notify;
+        ret = dev_pm_genpd_add_notifier(npu_device, &npu_gate_nb);
+        if (ret)
+            goto out;
+        npu_saved_use_autosuspend = npu_device->power.use_autosuspend;
+        npu_saved_autosuspend_delay = npu_device->power.autosuspend_delay;
+        npu_gate_on = true;
+    }
+    
+    if (ms) {
+        pm_runtime_set_autosuspend_delay(npu_device, ms);
+        pm_runtime_use_autosuspend(npu_device);
+    } else if (npu_gate_on) {
+        dev_pm_genpd_remove_notifier(npu_device);
+        cancel_work_sync(&npu_gate_work);
+        pm_runtime_set_autosuspend_delay(npu_device, npu_saved_autosuspend_delay);
+        if (!npu_saved_use_autosuspend)
+            pm_runtime_dont_use_autosuspend(npu_device);
+        npu_gate_on = false;
+        // Don't leave a gated NPU at its floor
+        npu_apply_target(0);
+    }
+    npu_idle_gate_ms = ms;
+out:
+    mutex_unlock(&npu_gate_lock);
     return ret;
 }
 
+// The cap moved: re-apply the requested rate within it
+static int npu_max_qos_notify(struct notifier_block *nb, unsigned long max_khz, void *data)
+{
+    npu_apply_target(0);
+    return NOTIFY_OK;
+}
+
 // Sysfs interface for unified overclocking
 static ssize_t llm_overclock_show(struct device *dev,
                                   struct device_attribute *attr, char *buf)
 {
-    unsigned long npu_freq = 0, gpu_freq = 0;
+    struct llm_domain_state npu, gpu;
     
-    if (npu_clk) npu_freq = clk_get_rate(npu_clk);
-    if (gpu_clk) gpu_freq = clk_get_rate(gpu_clk);
+    read_domain_state(RADXA_OC_DOMAIN_NPU, &npu);
+    read_domain_state(RADXA_OC_DOMAIN_GPU, &gpu);
     
     return sprintf(buf, "UNIFIED GPU/NPU OVERCLOCKING FOR LLMs\n"
                         "NPU: %lu MHz\n"
                         "GPU: %lu MHz\n"
+                        "GPU scaling: %s\n"
                         "Usage: echo <npu_mhz>,<gpu_mhz> > llm_overclock\n"
                         "Example: echo 1800,800 > llm_overclock\n"
+                        "         echo 1800,auto > llm_overclock (GPU follows load)\n"
                         "Presets:\n"
                         "  conservative: echo conservative > llm_overclock\n"
                         "  aggressive: echo aggressive > llm_overclock\n"
                         "  maximum: echo maximum > llm_overclock\n",
-                        npu_freq/1000000, gpu_freq/1000000);
+                        npu.cur_hz/1000000, gpu.cur_hz/1000000,
+                        !gpu_devfreq ? "fixed clock" :
+                        gpu_devfreq_ours ? "devfreq (simple_ondemand), llm_overclock sets a floor" :
+                        "GPU driver's devfreq, llm_overclock sets a floor");
 }
 
-static ssize_t llm_overclock_store(struct device *dev,
-                                   struct device_attribute *attr,
-                                   const char *buf, size_t count)
+static int apply_llm_setting(const char *buf)
 {
+    struct device *dev = npu_device;
     unsigned long npu_mhz, gpu_mhz;
+    unsigned long npu_uv, gpu_uv = 0;
     int ret;
     
     // Check for preset modes
@@ -111,6 +595,8 @@ static ssize_t llm_overclock_store(struct device *dev,
         npu_mhz = 1800; gpu_mhz = 800;
     } else if (strncmp(buf, "maximum", 7) == 0) {
         npu_mhz = 2000; gpu_mhz = 1000;
+    } else if (gpu_devfreq && strstr(buf, ",auto") && sscanf(buf, "%lu,", &npu_mhz) == 1) {
+        gpu_mhz = 0; // GPU follows load, no floor
     } else {
         // Parse custom frequencies
         if (sscanf(buf, "%lu,%lu", &npu_mhz, &gpu_mhz) != 2) {
@@ -135,40 +621,585 @@ static ssize_t llm_overclock_store(struct device *dev,
         ret = dev_pm_opp_add(npu_device, npu_hz, voltage);
         if (ret == 0) {
             dev_info(dev, "✅ Added NPU %luMHz OPP\n", npu_mhz);
+            update_energy_model(npu_device, "NPU");
         }
+        npu_uv = voltage;
     } else {
+        npu_uv = dev_pm_opp_get_voltage(opp);
         dev_pm_opp_put(opp);
     }
     
     // Add GPU OPP (if possible)
-    if (gpu_device) {
+    if (gpu_device && gpu_hz) {
         opp = dev_pm_opp_find_freq_exact(gpu_device, gpu_hz, true);
         if (IS_ERR(opp)) {
-            unsigned long voltage = 900000 + (gpu_mhz - 400) * 500; // Scale voltage
-            if (voltage > 1200000) voltage = 1200000; // Cap at 1.2V
+            unsigned long voltage = gpu_voltage_for_freq(gpu_hz);
             
             ret = dev_pm_opp_add(gpu_device, gpu_hz, voltage);
             if (ret == 0) {
                 dev_info(dev, "✅ Added GPU %luMHz OPP\n", gpu_mhz);
+                update_energy_model(gpu_device, "GPU");
             }
+            gpu_uv = voltage;
         } else {
+            gpu_uv = dev_pm_opp_get_voltage(opp);
             dev_pm_opp_put(opp);
         }
     }
     
     // Apply unified overclocking
-    ret = set_unified_frequency(npu_hz, gpu_hz);
+    ret = set_unified_frequency(npu_hz, npu_uv, gpu_hz, gpu_uv);
     
     if (ret == 0) {
         dev_info(dev, "🎉 UNIFIED GPU/NPU OVERCLOCKED FOR LLM PERFORMANCE!\n");
         dev_info(dev, "🚀 Ready for maximum LLM inference speed!\n");
     }
     
-    return count;
+    return ret;
+}
+
+static ssize_t llm_overclock_store(struct device *dev,
+                                   struct device_attribute *attr,
+                                   const char *buf, size_t count)
+{
+    int ret = apply_llm_setting(buf);
+    
+    return ret ? ret : count;
 }
 
 static DEVICE_ATTR(llm_overclock, S_IRUGO | S_IWUSR, llm_overclock_show, llm_overclock_store);
 
+// Speculative settings: llm_try, then llm_commit before try_timeout_s runs out
+static ssize_t llm_try_store(struct device *dev, struct device_attribute *attr,
+                             const char *buf, size_t count)
+{
+    int ret = radxa_oc_try_start(&llm_try, buf, try_timeout_s);
+    
+    return ret ? ret : count;
+}
+
+static ssize_t llm_commit_store(struct device *dev, struct device_attribute *attr,
+                                const char *buf, size_t count)
+{
+    int ret = radxa_oc_try_commit(&llm_try);
+    
+    return ret ? ret : count;
+}
+
+static ssize_t llm_try_state_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return radxa_oc_try_state_show(&llm_try, buf);
+}
+
+static ssize_t llm_lkg_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return radxa_oc_try_lkg_show(&llm_try, buf);
+}
+
+static DEVICE_ATTR_WO(llm_try);
+static DEVICE_ATTR_WO(llm_commit);
+static DEVICE_ATTR_RO(llm_try_state);
+static DEVICE_ATTR_RO(llm_lkg);
+
+static struct attribute *llm_try_attrs[] = {
+    &dev_attr_llm_try.attr,
+    &dev_attr_llm_commit.attr,
+    &dev_attr_llm_try_state.attr,
+    &dev_attr_llm_lkg.attr,
+    NULL,
+};
+
+static const struct attribute_group llm_try_group = {
+    .attrs = llm_try_attrs,
+};
+
+// Machine-readable interface: one value per file in llm_npu/ and llm_gpu/
+struct llm_domain_attribute {
+    struct device_attribute attr;
+    int domain;
+};
+
+#define to_llm_domain(a) (container_of(a, struct llm_domain_attribute, attr)->domain)
+
+static ssize_t cur_freq_hz_show(struct device *dev,
+                                struct device_attribute *attr, char *buf)
+{
+    struct llm_domain_state st;
+    
+    read_domain_state(to_llm_domain(attr), &st);
+    return sprintf(buf, "%lu\n", st.cur_hz);
+}
+
+static ssize_t target_freq_hz_show(struct device *dev,
+                                   struct device_attribute *attr, char *buf)
+{
+    struct llm_domain_state st;
+    
+    read_domain_state(to_llm_domain(attr), &st);
+    return sprintf(buf, "%lu\n", st.target_hz);
+}
+
+static ssize_t voltage_uv_show(struct device *dev,
+                               struct device_attribute *attr, char *buf)
+{
+    struct llm_domain_state st;
+    
+    read_domain_state(to_llm_domain(attr), &st);
+    return sprintf(buf, "%lu\n", st.voltage_uv);
+}
+
+static ssize_t rate_misses_show(struct device *dev,
+                                struct device_attribute *attr, char *buf)
+{
+    return sprintf(buf, "%u\n", to_llm_domain(attr) == RADXA_OC_DOMAIN_NPU ?
+                   npu_rate_misses : gpu_rate_misses);
+}
+
+static struct radxa_clk_watch *to_llm_watch(struct device_attribute *attr)
+{
+    return to_llm_domain(attr) == RADXA_OC_DOMAIN_NPU ? &npu_watch : &gpu_watch;
+}
+
+// Rate changes made behind our back, and who made the last one
+static ssize_t drift_count_show(struct device *dev,
+                                struct device_attribute *attr, char *buf)
+{
+    return sprintf(buf, "%u\n", radxa_cw_drift_count(to_llm_watch(attr)));
+}
+
+static ssize_t last_drift_show(struct device *dev,
+                               struct device_attribute *attr, char *buf)
+{
+    return radxa_cw_offender_show(to_llm_watch(attr), buf);
+}
+
+static ssize_t em_states_show(struct device *dev,
+                              struct device_attribute *attr, char *buf)
+{
+    struct device *target = to_llm_domain(attr) == RADXA_OC_DOMAIN_NPU ? npu_device : gpu_device;
+    
+    return sprintf(buf, "%d\n", target ? radxa_em_nr_states(target) : 0);
+}
+
+static ssize_t bus_freq_hz_show(struct device *dev,
+                                struct device_attribute *attr, char *buf)
+{
+    struct llm_domain_state st;
+    
+    read_domain_state(RADXA_OC_DOMAIN_NPU, &st);
+    return sprintf(buf, "%lu\n", st.bus_hz);
+}
+
+static ssize_t reg_freq_hz_show(struct device *dev,
+                                struct device_attribute *attr, char *buf)
+{
+    struct llm_domain_state st;
+    
+    read_domain_state(RADXA_OC_DOMAIN_NPU, &st);
+    return sprintf(buf, "%lu\n", st.reg_hz);
+}
+
+static ssize_t idle_gate_ms_show(struct device *dev,
+                                 struct device_attribute *attr, char *buf)
+{
+    return sprintf(buf, "%u\n", npu_idle_gate_ms);
+}
+
+static ssize_t idle_gate_ms_store(struct device *dev,
+                                  struct device_attribute *attr,
+                                  const char *buf, size_t count)
+{
+    unsigned int ms;
+    int ret;
+    
+    if (kstrtouint(buf, 10, &ms))
+        return -EINVAL;
+    ret = npu_idle_gate_set(ms);
+    return ret ? ret : count;
+}
+
+static ssize_t wake_latency_us_show(struct device *dev,
+                                    struct device_attribute *attr, char *buf)
+{
+    return sprintf(buf, "%llu\n", div_u64(npu_wake_last_ns, NSEC_PER_USEC));
+}
+
+static ssize_t wake_latency_max_us_show(struct device *dev,
+                                        struct device_attribute *attr, char *buf)
+{
+    return sprintf(buf, "%llu\n", div_u64(npu_wake_max_ns, NSEC_PER_USEC));
+}
+
+static ssize_t gate_count_show(struct device *dev,
+                               struct device_attribute *attr, char *buf)
+{
+    return sprintf(buf, "%u\n", npu_gate_count);
+}
+
+static struct device_attribute npu_bus_freq_hz_attr = __ATTR_RO(bus_freq_hz);
+static struct device_attribute npu_reg_freq_hz_attr = __ATTR_RO(reg_freq_hz);
+static struct device_attribute npu_idle_gate_ms_attr = __ATTR_RW(idle_gate_ms);
+static struct device_attribute npu_wake_latency_us_attr = __ATTR_RO(wake_latency_us);
+static struct device_attribute npu_wake_latency_max_us_attr = __ATTR_RO(wake_latency_max_us);
+static struct device_attribute npu_gate_count_attr = __ATTR_RO(gate_count);
+
+#define LLM_DOMAIN_ATTR_RO(_prefix, _name, _domain)                         \
+    static struct llm_domain_attribute _prefix##_##_name##_attr = {         \
+        .attr = __ATTR(_name, S_IRUGO, _name##_show, NULL),                 \
+        .domain = _domain,                                                  \
+    }
+
+LLM_DOMAIN_ATTR_RO(npu, cur_freq_hz, RADXA_OC_DOMAIN_NPU);
+LLM_DOMAIN_ATTR_RO(npu, target_freq_hz, RADXA_OC_DOMAIN_NPU);
+LLM_DOMAIN_ATTR_RO(npu, voltage_uv, RADXA_OC_DOMAIN_NPU);
+LLM_DOMAIN_ATTR_RO(npu, rate_misses, RADXA_OC_DOMAIN_NPU);
+LLM_DOMAIN_ATTR_RO(npu, drift_count, RADXA_OC_DOMAIN_NPU);
+LLM_DOMAIN_ATTR_RO(npu, last_drift, RADXA_OC_DOMAIN_NPU);
+LLM_DOMAIN_ATTR_RO(npu, em_states, RADXA_OC_DOMAIN_NPU);
+LLM_DOMAIN_ATTR_RO(gpu, cur_freq_hz, RADXA_OC_DOMAIN_GPU);
+LLM_DOMAIN_ATTR_RO(gpu, target_freq_hz, RADXA_OC_DOMAIN_GPU);
+LLM_DOMAIN_ATTR_RO(gpu, voltage_uv, RADXA_OC_DOMAIN_GPU);
+LLM_DOMAIN_ATTR_RO(gpu, rate_misses, RADXA_OC_DOMAIN_GPU);
+LLM_DOMAIN_ATTR_RO(gpu, drift_count, RADXA_OC_DOMAIN_GPU);
+LLM_DOMAIN_ATTR_RO(gpu, last_drift, RADXA_OC_DOMAIN_GPU);
+LLM_DOMAIN_ATTR_RO(gpu, em_states, RADXA_OC_DOMAIN_GPU);
+
+static struct attribute *llm_npu_attrs[] = {
+    &npu_cur_freq_hz_attr.attr.attr,
+    &npu_target_freq_hz_attr.attr.attr,
+    &npu_voltage_uv_attr.attr.attr,
+    &npu_rate_misses_attr.attr.attr,
+    &npu_drift_count_attr.attr.attr,
+    &npu_last_drift_attr.attr.attr,
+    &npu_em_states_attr.attr.attr,
+    &npu_bus_freq_hz_attr.attr,
+    &npu_reg_freq_hz_attr.attr,
+    &npu_idle_gate_ms_attr.attr,
+    &npu_wake_latency_us_attr.attr,
+    &npu_wake_latency_max_us_attr.attr,
+    &npu_gate_count_attr.attr,
+    NULL,
+};
+
+static struct attribute *llm_gpu_attrs[] = {
+    &gpu_cur_freq_hz_attr.attr.attr,
+    &gpu_target_freq_hz_attr.attr.attr,
+    &gpu_voltage_uv_attr.attr.attr,
+    &gpu_rate_misses_attr.attr.attr,
+    &gpu_drift_count_attr.attr.attr,
+    &gpu_last_drift_attr.attr.attr,
+    &gpu_em_states_attr.attr.attr,
+    NULL,
+};
+
+static const struct attribute_group llm_npu_group = {
+    .name = "llm_npu",
+    .attrs = llm_npu_attrs,
+};
+
+static const struct attribute_group llm_gpu_group = {
+    .name = "llm_gpu",
+    .attrs = llm_gpu_attrs,
+};
+
+// Binary snapshot of NPU and GPU in a single read
+struct llm_snapshot {
+    struct radxa_oc_snapshot_header hdr;
+    struct radxa_oc_domain_state dom[2];
+} __attribute__((packed));
+
+static void fill_domain_state(struct radxa_oc_domain_state *st, u32 domain,
+                              struct clk *clk, unsigned long stock_max)
+{
+    struct llm_domain_state cur;
+    
+    read_domain_state(domain, &cur);
+    st->domain = domain;
+    st->flags = clk ? RADXA_OC_F_PRESENT : 0;
+    if (cur.target_hz > stock_max)
+        st->flags |= RADXA_OC_F_OVERCLOCKED;
+    st->cur_freq_hz = cur.cur_hz;
+    st->target_freq_hz = cur.target_hz;
+    st->voltage_uv = cur.voltage_uv;
+}
+
+static ssize_t llm_snapshot_read(struct file *filp, struct kobject *kobj,
+                                 struct bin_attribute *attr, char *buf,
+                                 loff_t off, size_t count)
+{
+    struct llm_snapshot snap = {};
+    
+    snap.hdr.magic = RADXA_OC_SNAPSHOT_MAGIC;
+    snap.hdr.version = RADXA_OC_SNAPSHOT_VERSION;
+    snap.hdr.nr_domains = 2;
+    snap.hdr.header_size = sizeof(snap.hdr);
+    snap.hdr.domain_size = sizeof(snap.dom[0]);
+    snap.hdr.timestamp_ns = ktime_get_ns();
+    
+    fill_domain_state(&snap.dom[0], RADXA_OC_DOMAIN_NPU, npu_clk, NPU_STOCK_MAX_HZ);
+    fill_domain_state(&snap.dom[1], RADXA_OC_DOMAIN_GPU, gpu_clk, GPU_STOCK_MAX_HZ);
+    
+    return memory_read_from_buffer(buf, count, &off, &snap, sizeof(snap));
+}
+
+static struct bin_attribute llm_snapshot_attr =
+    __BIN_ATTR(llm_snapshot, S_IRUGO, llm_snapshot_read, NULL, sizeof(struct llm_snapshot));
+
+// Busy sampling: a sample is busy when any job slot is running. The
+// registers are only read while the GPU is runtime-active; holding the
+// PM lock keeps its suspend callback from starting meanwhile. Once the
+// GPU suspends the sampler stops, and devfreq's next poll restarts it;
+// until then the window counts as idle.
+static enum hrtimer_restart gpu_sampler_fn(struct hrtimer *timer)
+{
+    unsigned long flags;
+    bool active, busy = false;
+    int slot;
+    
+    spin_lock_irqsave(&gpu_device->power.lock, flags);
+    active = gpu_device->power.runtime_status == RPM_ACTIVE;
+    if (active) {
+        for (slot = 0; slot < MALI_NR_JOB_SLOTS && !busy; slot++)
+            busy = readl_relaxed(gpu_regs + MALI_JS_BASE(slot) + MALI_JS_STATUS) == MALI_JS_ACTIVE;
+    }
+    spin_unlock_irqrestore(&gpu_device->power.lock, flags);
+    
+    if (!active)
+        return HRTIMER_NORESTART;
+    if (busy)
+        atomic_inc(&gpu_busy_samples);
+    
+    hrtimer_forward_now(timer, us_to_ktime(gpu_sample_us));
+    return HRTIMER_RESTART;
+}
+
+static void gpu_sampler_kick(void)
+{
+    if (gpu_device->power.runtime_status == RPM_ACTIVE && !hrtimer_active(&gpu_sampler))
+        hrtimer_start(&gpu_sampler, us_to_ktime(gpu_sample_us), HRTIMER_MODE_REL);
+}
+
+// Bus clock keeps its boot-time ratio to the core clock
+static void set_gpu_bus_rate(unsigned long core_hz)
+{
+    unsigned long bus_hz;
+    int ret;
+    
+    if (!gpu_bus_scalable)
+        return;
+    bus_hz = mult_frac(gpu_bus_stock_hz, core_hz, gpu_core_stock_hz);
+    ret = clk_set_rate(gpu_bus_clk, bus_hz);
+    if (ret)
+        pr_warn("⚠️ GPU bus clock %luMHz failed: %d\n", bus_hz/1000000, ret);
+}
+
+static int gpu_devfreq_target(struct device *dev, unsigned long *freq, u32 flags)
+{
+    unsigned long old = clk_get_rate(gpu_clk);
+    struct dev_pm_opp *opp;
+    int ret;
+    
+    opp = devfreq_recommended_opp(dev, freq, flags);
+    if (IS_ERR(opp))
+        return PTR_ERR(opp);
+    mutex_lock(&gpu_rate_lock);
+    gpu_voltage_uv = dev_pm_opp_get_voltage(opp);
+    dev_pm_opp_put(opp);
+    
+    if (*freq == old)
+        goto out;
+    
+    radxa_fan_feed_forward(radxa_em_power_delta(em_pd_get(dev), old, *freq));
+    
+    // Raise the bus before the core, lower it after
+    if (*freq > old)
+        set_gpu_bus_rate(*freq);
+    // Sets mali-supply before raising and after lowering the clock
+    ret = dev_pm_opp_set_rate(dev, *freq);
+    if (ret) {
+        if (*freq > old)
+            set_gpu_bus_rate(old);
+        mutex_unlock(&gpu_rate_lock);
+        return ret;
+    }
+    if (*freq < old)
+        set_gpu_bus_rate(*freq);
+out:
+    publish_gpu();
+    mutex_unlock(&gpu_rate_lock);
+    if (*freq != old)
+        notify_domain_change("llm_gpu", gpu_clk, *freq, &gpu_rate_misses);
+    return 0;
+}
+
+// The window is wall time since the last poll, so time the sampler spent
+// stopped counts as idle rather than missing
+static int gpu_devfreq_get_dev_status(struct device *dev, struct devfreq_dev_status *stat)
+{
+    unsigned int busy = atomic_xchg(&gpu_busy_samples, 0);
+    ktime_t now = ktime_get();
+    
+    stat->total_time = ktime_us_delta(now, gpu_status_last);
+    stat->busy_time = min_t(unsigned long, (unsigned long)busy * gpu_sample_us,
+                            stat->total_time);
+    stat->current_frequency = clk_get_rate(gpu_clk);
+    gpu_status_last = now;
+    gpu_sampler_kick();
+    return 0;
+}
+
+static int gpu_devfreq_get_cur_freq(struct device *dev, unsigned long *freq)
+{
+    *freq = clk_get_rate(gpu_clk);
+    return 0;
+}
+
+static struct devfreq_dev_profile gpu_devfreq_profile = {
+    .target = gpu_devfreq_target,
+    .get_dev_status = gpu_devfreq_get_dev_status,
+    .get_cur_freq = gpu_devfreq_get_cur_freq,
+};
+
+static void setup_gpu_bus_clock(void)
+{
+    gpu_bus_clk = clk_get(gpu_device, "bus");
+    if (IS_ERR(gpu_bus_clk)) {
+        gpu_bus_clk = NULL;
+        return;
+    }
+    gpu_bus_stock_hz = clk_get_rate(gpu_bus_clk);
+    gpu_core_stock_hz = clk_get_rate(gpu_clk);
+    
+    // A plain gate rounds every rate to its parent's: nothing to scale
+    gpu_bus_scalable = gpu_bus_stock_hz && gpu_core_stock_hz &&
+                       clk_round_rate(gpu_bus_clk, gpu_bus_stock_hz * 2) != gpu_bus_stock_hz;
+    pr_info("✅ GPU bus clock %luMHz%s\n", gpu_bus_stock_hz/1000000,
+            gpu_bus_scalable ? ", scaled with the core" : " (fixed)");
+}
+
+// Register a devfreq device for the GPU with the llm_gpu_freqs points on
+// mali-supply. If the GPU driver (mali_kbase) already runs its own, a
+// second one on the same device would fight it, so only the floor request
+// is added; devfreq honours the device's PM QoS whoever registered it.
+static int setup_gpu_devfreq(void)
+{
+    struct devfreq *existing;
+    const char * const regulators[] = { "mali" };
+    unsigned long freq;
+    int i, ret;
+    
+    existing = devfreq_get_devfreq_by_node(gpu_device->of_node);
+    if (!IS_ERR(existing)) {
+        ret = dev_pm_qos_add_request(gpu_device, &gpu_floor_req, DEV_PM_QOS_MIN_FREQUENCY,
+                                     PM_QOS_MIN_FREQUENCY_DEFAULT_VALUE);
+        if (ret < 0)
+            return ret;
+        gpu_devfreq = existing;
+        pr_info("✅ GPU driver runs devfreq (%s), llm_overclock sets a floor on it\n",
+                dev_name(&existing->dev));
+        return 0;
+    }
+    if (!gpu_clk)
+        return -ENODEV;
+    
+    // Regulators must be attached before the first OPP exists
+    gpu_opp_table = dev_pm_opp_set_regulators(gpu_device, regulators, ARRAY_SIZE(regulators));
+    if (IS_ERR(gpu_opp_table)) {
+        ret = PTR_ERR(gpu_opp_table);
+        gpu_opp_table = NULL;
+        return ret;
+    }
+    
+    for (i = 0; i < ARRAY_SIZE(llm_gpu_freqs); i++) {
+        ret = dev_pm_opp_add(gpu_device, llm_gpu_freqs[i],
+                             gpu_voltage_for_freq(llm_gpu_freqs[i]));
+        if (ret && ret != -EEXIST)
+            pr_warn("⚠️ GPU %luMHz OPP: %d\n", llm_gpu_freqs[i]/1000000, ret);
+    }
+    
+    gpu_regs = of_iomap(gpu_device->of_node, 0);
+    if (!gpu_regs) {
+        ret = -ENOMEM;
+        goto err_opps;
+    }
+    
+    setup_gpu_bus_clock();
+    
+    hrtimer_init(&gpu_sampler, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+    gpu_sampler.function = gpu_sampler_fn;
+    gpu_status_last = ktime_get();
+    gpu_sampler_kick();
+    
+    freq = clk_get_rate(gpu_clk);
+    gpu_devfreq_profile.initial_freq = freq;
+    gpu_devfreq_profile.polling_ms = gpu_poll_ms;
+    gpu_ondemand_data.upthreshold = gpu_upthreshold;
+    gpu_ondemand_data.downdifferential = gpu_downdifferential;
+    gpu_devfreq = devfreq_add_device(gpu_device, &gpu_devfreq_profile,
+                                     DEVFREQ_GOV_SIMPLE_ONDEMAND, &gpu_ondemand_data);
+    if (IS_ERR(gpu_devfreq)) {
+        ret = PTR_ERR(gpu_devfreq);
+        gpu_devfreq = NULL;
+        goto err_sampler;
+    }
+    gpu_devfreq_ours = true;
+    // OPPs added later by llm_overclock show up in devfreq too
+    devfreq_register_opp_notifier(gpu_device, gpu_devfreq);
+    
+    ret = dev_pm_qos_add_request(gpu_device, &gpu_floor_req, DEV_PM_QOS_MIN_FREQUENCY,
+                                 PM_QOS_MIN_FREQUENCY_DEFAULT_VALUE);
+    if (ret < 0)
+        goto err_devfreq;
+    
+    pr_info("✅ GPU devfreq: simple_ondemand, %d OPPs up to %luMHz\n",
+            dev_pm_opp_get_opp_count(gpu_device),
+            llm_gpu_freqs[ARRAY_SIZE(llm_gpu_freqs) - 1]/1000000);
+    return 0;
+    
+err_devfreq:
+    devfreq_unregister_opp_notifier(gpu_device, gpu_devfreq);
+    devfreq_remove_device(gpu_devfreq);
+    gpu_devfreq = NULL;
+    gpu_devfreq_ours = false;
+err_sampler:
+    hrtimer_cancel(&gpu_sampler);
+    if (gpu_bus_clk) clk_put(gpu_bus_clk);
+    gpu_bus_clk = NULL;
+    iounmap(gpu_regs);
+    gpu_regs = NULL;
+err_opps:
+    dev_pm_opp_remove_all_dynamic(gpu_device);
+    dev_pm_opp_put_regulators(gpu_opp_table);
+    gpu_opp_table = NULL;
+    return ret;
+}
+
+static void teardown_gpu_devfreq(void)
+{
+    if (!gpu_devfreq)
+        return;
+    dev_pm_qos_remove_request(&gpu_floor_req);
+    if (!gpu_devfreq_ours) {
+        gpu_devfreq = NULL;
+        return;
+    }
+    devfreq_unregister_opp_notifier(gpu_device, gpu_devfreq);
+    devfreq_remove_device(gpu_devfreq);
+    gpu_devfreq = NULL;
+    gpu_devfreq_ours = false;
+    hrtimer_cancel(&gpu_sampler);
+    iounmap(gpu_regs);
+    
+    if (gpu_bus_clk) {
+        if (gpu_bus_scalable)
+            clk_set_rate(gpu_bus_clk, gpu_bus_stock_hz);
+        clk_put(gpu_bus_clk);
+    }
+    // The regulators can only go once the table is empty
+    dev_pm_opp_remove_all_dynamic(gpu_device);
+    dev_pm_opp_put_regulators(gpu_opp_table);
+}
+
 static int find_gpu_npu_devices(void)
 {
     // Find NPU device
@@ -187,18 +1218,15 @@ static int find_gpu_npu_devices(void)
         pr_info("✅ Found GPU device\n");
     }
     
-    // Get NPU clock
-    npu_clk = clk_get(npu_device, NULL);
-    if (IS_ERR(npu_clk)) {
-        npu_clk = clk_get(npu_device, "npu");
-        if (IS_ERR(npu_clk)) {
-            pr_warn("⚠️ NPU clock not directly accessible\n");
-            npu_clk = NULL;
-        }
-    }
-    
-    if (npu_clk) {
-        pr_info("✅ NPU clock found: %luMHz\n", clk_get_rate(npu_clk)/1000000);
+    // Get NPU clocks
+    if (radxa_npu_clocks_get(&npu_clks, npu_device)) {
+        pr_warn("⚠️ NPU clock not directly accessible\n");
+    } else {
+        npu_clk = npu_clks.clk[RADXA_NPU_CLK_CORE];
+        pr_info("✅ NPU clock found: %luMHz, bus %luMHz, reg %luMHz\n",
+                clk_get_rate(npu_clk)/1000000,
+                radxa_npu_rate(&npu_clks, RADXA_NPU_CLK_BUS)/1000000,
+                radxa_npu_rate(&npu_clks, RADXA_NPU_CLK_REG)/1000000);
     }
     
     // Try to get GPU clock
@@ -223,6 +1251,92 @@ static int find_gpu_npu_devices(void)
     return 0;
 }
 
+// Someone else moved a clock we set: count the time at the new rate and
+// let pollers re-read it
+static void llm_drifted(struct radxa_clk_watch *w, unsigned long hz)
+{
+    bool npu = w == &npu_watch;
+    const char *group = npu ? "llm_npu" : "llm_gpu";
+    struct mutex *lock = npu ? &npu_rate_lock : &gpu_rate_lock;
+    
+    mutex_lock(lock);
+    radxa_fs_update(npu ? npu_stats : gpu_stats, hz);
+    if (npu)
+        publish_npu();
+    else
+        publish_gpu();
+    mutex_unlock(lock);
+    sysfs_notify(&npu_device->kobj, group, "drift_count");
+    sysfs_notify(&npu_device->kobj, group, "cur_freq_hz");
+}
+
+static int npu_reassert(struct radxa_clk_watch *w, unsigned long hz)
+{
+    return npu_apply_rate(npu_capped_hz(hz));
+}
+
+static int gpu_reassert(struct radxa_clk_watch *w, unsigned long hz)
+{
+    int ret;
+    
+    mutex_lock(&gpu_rate_lock);
+    radxa_cw_begin(&gpu_watch);
+    ret = clk_set_rate(gpu_clk, hz);
+    radxa_cw_end(&gpu_watch, 0);
+    if (ret)
+        radxa_fs_failed(gpu_stats);
+    else
+        radxa_fs_update(gpu_stats, clk_get_rate(gpu_clk));
+    publish_gpu();
+    mutex_unlock(&gpu_rate_lock);
+    return ret;
+}
+
+// After suspend the NPU and a directly driven GPU come back at the
+// firmware's rates while the clock framework still caches ours, so go
+// through half the rate to really program them. Done before userspace
+// runs its first job; our devfreq resumes the GPU itself.
+static int llm_pm_notify(struct notifier_block *nb, unsigned long action, void *data)
+{
+    unsigned long hz;
+    int ret = 0;
+    
+    if (action != PM_POST_SUSPEND && action != PM_POST_HIBERNATION && action != PM_POST_RESTORE)
+        return NOTIFY_OK;
+    
+    if (npu_clk) {
+        mutex_lock(&npu_rate_lock);
+        hz = npu_target_freq ? npu_capped_hz(npu_target_freq) : 0;
+        if (hz) {
+            radxa_cw_begin(&npu_watch);
+            radxa_npu_set_rate(&npu_clks, hz / 2);
+            radxa_cw_end(&npu_watch, 0);
+            ret = __npu_apply_rate(hz);
+        }
+        mutex_unlock(&npu_rate_lock);
+        if (hz) {
+            pr_info("%s NPU restored to %luMHz after resume (%d)\n", ret ? "❌" : "✅",
+                    hz/1000000, ret);
+            notify_domain_change("llm_npu", npu_clk, hz, &npu_rate_misses);
+        }
+    }
+    
+    if (gpu_clk && !gpu_devfreq && gpu_target_freq) {
+        mutex_lock(&gpu_rate_lock);
+        ret = radxa_cw_reprogram(&gpu_watch, gpu_clk, gpu_target_freq);
+        if (ret)
+            radxa_fs_failed(gpu_stats);
+        else
+            radxa_fs_update(gpu_stats, clk_get_rate(gpu_clk));
+        publish_gpu();
+        mutex_unlock(&gpu_rate_lock);
+        pr_info("%s GPU restored to %luMHz after resume (%d)\n", ret ? "❌" : "✅",
+                gpu_target_freq/1000000, ret);
+        notify_domain_change("llm_gpu", gpu_clk, gpu_target_freq, &gpu_rate_misses);
+    }
+    return NOTIFY_OK;
+}
+
 static int __init llm_unified_overclock_init(void)
 {
     int ret;
@@ -236,6 +1350,17 @@ static int __init llm_unified_overclock_init(void)
         return ret;
     }
     
+    if (gpu_device) {
+        ret = setup_gpu_devfreq();
+        if (ret)
+            pr_warn("⚠️ GPU devfreq not available (%d), fixed GPU clock\n", ret);
+    }
+    publish_npu();
+    publish_gpu();
+    
+    // With devfreq, stock is the GPU following its load
+    radxa_oc_try_init(&llm_try, apply_llm_setting, gpu_devfreq ? "1008,auto" : "1008,840", lkg);
+    
     // Create unified overclocking interface on NPU device
     ret = device_create_file(npu_device, &dev_attr_llm_overclock);
     if (ret) {
@@ -243,6 +1368,64 @@ static int __init llm_unified_overclock_init(void)
         goto cleanup;
     }
     
+    ret = sysfs_create_group(&npu_device->kobj, &llm_npu_group);
+    if (ret)
+        goto cleanup_file;
+    ret = sysfs_create_group(&npu_device->kobj, &llm_gpu_group);
+    if (ret)
+        goto cleanup_npu_group;
+    ret = sysfs_create_bin_file(&npu_device->kobj, &llm_snapshot_attr);
+    if (ret)
+        goto cleanup_gpu_group;
+    ret = sysfs_create_group(&npu_device->kobj, &llm_try_group);
+    if (ret)
+        goto cleanup_snapshot;
+    
+    // Perf domains for the current OPP tables; refreshed as OPPs are added
+    update_energy_model(npu_device, "NPU");
+    if (gpu_device)
+        update_energy_model(gpu_device, "GPU");
+    
+    // Not fatal: without them only the statistics are missing
+    if (npu_clk || (gpu_clk && !gpu_devfreq))
+        llm_stats_kobj = kobject_create_and_add("llm_freq_stats", &npu_device->kobj);
+    if (npu_clk)
+        npu_stats = radxa_fs_create(llm_stats_kobj, "npu", clk_get_rate(npu_clk));
+    if (gpu_clk && !gpu_devfreq)
+        gpu_stats = radxa_fs_create(llm_stats_kobj, "gpu", clk_get_rate(gpu_clk));
+    
+    if (npu_clk) {
+        npu_watch.drifted = llm_drifted;
+        npu_watch.reassert = npu_reassert;
+        if (radxa_cw_register(&npu_watch, npu_clk, "NPU", &drift_policy))
+            pr_warn("⚠️ Cannot watch the NPU clock for changes\n");
+    }
+    if (gpu_clk && !gpu_devfreq) {
+        gpu_watch.drifted = llm_drifted;
+        gpu_watch.reassert = gpu_reassert;
+        if (radxa_cw_register(&gpu_watch, gpu_clk, "GPU", &drift_policy))
+            pr_warn("⚠️ Cannot watch the GPU clock for changes\n");
+    }
+    
+    llm_pm_nb.notifier_call = llm_pm_notify;
+    register_pm_notifier(&llm_pm_nb);
+    
+    radxa_oc_try_restore(&llm_try, &npu_device->kobj, "llm_try_state");
+    
+    if (npu_clk) {
+        npu_max_qos_nb.notifier_call = npu_max_qos_notify;
+        npu_max_qos_registered = !dev_pm_qos_add_notifier(npu_device, &npu_max_qos_nb,
+                                                          DEV_PM_QOS_MAX_FREQUENCY);
+    }
+    
+    if (npu_idle_gate_ms) {
+        ret = npu_idle_gate_set(npu_idle_gate_ms);
+        if (ret) {
+            pr_warn("⚠️ NPU race-to-idle not available: %d\n", ret);
+            npu_idle_gate_ms = 0;
+        }
+    }
+    
     pr_info("✅ UNIFIED GPU/NPU OVERCLOCKING MODULE LOADED!\n");
     pr_info("📍 Interface: /sys/devices/platform/soc@3000000/3600000.npu/llm_overclock\n");
     pr_info("🚀 READY FOR LLM OVERCLOCKING!\n");
@@ -250,8 +1433,17 @@ static int __init llm_unified_overclock_init(void)
     
     return 0;
     
+cleanup_snapshot:
+    sysfs_remove_bin_file(&npu_device->kobj, &llm_snapshot_attr);
+cleanup_gpu_group:
+    sysfs_remove_group(&npu_device->kobj, &llm_gpu_group);
+cleanup_npu_group:
+    sysfs_remove_group(&npu_device->kobj, &llm_npu_group);
+cleanup_file:
+    device_remove_file(npu_device, &dev_attr_llm_overclock);
 cleanup:
-    if (npu_clk) clk_put(npu_clk);
+    teardown_gpu_devfreq();
+    radxa_npu_clocks_put(&npu_clks);
     if (gpu_clk) clk_put(gpu_clk);
     if (npu_device) put_device(npu_device);
     if (gpu_device) put_device(gpu_device);
@@ -260,13 +1452,34 @@ cleanup:
 
 static void __exit llm_unified_overclock_exit(void)
 {
+    radxa_oc_try_exit(&llm_try);
+    unregister_pm_notifier(&llm_pm_nb);
+    radxa_cw_unregister(&npu_watch);
+    radxa_cw_unregister(&gpu_watch);
+    npu_idle_gate_set(0);
+    if (npu_max_qos_registered)
+        dev_pm_qos_remove_notifier(npu_device, &npu_max_qos_nb, DEV_PM_QOS_MAX_FREQUENCY);
+    
+    // Our callback goes away with the module
+    if (gpu_device) {
+        em_dev_unregister_perf_domain(gpu_device);
+        teardown_gpu_devfreq();
+    }
     if (npu_device) {
+        em_dev_unregister_perf_domain(npu_device);
+        radxa_fs_destroy(npu_stats);
+        radxa_fs_destroy(gpu_stats);
+        kobject_put(llm_stats_kobj);
+        sysfs_remove_group(&npu_device->kobj, &llm_try_group);
+        sysfs_remove_bin_file(&npu_device->kobj, &llm_snapshot_attr);
+        sysfs_remove_group(&npu_device->kobj, &llm_gpu_group);
+        sysfs_remove_group(&npu_device->kobj, &llm_npu_group);
         device_remove_file(npu_device, &dev_attr_llm_overclock);
         put_device(npu_device);
     }
     
     if (gpu_device) put_device(gpu_device);
-    if (npu_clk) clk_put(npu_clk);
+    radxa_npu_clocks_put(&npu_clks);
     if (gpu_clk) clk_put(gpu_clk);
     
     pr_info("🔥 UNIFIED GPU/NPU OVERCLOCKING MODULE UNLOADED\n");
@@ -278,4 +1491,6 @@ module_exit(llm_unified_overclock_exit);
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("LLM Performance Team");
 MODULE_DESCRIPTION("Unified GPU/NPU Overclocking for Maximum LLM Performance");
-MODULE_VERSION("1.0");
\ No newline at end of file
+MODULE_VERSION("1.0");
+// The Mali driver registers its devfreq first, so ours never collides with it
+MODULE_SOFTDEP("pre: mali_kbase");
\ No newline at end of file
@@ -0,0 +1,668 @@
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/cpu.h>
+#include <linux/cpuhotplug.h>
+#include <linux/cpufreq.h>
+#include <linux/perf_event.h>
+#include <linux/workqueue.h>
+#include <linux/sysfs.h>
+#include <linux/kobject.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/spinlock.h>
+
+#include "radxa_overclock_hooks.h"
+#include "radxa_cpu_clusters.h"
+#include "radxa_tunable.h"
+
+#define MODULE_NAME "mem_stall_governor"
+#define CLUSTER_E 0
+#define CLUSTER_P 1
+#define NR_CLUSTERS 2
+
+// ARMv8 common PMU events, implemented by both the A55 and the A76
+#define ARMV8_INST_RETIRED      0x08
+#define ARMV8_L2D_CACHE_REFILL  0x17
+#define ARMV8_STALL_BACKEND     0x24
+#define ARMV8_L3D_CACHE_REFILL  0x2a
+#define ARMV8_CPU_CYCLES        0x11
+
+enum stall_event {
+    EV_CYCLES,
+    EV_INSTRUCTIONS,
+    EV_L2_REFILL,
+    EV_L3_REFILL,
+    EV_STALL_BACKEND,
+    NR_STALL_EVENTS,
+};
+
+static const u64 stall_event_config[NR_STALL_EVENTS] = {
+    [EV_CYCLES]        = ARMV8_CPU_CYCLES,
+    [EV_INSTRUCTIONS]  = ARMV8_INST_RETIRED,
+    [EV_L2_REFILL]     = ARMV8_L2D_CACHE_REFILL,
+    [EV_L3_REFILL]     = ARMV8_L3D_CACHE_REFILL,
+    [EV_STALL_BACKEND] = ARMV8_STALL_BACKEND,
+};
+
+enum stall_class {
+    CLASS_IDLE,
+    CLASS_COMPUTE,
+    CLASS_MEMORY,
+};
+
+static const char * const class_names[] = { "idle", "compute", "memory" };
+
+// Each CPU reads its own counters from a deferrable work item bound to it:
+// perf reads a local event without an IPI, and an idle CPU is not woken
+// just to be sampled (its cycles stop in WFI anyway)
+struct stall_cpu {
+    struct perf_event *ev[NR_STALL_EVENTS];
+    u64 last[NR_STALL_EVENTS];
+    spinlock_t lock;                // acc, between the CPU and the governor
+    u64 acc[NR_STALL_EVENTS];       // Counted since the governor last collected
+    struct delayed_work work;
+    int cpu;
+};
+
+struct stall_cluster {
+    const char *name;
+    cpumask_t cpus;
+    int cpu;                        // First CPU of the cpufreq policy, -1 if none
+    enum stall_class state;
+    enum stall_class pending;       // Candidate state, needs hold_samples in a row
+    unsigned int pending_count;
+    bool capped;
+    unsigned long floor_hz;         // Compute-bound floor, 0 if none
+    // Last sample, per mille / per thousand instructions
+    unsigned int busy_permille;     // Cycles counted vs. cycles available
+    unsigned int ipc_milli;
+    unsigned int stall_permille;    // Backend stall cycles / cycles
+    unsigned int mpki;              // Last-level refills / 1000 instructions
+};
+
+struct mem_stall_data {
+    struct stall_cpu cpu[NR_CPUS];
+    struct stall_cluster cluster[NR_CLUSTERS];
+    int nr_clusters;
+    struct delayed_work work;
+    enum cpuhp_state cpuhp_state;   // 0 while stopped
+    ktime_t last_sample;
+    struct kobject *kobj;
+    bool enabled;
+    unsigned int sample_ms;
+    unsigned int stall_threshold;   // Enter memory-bound, per mille
+    unsigned int compute_threshold; // Leave memory-bound, per mille
+    unsigned int mpki_threshold;
+    unsigned int busy_threshold;    // Below this a cluster is idle, per mille
+    unsigned int boost_threshold;   // Compute-bound and this busy: floor, per mille
+    unsigned int hold_samples;
+    unsigned int ddr_boosts;
+    // Hooks into the other modules, NULL if not loaded
+    int (*cpu_cap)(unsigned int cpu, unsigned long max_hz);
+    int (*cpu_floor)(unsigned int cpu, unsigned long min_hz);
+    int (*ddr_boost)(bool stalled);
+};
+
+static struct mem_stall_data *g_data;
+
+static const char * const cluster_names[NR_CLUSTERS] = { "efficiency", "performance" };
+
+// Clusters as cpu_overclock sees them
+static int discover_clusters(void) {
+    struct radxa_cpu_cluster found[NR_CLUSTERS];
+    int c, nr = min(radxa_discover_clusters(found, NR_CLUSTERS), NR_CLUSTERS);
+
+    for (c = 0; c < NR_CLUSTERS; c++) {
+        g_data->cluster[c].cpu = found[c].cpu;
+        cpumask_copy(&g_data->cluster[c].cpus, &found[c].cpus);
+    }
+    return nr;
+}
+
+static void release_counters(void) {
+    int cpu, i;
+
+    for_each_possible_cpu(cpu) {
+        for (i = 0; i < NR_STALL_EVENTS; i++) {
+            if (g_data->cpu[cpu].ev[i])
+                perf_event_release_kernel(g_data->cpu[cpu].ev[i]);
+            g_data->cpu[cpu].ev[i] = NULL;
+        }
+    }
+}
+
+// Counting (not sampling) events, pinned to each CPU. CPUs that are
+// offline now are left out until the module is reloaded.
+static int create_counters(void) {
+    struct perf_event_attr attr = {
+        .type = PERF_TYPE_RAW,
+        .size = sizeof(attr),
+    };
+    int cpu, i, nr = 0;
+
+    cpus_read_lock();
+    for_each_online_cpu(cpu) {
+        for (i = 0; i < NR_STALL_EVENTS; i++) {
+            struct perf_event *ev;
+
+            attr.config = stall_event_config[i];
+            ev = perf_event_create_kernel_counter(&attr, cpu, NULL, NULL, NULL);
+            if (IS_ERR(ev)) {
+                // L3 refills are optional without a DSU L3
+                if (i != EV_L3_REFILL)
+                    pr_warn("MEM_STALL: cpu%d: event 0x%llx unavailable: %ld\n",
+                            cpu, attr.config, PTR_ERR(ev));
+                continue;
+            }
+            g_data->cpu[cpu].ev[i] = ev;
+            nr++;
+        }
+    }
+    cpus_read_unlock();
+
+    return nr ? 0 : -ENODEV;
+}
+
+static u64 read_delta(struct stall_cpu *sc, int i) {
+    u64 enabled, running, value, delta;
+
+    if (!sc->ev[i])
+        return 0;
+    value = perf_event_read_value(sc->ev[i], &enabled, &running);
+    // Scale up if the PMU had to multiplex
+    if (running && running < enabled)
+        value = div64_u64(value * enabled, running);
+    delta = value - sc->last[i];
+    sc->last[i] = value;
+    return delta;
+}
+
+static void stall_cpu_workfn(struct work_struct *work) {
+    struct stall_cpu *sc = container_of(to_delayed_work(work), struct stall_cpu, work);
+    u64 delta[NR_STALL_EVENTS];
+    int i;
+
+    for (i = 0; i < NR_STALL_EVENTS; i++)
+        delta[i] = read_delta(sc, i);
+
+    spin_lock(&sc->lock);
+    for (i = 0; i < NR_STALL_EVENTS; i++)
+        sc->acc[i] += delta[i];
+    spin_unlock(&sc->lock);
+
+    queue_delayed_work_on(sc->cpu, system_wq, &sc->work, msecs_to_jiffies(g_data->sample_ms));
+}
+
+// Hotplug callbacks run on the CPU itself; the sampler stops before the
+// CPU's workqueue is unbound
+static int stall_cpu_online(unsigned int cpu) {
+    struct stall_cpu *sc = &g_data->cpu[cpu];
+    int i;
+
+    if (!sc->ev[EV_CYCLES])
+        return 0;
+
+    // Count from now, not from when the sampler last stopped
+    for (i = 0; i < NR_STALL_EVENTS; i++)
+        read_delta(sc, i);
+    spin_lock(&sc->lock);
+    memset(sc->acc, 0, sizeof(sc->acc));
+    spin_unlock(&sc->lock);
+
+    queue_delayed_work_on(cpu, system_wq, &sc->work, msecs_to_jiffies(g_data->sample_ms));
+    return 0;
+}
+
+static int stall_cpu_offline(unsigned int cpu) {
+    cancel_delayed_work_sync(&g_data->cpu[cpu].work);
+    return 0;
+}
+
+// Take what the CPU counted since the last call
+static void collect(struct stall_cpu *sc, u64 *sum) {
+    int i;
+
+    spin_lock(&sc->lock);
+    for (i = 0; i < NR_STALL_EVENTS; i++) {
+        sum[i] += sc->acc[i];
+        sc->acc[i] = 0;
+    }
+    spin_unlock(&sc->lock);
+}
+
+static enum stall_class classify(struct stall_cluster *cl, const u64 *sum, u64 elapsed_us) {
+    struct cpufreq_policy *policy;
+    u64 available = 0;
+    u64 refills;
+
+    // Cycles the cluster could have run in the period
+    policy = cpufreq_cpu_get(cl->cpu);
+    if (policy) {
+        available = (u64)policy->cur * elapsed_us / 1000 * cpumask_weight(&cl->cpus);
+        cpufreq_cpu_put(policy);
+    }
+
+    refills = sum[EV_L3_REFILL] ? sum[EV_L3_REFILL] : sum[EV_L2_REFILL];
+    cl->busy_permille = available ? min_t(u64, div64_u64(sum[EV_CYCLES] * 1000, available), 1000) : 0;
+    cl->ipc_milli = sum[EV_CYCLES] ? div64_u64(sum[EV_INSTRUCTIONS] * 1000, sum[EV_CYCLES]) : 0;
+    cl->stall_permille = sum[EV_CYCLES] ? div64_u64(sum[EV_STALL_BACKEND] * 1000, sum[EV_CYCLES]) : 0;
+    cl->mpki = sum[EV_INSTRUCTIONS] ? div64_u64(refills * 1000, sum[EV_INSTRUCTIONS]) : 0;
+
+    if (cl->busy_permille < g_data->busy_threshold)
+        return CLASS_IDLE;
+    if (cl->stall_permille >= g_data->stall_threshold && cl->mpki >= g_data->mpki_threshold)
+        return CLASS_MEMORY;
+    // Hysteresis: stay memory-bound until the stalls have clearly gone
+    if (cl->state == CLASS_MEMORY && cl->stall_permille >= g_data->compute_threshold)
+        return CLASS_MEMORY;
+    return CLASS_COMPUTE;
+}
+
+// Memory-bound: hold the cluster where it is, a faster core only waits
+// longer. Otherwise give cpufreq its full range back.
+static void apply_cluster_state(struct stall_cluster *cl) {
+    struct cpufreq_policy *policy;
+    unsigned long cap = 0;
+    int ret;
+
+    if (!g_data->cpu_cap)
+        return;
+
+    if (cl->state == CLASS_MEMORY) {
+        policy = cpufreq_cpu_get(cl->cpu);
+        if (!policy)
+            return;
+        cap = (unsigned long)policy->cur * 1000;
+        cpufreq_cpu_put(policy);
+    } else if (!cl->capped) {
+        return;
+    }
+
+    ret = g_data->cpu_cap(cl->cpu, cap);
+    if (ret)
+        pr_warn_ratelimited("MEM_STALL: %s cluster cap failed: %d\n", cl->name, ret);
+    else
+        cl->capped = cap != 0;
+}
+
+// Compute-bound and busy: keep cpufreq at the policy maximum (within every
+// cap), a faster core finishes sooner. Anything else lifts the floor.
+static void apply_cluster_floor(struct stall_cluster *cl) {
+    struct cpufreq_policy *policy;
+    unsigned long floor = 0;
+    int ret;
+
+    if (!g_data->cpu_floor)
+        return;
+
+    if (cl->state == CLASS_COMPUTE && cl->busy_permille >= g_data->boost_threshold) {
+        policy = cpufreq_cpu_get(cl->cpu);
+        if (!policy)
+            return;
+        floor = (unsigned long)policy->max * 1000;
+        cpufreq_cpu_put(policy);
+    }
+    if (floor == cl->floor_hz)
+        return;
+
+    ret = g_data->cpu_floor(cl->cpu, floor);
+    if (ret)
+        pr_warn_ratelimited("MEM_STALL: %s cluster floor failed: %d\n", cl->name, ret);
+    else
+        cl->floor_hz = floor;
+}
+
+static void mem_stall_work(struct work_struct *work) {
+    ktime_t now = ktime_get();
+    u64 elapsed_us = ktime_us_delta(now, g_data->last_sample);
+    bool stalled = false, growing = false;
+    int c, cpu;
+
+    g_data->last_sample = now;
+
+    for (c = 0; c < g_data->nr_clusters; c++) {
+        struct stall_cluster *cl = &g_data->cluster[c];
+        u64 sum[NR_STALL_EVENTS] = {};
+        enum stall_class class;
+
+        for_each_cpu(cpu, &cl->cpus)
+            collect(&g_data->cpu[cpu], sum);
+
+        class = classify(cl, sum, elapsed_us);
+        if (class != cl->state) {
+            if (class != cl->pending) {
+                cl->pending = class;
+                cl->pending_count = 0;
+            }
+            if (++cl->pending_count >= g_data->hold_samples) {
+                cl->state = class;
+                cl->pending_count = 0;
+                apply_cluster_state(cl);
+                sysfs_notify(g_data->kobj, cl->name, "state");
+            }
+        } else {
+            cl->pending = class;
+            cl->pending_count = 0;
+        }
+        apply_cluster_floor(cl);
+
+        if (cl->state == CLASS_MEMORY) {
+            stalled = true;
+            // Keep stepping DDR up only while stalls stay above the entry bar
+            growing |= cl->stall_permille >= g_data->stall_threshold;
+        }
+    }
+
+    if (g_data->ddr_boost) {
+        if (!stalled)
+            g_data->ddr_boost(false);
+        else if (growing && !g_data->ddr_boost(true))
+            g_data->ddr_boosts++;
+    }
+
+    queue_delayed_work(system_power_efficient_wq, &g_data->work,
+                       msecs_to_jiffies(g_data->sample_ms));
+}
+
+static int mem_stall_start(void) {
+    int ret;
+
+    ret = cpuhp_setup_state(CPUHP_AP_ONLINE_DYN, "mem_stall:online",
+                            stall_cpu_online, stall_cpu_offline);
+    if (ret < 0) {
+        pr_err("MEM_STALL: Could not start the CPU samplers: %d\n", ret);
+        return ret;
+    }
+    g_data->cpuhp_state = ret;
+
+    g_data->last_sample = ktime_get();
+    queue_delayed_work(system_power_efficient_wq, &g_data->work,
+                       msecs_to_jiffies(g_data->sample_ms));
+    return 0;
+}
+
+// Stop sampling and hand the clocks back to cpufreq and devfreq
+static void mem_stall_stop(void) {
+    int c;
+
+    if (g_data->cpuhp_state) {
+        cpuhp_remove_state(g_data->cpuhp_state);
+        g_data->cpuhp_state = 0;
+    }
+    cancel_delayed_work_sync(&g_data->work);
+    for (c = 0; c < g_data->nr_clusters; c++) {
+        g_data->cluster[c].state = CLASS_IDLE;
+        g_data->cluster[c].pending_count = 0;
+        apply_cluster_state(&g_data->cluster[c]);
+        apply_cluster_floor(&g_data->cluster[c]);
+    }
+    if (g_data->ddr_boost)
+        g_data->ddr_boost(false);
+}
+
+// Sysfs interface: tunables at the top, last sample per cluster
+static ssize_t enabled_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%d\n", g_data->enabled ? 1 : 0);
+}
+
+static ssize_t enabled_store(struct kobject *kobj, struct kobj_attribute *attr,
+                             const char *buf, size_t count) {
+    bool enable;
+    int ret;
+
+    ret = kstrtobool(buf, &enable);
+    if (ret)
+        return ret;
+
+    if (enable != g_data->enabled) {
+        if (enable) {
+            ret = mem_stall_start();
+            if (ret)
+                return ret;
+        } else {
+            mem_stall_stop();
+        }
+        g_data->enabled = enable;
+    }
+    return count;
+}
+
+static ssize_t ddr_boosts_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%u\n", g_data->ddr_boosts);
+}
+
+RADXA_TUNABLE_ATTR(sample_ms, 5, 1000);
+RADXA_TUNABLE_ATTR(stall_threshold, 1, 1000);
+RADXA_TUNABLE_ATTR(compute_threshold, 0, 1000);
+RADXA_TUNABLE_ATTR(mpki_threshold, 0, 1000);
+RADXA_TUNABLE_ATTR(busy_threshold, 0, 1000);
+RADXA_TUNABLE_ATTR(boost_threshold, 0, 1001);
+RADXA_TUNABLE_ATTR(hold_samples, 1, 100);
+
+static struct kobj_attribute enabled_attr = __ATTR_RW(enabled);
+static struct kobj_attribute ddr_boosts_attr = __ATTR_RO(ddr_boosts);
+
+static struct attribute *mem_stall_attrs[] = {
+    &enabled_attr.attr,
+    &ddr_boosts_attr.attr,
+    &sample_ms_attr.attr.attr,
+    &stall_threshold_attr.attr.attr,
+    &compute_threshold_attr.attr.attr,
+    &mpki_threshold_attr.attr.attr,
+    &busy_threshold_attr.attr.attr,
+    &boost_threshold_attr.attr.attr,
+    &hold_samples_attr.attr.attr,
+    NULL,
+};
+
+static const struct attribute_group mem_stall_group = {
+    .attrs = mem_stall_attrs,
+};
+
+struct cluster_attribute {
+    struct kobj_attribute attr;
+    int cluster;
+};
+
+#define to_cluster(a) (&g_data->cluster[container_of(a, struct cluster_attribute, attr)->cluster])
+
+static ssize_t state_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%s\n", class_names[to_cluster(attr)->state]);
+}
+
+static ssize_t busy_permille_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%u\n", to_cluster(attr)->busy_permille);
+}
+
+static ssize_t ipc_milli_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%u\n", to_cluster(attr)->ipc_milli);
+}
+
+static ssize_t stall_permille_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%u\n", to_cluster(attr)->stall_permille);
+}
+
+static ssize_t mpki_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%u\n", to_cluster(attr)->mpki);
+}
+
+#define CLUSTER_ATTR_RO(_prefix, _name, _cluster)                           \
+    static struct cluster_attribute _prefix##_##_name##_attr = {            \
+        .attr = __ATTR(_name, 0444, _name##_show, NULL),                    \
+        .cluster = _cluster,                                                \
+    }
+
+CLUSTER_ATTR_RO(e, state, CLUSTER_E);
+CLUSTER_ATTR_RO(e, busy_permille, CLUSTER_E);
+CLUSTER_ATTR_RO(e, ipc_milli, CLUSTER_E);
+CLUSTER_ATTR_RO(e, stall_permille, CLUSTER_E);
+CLUSTER_ATTR_RO(e, mpki, CLUSTER_E);
+CLUSTER_ATTR_RO(p, state, CLUSTER_P);
+CLUSTER_ATTR_RO(p, busy_permille, CLUSTER_P);
+CLUSTER_ATTR_RO(p, ipc_milli, CLUSTER_P);
+CLUSTER_ATTR_RO(p, stall_permille, CLUSTER_P);
+CLUSTER_ATTR_RO(p, mpki, CLUSTER_P);
+
+static struct attribute *efficiency_attrs[] = {
+    &e_state_attr.attr.attr,
+    &e_busy_permille_attr.attr.attr,
+    &e_ipc_milli_attr.attr.attr,
+    &e_stall_permille_attr.attr.attr,
+    &e_mpki_attr.attr.attr,
+    NULL,
+};
+
+static struct attribute *performance_attrs[] = {
+    &p_state_attr.attr.attr,
+    &p_busy_permille_attr.attr.attr,
+    &p_ipc_milli_attr.attr.attr,
+    &p_stall_permille_attr.attr.attr,
+    &p_mpki_attr.attr.attr,
+    NULL,
+};
+
+static const struct attribute_group efficiency_group = {
+    .name = "efficiency",
+    .attrs = efficiency_attrs,
+};
+
+static const struct attribute_group performance_group = {
+    .name = "performance",
+    .attrs = performance_attrs,
+};
+
+static const struct attribute_group *cluster_groups[NR_CLUSTERS] = {
+    &efficiency_group,
+    &performance_group,
+};
+
+static int __init mem_stall_init(void) {
+    int c, cpu, ret;
+
+    pr_info("MEM_STALL: Loading memory-stall governor...\n");
+
+    g_data = kzalloc(sizeof(*g_data), GFP_KERNEL);
+    if (!g_data)
+        return -ENOMEM;
+
+    g_data->enabled = true;
+    g_data->sample_ms = 20;
+    g_data->stall_threshold = 400;
+    g_data->compute_threshold = 250;
+    g_data->mpki_threshold = 5;
+    g_data->busy_threshold = 200;
+    g_data->boost_threshold = 600;
+    g_data->hold_samples = 3;
+    sample_ms_attr.value = &g_data->sample_ms;
+    stall_threshold_attr.value = &g_data->stall_threshold;
+    compute_threshold_attr.value = &g_data->compute_threshold;
+    mpki_threshold_attr.value = &g_data->mpki_threshold;
+    busy_threshold_attr.value = &g_data->busy_threshold;
+    boost_threshold_attr.value = &g_data->boost_threshold;
+    hold_samples_attr.value = &g_data->hold_samples;
+    INIT_DEFERRABLE_WORK(&g_data->work, mem_stall_work);
+    for_each_possible_cpu(cpu) {
+        g_data->cpu[cpu].cpu = cpu;
+        spin_lock_init(&g_data->cpu[cpu].lock);
+        INIT_DEFERRABLE_WORK(&g_data->cpu[cpu].work, stall_cpu_workfn);
+    }
+
+    g_data->nr_clusters = discover_clusters();
+    if (!g_data->nr_clusters) {
+        pr_err("MEM_STALL: No cpufreq policies found\n");
+        ret = -ENODEV;
+        goto err_free;
+    }
+    for (c = 0; c < g_data->nr_clusters; c++)
+        g_data->cluster[c].name = cluster_names[c];
+
+    ret = create_counters();
+    if (ret) {
+        pr_err("MEM_STALL: No PMU counters available\n");
+        goto err_free;
+    }
+
+    // Either side works on its own; whatever is loaded gets used
+    g_data->cpu_cap = symbol_get(cpu_overclock_stall_cap);
+    g_data->cpu_floor = symbol_get(cpu_overclock_stall_floor);
+    g_data->ddr_boost = symbol_get(ram_overclock_stall_boost);
+    if (!g_data->cpu_cap)
+        pr_warn("MEM_STALL: cpu_overclock not loaded, CPU clocks left alone\n");
+    if (!g_data->ddr_boost)
+        pr_warn("MEM_STALL: ram_overclock not loaded, DDR left alone\n");
+
+    g_data->kobj = kobject_create_and_add("mem_stall_governor", kernel_kobj);
+    if (!g_data->kobj) {
+        ret = -ENOMEM;
+        goto err_counters;
+    }
+
+    ret = sysfs_create_group(g_data->kobj, &mem_stall_group);
+    if (ret)
+        goto err_kobj;
+    for (c = 0; c < g_data->nr_clusters; c++) {
+        ret = sysfs_create_group(g_data->kobj, cluster_groups[c]);
+        if (ret)
+            goto err_groups;
+    }
+
+    ret = mem_stall_start();
+    if (ret)
+        goto err_groups_all;
+
+    pr_info("MEM_STALL: Sampling %d clusters every %u ms\n", g_data->nr_clusters, g_data->sample_ms);
+    pr_info("MEM_STALL: Control interface at /sys/kernel/mem_stall_governor/\n");
+    return 0;
+
+err_groups_all:
+    c = g_data->nr_clusters;
+err_groups:
+    while (--c >= 0)
+        sysfs_remove_group(g_data->kobj, cluster_groups[c]);
+    sysfs_remove_group(g_data->kobj, &mem_stall_group);
+err_kobj:
+    kobject_put(g_data->kobj);
+err_counters:
+    if (g_data->cpu_cap) symbol_put(cpu_overclock_stall_cap);
+    if (g_data->cpu_floor) symbol_put(cpu_overclock_stall_floor);
+    if (g_data->ddr_boost) symbol_put(ram_overclock_stall_boost);
+    release_counters();
+err_free:
+    kfree(g_data);
+    return ret;
+}
+
+static void __exit mem_stall_exit(void) {
+    int c;
+
+    pr_info("MEM_STALL: Unloading module...\n");
+
+    if (g_data) {
+        mem_stall_stop();
+
+        if (g_data->kobj) {
+            for (c = 0; c < g_data->nr_clusters; c++)
+                sysfs_remove_group(g_data->kobj, cluster_groups[c]);
+            sysfs_remove_group(g_data->kobj, &mem_stall_group);
+            kobject_put(g_data->kobj);
+        }
+
+        if (g_data->cpu_cap) symbol_put(cpu_overclock_stall_cap);
+        if (g_data->cpu_floor) symbol_put(cpu_overclock_stall_floor);
+        if (g_data->ddr_boost) symbol_put(ram_overclock_stall_boost);
+        release_counters();
+
+        kfree(g_data);
+    }
+
+    pr_info("MEM_STALL: Module unloaded\n");
+}
+
+module_init(mem_stall_init);
+module_exit(mem_stall_exit);
+
+MODULE_AUTHOR("Radxa Performance Team");
+MODULE_DESCRIPTION("Memory-stall aware CPU/DDR governor for A733 SoC");
+MODULE_LICENSE("GPL v2");
+MODULE_VERSION("1.0");
@@ -12,6 +12,11 @@
 #include <linux/pm_opp.h>
 #include <linux/device.h>
 #include <linux/clk.h>
+#include <linux/mutex.h>
+
+#include "radxa_clk_watch.h"
+#include "radxa_freq_stats.h"
+#include "radxa_npu_clocks.h"
 
 #define NPU_DEVICE_NAME "3600000.npu"
 
@@ -34,7 +39,25 @@ static unsigned long extreme_freqs[] = {
 };
 
 static struct device *npu_device = NULL;
-static struct clk *npu_clk = NULL;
+static struct clk *npu_clk = NULL;     // Core clock of npu_clks
+
+// NPU core, bus and reg clocks, moved together
+RADXA_NPU_CLOCKS(npu_clks);
+RADXA_NPU_RATIO_PARAM(npu_clk_ratios, npu_clks);
+MODULE_PARM_DESC(npu_clk_ratios, "NPU bus/reg rates per core band: core_mhz:bus_pct[:reg_pct],... or stock");
+
+// Residency of the core clock, devfreq does not see our changes
+static struct radxa_freq_stats *npu_stats = NULL;
+
+// Someone else (devfreq, another NPU module) changing the core clock
+static struct radxa_clk_watch npu_watch;
+RADXA_CW_POLICY_PARAM(drift_policy);
+MODULE_PARM_DESC(drift_policy, "On external clock changes: log or reassert");
+
+// Rate changes are serialized; the result is published for readers, who
+// then stay off the clock framework's prepare lock
+static DEFINE_MUTEX(npu_rate_lock);
+static unsigned long npu_cur_hz = 0;
 
 // Direct frequency control bypassing devfreq
 static int direct_set_frequency(unsigned long target_freq)
@@ -51,16 +74,26 @@ static int direct_set_frequency(unsigned long target_freq)
             target_freq/1000000, (float)target_freq/1000000/1008*1.0);
     
     // Set clock frequency directly
-    ret = clk_set_rate(npu_clk, target_freq);
+    mutex_lock(&npu_rate_lock);
+    radxa_cw_begin(&npu_watch);
+    ret = radxa_npu_set_rate(&npu_clks, target_freq);
+    radxa_cw_end(&npu_watch, ret ? 0 : target_freq);
     if (ret) {
         pr_err("Extreme clock set failed: %d\n", ret);
+        radxa_fs_failed(npu_stats);
+        mutex_unlock(&npu_rate_lock);
         return ret;
     }
     
     // Verify the frequency was set
     actual_freq = clk_get_rate(npu_clk);
-    pr_info("EXTREME OVERCLOCK SUCCESS! Target: %luMHz, Actual: %luMHz\n", 
-            target_freq/1000000, actual_freq/1000000);
+    radxa_fs_update(npu_stats, actual_freq);
+    WRITE_ONCE(npu_cur_hz, actual_freq);
+    mutex_unlock(&npu_rate_lock);
+    pr_info("EXTREME OVERCLOCK SUCCESS! Target: %luMHz, Actual: %luMHz (bus %luMHz, reg %luMHz)\n", 
+            target_freq/1000000, actual_freq/1000000,
+            radxa_npu_rate(&npu_clks, RADXA_NPU_CLK_BUS)/1000000,
+            radxa_npu_rate(&npu_clks, RADXA_NPU_CLK_REG)/1000000);
     
     return 0;
 }
@@ -69,20 +102,18 @@ static int direct_set_frequency(unsigned long target_freq)
 static ssize_t extreme_overclock_show(struct device *dev,
                                      struct device_attribute *attr, char *buf)
 {
-    unsigned long current_freq = 0;
-    
-    if (npu_clk) {
-        current_freq = clk_get_rate(npu_clk);
-    }
+    unsigned long current_freq = READ_ONCE(npu_cur_hz);
     
     return sprintf(buf, "NPU EXTREME Overclock Control - TARGET: 2.7+ TOPS!\n"
                         "Current: %lu MHz (~%.1f TOPS)\n"
+                        "External changes: %u (drift_policy %s)\n"
                         "EXTREME Frequencies Available:\n"
                         "1488, 1600, 1800, 2000, 2200, 2400, 2700, 3000 MHz\n"
                         "Usage: echo <freq_mhz> > extreme_overclock\n"
                         "TARGET: echo 2700 > extreme_overclock  # 2.7 TOPS!\n",
                         current_freq/1000000, 
-                        (float)current_freq/1000000/1008*1.0);
+                        (float)current_freq/1000000/1008*1.0,
+                        radxa_cw_drift_count(&npu_watch), radxa_cw_policies[drift_policy]);
 }
 
 static ssize_t extreme_overclock_store(struct device *dev,
@@ -180,27 +211,34 @@ static int find_npu_resources(void)
     npu_device = dev;
     pr_info("Found NPU device for EXTREME overclocking\n");
     
-    // Try to get NPU clock for direct control
-    npu_clk = clk_get(dev, NULL);
-    if (IS_ERR(npu_clk)) {
-        npu_clk = clk_get(dev, "npu");
-        if (IS_ERR(npu_clk)) {
-            npu_clk = clk_get(dev, "core");
-            if (IS_ERR(npu_clk)) {
-                pr_warn("Could not get NPU clock directly\n");
-                npu_clk = NULL;
-            }
-        }
-    }
-    
-    if (npu_clk) {
-        unsigned long current_rate = clk_get_rate(npu_clk);
-        pr_info("NPU clock found! Current rate: %lu MHz\n", current_rate/1000000);
+    // Try to get NPU clocks for direct control
+    if (radxa_npu_clocks_get(&npu_clks, dev)) {
+        pr_warn("Could not get NPU clock directly\n");
+    } else {
+        npu_clk = npu_clks.clk[RADXA_NPU_CLK_CORE];
+        npu_cur_hz = clk_get_rate(npu_clk);
+        pr_info("NPU clock found! Current rate: %lu MHz, bus %lu MHz, reg %lu MHz\n",
+                clk_get_rate(npu_clk)/1000000,
+                radxa_npu_rate(&npu_clks, RADXA_NPU_CLK_BUS)/1000000,
+                radxa_npu_rate(&npu_clks, RADXA_NPU_CLK_REG)/1000000);
     }
     
     return 0;
 }
 
+static void npu_drifted(struct radxa_clk_watch *w, unsigned long hz)
+{
+    mutex_lock(&npu_rate_lock);
+    radxa_fs_update(npu_stats, hz);
+    WRITE_ONCE(npu_cur_hz, hz);
+    mutex_unlock(&npu_rate_lock);
+}
+
+static int npu_reassert(struct radxa_clk_watch *w, unsigned long hz)
+{
+    return direct_set_frequency(hz);
+}
+
 static int __init npu_extreme_overclock_init(void)
 {
     int ret;
@@ -218,11 +256,17 @@ static int __init npu_extreme_overclock_init(void)
     ret = device_create_file(npu_device, &dev_attr_extreme_overclock);
     if (ret) {
         pr_err("Failed to create extreme_overclock interface: %d\n", ret);
-        if (npu_clk) clk_put(npu_clk);
+        radxa_npu_clocks_put(&npu_clks);
         put_device(npu_device);
         return ret;
     }
     
+    npu_stats = radxa_fs_create(&npu_device->kobj, "extreme_freq_stats", clk_get_rate(npu_clk));
+    npu_watch.drifted = npu_drifted;
+    npu_watch.reassert = npu_reassert;
+    if (radxa_cw_register(&npu_watch, npu_clk, "NPU", &drift_policy))
+        pr_warn("Cannot watch the NPU clock for changes\n");
+    
     pr_info("NPU EXTREME OVERCLOCK LOADED!\n");
     pr_info("Interface: /sys/devices/platform/soc@3000000/3600000.npu/extreme_overclock\n");
     pr_info("TARGET COMMAND: echo 2700 > extreme_overclock  # 2.7 TOPS!\n");
@@ -234,14 +278,14 @@ static int __init npu_extreme_overclock_init(void)
 
 static void __exit npu_extreme_overclock_exit(void)
 {
+    radxa_cw_unregister(&npu_watch);
     if (npu_device) {
+        radxa_fs_destroy(npu_stats);
         device_remove_file(npu_device, &dev_attr_extreme_overclock);
         put_device(npu_device);
     }
     
-    if (npu_clk) {
-        clk_put(npu_clk);
-    }
+    radxa_npu_clocks_put(&npu_clks);
     
     pr_info("NPU EXTREME OVERCLOCK MODULE UNLOADED\n");
 }
@@ -0,0 +1,601 @@
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/cpu.h>
+#include <linux/cpufreq.h>
+#include <linux/energy_model.h>
+#include <linux/platform_device.h>
+#include <linux/pm_qos.h>
+#include <linux/pm_runtime.h>
+#include <linux/clk.h>
+#include <linux/thermal.h>
+#include <linux/workqueue.h>
+#include <linux/sysfs.h>
+#include <linux/kobject.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+
+#include "radxa_energy_model.h"
+#include "radxa_cpu_clusters.h"
+#include "radxa_tunable.h"
+
+#define MODULE_NAME "power_arbiter"
+#define GPU_DEVICE_NAME "1800000.gpu"
+#define NPU_DEVICE_NAME "3600000.npu"
+#define WEIGHT_UNIT 1024
+
+// Thermal zone whose temperature trims the budget
+static char *thermal_zone = "cpu-thermal";
+module_param(thermal_zone, charp, 0444);
+MODULE_PARM_DESC(thermal_zone, "Thermal zone for control_temp");
+
+enum arb_domain_id {
+    DOM_CPU_E,
+    DOM_CPU_P,
+    DOM_GPU,
+    DOM_NPU,
+    NR_DOMAINS,
+};
+
+static const char * const domain_names[NR_DOMAINS] = { "efficiency", "performance", "gpu", "npu" };
+
+struct arb_domain {
+    const char *name;
+    bool present;
+    int cpu;                        // First CPU of the cluster, -1 for GPU/NPU
+    cpumask_t cpus;
+    struct device *dev;             // GPU/NPU platform device
+    struct clk *clk;                // GPU/NPU core clock, for the current rate
+    struct freq_qos_request cpu_req;
+    struct dev_pm_qos_request dev_req;
+    u64 last_suspended_ns;          // GPU/NPU runtime-PM bookkeeping
+    u64 last_sample_ns;
+    unsigned int weight;
+    // Last control period
+    unsigned int load;              // Per mille, summed over the CPUs of a cluster
+    unsigned int peak;              // Busiest CPU (cluster) or the device, per mille
+    unsigned int cur_khz;
+    unsigned long min_mw, max_mw;   // Lowest and highest state at the measured load
+    unsigned long request_mw;
+    unsigned long granted_mw;
+    unsigned int cap_khz;
+};
+
+struct power_arbiter_data {
+    struct arb_domain domain[NR_DOMAINS];
+    u64 cpu_idle_us[NR_CPUS];
+    u64 cpu_wall_us[NR_CPUS];
+    struct thermal_zone_device *tz;
+    struct delayed_work work;
+    struct kobject *kobj;
+    bool enabled;
+    unsigned int period_ms;
+    unsigned int budget_mw;         // Total for CPU, GPU and NPU
+    unsigned int control_temp;      // m°C, 0 = no thermal trim
+    unsigned int k_p;               // mW taken off per °C above control_temp
+    unsigned int busy_threshold;    // A domain this busy asks for its top state, per mille
+    unsigned long allocated_mw;     // Budget of the last period after the thermal trim
+    int temp;
+};
+
+static struct power_arbiter_data *g_data;
+
+// Clusters as cpu_overclock sees them, in DOM_CPU_E and DOM_CPU_P
+static int discover_clusters(void) {
+    struct radxa_cpu_cluster found[2];
+    struct arb_domain *cl = &g_data->domain[DOM_CPU_E];
+    int c, nr = min(radxa_discover_clusters(found, 2), 2);
+
+    for (c = 0; c < 2; c++) {
+        cl[c].cpu = found[c].cpu;
+        cpumask_copy(&cl[c].cpus, &found[c].cpus);
+    }
+    return nr;
+}
+
+static struct em_perf_domain *domain_em(struct arb_domain *d) {
+    // Looked up every period: llm_unified_overclock rebuilds the GPU/NPU
+    // perf domains when it adds OPPs
+    return d->cpu >= 0 ? em_cpu_get(d->cpu) : em_pd_get(d->dev);
+}
+
+static void sample_cpu_load(struct arb_domain *d) {
+    int cpu;
+
+    d->load = 0;
+    d->peak = 0;
+    for_each_cpu_and(cpu, &d->cpus, cpu_online_mask) {
+        u64 wall, idle = get_cpu_idle_time(cpu, &wall, 0);
+        u64 dwall = wall - g_data->cpu_wall_us[cpu];
+        u64 didle = idle - g_data->cpu_idle_us[cpu];
+        unsigned int load = 0;
+
+        if (dwall && didle < dwall)
+            load = div64_u64((dwall - didle) * 1000, dwall);
+        g_data->cpu_wall_us[cpu] = wall;
+        g_data->cpu_idle_us[cpu] = idle;
+        d->load += load;
+        d->peak = max(d->peak, load);
+    }
+    d->cur_khz = cpufreq_quick_get(d->cpu);
+}
+
+// The GPU and NPU are busy while runtime-active: both drivers suspend
+// them between jobs (NPU: see idle_gate_ms in llm_unified_overclock)
+static void sample_device_load(struct arb_domain *d) {
+    u64 now = ktime_get_ns(), suspended = pm_runtime_suspended_time(d->dev);
+    u64 dwall = now - d->last_sample_ns;
+    u64 dsusp = suspended - d->last_suspended_ns;
+
+    d->load = dwall && dsusp < dwall ? div64_u64((dwall - dsusp) * 1000, dwall) : 0;
+    d->peak = d->load;
+    d->last_sample_ns = now;
+    d->last_suspended_ns = suspended;
+    d->cur_khz = clk_get_rate(d->clk) / 1000;
+}
+
+// What the domain would burn at its current load. A domain at or above
+// busy_threshold is the bottleneck and asks for its top state.
+static void update_request(struct arb_domain *d, struct em_perf_domain *pd) {
+    // Never assume less than one busy unit, or an idle domain gets
+    // everything for free the moment work arrives
+    unsigned int load = max(d->load, 1000U);
+    unsigned long cur_mw = radxa_em_power_at(pd, d->cur_khz);
+
+    d->min_mw = pd->table[0].power * load / 1000;
+    d->max_mw = pd->table[pd->nr_perf_states - 1].power * load / 1000;
+    if (d->peak >= g_data->busy_threshold)
+        d->request_mw = d->max_mw;
+    else
+        d->request_mw = cur_mw * d->load / 1000;
+}
+
+// IPA's split: every domain gets its lowest state, the rest goes out in
+// proportion to the weighted requests, and what a domain cannot use is
+// handed to the others by their remaining room
+static void divvy_up(unsigned long budget) {
+    unsigned long spare = 0, extra = 0, total_room = 0;
+    u64 total_req = 0;
+    int i, nr = 0;
+
+    for (i = 0; i < NR_DOMAINS; i++) {
+        struct arb_domain *d = &g_data->domain[i];
+
+        if (!d->present)
+            continue;
+        d->granted_mw = d->min_mw;
+        spare += d->min_mw;
+        total_req += (u64)d->request_mw * d->weight;
+        nr++;
+    }
+    spare = budget > spare ? budget - spare : 0;
+
+    for (i = 0; i < NR_DOMAINS; i++) {
+        struct arb_domain *d = &g_data->domain[i];
+        u64 share;
+
+        if (!d->present)
+            continue;
+        share = total_req ? div64_u64((u64)d->request_mw * d->weight * spare, total_req) : spare / nr;
+        d->granted_mw += share;
+        if (d->granted_mw > d->max_mw) {
+            extra += d->granted_mw - d->max_mw;
+            d->granted_mw = d->max_mw;
+        }
+        total_room += d->max_mw - d->granted_mw;
+    }
+
+    for (i = 0; i < NR_DOMAINS && extra && total_room; i++) {
+        struct arb_domain *d = &g_data->domain[i];
+
+        if (d->present)
+            d->granted_mw += div64_u64((u64)extra * (d->max_mw - d->granted_mw), total_room);
+    }
+}
+
+// Highest state whose power at the measured load fits the grant
+static unsigned int grant_to_khz(struct arb_domain *d, struct em_perf_domain *pd) {
+    unsigned int load = max(d->load, 1000U);
+    int i;
+
+    for (i = pd->nr_perf_states - 1; i > 0; i--)
+        if (pd->table[i].power * load / 1000 <= d->granted_mw)
+            break;
+    return pd->table[i].frequency;
+}
+
+static void apply_cap(struct arb_domain *d, unsigned int khz) {
+    int ret;
+
+    if (khz == d->cap_khz)
+        return;
+    if (d->cpu >= 0)
+        ret = freq_qos_update_request(&d->cpu_req, khz ? khz : FREQ_QOS_MAX_DEFAULT_VALUE);
+    else
+        ret = dev_pm_qos_update_request(&d->dev_req, khz ? khz : PM_QOS_MAX_FREQUENCY_DEFAULT_VALUE);
+    if (ret < 0) {
+        pr_warn_ratelimited("POWER_ARB: %s cap failed: %d\n", d->name, ret);
+        return;
+    }
+    d->cap_khz = khz;
+    sysfs_notify(g_data->kobj, d->name, "cap_khz");
+}
+
+static unsigned long current_budget(void) {
+    unsigned long budget = g_data->budget_mw;
+    int temp, over;
+
+    if (!g_data->tz || !g_data->control_temp)
+        return budget;
+    if (thermal_zone_get_temp(g_data->tz, &temp)) {
+        pr_warn_ratelimited("POWER_ARB: Cannot read %s, no thermal trim\n", thermal_zone);
+        return budget;
+    }
+    g_data->temp = temp;
+    over = temp - (int)g_data->control_temp;
+    if (over <= 0)
+        return budget;
+    return budget - min_t(unsigned long, budget, (unsigned long)over * g_data->k_p / 1000);
+}
+
+static void arbiter_work(struct work_struct *work) {
+    struct em_perf_domain *pd[NR_DOMAINS] = {};
+    int i;
+
+    for (i = 0; i < NR_DOMAINS; i++) {
+        struct arb_domain *d = &g_data->domain[i];
+
+        if (!d->present)
+            continue;
+        if (d->cpu >= 0)
+            sample_cpu_load(d);
+        else
+            sample_device_load(d);
+        pd[i] = domain_em(d);
+        // No power model (yet): left out of this period
+        if (!pd[i]) {
+            d->request_mw = d->min_mw = d->max_mw = 0;
+            continue;
+        }
+        update_request(d, pd[i]);
+    }
+
+    g_data->allocated_mw = current_budget();
+    divvy_up(g_data->allocated_mw);
+
+    for (i = 0; i < NR_DOMAINS; i++) {
+        struct arb_domain *d = &g_data->domain[i];
+
+        if (d->present && pd[i])
+            apply_cap(d, grant_to_khz(d, pd[i]));
+    }
+
+    queue_delayed_work(system_power_efficient_wq, &g_data->work,
+                       msecs_to_jiffies(g_data->period_ms));
+}
+
+static void arbiter_start(void) {
+    queue_delayed_work(system_power_efficient_wq, &g_data->work,
+                       msecs_to_jiffies(g_data->period_ms));
+}
+
+// Stop arbitrating and lift every cap
+static void arbiter_stop(void) {
+    int i;
+
+    cancel_delayed_work_sync(&g_data->work);
+    for (i = 0; i < NR_DOMAINS; i++)
+        if (g_data->domain[i].present)
+            apply_cap(&g_data->domain[i], 0);
+}
+
+static int setup_cpu_domain(struct arb_domain *d) {
+    struct cpufreq_policy *policy = cpufreq_cpu_get(d->cpu);
+    int ret;
+
+    if (!policy)
+        return -ENODEV;
+    ret = freq_qos_add_request(&policy->constraints, &d->cpu_req, FREQ_QOS_MAX,
+                               FREQ_QOS_MAX_DEFAULT_VALUE);
+    cpufreq_cpu_put(policy);
+    return ret < 0 ? ret : 0;
+}
+
+static int setup_device_domain(struct arb_domain *d, const char *dev_name) {
+    int ret;
+
+    d->cpu = -1;
+    d->dev = bus_find_device_by_name(&platform_bus_type, NULL, dev_name);
+    if (!d->dev)
+        return -ENODEV;
+    d->clk = clk_get(d->dev, "core");
+    if (IS_ERR(d->clk)) {
+        ret = PTR_ERR(d->clk);
+        goto err_dev;
+    }
+    // Honoured by devfreq, and for the NPU by llm_unified_overclock
+    ret = dev_pm_qos_add_request(d->dev, &d->dev_req, DEV_PM_QOS_MAX_FREQUENCY,
+                                 PM_QOS_MAX_FREQUENCY_DEFAULT_VALUE);
+    if (ret < 0)
+        goto err_clk;
+    d->last_sample_ns = ktime_get_ns();
+    d->last_suspended_ns = pm_runtime_suspended_time(d->dev);
+    return 0;
+
+err_clk:
+    clk_put(d->clk);
+err_dev:
+    put_device(d->dev);
+    return ret;
+}
+
+static void release_domains(void) {
+    int i;
+
+    for (i = 0; i < NR_DOMAINS; i++) {
+        struct arb_domain *d = &g_data->domain[i];
+
+        if (!d->present)
+            continue;
+        if (d->cpu >= 0) {
+            freq_qos_remove_request(&d->cpu_req);
+        } else {
+            dev_pm_qos_remove_request(&d->dev_req);
+            clk_put(d->clk);
+            put_device(d->dev);
+        }
+        d->present = false;
+    }
+}
+
+// Sysfs interface: tunables at the top, last period per domain
+static ssize_t enabled_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%d\n", g_data->enabled ? 1 : 0);
+}
+
+static ssize_t enabled_store(struct kobject *kobj, struct kobj_attribute *attr,
+                             const char *buf, size_t count) {
+    bool enable;
+    int ret;
+
+    ret = kstrtobool(buf, &enable);
+    if (ret)
+        return ret;
+
+    if (enable != g_data->enabled) {
+        g_data->enabled = enable;
+        if (enable)
+            arbiter_start();
+        else
+            arbiter_stop();
+    }
+    return count;
+}
+
+static ssize_t allocated_mw_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%lu\n", g_data->allocated_mw);
+}
+
+static ssize_t temp_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%d\n", g_data->temp);
+}
+
+RADXA_TUNABLE_ATTR(period_ms, 10, 1000);
+RADXA_TUNABLE_ATTR(budget_mw, 100, 100000);
+RADXA_TUNABLE_ATTR(control_temp, 0, 125000);
+RADXA_TUNABLE_ATTR(k_p, 0, 100000);
+RADXA_TUNABLE_ATTR(busy_threshold, 1, 1000);
+
+static struct kobj_attribute enabled_attr = __ATTR_RW(enabled);
+static struct kobj_attribute allocated_mw_attr = __ATTR_RO(allocated_mw);
+static struct kobj_attribute temp_attr = __ATTR_RO(temp);
+
+static struct attribute *power_arbiter_attrs[] = {
+    &enabled_attr.attr,
+    &allocated_mw_attr.attr,
+    &temp_attr.attr,
+    &period_ms_attr.attr.attr,
+    &budget_mw_attr.attr.attr,
+    &control_temp_attr.attr.attr,
+    &k_p_attr.attr.attr,
+    &busy_threshold_attr.attr.attr,
+    NULL,
+};
+
+static const struct attribute_group power_arbiter_group = {
+    .attrs = power_arbiter_attrs,
+};
+
+struct domain_attribute {
+    struct kobj_attribute attr;
+    int domain;
+};
+
+#define to_domain(a) (&g_data->domain[container_of(a, struct domain_attribute, attr)->domain])
+
+static ssize_t load_permille_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%u\n", to_domain(attr)->load);
+}
+
+static ssize_t cur_khz_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%u\n", to_domain(attr)->cur_khz);
+}
+
+static ssize_t request_mw_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%lu\n", to_domain(attr)->request_mw);
+}
+
+static ssize_t granted_mw_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%lu\n", to_domain(attr)->granted_mw);
+}
+
+static ssize_t cap_khz_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%u\n", to_domain(attr)->cap_khz);
+}
+
+static ssize_t weight_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%u\n", to_domain(attr)->weight);
+}
+
+static ssize_t weight_store(struct kobject *kobj, struct kobj_attribute *attr,
+                            const char *buf, size_t count) {
+    unsigned int value;
+    int ret;
+
+    ret = kstrtouint(buf, 10, &value);
+    if (ret)
+        return ret;
+    if (value > 64 * WEIGHT_UNIT)
+        return -EINVAL;
+
+    to_domain(attr)->weight = value;
+    return count;
+}
+
+#define DOMAIN_ATTR_RO(_prefix, _name, _domain)                             \
+    static struct domain_attribute _prefix##_##_name##_attr = {             \
+        .attr = __ATTR(_name, 0444, _name##_show, NULL),                    \
+        .domain = _domain,                                                  \
+    }
+
+#define DOMAIN_ATTR_RW(_prefix, _name, _domain)                             \
+    static struct domain_attribute _prefix##_##_name##_attr = {             \
+        .attr = __ATTR(_name, 0664, _name##_show, _name##_store),           \
+        .domain = _domain,                                                  \
+    }
+
+#define DOMAIN_ATTRS(_prefix, _domain)                                      \
+    DOMAIN_ATTR_RO(_prefix, load_permille, _domain);                        \
+    DOMAIN_ATTR_RO(_prefix, cur_khz, _domain);                              \
+    DOMAIN_ATTR_RO(_prefix, request_mw, _domain);                           \
+    DOMAIN_ATTR_RO(_prefix, granted_mw, _domain);                           \
+    DOMAIN_ATTR_RO(_prefix, cap_khz, _domain);                              \
+    DOMAIN_ATTR_RW(_prefix, weight, _domain);                               \
+    static struct attribute *_prefix##_attrs[] = {                          \
+        &_prefix##_load_permille_attr.attr.attr,                            \
+        &_prefix##_cur_khz_attr.attr.attr,                                  \
+        &_prefix##_request_mw_attr.attr.attr,                               \
+        &_prefix##_granted_mw_attr.attr.attr,                               \
+        &_prefix##_cap_khz_attr.attr.attr,                                  \
+        &_prefix##_weight_attr.attr.attr,                                   \
+        NULL,                                                               \
+    }
+
+DOMAIN_ATTRS(e, DOM_CPU_E);
+DOMAIN_ATTRS(p, DOM_CPU_P);
+DOMAIN_ATTRS(gpu, DOM_GPU);
+DOMAIN_ATTRS(npu, DOM_NPU);
+
+static const struct attribute_group domain_groups[NR_DOMAINS] = {
+    { .name = "efficiency", .attrs = e_attrs },
+    { .name = "performance", .attrs = p_attrs },
+    { .name = "gpu", .attrs = gpu_attrs },
+    { .name = "npu", .attrs = npu_attrs },
+};
+
+static int __init power_arbiter_init(void) {
+    int i, nr_clusters, ret;
+
+    pr_info("POWER_ARB: Loading CPU/GPU/NPU power arbiter...\n");
+
+    g_data = kzalloc(sizeof(*g_data), GFP_KERNEL);
+    if (!g_data)
+        return -ENOMEM;
+
+    g_data->enabled = true;
+    g_data->period_ms = 50;
+    g_data->budget_mw = 8000;
+    g_data->control_temp = 85000;
+    g_data->k_p = 500;
+    g_data->busy_threshold = 900;
+    period_ms_attr.value = &g_data->period_ms;
+    budget_mw_attr.value = &g_data->budget_mw;
+    control_temp_attr.value = &g_data->control_temp;
+    k_p_attr.value = &g_data->k_p;
+    busy_threshold_attr.value = &g_data->busy_threshold;
+    INIT_DELAYED_WORK(&g_data->work, arbiter_work);
+
+    nr_clusters = discover_clusters();
+    for (i = 0; i < NR_DOMAINS; i++) {
+        struct arb_domain *d = &g_data->domain[i];
+
+        d->name = domain_names[i];
+        d->weight = WEIGHT_UNIT;
+        if (i < DOM_GPU)
+            ret = i < nr_clusters ? setup_cpu_domain(d) : -ENODEV;
+        else
+            ret = setup_device_domain(d, i == DOM_GPU ? GPU_DEVICE_NAME : NPU_DEVICE_NAME);
+        if (ret)
+            pr_warn("POWER_ARB: %s left out: %d\n", d->name, ret);
+        d->present = !ret;
+    }
+
+    g_data->tz = thermal_zone_get_zone_by_name(thermal_zone);
+    if (IS_ERR(g_data->tz)) {
+        pr_warn("POWER_ARB: Thermal zone %s not found: %ld, fixed budget without thermal trim\n",
+                thermal_zone, PTR_ERR(g_data->tz));
+        g_data->tz = NULL;
+    }
+
+    g_data->kobj = kobject_create_and_add(MODULE_NAME, kernel_kobj);
+    if (!g_data->kobj) {
+        ret = -ENOMEM;
+        goto err_domains;
+    }
+
+    ret = sysfs_create_group(g_data->kobj, &power_arbiter_group);
+    if (ret)
+        goto err_kobj;
+    for (i = 0; i < NR_DOMAINS; i++) {
+        ret = sysfs_create_group(g_data->kobj, &domain_groups[i]);
+        if (ret)
+            goto err_groups;
+    }
+
+    arbiter_start();
+
+    pr_info("POWER_ARB: %u mW shared every %u ms\n", g_data->budget_mw, g_data->period_ms);
+    pr_info("POWER_ARB: Control interface at /sys/kernel/power_arbiter/\n");
+    return 0;
+
+err_groups:
+    while (--i >= 0)
+        sysfs_remove_group(g_data->kobj, &domain_groups[i]);
+    sysfs_remove_group(g_data->kobj, &power_arbiter_group);
+err_kobj:
+    kobject_put(g_data->kobj);
+err_domains:
+    release_domains();
+    kfree(g_data);
+    return ret;
+}
+
+static void __exit power_arbiter_exit(void) {
+    int i;
+
+    pr_info("POWER_ARB: Unloading module...\n");
+
+    if (g_data) {
+        arbiter_stop();
+
+        if (g_data->kobj) {
+            for (i = 0; i < NR_DOMAINS; i++)
+                sysfs_remove_group(g_data->kobj, &domain_groups[i]);
+            sysfs_remove_group(g_data->kobj, &power_arbiter_group);
+            kobject_put(g_data->kobj);
+        }
+
+        release_domains();
+        kfree(g_data);
+    }
+
+    pr_info("POWER_ARB: Module unloaded\n");
+}
+
+module_init(power_arbiter_init);
+module_exit(power_arbiter_exit);
+
+MODULE_AUTHOR("Radxa Performance Team");
+MODULE_DESCRIPTION("Shared CPU/GPU/NPU power budget arbiter for A733 SoC");
+MODULE_LICENSE("GPL v2");
+MODULE_VERSION("1.0");
@@ -0,0 +1,217 @@
+/*
+ * RADXA OVERCLOCK - CLOCK DRIFT WATCH
+ *
+ * cpufreq, devfreq or another loaded module can change a clock after we
+ * set it, and nothing told us. A watch is a rate-change notifier on a
+ * clock we set directly. Changes made between radxa_cw_begin() and
+ * radxa_cw_end() are ours; any other change is drift: it is counted,
+ * logged with the task that made it, and handed to the module's drifted()
+ * callback. Under the "reassert" policy the target rate is then set
+ * again through the module's reassert() callback, at most
+ * RADXA_CW_MAX_REASSERTS times a second so two owners cannot fight
+ * forever.
+ *
+ * Both callbacks run from a work item, never in the notifier.
+ *
+ * Kernel-only, included by the overclocking modules.
+ */
+
+#ifndef RADXA_CLK_WATCH_H
+#define RADXA_CLK_WATCH_H
+
+#include <linux/atomic.h>
+#include <linux/clk.h>
+#include <linux/jiffies.h>
+#include <linux/moduleparam.h>
+#include <linux/notifier.h>
+#include <linux/sched.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/workqueue.h>
+
+#define RADXA_CW_MAX_REASSERTS 3
+
+enum radxa_cw_policy {
+    RADXA_CW_LOG,
+    RADXA_CW_REASSERT,
+};
+
+static const char * const radxa_cw_policies[] = { "log", "reassert" };
+
+struct radxa_clk_watch {
+    struct notifier_block nb;
+    struct work_struct work;
+    struct clk *clk;                    // NULL: not registered
+    const char *name;                   // For the log
+    const int *policy;                  // A RADXA_CW_POLICY_PARAM
+    atomic_t own;                       // Our own rate changes in flight
+    unsigned long target_hz;            // Rate to re-assert, 0: none
+    spinlock_t lock;                    // The offender record
+    unsigned int drift_count;
+    char offender[TASK_COMM_LEN];
+    pid_t offender_pid;
+    unsigned long old_hz, new_hz;
+    unsigned long window_start;         // jiffies, re-assert rate limit
+    unsigned int window_reasserts;
+    void (*drifted)(struct radxa_clk_watch *w, unsigned long hz);
+    int (*reassert)(struct radxa_clk_watch *w, unsigned long hz);
+};
+
+static inline void radxa_cw_begin(struct radxa_clk_watch *w)
+{
+    atomic_inc(&w->own);
+}
+
+// hz: the rate to defend from now on, 0 to keep the last one
+static inline void radxa_cw_end(struct radxa_clk_watch *w, unsigned long hz)
+{
+    if (hz)
+        WRITE_ONCE(w->target_hz, hz);
+    atomic_dec(&w->own);
+}
+
+// Program clk at hz again after the hardware lost it (suspend, cluster
+// power-down). The clock framework still caches hz, which makes a plain
+// clk_set_rate(hz) a no-op, so go through hz / 2 first. The supply must
+// already be at the voltage for hz.
+static inline int radxa_cw_reprogram(struct radxa_clk_watch *w, struct clk *clk,
+                                     unsigned long hz)
+{
+    int ret;
+
+    radxa_cw_begin(w);
+    ret = clk_set_rate(clk, hz / 2);
+    if (!ret)
+        ret = clk_set_rate(clk, hz);
+    radxa_cw_end(w, 0);
+    return ret;
+}
+
+static inline void radxa_cw_work_fn(struct work_struct *work)
+{
+    struct radxa_clk_watch *w = container_of(work, struct radxa_clk_watch, work);
+    unsigned long target = READ_ONCE(w->target_hz);
+    unsigned long hz = clk_get_rate(w->clk);
+
+    if (w->drifted)
+        w->drifted(w, hz);
+
+    // Tolerate PLL rounding, like the rate_misses check
+    if (READ_ONCE(*w->policy) != RADXA_CW_REASSERT || !target || !w->reassert ||
+        abs((long)(hz - target)) <= target / 100)
+        return;
+
+    if (time_after(jiffies, w->window_start + HZ)) {
+        w->window_start = jiffies;
+        w->window_reasserts = 0;
+    }
+    if (++w->window_reasserts > RADXA_CW_MAX_REASSERTS) {
+        pr_warn_ratelimited("RADXA_OC: %s keeps being changed by %s, not re-asserting\n",
+                            w->name, w->offender);
+        return;
+    }
+    pr_info("RADXA_OC: Re-asserting %s at %lu MHz\n", w->name, target / 1000000);
+    w->reassert(w, target);
+}
+
+static inline int radxa_cw_notify(struct notifier_block *nb, unsigned long event, void *data)
+{
+    struct radxa_clk_watch *w = container_of(nb, struct radxa_clk_watch, nb);
+    struct clk_notifier_data *cnd = data;
+
+    if (event != POST_RATE_CHANGE || atomic_read(&w->own) ||
+        cnd->old_rate == cnd->new_rate)
+        return NOTIFY_DONE;
+
+    spin_lock(&w->lock);
+    w->drift_count++;
+    get_task_comm(w->offender, current);
+    w->offender_pid = task_pid_nr(current);
+    w->old_hz = cnd->old_rate;
+    w->new_hz = cnd->new_rate;
+    spin_unlock(&w->lock);
+
+    pr_warn_ratelimited("RADXA_OC: %s changed behind our back by %s[%d]: %lu -> %lu MHz\n",
+                        w->name, current->comm, task_pid_nr(current),
+                        cnd->old_rate / 1000000, cnd->new_rate / 1000000);
+    schedule_work(&w->work);
+    return NOTIFY_OK;
+}
+
+// Start watching clk; the target is the current rate until radxa_cw_end()
+static inline int radxa_cw_register(struct radxa_clk_watch *w, struct clk *clk,
+                                    const char *name, const int *policy)
+{
+    int ret;
+
+    if (!clk)
+        return -ENODEV;
+    INIT_WORK(&w->work, radxa_cw_work_fn);
+    spin_lock_init(&w->lock);
+    atomic_set(&w->own, 0);
+    w->name = name;
+    w->policy = policy;
+    w->target_hz = clk_get_rate(clk);
+    w->nb.notifier_call = radxa_cw_notify;
+    ret = clk_notifier_register(clk, &w->nb);
+    if (ret)
+        return ret;
+    w->clk = clk;
+    return 0;
+}
+
+static inline void radxa_cw_unregister(struct radxa_clk_watch *w)
+{
+    if (!w->clk)
+        return;
+    clk_notifier_unregister(w->clk, &w->nb);
+    cancel_work_sync(&w->work);
+    w->clk = NULL;
+}
+
+static inline unsigned int radxa_cw_drift_count(struct radxa_clk_watch *w)
+{
+    return READ_ONCE(w->drift_count);
+}
+
+// "comm[pid] old_hz new_hz" of the last drift, "none" before the first
+// or for a clock that is not watched
+static inline ssize_t radxa_cw_offender_show(struct radxa_clk_watch *w, char *buf)
+{
+    ssize_t len;
+
+    if (!w->clk)
+        return sprintf(buf, "none\n");
+    spin_lock(&w->lock);
+    if (w->drift_count)
+        len = sprintf(buf, "%s[%d] %lu %lu\n", w->offender, w->offender_pid,
+                      w->old_hz, w->new_hz);
+    else
+        len = sprintf(buf, "none\n");
+    spin_unlock(&w->lock);
+    return len;
+}
+
+// Module parameter "log" or "reassert", shared by the module's watches
+#define RADXA_CW_POLICY_PARAM(_name)                                        \
+    static int _name = RADXA_CW_LOG;                                        \
+    static int _name##_set(const char *val, const struct kernel_param *kp)  \
+    {                                                                       \
+        int i = sysfs_match_string(radxa_cw_policies, val);                 \
+                                                                            \
+        if (i < 0)                                                          \
+            return i;                                                       \
+        WRITE_ONCE(_name, i);                                               \
+        return 0;                                                           \
+    }                                                                       \
+    static int _name##_get(char *buf, const struct kernel_param *kp)        \
+    {                                                                       \
+        return sprintf(buf, "%s\n", radxa_cw_policies[READ_ONCE(_name)]);   \
+    }                                                                       \
+    static const struct kernel_param_ops _name##_ops = {                    \
+        .set = _name##_set,                                                 \
+        .get = _name##_get,                                                 \
+    };                                                                      \
+    module_param_cb(_name, &_name##_ops, NULL, 0644)
+
+#endif /* RADXA_CLK_WATCH_H */
@@ -0,0 +1,57 @@
+/*
+ * RADXA OVERCLOCK - CPU CLUSTERS
+ *
+ * One cluster per cpufreq policy, the policy with the lower maximum first,
+ * so "efficiency" and "performance" mean the same CPUs in every module
+ * that groups CPUs: cpu_overclock, cpu_selftest, mem_stall_governor and
+ * power_arbiter.
+ *
+ * Kernel-only, included by the overclocking modules.
+ */
+
+#ifndef RADXA_CPU_CLUSTERS_H
+#define RADXA_CPU_CLUSTERS_H
+
+#include <linux/cpufreq.h>
+#include <linux/cpumask.h>
+
+struct radxa_cpu_cluster {
+    int cpu;                        // First CPU of the policy, -1 if none
+    cpumask_t cpus;                 // All CPUs of the policy
+    unsigned int max_khz;           // cpuinfo.max_freq at discovery
+};
+
+// Fills up to max clusters in ascending order of maximum frequency; the
+// rest get cpu -1. Returns the number of policies, which may exceed max:
+// only the first max policies are used then.
+static inline int radxa_discover_clusters(struct radxa_cpu_cluster *cl, int max)
+{
+    int cpu, nr = 0, i;
+
+    for (i = 0; i < max; i++) {
+        cl[i].cpu = -1;
+        cpumask_clear(&cl[i].cpus);
+        cl[i].max_khz = 0;
+    }
+
+    for_each_possible_cpu(cpu) {
+        struct cpufreq_policy *policy = cpufreq_cpu_get(cpu);
+
+        if (!policy)
+            continue;
+        if (cpumask_first(policy->related_cpus) == cpu) {
+            if (nr < max) {
+                for (i = nr; i > 0 && cl[i - 1].max_khz > policy->cpuinfo.max_freq; i--)
+                    cl[i] = cl[i - 1];
+                cl[i].cpu = cpu;
+                cpumask_copy(&cl[i].cpus, policy->related_cpus);
+                cl[i].max_khz = policy->cpuinfo.max_freq;
+            }
+            nr++;
+        }
+        cpufreq_cpu_put(policy);
+    }
+    return nr;
+}
+
+#endif /* RADXA_CPU_CLUSTERS_H */
@@ -0,0 +1,94 @@
+/*
+ * RADXA OVERCLOCK - ENERGY MODEL HELPERS
+ *
+ * Builds Energy Model perf domains from a device's OPP table so EAS and
+ * the thermal framework see the overclocked operating points. Power is
+ * the usual CMOS estimate P = C * V^2 * f, with C the dynamic-power
+ * coefficient in uW/MHz/V^2 (same unit as the DT property
+ * "dynamic-power-coefficient"). Pass a measured coefficient as module
+ * parameter to replace the estimate.
+ *
+ * Kernel-only, included by the overclocking modules.
+ */
+
+#ifndef RADXA_ENERGY_MODEL_H
+#define RADXA_ENERGY_MODEL_H
+
+#include <linux/energy_model.h>
+#include <linux/pm_opp.h>
+#include <linux/math64.h>
+
+static inline unsigned long radxa_em_power_mw(u32 coeff, unsigned long freq_hz,
+                                              unsigned long voltage_uv)
+{
+    u64 mv = voltage_uv / 1000;
+    u64 power = (u64)coeff * mv * mv * (freq_hz / 1000000);
+
+    return div_u64(power, 1000000000);
+}
+
+// Body of an em_data_callback: round *freq up to the next OPP of dev and
+// estimate its power
+static inline int radxa_em_opp_power(struct device *dev, u32 coeff,
+                                     unsigned long *power, unsigned long *freq)
+{
+    struct dev_pm_opp *opp;
+    unsigned long uv;
+
+    opp = dev_pm_opp_find_freq_ceil(dev, freq);
+    if (IS_ERR(opp))
+        return -EINVAL;
+    uv = dev_pm_opp_get_voltage(opp);
+    dev_pm_opp_put(opp);
+    if (!uv)
+        return -EINVAL;
+
+    *power = radxa_em_power_mw(coeff, *freq, uv);
+    return *power ? 0 : -EINVAL;
+}
+
+// (Re)build dev's perf domain from its current OPP table. span is the
+// policy's CPU mask for CPU devices, NULL otherwise. A CPU perf domain
+// cannot be replaced once registered, so only the first call counts for
+// CPUs.
+static inline int radxa_em_update(struct device *dev, struct em_data_callback *cb,
+                                  cpumask_t *span)
+{
+    int nr = dev_pm_opp_get_opp_count(dev);
+
+    if (nr <= 0)
+        return nr < 0 ? nr : -ENODATA;
+    if (!span)
+        em_dev_unregister_perf_domain(dev);
+    return em_dev_register_perf_domain(dev, nr, cb, span, true);
+}
+
+// Power of the lowest state at or above khz (per CPU for CPU domains)
+static inline unsigned long radxa_em_power_at(struct em_perf_domain *pd, unsigned long khz)
+{
+    int i;
+
+    for (i = 0; i < pd->nr_perf_states - 1; i++)
+        if (pd->table[i].frequency >= khz)
+            break;
+    return pd->table[i].power;
+}
+
+// mW a move from old_hz to new_hz adds (negative: saves); 0 without a
+// perf domain
+static inline long radxa_em_power_delta(struct em_perf_domain *pd, unsigned long old_hz,
+                                        unsigned long new_hz)
+{
+    if (!pd)
+        return 0;
+    return (long)radxa_em_power_at(pd, new_hz / 1000) - (long)radxa_em_power_at(pd, old_hz / 1000);
+}
+
+static inline int radxa_em_nr_states(struct device *dev)
+{
+    struct em_perf_domain *pd = em_pd_get(dev);
+
+    return pd ? pd->nr_perf_states : 0;
+}
+
+#endif /* RADXA_ENERGY_MODEL_H */
@@ -0,0 +1,248 @@
+/*
+ * RADXA OVERCLOCK - FREQUENCY STATISTICS
+ *
+ * Residency and transition counters for clocks the modules program
+ * directly, behind the back of cpufreq and devfreq and so missing from
+ * their stats. Each clock gets a directory of its own, usually under the
+ * module's freq_stats:
+ *
+ *   time_in_state   "<kHz> <ms>" per frequency, lowest first
+ *   trans_table     From/To transition counts, in cpufreq's layout
+ *   total_trans     Frequency changes
+ *   failed_trans    Rate changes the clock framework refused
+ *   reset           Write anything to zero the counters
+ *
+ * Frequencies are the rates the clock reports after a change and are
+ * added as they are first seen, up to RADXA_FS_MAX_STATES; time at any
+ * rate beyond that is not counted. An update is a short table scan under
+ * a spinlock, so it is fine in notifier context.
+ *
+ * Kernel-only, included by the overclocking modules.
+ */
+
+#ifndef RADXA_FREQ_STATS_H
+#define RADXA_FREQ_STATS_H
+
+#include <linux/kobject.h>
+#include <linux/ktime.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/sysfs.h>
+
+// Keeps trans_table within a page
+#define RADXA_FS_MAX_STATES 16
+
+struct radxa_freq_stats {
+    struct kobject kobj;
+    spinlock_t lock;
+    unsigned int nr;
+    int cur;                        // -1: not in the table
+    u64 last_ns;
+    unsigned long freq[RADXA_FS_MAX_STATES];
+    u64 time_ns[RADXA_FS_MAX_STATES];
+    unsigned int trans[RADXA_FS_MAX_STATES][RADXA_FS_MAX_STATES];
+    unsigned int total_trans;
+    unsigned int failed_trans;
+};
+
+#define to_radxa_fs(k) container_of(k, struct radxa_freq_stats, kobj)
+
+// Lock held; adds hz to the table on first sight
+static inline int radxa_fs_index(struct radxa_freq_stats *s, unsigned long hz)
+{
+    unsigned int i;
+
+    for (i = 0; i < s->nr; i++)
+        if (s->freq[i] == hz)
+            return i;
+    if (s->nr == RADXA_FS_MAX_STATES)
+        return -1;
+    s->freq[s->nr] = hz;
+    return s->nr++;
+}
+
+static inline void radxa_fs_account(struct radxa_freq_stats *s, u64 now)
+{
+    if (s->cur >= 0)
+        s->time_ns[s->cur] += now - s->last_ns;
+    s->last_ns = now;
+}
+
+// The clock now runs at hz; NULL stats are ignored
+static inline void radxa_fs_update(struct radxa_freq_stats *s, unsigned long hz)
+{
+    unsigned long flags;
+    int idx;
+
+    if (!s)
+        return;
+    spin_lock_irqsave(&s->lock, flags);
+    radxa_fs_account(s, ktime_get_ns());
+    idx = radxa_fs_index(s, hz);
+    if (idx != s->cur) {
+        if (s->cur >= 0 && idx >= 0)
+            s->trans[s->cur][idx]++;
+        s->total_trans++;
+        s->cur = idx;
+    }
+    spin_unlock_irqrestore(&s->lock, flags);
+}
+
+static inline void radxa_fs_failed(struct radxa_freq_stats *s)
+{
+    unsigned long flags;
+
+    if (!s)
+        return;
+    spin_lock_irqsave(&s->lock, flags);
+    s->failed_trans++;
+    spin_unlock_irqrestore(&s->lock, flags);
+}
+
+// Table indices by ascending frequency
+static inline void radxa_fs_sorted(struct radxa_freq_stats *s, int *order)
+{
+    int i, j;
+
+    for (i = 0; i < s->nr; i++) {
+        for (j = i; j > 0 && s->freq[order[j - 1]] > s->freq[i]; j--)
+            order[j] = order[j - 1];
+        order[j] = i;
+    }
+}
+
+static inline ssize_t radxa_fs_time_in_state_show(struct kobject *kobj,
+                                                  struct kobj_attribute *attr, char *buf)
+{
+    struct radxa_freq_stats *s = to_radxa_fs(kobj);
+    int order[RADXA_FS_MAX_STATES];
+    unsigned long flags;
+    ssize_t len = 0;
+    int i;
+
+    spin_lock_irqsave(&s->lock, flags);
+    radxa_fs_account(s, ktime_get_ns());
+    radxa_fs_sorted(s, order);
+    for (i = 0; i < s->nr; i++)
+        len += scnprintf(buf + len, PAGE_SIZE - len, "%lu %llu\n", s->freq[order[i]] / 1000,
+                         div_u64(s->time_ns[order[i]], NSEC_PER_MSEC));
+    spin_unlock_irqrestore(&s->lock, flags);
+    return len;
+}
+
+static inline ssize_t radxa_fs_trans_table_show(struct kobject *kobj,
+                                                struct kobj_attribute *attr, char *buf)
+{
+    struct radxa_freq_stats *s = to_radxa_fs(kobj);
+    int order[RADXA_FS_MAX_STATES];
+    unsigned long flags;
+    ssize_t len;
+    int i, j;
+
+    spin_lock_irqsave(&s->lock, flags);
+    radxa_fs_sorted(s, order);
+    len = scnprintf(buf, PAGE_SIZE, "   From  :    To\n         : ");
+    for (i = 0; i < s->nr; i++)
+        len += scnprintf(buf + len, PAGE_SIZE - len, "%9lu ", s->freq[order[i]] / 1000);
+    len += scnprintf(buf + len, PAGE_SIZE - len, "\n");
+    for (i = 0; i < s->nr; i++) {
+        len += scnprintf(buf + len, PAGE_SIZE - len, "%9lu: ", s->freq[order[i]] / 1000);
+        for (j = 0; j < s->nr; j++)
+            len += scnprintf(buf + len, PAGE_SIZE - len, "%9u ", s->trans[order[i]][order[j]]);
+        len += scnprintf(buf + len, PAGE_SIZE - len, "\n");
+    }
+    spin_unlock_irqrestore(&s->lock, flags);
+    return len;
+}
+
+static inline ssize_t radxa_fs_total_trans_show(struct kobject *kobj,
+                                                struct kobj_attribute *attr, char *buf)
+{
+    return sprintf(buf, "%u\n", to_radxa_fs(kobj)->total_trans);
+}
+
+static inline ssize_t radxa_fs_failed_trans_show(struct kobject *kobj,
+                                                 struct kobj_attribute *attr, char *buf)
+{
+    return sprintf(buf, "%u\n", to_radxa_fs(kobj)->failed_trans);
+}
+
+// The frequencies stay, so the current one keeps counting
+static inline ssize_t radxa_fs_reset_store(struct kobject *kobj, struct kobj_attribute *attr,
+                                           const char *buf, size_t count)
+{
+    struct radxa_freq_stats *s = to_radxa_fs(kobj);
+    unsigned long flags;
+
+    spin_lock_irqsave(&s->lock, flags);
+    memset(s->time_ns, 0, sizeof(s->time_ns));
+    memset(s->trans, 0, sizeof(s->trans));
+    s->total_trans = 0;
+    s->failed_trans = 0;
+    s->last_ns = ktime_get_ns();
+    spin_unlock_irqrestore(&s->lock, flags);
+    return count;
+}
+
+static struct kobj_attribute radxa_fs_time_in_state_attr =
+    __ATTR(time_in_state, 0444, radxa_fs_time_in_state_show, NULL);
+static struct kobj_attribute radxa_fs_trans_table_attr =
+    __ATTR(trans_table, 0444, radxa_fs_trans_table_show, NULL);
+static struct kobj_attribute radxa_fs_total_trans_attr =
+    __ATTR(total_trans, 0444, radxa_fs_total_trans_show, NULL);
+static struct kobj_attribute radxa_fs_failed_trans_attr =
+    __ATTR(failed_trans, 0444, radxa_fs_failed_trans_show, NULL);
+static struct kobj_attribute radxa_fs_reset_attr =
+    __ATTR(reset, 0200, NULL, radxa_fs_reset_store);
+
+static struct attribute *radxa_fs_attrs[] = {
+    &radxa_fs_time_in_state_attr.attr,
+    &radxa_fs_trans_table_attr.attr,
+    &radxa_fs_total_trans_attr.attr,
+    &radxa_fs_failed_trans_attr.attr,
+    &radxa_fs_reset_attr.attr,
+    NULL,
+};
+ATTRIBUTE_GROUPS(radxa_fs);
+
+static inline void radxa_fs_release(struct kobject *kobj)
+{
+    kfree(to_radxa_fs(kobj));
+}
+
+static struct kobj_type radxa_fs_ktype = {
+    .release = radxa_fs_release,
+    .sysfs_ops = &kobj_sysfs_ops,
+    .default_groups = radxa_fs_groups,
+};
+
+// Directory name under parent, starting at hz (0: not known yet). NULL on
+// failure; the updates then do nothing.
+static inline struct radxa_freq_stats *radxa_fs_create(struct kobject *parent, const char *name,
+                                                       unsigned long hz)
+{
+    struct radxa_freq_stats *s;
+
+    if (!parent)
+        return NULL;
+    s = kzalloc(sizeof(*s), GFP_KERNEL);
+    if (!s)
+        return NULL;
+    spin_lock_init(&s->lock);
+    s->cur = hz ? radxa_fs_index(s, hz) : -1;
+    s->last_ns = ktime_get_ns();
+
+    if (kobject_init_and_add(&s->kobj, &radxa_fs_ktype, parent, "%s", name)) {
+        kobject_put(&s->kobj);
+        return NULL;
+    }
+    return s;
+}
+
+static inline void radxa_fs_destroy(struct radxa_freq_stats *s)
+{
+    if (s)
+        kobject_put(&s->kobj);
+}
+
+#endif /* RADXA_FREQ_STATS_H */
@@ -0,0 +1,255 @@
+/*
+ * RADXA OVERCLOCK - NPU CLOCK SET
+ *
+ * The NPU node has three clocks: "core" drives the compute array, "bus"
+ * its AXI master port and "reg" the register interface. Raising the core
+ * alone leaves the AXI port at its stock rate, and that then caps the
+ * throughput. radxa_npu_set_rate() moves the three together: bus and reg
+ * go up before the core and down after it, and the clocks already changed
+ * are put back if a step fails.
+ *
+ * Bus and reg keep the ratio to the core they had at load, unless the
+ * ratio table says otherwise. The table is a list of
+ * "core_mhz:bus_pct[:reg_pct]" entries, sorted by core_mhz. An entry
+ * covers core rates from its core_mhz up to the next entry; bus_pct and
+ * reg_pct are the rates in percent of the core rate (0 or left out: stock
+ * ratio). Define the table as module parameter with RADXA_NPU_RATIO_PARAM.
+ *
+ * Kernel-only, included by the NPU overclocking modules.
+ */
+
+#ifndef RADXA_NPU_CLOCKS_H
+#define RADXA_NPU_CLOCKS_H
+
+#include <linux/clk.h>
+#include <linux/device.h>
+#include <linux/kernel.h>
+#include <linux/moduleparam.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+#define RADXA_NPU_MAX_RATIOS 8
+
+enum {
+    RADXA_NPU_CLK_CORE,
+    RADXA_NPU_CLK_BUS,
+    RADXA_NPU_CLK_REG,
+    RADXA_NPU_NR_CLKS,
+};
+
+struct radxa_npu_ratio {
+    unsigned int core_mhz;
+    unsigned int pct[RADXA_NPU_NR_CLKS];    // pct[RADXA_NPU_CLK_CORE] unused
+};
+
+struct radxa_npu_clocks {
+    struct mutex lock;                       // Rate changes and table updates
+    struct clk *clk[RADXA_NPU_NR_CLKS];      // bus/reg NULL: absent or fixed
+    unsigned long stock_hz[RADXA_NPU_NR_CLKS];
+    struct radxa_npu_ratio ratios[RADXA_NPU_MAX_RATIOS];
+    int nr_ratios;
+};
+
+// Module parameters are parsed before init, so the lock is static
+#define RADXA_NPU_CLOCKS(_name)                                             \
+    static struct radxa_npu_clocks _name = {                                \
+        .lock = __MUTEX_INITIALIZER(_name.lock),                            \
+    }
+
+static inline unsigned long radxa_npu_rate(struct radxa_npu_clocks *c, int id)
+{
+    return c->clk[id] ? clk_get_rate(c->clk[id]) : 0;
+}
+
+// Side clock rate for a core rate: the table's percentage, else the
+// ratio measured at load
+static inline unsigned long radxa_npu_side_rate(struct radxa_npu_clocks *c, int id,
+                                                const struct radxa_npu_ratio *r,
+                                                unsigned long core_hz)
+{
+    if (r && r->pct[id])
+        return core_hz / 100 * r->pct[id];
+    return mult_frac(c->stock_hz[id], core_hz, c->stock_hz[RADXA_NPU_CLK_CORE]);
+}
+
+static inline int __radxa_npu_set_rate(struct radxa_npu_clocks *c, unsigned long core_hz)
+{
+    static const int up[] = { RADXA_NPU_CLK_BUS, RADXA_NPU_CLK_REG, RADXA_NPU_CLK_CORE };
+    static const int down[] = { RADXA_NPU_CLK_CORE, RADXA_NPU_CLK_BUS, RADXA_NPU_CLK_REG };
+    const struct radxa_npu_ratio *r = NULL;
+    unsigned long want[RADXA_NPU_NR_CLKS], old[RADXA_NPU_NR_CLKS];
+    const int *order;
+    int i, id, ret = 0;
+
+    lockdep_assert_held(&c->lock);
+    if (!c->clk[RADXA_NPU_CLK_CORE])
+        return -ENODEV;
+
+    for (i = 0; i < c->nr_ratios && c->ratios[i].core_mhz <= core_hz / 1000000; i++)
+        r = &c->ratios[i];
+    want[RADXA_NPU_CLK_CORE] = core_hz;
+    want[RADXA_NPU_CLK_BUS] = radxa_npu_side_rate(c, RADXA_NPU_CLK_BUS, r, core_hz);
+    want[RADXA_NPU_CLK_REG] = radxa_npu_side_rate(c, RADXA_NPU_CLK_REG, r, core_hz);
+
+    // Bus and reg never lag behind a faster core
+    order = core_hz >= clk_get_rate(c->clk[RADXA_NPU_CLK_CORE]) ? up : down;
+    for (i = 0; i < RADXA_NPU_NR_CLKS; i++) {
+        id = order[i];
+        if (!c->clk[id])
+            continue;
+        old[id] = clk_get_rate(c->clk[id]);
+        ret = clk_set_rate(c->clk[id], want[id]);
+        if (ret)
+            break;
+    }
+    if (ret) {
+        while (--i >= 0) {
+            id = order[i];
+            if (c->clk[id])
+                clk_set_rate(c->clk[id], old[id]);
+        }
+    }
+    return ret;
+}
+
+static inline int radxa_npu_set_rate(struct radxa_npu_clocks *c, unsigned long core_hz)
+{
+    int ret;
+
+    mutex_lock(&c->lock);
+    ret = __radxa_npu_set_rate(c, core_hz);
+    mutex_unlock(&c->lock);
+    return ret;
+}
+
+// A plain gate rounds every rate to its parent's: nothing to scale
+static inline struct clk *radxa_npu_side_get(struct device *dev, const char *id,
+                                             unsigned long *stock_hz)
+{
+    struct clk *clk = clk_get(dev, id);
+
+    if (IS_ERR(clk))
+        return NULL;
+    *stock_hz = clk_get_rate(clk);
+    if (!*stock_hz || clk_round_rate(clk, *stock_hz * 2) == *stock_hz) {
+        clk_put(clk);
+        return NULL;
+    }
+    return clk;
+}
+
+// Ask for "core" by name first: clk_get(dev, NULL) returns the node's
+// first clock, which is "bus"
+static inline int radxa_npu_clocks_get(struct radxa_npu_clocks *c, struct device *dev)
+{
+    static const char * const core_ids[] = { "core", "npu", NULL };
+    struct clk *clk = ERR_PTR(-ENOENT);
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(core_ids) && IS_ERR(clk); i++)
+        clk = clk_get(dev, core_ids[i]);
+    if (IS_ERR(clk))
+        return PTR_ERR(clk);
+
+    mutex_lock(&c->lock);
+    c->clk[RADXA_NPU_CLK_CORE] = clk;
+    c->stock_hz[RADXA_NPU_CLK_CORE] = clk_get_rate(clk);
+    if (c->stock_hz[RADXA_NPU_CLK_CORE]) {
+        c->clk[RADXA_NPU_CLK_BUS] = radxa_npu_side_get(dev, "bus", &c->stock_hz[RADXA_NPU_CLK_BUS]);
+        c->clk[RADXA_NPU_CLK_REG] = radxa_npu_side_get(dev, "reg", &c->stock_hz[RADXA_NPU_CLK_REG]);
+    }
+    mutex_unlock(&c->lock);
+    return 0;
+}
+
+// The rates stay where they are, like the core rate always did
+static inline void radxa_npu_clocks_put(struct radxa_npu_clocks *c)
+{
+    int id;
+
+    mutex_lock(&c->lock);
+    for (id = 0; id < RADXA_NPU_NR_CLKS; id++) {
+        if (c->clk[id])
+            clk_put(c->clk[id]);
+        c->clk[id] = NULL;
+    }
+    mutex_unlock(&c->lock);
+}
+
+// Replace the ratio table ("" or "stock" clears it) and re-apply it at
+// the current core rate
+static inline int radxa_npu_parse_ratios(struct radxa_npu_clocks *c, const char *val)
+{
+    struct radxa_npu_ratio ratios[RADXA_NPU_MAX_RATIOS];
+    char *copy, *cur, *tok;
+    int nr = 0, ret = 0;
+
+    copy = kstrdup(val, GFP_KERNEL);
+    if (!copy)
+        return -ENOMEM;
+    cur = strim(copy);
+    if (!strcmp(cur, "stock"))
+        *cur = '\0';
+
+    while ((tok = strsep(&cur, ",")) && *tok) {
+        struct radxa_npu_ratio *r = &ratios[nr];
+        int n;
+
+        if (nr == RADXA_NPU_MAX_RATIOS) {
+            ret = -E2BIG;
+            break;
+        }
+        memset(r, 0, sizeof(*r));
+        n = sscanf(tok, "%u:%u:%u", &r->core_mhz, &r->pct[RADXA_NPU_CLK_BUS],
+                   &r->pct[RADXA_NPU_CLK_REG]);
+        if (n < 2 || r->pct[RADXA_NPU_CLK_BUS] > 200 || r->pct[RADXA_NPU_CLK_REG] > 200 ||
+            (nr && r->core_mhz <= ratios[nr - 1].core_mhz)) {
+            ret = -EINVAL;
+            break;
+        }
+        nr++;
+    }
+    kfree(copy);
+    if (ret)
+        return ret;
+
+    mutex_lock(&c->lock);
+    memcpy(c->ratios, ratios, nr * sizeof(ratios[0]));
+    c->nr_ratios = nr;
+    if (c->clk[RADXA_NPU_CLK_CORE])
+        ret = __radxa_npu_set_rate(c, clk_get_rate(c->clk[RADXA_NPU_CLK_CORE]));
+    mutex_unlock(&c->lock);
+    return ret;
+}
+
+static inline int radxa_npu_format_ratios(struct radxa_npu_clocks *c, char *buf)
+{
+    int i, len = 0;
+
+    mutex_lock(&c->lock);
+    for (i = 0; i < c->nr_ratios; i++)
+        len += scnprintf(buf + len, PAGE_SIZE - len, "%s%u:%u:%u", i ? "," : "",
+                         c->ratios[i].core_mhz, c->ratios[i].pct[RADXA_NPU_CLK_BUS],
+                         c->ratios[i].pct[RADXA_NPU_CLK_REG]);
+    mutex_unlock(&c->lock);
+    len += scnprintf(buf + len, PAGE_SIZE - len, "%s\n", len ? "" : "stock");
+    return len;
+}
+
+#define RADXA_NPU_RATIO_PARAM(_name, _clocks)                               \
+    static int _name##_set(const char *val, const struct kernel_param *kp)  \
+    {                                                                       \
+        return radxa_npu_parse_ratios(&_clocks, val);                       \
+    }                                                                       \
+    static int _name##_get(char *buf, const struct kernel_param *kp)        \
+    {                                                                       \
+        return radxa_npu_format_ratios(&_clocks, buf);                      \
+    }                                                                       \
+    static const struct kernel_param_ops _name##_ops = {                    \
+        .set = _name##_set,                                                 \
+        .get = _name##_get,                                                 \
+    };                                                                      \
+    module_param_cb(_name, &_name##_ops, NULL, 0644)
+
+#endif /* RADXA_NPU_CLOCKS_H */
@@ -0,0 +1,75 @@
+/*
+ * RADXA OVERCLOCK - IN-KERNEL HOOKS
+ *
+ * Functions the overclocking modules export to each other. Callers look
+ * them up with symbol_get() so every module still loads on its own.
+ *
+ * Kernel-only, included by the overclocking modules.
+ */
+
+#ifndef RADXA_OVERCLOCK_HOOKS_H
+#define RADXA_OVERCLOCK_HOOKS_H
+
+#include <linux/module.h>
+#include <linux/notifier.h>
+#include <linux/types.h>
+
+// cpu_overclock: cap the cluster that contains cpu at max_hz on top of the
+// user's overclock setting; 0 lifts the cap. -ENODEV if the cluster is not
+// under cpufreq.
+int cpu_overclock_stall_cap(unsigned int cpu, unsigned long max_hz);
+
+// cpu_overclock: keep the cluster that contains cpu at min_hz or above; 0
+// lifts the floor. Caps still win. -ENODEV as above.
+int cpu_overclock_stall_floor(unsigned int cpu, unsigned long min_hz);
+
+// cpu_overclock: notifier chain called with CPU_OVERCLOCK_APPLIED and a
+// struct cpu_overclock_event after a cluster got a new frequency
+#define CPU_OVERCLOCK_APPLIED 1
+
+struct cpu_overclock_event {
+    unsigned int cpu;           // First CPU of the cluster
+    unsigned long freq_hz;
+};
+
+int cpu_overclock_register_notifier(struct notifier_block *nb);
+int cpu_overclock_unregister_notifier(struct notifier_block *nb);
+
+// cpu_overclock: move the cluster that contains cpu one operating point
+// down. Returns the new frequency, -ERANGE at the lowest point.
+long cpu_overclock_step_down(unsigned int cpu);
+
+// ram_overclock: while stalled, raise the DDR floor by one OPP per call;
+// false drops the floor again. -ENODEV without the dmcfreq devfreq device.
+int ram_overclock_stall_boost(bool stalled);
+
+// ram_overclock: notifier chain called with RAM_OVERCLOCK_APPLIED and a
+// pointer to the new DDR frequency (unsigned long, Hz) after DDR switched
+#define RAM_OVERCLOCK_APPLIED 1
+
+int ram_overclock_register_notifier(struct notifier_block *nb);
+int ram_overclock_unregister_notifier(struct notifier_block *nb);
+
+// ram_overclock: keep DDR at freq (Hz) until called with 0
+int ram_overclock_hold(unsigned long freq);
+unsigned long ram_overclock_cur_freq(void);
+
+// fan_control: about delta_mw more (or, negative, less) power is on its
+// way; pre-spin the fan for it before the temperature shows it
+int fan_control_feed_forward(long delta_mw);
+
+// Looked up per call: fan_control may come and go after the caller loaded
+static inline void radxa_fan_feed_forward(long delta_mw)
+{
+    int (*feed_forward)(long delta_mw);
+
+    if (!delta_mw)
+        return;
+    feed_forward = symbol_get(fan_control_feed_forward);
+    if (feed_forward) {
+        feed_forward(delta_mw);
+        symbol_put(fan_control_feed_forward);
+    }
+}
+
+#endif /* RADXA_OVERCLOCK_HOOKS_H */
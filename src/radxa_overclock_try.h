@@ -0,0 +1,167 @@
+/*
+ * RADXA OVERCLOCK - SPECULATIVE SETTINGS
+ *
+ * Writing a setting to "try" applies it and reverts to the last-known-good
+ * setting unless "commit" follows within try_timeout_s. The last-known-good
+ * setting is a module parameter (lkg=) applied at load; radxa-perfd writes
+ * it to /etc/modprobe.d on commit, and keeps the hardware watchdog armed
+ * while a try is pending so a hang reboots into it. Nothing here arms the
+ * watchdog: a try written straight to sysfs is only covered by the timer.
+ *
+ * Settings use the format of the module's control file.
+ *
+ * Kernel-only, included by the overclocking modules.
+ */
+
+#ifndef RADXA_OVERCLOCK_TRY_H
+#define RADXA_OVERCLOCK_TRY_H
+
+#include <linux/kobject.h>
+#include <linux/mutex.h>
+#include <linux/string.h>
+#include <linux/sysfs.h>
+#include <linux/workqueue.h>
+
+#define RADXA_OC_SETTING_LEN 64
+
+enum radxa_oc_try_state {
+    RADXA_OC_TRY_IDLE,
+    RADXA_OC_TRY_PENDING,
+    RADXA_OC_TRY_REVERTED,
+};
+
+struct radxa_oc_try {
+    struct delayed_work revert_work;
+    struct mutex lock;
+    struct kobject *kobj;               // Where the state attribute lives
+    const char *state_attr;
+    int (*apply)(const char *setting);
+    const char *stock;                  // Reverted to without a last-known-good
+    char lkg[RADXA_OC_SETTING_LEN];
+    char candidate[RADXA_OC_SETTING_LEN];
+    enum radxa_oc_try_state state;
+};
+
+static const char * const radxa_oc_try_states[] = { "idle", "pending", "reverted" };
+
+static inline const char *radxa_oc_try_fallback(struct radxa_oc_try *t)
+{
+    return t->lkg[0] ? t->lkg : t->stock;
+}
+
+// The attributes may already be visible before radxa_oc_try_restore()
+static inline void radxa_oc_try_notify(struct radxa_oc_try *t)
+{
+    if (t->kobj)
+        sysfs_notify(t->kobj, NULL, t->state_attr);
+}
+
+static inline void radxa_oc_try_revert_fn(struct work_struct *work)
+{
+    struct radxa_oc_try *t = container_of(to_delayed_work(work), struct radxa_oc_try,
+                                          revert_work);
+
+    mutex_lock(&t->lock);
+    if (t->state == RADXA_OC_TRY_PENDING) {
+        pr_warn("RADXA_OC: \"%s\" not committed, reverting to \"%s\"\n",
+                t->candidate, radxa_oc_try_fallback(t));
+        t->apply(radxa_oc_try_fallback(t));
+        t->state = RADXA_OC_TRY_REVERTED;
+    }
+    mutex_unlock(&t->lock);
+    radxa_oc_try_notify(t);
+}
+
+// lkg is the module parameter; it is applied by radxa_oc_try_restore()
+static inline void radxa_oc_try_init(struct radxa_oc_try *t, int (*apply)(const char *),
+                                     const char *stock, const char *lkg)
+{
+    INIT_DELAYED_WORK(&t->revert_work, radxa_oc_try_revert_fn);
+    mutex_init(&t->lock);
+    t->apply = apply;
+    t->stock = stock;
+    if (lkg)
+        strscpy(t->lkg, lkg, sizeof(t->lkg));
+}
+
+// Module init, once the control path works: bring back the committed setting
+static inline void radxa_oc_try_restore(struct radxa_oc_try *t, struct kobject *kobj,
+                                        const char *state_attr)
+{
+    t->kobj = kobj;
+    t->state_attr = state_attr;
+    if (!t->lkg[0])
+        return;
+    pr_info("RADXA_OC: Restoring last-known-good setting \"%s\"\n", t->lkg);
+    if (t->apply(t->lkg))
+        pr_warn("RADXA_OC: Last-known-good setting \"%s\" failed\n", t->lkg);
+}
+
+static inline int radxa_oc_try_start(struct radxa_oc_try *t, const char *buf,
+                                     unsigned int timeout_s)
+{
+    char setting[RADXA_OC_SETTING_LEN];
+    int ret;
+
+    strscpy(setting, buf, sizeof(setting));
+    strim(setting);
+    if (!setting[0] || !timeout_s)
+        return -EINVAL;
+
+    // A new try replaces a pending one and restarts the clock
+    cancel_delayed_work_sync(&t->revert_work);
+
+    mutex_lock(&t->lock);
+    ret = t->apply(setting);
+    if (ret) {
+        // Half-applied settings are worse than either end
+        t->apply(radxa_oc_try_fallback(t));
+        t->state = RADXA_OC_TRY_IDLE;
+    } else {
+        strscpy(t->candidate, setting, sizeof(t->candidate));
+        t->state = RADXA_OC_TRY_PENDING;
+        schedule_delayed_work(&t->revert_work, msecs_to_jiffies(timeout_s * 1000));
+    }
+    mutex_unlock(&t->lock);
+
+    radxa_oc_try_notify(t);
+    return ret;
+}
+
+static inline int radxa_oc_try_commit(struct radxa_oc_try *t)
+{
+    int ret = 0;
+
+    cancel_delayed_work_sync(&t->revert_work);
+
+    mutex_lock(&t->lock);
+    if (t->state == RADXA_OC_TRY_PENDING) {
+        strscpy(t->lkg, t->candidate, sizeof(t->lkg));
+        t->state = RADXA_OC_TRY_IDLE;
+        pr_info("RADXA_OC: Committed \"%s\" as last-known-good\n", t->lkg);
+    } else {
+        // Too late: the revert already happened
+        ret = t->state == RADXA_OC_TRY_REVERTED ? -ETIMEDOUT : -EINVAL;
+    }
+    mutex_unlock(&t->lock);
+
+    radxa_oc_try_notify(t);
+    return ret;
+}
+
+static inline void radxa_oc_try_exit(struct radxa_oc_try *t)
+{
+    cancel_delayed_work_sync(&t->revert_work);
+}
+
+static inline ssize_t radxa_oc_try_state_show(struct radxa_oc_try *t, char *buf)
+{
+    return sprintf(buf, "%s\n", radxa_oc_try_states[t->state]);
+}
+
+static inline ssize_t radxa_oc_try_lkg_show(struct radxa_oc_try *t, char *buf)
+{
+    return sprintf(buf, "%s\n", t->lkg);
+}
+
+#endif /* RADXA_OVERCLOCK_TRY_H */
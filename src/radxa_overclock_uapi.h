@@ -0,0 +1,53 @@
+/*
+ * RADXA OVERCLOCK - SHARED USERSPACE ABI
+ *
+ * Layout of the binary "snapshot" sysfs attributes exported by the
+ * overclocking modules. One read() returns a header followed by
+ * nr_domains fixed-size domain records, so monitoring tools can poll
+ * every value of a module without parsing text.
+ *
+ * Included by the kernel modules and by userspace tools alike.
+ */
+
+#ifndef RADXA_OVERCLOCK_UAPI_H
+#define RADXA_OVERCLOCK_UAPI_H
+
+#include <linux/types.h>
+
+#define RADXA_OC_SNAPSHOT_MAGIC   0x53434f52  /* "ROCS" little endian */
+#define RADXA_OC_SNAPSHOT_VERSION 1
+
+// Domain identifiers (stable, never renumber)
+enum radxa_oc_domain {
+    RADXA_OC_DOMAIN_CPU_E = 0,  // Efficiency cluster
+    RADXA_OC_DOMAIN_CPU_P = 1,  // Performance cluster
+    RADXA_OC_DOMAIN_DDR   = 2,
+    RADXA_OC_DOMAIN_NPU   = 3,
+    RADXA_OC_DOMAIN_GPU   = 4,
+    RADXA_OC_DOMAIN_FAN   = 5,  // cur/target hold PWM duty (0-255)
+};
+
+// Domain record flags
+#define RADXA_OC_F_PRESENT        (1U << 0)  // Clock/device found
+#define RADXA_OC_F_OVERCLOCKED    (1U << 1)  // Target above stock maximum
+#define RADXA_OC_F_THERMAL_CTRL   (1U << 2)  // Fan under thermal control
+
+struct radxa_oc_snapshot_header {
+    __u32 magic;
+    __u16 version;
+    __u16 nr_domains;
+    __u32 header_size;      // sizeof(struct radxa_oc_snapshot_header)
+    __u32 domain_size;      // sizeof(struct radxa_oc_domain_state)
+    __u64 timestamp_ns;     // CLOCK_MONOTONIC when the snapshot was taken
+} __attribute__((packed));
+
+struct radxa_oc_domain_state {
+    __u32 domain;           // enum radxa_oc_domain
+    __u32 flags;            // RADXA_OC_F_*
+    __u64 cur_freq_hz;
+    __u64 target_freq_hz;
+    __u32 voltage_uv;       // Last applied voltage, 0 if unmanaged
+    __s32 temp_mc;          // Millidegrees C, 0 if not applicable
+} __attribute__((packed));
+
+#endif /* RADXA_OVERCLOCK_UAPI_H */
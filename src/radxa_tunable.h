@@ -0,0 +1,69 @@
+/*
+ * RADXA OVERCLOCK - SYSFS TUNABLES
+ *
+ * An unsigned int of the module's state as a 0664 attribute with a range.
+ * Values are written with WRITE_ONCE() and readers take them with
+ * READ_ONCE(); a tunable whose change needs acting on right away names a
+ * changed() callback, called after the new value is in place.
+ *
+ *   RADXA_TUNABLE_ATTR(sample_ms, 5, 1000);
+ *   ...
+ *   sample_ms_attr.value = &g_data->sample_ms;     // At init
+ *   &sample_ms_attr.attr.attr                      // In the attribute list
+ *
+ * Kernel-only, included by the overclocking modules.
+ */
+
+#ifndef RADXA_TUNABLE_H
+#define RADXA_TUNABLE_H
+
+#include <linux/kernel.h>
+#include <linux/kobject.h>
+#include <linux/sysfs.h>
+
+struct radxa_tunable {
+    struct kobj_attribute attr;
+    unsigned int *value;
+    unsigned int min, max;
+    void (*changed)(unsigned int value);
+};
+
+#define to_radxa_tunable(a) container_of(a, struct radxa_tunable, attr)
+
+static inline ssize_t radxa_tunable_show(struct kobject *kobj, struct kobj_attribute *attr,
+                                         char *buf)
+{
+    return sprintf(buf, "%u\n", READ_ONCE(*to_radxa_tunable(attr)->value));
+}
+
+static inline ssize_t radxa_tunable_store(struct kobject *kobj, struct kobj_attribute *attr,
+                                          const char *buf, size_t count)
+{
+    struct radxa_tunable *t = to_radxa_tunable(attr);
+    unsigned int value;
+    int ret;
+
+    ret = kstrtouint(buf, 10, &value);
+    if (ret)
+        return ret;
+    if (value < t->min || value > t->max)
+        return -EINVAL;
+
+    WRITE_ONCE(*t->value, value);
+    if (t->changed)
+        t->changed(value);
+    return count;
+}
+
+#define RADXA_TUNABLE_ATTR_CB(_name, _min, _max, _changed)                  \
+    static struct radxa_tunable _name##_attr = {                            \
+        .attr = __ATTR(_name, 0664, radxa_tunable_show, radxa_tunable_store), \
+        .min = _min,                                                        \
+        .max = _max,                                                        \
+        .changed = _changed,                                                \
+    }
+
+#define RADXA_TUNABLE_ATTR(_name, _min, _max) \
+    RADXA_TUNABLE_ATTR_CB(_name, _min, _max, NULL)
+
+#endif /* RADXA_TUNABLE_H */
@@ -0,0 +1,37 @@
+/*
+ * RADXA OVERCLOCK - DDR PATTERN TEST KERNELS
+ *
+ * Wide NEON stores and loads for ram_memtest. Buffers are processed in
+ * blocks of MEMTEST_BLOCK_WORDS (128 bytes, two cache lines) against a
+ * template of the same size; a mismatching block is rescanned word by
+ * word and every bad word goes to memtest_record().
+ *
+ * ram_memtest_neon.c is built with the FP/SIMD registers enabled: only
+ * call it between kernel_neon_begin() and kernel_neon_end().
+ */
+
+#ifndef RAM_MEMTEST_H
+#define RAM_MEMTEST_H
+
+#include <linux/types.h>
+
+#define MEMTEST_BLOCK_WORDS 32
+
+struct memtest_errors;
+
+// Provided by ram_memtest_main.c; called with preemption disabled
+void memtest_record(struct memtest_errors *err, const u32 *addr, u32 expected, u32 actual);
+
+void memtest_neon_fill(u32 *buf, size_t words, const u32 *tmpl);
+
+// Compare against expect and, if next is set, overwrite with next right
+// after (one moving-inversions step). down walks from the end.
+size_t memtest_neon_check(u32 *buf, size_t words, const u32 *expect, const u32 *next,
+                          bool down, struct memtest_errors *err);
+
+// Four interleaved xorshift32 streams seeded from seed
+void memtest_neon_random_fill(u32 *buf, size_t words, u32 seed);
+size_t memtest_neon_random_check(const u32 *buf, size_t words, u32 seed,
+                                 struct memtest_errors *err);
+
+#endif /* RAM_MEMTEST_H */
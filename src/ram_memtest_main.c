@@ -0,0 +1,720 @@
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/cpu.h>
+#include <linux/mm.h>
+#include <linux/gfp.h>
+#include <linux/kthread.h>
+#include <linux/completion.h>
+#include <linux/workqueue.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/delay.h>
+#include <linux/sysfs.h>
+#include <linux/kobject.h>
+#include <asm/neon.h>
+#include <asm/barrier.h>
+
+#include "ram_memtest.h"
+#include "radxa_overclock_hooks.h"
+#include "radxa_tunable.h"
+
+#define MODULE_NAME "ram_memtest"
+
+// 4 MiB physically contiguous chunks: whole DRAM rows, few allocations
+#define MEMTEST_ORDER       (MAX_ORDER - 1)
+#define MEMTEST_CHUNK_WORDS ((PAGE_SIZE << MEMTEST_ORDER) / sizeof(u32))
+#define MEMTEST_MAX_ERRORS  16      // Addresses kept per run
+#define MEMTEST_MAX_FREQS   16      // Frequencies with a result
+
+static unsigned int row_bytes = 8192;
+module_param(row_bytes, uint, 0444);
+MODULE_PARM_DESC(row_bytes, "DRAM row size assumed by the neighbor-row test (default: 8192)");
+
+enum memtest_pattern {
+    PAT_WALKING,
+    PAT_MOVING_INV,
+    PAT_RANDOM,
+    PAT_NEIGHBOR,
+    NR_PATTERNS,
+};
+
+static const char * const pattern_names[NR_PATTERNS] = {
+    "walking_bits", "moving_inversions", "random", "neighbor_rows",
+};
+
+static const u32 inversion_patterns[] = { 0x55555555, 0x33333333, 0x0f0f0f0f, 0x00ff00ff };
+
+struct memtest_error {
+    phys_addr_t addr;
+    u32 expected;
+    u32 actual;
+    enum memtest_pattern pattern;
+};
+
+// One per worker, filled from NEON context
+struct memtest_errors {
+    enum memtest_pattern pattern;
+    unsigned long count[NR_PATTERNS];
+    struct memtest_error rec[MEMTEST_MAX_ERRORS];
+    int nr;
+};
+
+struct memtest_worker {
+    struct task_struct *task;
+    struct completion done;
+    struct page **chunks;           // Slice of the run's chunks
+    int nr_chunks;
+    u32 seed;
+    struct memtest_errors err;
+    u64 bytes[NR_PATTERNS];
+    u64 ns[NR_PATTERNS];
+};
+
+struct memtest_freq_result {
+    unsigned long freq_hz;
+    unsigned int runs;
+    unsigned long errors;
+};
+
+struct memtest_data {
+    struct work_struct work;        // Runs the test on system_long_wq
+    struct mutex lock;              // Everything below the tunables
+    struct kobject *kobj;
+    unsigned int mem_percent;       // Of available memory
+    unsigned int threads;           // 0: one per online CPU
+    unsigned int on_transition;
+    unsigned int hammer_count;      // Reads per aggressor pair
+    unsigned int hammer_rows;       // Victim rows per worker
+    bool abort;
+    bool running;
+    unsigned long request_hz;       // Frequency to test, 0: current
+    unsigned int runs;
+    // Last run
+    unsigned long last_freq_hz;
+    u64 last_bytes;
+    int last_threads;
+    u64 pattern_bytes[NR_PATTERNS];
+    u64 pattern_ns[NR_PATTERNS];    // Slowest worker
+    unsigned long pattern_errors[NR_PATTERNS];
+    struct memtest_error errors[MEMTEST_MAX_ERRORS];
+    int nr_errors;
+    unsigned long total_errors;     // Since load
+    struct memtest_freq_result freqs[MEMTEST_MAX_FREQS];
+    int nr_freqs;
+    struct notifier_block transition_nb;
+    // Hooks into ram_overclock, NULL if not loaded
+    int (*register_nb)(struct notifier_block *nb);
+    int (*unregister_nb)(struct notifier_block *nb);
+    int (*hold)(unsigned long freq);
+    unsigned long (*cur_freq)(void);
+};
+
+static struct memtest_data *g_data;
+
+void memtest_record(struct memtest_errors *err, const u32 *addr, u32 expected, u32 actual) {
+    err->count[err->pattern]++;
+    if (err->nr == MEMTEST_MAX_ERRORS)
+        return;
+    err->rec[err->nr].addr = virt_to_phys(addr);
+    err->rec[err->nr].expected = expected;
+    err->rec[err->nr].actual = actual;
+    err->rec[err->nr].pattern = err->pattern;
+    err->nr++;
+}
+
+static inline u32 *chunk_words(struct memtest_worker *w, int c) {
+    return page_address(w->chunks[c]);
+}
+
+static inline bool memtest_aborted(void) {
+    return READ_ONCE(g_data->abort);
+}
+
+// Pattern passes. Each works through the chunks one at a time with NEON
+// enabled and reschedules in between; returns the bytes moved.
+
+static u64 fill_all(struct memtest_worker *w, const u32 *tmpl) {
+    int c;
+
+    for (c = 0; c < w->nr_chunks && !memtest_aborted(); c++) {
+        kernel_neon_begin();
+        memtest_neon_fill(chunk_words(w, c), MEMTEST_CHUNK_WORDS, tmpl);
+        kernel_neon_end();
+        cond_resched();
+    }
+    return (u64)w->nr_chunks * MEMTEST_CHUNK_WORDS * sizeof(u32);
+}
+
+static u64 check_all(struct memtest_worker *w, const u32 *expect, const u32 *next, bool down) {
+    int c, i;
+
+    for (i = 0; i < w->nr_chunks && !memtest_aborted(); i++) {
+        c = down ? w->nr_chunks - 1 - i : i;
+        kernel_neon_begin();
+        memtest_neon_check(chunk_words(w, c), MEMTEST_CHUNK_WORDS, expect, next, down, &w->err);
+        kernel_neon_end();
+        cond_resched();
+    }
+    return (u64)w->nr_chunks * MEMTEST_CHUNK_WORDS * sizeof(u32) * (next ? 2 : 1);
+}
+
+// One bit set per word, the position moving along the burst; then the
+// same with one bit cleared
+static u64 test_walking(struct memtest_worker *w) {
+    u32 ones[MEMTEST_BLOCK_WORDS], zeros[MEMTEST_BLOCK_WORDS];
+    u64 bytes = 0;
+    int i;
+
+    for (i = 0; i < MEMTEST_BLOCK_WORDS; i++) {
+        ones[i] = 1U << i;
+        zeros[i] = ~ones[i];
+    }
+    bytes += fill_all(w, ones);
+    bytes += check_all(w, ones, NULL, false);
+    bytes += fill_all(w, zeros);
+    bytes += check_all(w, zeros, NULL, false);
+    return bytes;
+}
+
+// March: write p up; read p, write ~p up; read ~p, write p down; read p
+static u64 test_moving_inv(struct memtest_worker *w, u32 p) {
+    u32 pat[MEMTEST_BLOCK_WORDS], inv[MEMTEST_BLOCK_WORDS];
+    u64 bytes = 0;
+    int i;
+
+    for (i = 0; i < MEMTEST_BLOCK_WORDS; i++) {
+        pat[i] = p;
+        inv[i] = ~p;
+    }
+    bytes += fill_all(w, pat);
+    bytes += check_all(w, pat, inv, false);
+    bytes += check_all(w, inv, pat, true);
+    bytes += check_all(w, pat, NULL, false);
+    return bytes;
+}
+
+static u64 test_random(struct memtest_worker *w) {
+    int c;
+
+    for (c = 0; c < w->nr_chunks && !memtest_aborted(); c++) {
+        kernel_neon_begin();
+        memtest_neon_random_fill(chunk_words(w, c), MEMTEST_CHUNK_WORDS, w->seed + c);
+        kernel_neon_end();
+        cond_resched();
+    }
+    for (c = 0; c < w->nr_chunks && !memtest_aborted(); c++) {
+        kernel_neon_begin();
+        memtest_neon_random_check(chunk_words(w, c), MEMTEST_CHUNK_WORDS, w->seed + c, &w->err);
+        kernel_neon_end();
+        cond_resched();
+    }
+    return (u64)w->nr_chunks * MEMTEST_CHUNK_WORDS * sizeof(u32) * 2;
+}
+
+// Read both aggressors straight from DRAM, over and over
+static void hammer(const u32 *a, const u32 *b, unsigned int count) {
+    while (count--) {
+        (void)READ_ONCE(*a);
+        (void)READ_ONCE(*b);
+        asm volatile("dc civac, %0\n\tdc civac, %1" : : "r" (a), "r" (b) : "memory");
+        dsb(ish);
+    }
+}
+
+// Row-hammer style: rows alternate p / ~p, the rows on both sides of a
+// victim are read hammer_count times with the cache flushed, then every
+// row is checked. Physical rows are only approximated by row_bytes.
+static u64 test_neighbor(struct memtest_worker *w) {
+    size_t row_words = max_t(size_t, rounddown(row_bytes / sizeof(u32), MEMTEST_BLOCK_WORDS),
+                             MEMTEST_BLOCK_WORDS);
+    size_t nr_rows = MEMTEST_CHUNK_WORDS / row_words, r;
+    unsigned int victims = max(g_data->hammer_rows / max(w->nr_chunks, 1), 1U);
+    u32 pat[MEMTEST_BLOCK_WORDS], inv[MEMTEST_BLOCK_WORDS];
+    u64 bytes = 0;
+    int c, i;
+
+    for (i = 0; i < MEMTEST_BLOCK_WORDS; i++) {
+        pat[i] = 0xaaaaaaaa;
+        inv[i] = ~pat[i];
+    }
+    if (nr_rows < 3)
+        return 0;
+
+    for (c = 0; c < w->nr_chunks && !memtest_aborted(); c++) {
+        u32 *base = chunk_words(w, c);
+        unsigned int v;
+
+        kernel_neon_begin();
+        for (r = 0; r < nr_rows; r++)
+            memtest_neon_fill(base + r * row_words, row_words, r & 1 ? inv : pat);
+        kernel_neon_end();
+
+        // Victims are the even rows, spread over the chunk
+        for (v = 0; v < victims && !memtest_aborted(); v++) {
+            size_t victim = (1 + v * (nr_rows - 2) / victims) & ~1UL;
+
+            if (!victim)
+                victim = 2;
+            if (victim + 1 >= nr_rows)
+                break;
+            hammer(base + (victim - 1) * row_words, base + (victim + 1) * row_words,
+                   READ_ONCE(g_data->hammer_count));
+            cond_resched();
+        }
+
+        kernel_neon_begin();
+        for (r = 0; r < nr_rows; r++)
+            memtest_neon_check(base + r * row_words, row_words, r & 1 ? inv : pat, NULL,
+                               false, &w->err);
+        kernel_neon_end();
+        bytes += nr_rows * row_words * sizeof(u32) * 2;
+        cond_resched();
+    }
+    return bytes;
+}
+
+static int memtest_worker_fn(void *data) {
+    struct memtest_worker *w = data;
+    u32 inversion = inversion_patterns[g_data->runs % ARRAY_SIZE(inversion_patterns)];
+    enum memtest_pattern p;
+
+    for (p = 0; p < NR_PATTERNS && !memtest_aborted(); p++) {
+        u64 start = ktime_get_ns();
+
+        w->err.pattern = p;
+        switch (p) {
+        case PAT_WALKING:
+            w->bytes[p] = test_walking(w);
+            break;
+        case PAT_MOVING_INV:
+            w->bytes[p] = test_moving_inv(w, inversion);
+            break;
+        case PAT_RANDOM:
+            w->bytes[p] = test_random(w);
+            break;
+        case PAT_NEIGHBOR:
+            w->bytes[p] = test_neighbor(w);
+            break;
+        default:
+            break;
+        }
+        w->ns[p] = ktime_get_ns() - start;
+    }
+
+    complete(&w->done);
+
+    // kthread_stop() needs the task to still be there
+    while (!kthread_should_stop()) {
+        set_current_state(TASK_INTERRUPTIBLE);
+        if (!kthread_should_stop())
+            schedule();
+        __set_current_state(TASK_RUNNING);
+    }
+    return 0;
+}
+
+static int alloc_chunks(struct page ***chunks) {
+    unsigned long want = si_mem_available() / 100 * g_data->mem_percent;
+    int nr = want >> MEMTEST_ORDER, i;
+
+    if (nr <= 0)
+        return -ENOMEM;
+    *chunks = kvmalloc_array(nr, sizeof(**chunks), GFP_KERNEL);
+    if (!*chunks)
+        return -ENOMEM;
+
+    // Take what the buddy allocator has without reclaim storms
+    for (i = 0; i < nr; i++) {
+        (*chunks)[i] = alloc_pages(GFP_KERNEL | __GFP_NORETRY | __GFP_NOWARN, MEMTEST_ORDER);
+        if (!(*chunks)[i])
+            break;
+        cond_resched();
+    }
+    if (!i) {
+        kvfree(*chunks);
+        return -ENOMEM;
+    }
+    return i;
+}
+
+static void free_chunks(struct page **chunks, int nr) {
+    while (nr--)
+        __free_pages(chunks[nr], MEMTEST_ORDER);
+    kvfree(chunks);
+}
+
+static struct memtest_freq_result *freq_result(unsigned long freq_hz, bool create) {
+    int i;
+
+    for (i = 0; i < g_data->nr_freqs; i++)
+        if (g_data->freqs[i].freq_hz == freq_hz)
+            return &g_data->freqs[i];
+    if (!create || g_data->nr_freqs == MEMTEST_MAX_FREQS)
+        return NULL;
+    g_data->freqs[g_data->nr_freqs].freq_hz = freq_hz;
+    return &g_data->freqs[g_data->nr_freqs++];
+}
+
+static void publish(struct memtest_worker *workers, int nr_workers, unsigned long freq_hz,
+                    u64 total_bytes) {
+    struct memtest_freq_result *res;
+    unsigned long errors = 0;
+    int i, p;
+
+    mutex_lock(&g_data->lock);
+    g_data->runs++;
+    g_data->last_freq_hz = freq_hz;
+    g_data->last_bytes = total_bytes;
+    g_data->last_threads = nr_workers;
+    g_data->nr_errors = 0;
+    for (p = 0; p < NR_PATTERNS; p++) {
+        g_data->pattern_bytes[p] = 0;
+        g_data->pattern_ns[p] = 0;
+        g_data->pattern_errors[p] = 0;
+    }
+
+    for (i = 0; i < nr_workers; i++) {
+        struct memtest_worker *w = &workers[i];
+        int e;
+
+        for (p = 0; p < NR_PATTERNS; p++) {
+            g_data->pattern_bytes[p] += w->bytes[p];
+            g_data->pattern_ns[p] = max(g_data->pattern_ns[p], w->ns[p]);
+            g_data->pattern_errors[p] += w->err.count[p];
+            errors += w->err.count[p];
+        }
+        for (e = 0; e < w->err.nr && g_data->nr_errors < MEMTEST_MAX_ERRORS; e++)
+            g_data->errors[g_data->nr_errors++] = w->err.rec[e];
+    }
+
+    g_data->total_errors += errors;
+    res = freq_result(freq_hz, true);
+    if (res) {
+        res->runs++;
+        res->errors += errors;
+    }
+    mutex_unlock(&g_data->lock);
+
+    if (errors) {
+        pr_err("MEMTEST: %lu errors at %lu MHz, first at %pa\n",
+               errors, freq_hz / 1000000, &g_data->errors[0].addr);
+        sysfs_notify(g_data->kobj, NULL, "errors");
+    } else {
+        pr_info("MEMTEST: %llu MiB clean at %lu MHz\n", total_bytes >> 20, freq_hz / 1000000);
+    }
+    sysfs_notify(g_data->kobj, NULL, "last_run");
+}
+
+static void memtest_work(struct work_struct *work) {
+    struct memtest_worker *workers;
+    struct page **chunks;
+    unsigned long freq_hz;
+    int nr_chunks, nr_workers, per, cpu, i = 0, n;
+
+    mutex_lock(&g_data->lock);
+    freq_hz = g_data->request_hz;
+    g_data->request_hz = 0;
+    mutex_unlock(&g_data->lock);
+
+    // Hold DDR where it is to be tested, or where it is now
+    if (g_data->hold) {
+        if (!freq_hz && g_data->cur_freq)
+            freq_hz = g_data->cur_freq();
+        if (freq_hz) {
+            g_data->hold(freq_hz);
+            msleep(20);
+        }
+    }
+    if (g_data->cur_freq)
+        freq_hz = g_data->cur_freq();
+
+    nr_chunks = alloc_chunks(&chunks);
+    if (nr_chunks < 0) {
+        pr_err("MEMTEST: Could not allocate test memory\n");
+        goto out_release;
+    }
+
+    nr_workers = g_data->threads ? min(g_data->threads, num_online_cpus()) : num_online_cpus();
+    nr_workers = min(nr_workers, nr_chunks);
+    workers = kcalloc(nr_workers, sizeof(*workers), GFP_KERNEL);
+    if (!workers)
+        goto out_chunks;
+
+    pr_info("MEMTEST: Testing %d MiB at %lu MHz with %d threads\n",
+            nr_chunks << (MEMTEST_ORDER + PAGE_SHIFT - 20), freq_hz / 1000000, nr_workers);
+
+    per = nr_chunks / nr_workers;
+    cpus_read_lock();
+    for_each_online_cpu(cpu) {
+        struct memtest_worker *w = &workers[i];
+
+        if (i == nr_workers)
+            break;
+        init_completion(&w->done);
+        w->chunks = chunks + i * per;
+        w->nr_chunks = i == nr_workers - 1 ? nr_chunks - i * per : per;
+        w->seed = (g_data->runs + 1) * 0x9e3779b9 + cpu;
+        w->task = kthread_create_on_cpu(memtest_worker_fn, w, cpu, "ram_memtest/%u");
+        if (IS_ERR(w->task)) {
+            w->task = NULL;
+            continue;
+        }
+        wake_up_process(w->task);
+        i++;
+    }
+    cpus_read_unlock();
+    n = i;
+
+    for (i = 0; i < n; i++) {
+        wait_for_completion(&workers[i].done);
+        kthread_stop(workers[i].task);
+    }
+
+    // Workers that could not start leave their chunks untested
+    if (n && !memtest_aborted()) {
+        u64 total = 0;
+        int p;
+
+        for (i = 0; i < n; i++)
+            for (p = 0; p < NR_PATTERNS; p++)
+                total += workers[i].bytes[p];
+        publish(workers, n, freq_hz, total);
+    }
+
+    kfree(workers);
+out_chunks:
+    free_chunks(chunks, nr_chunks);
+out_release:
+    if (g_data->hold)
+        g_data->hold(0);
+    WRITE_ONCE(g_data->running, false);
+    sysfs_notify(g_data->kobj, NULL, "status");
+}
+
+static int memtest_start(unsigned long freq_hz) {
+    if (xchg(&g_data->running, true))
+        return -EBUSY;
+
+    mutex_lock(&g_data->lock);
+    g_data->request_hz = freq_hz;
+    mutex_unlock(&g_data->lock);
+
+    queue_work(system_long_wq, &g_data->work);
+    sysfs_notify(g_data->kobj, NULL, "status");
+    return 0;
+}
+
+// ram_overclock switched DDR: test frequencies that have no result yet
+static int memtest_transition(struct notifier_block *nb, unsigned long event, void *data) {
+    unsigned long freq_hz = *(unsigned long *)data;
+    bool tested;
+
+    if (event != RAM_OVERCLOCK_APPLIED || !READ_ONCE(g_data->on_transition))
+        return NOTIFY_DONE;
+
+    mutex_lock(&g_data->lock);
+    tested = freq_result(freq_hz, false) != NULL;
+    mutex_unlock(&g_data->lock);
+
+    if (!tested)
+        memtest_start(freq_hz);
+    return NOTIFY_OK;
+}
+
+// Sysfs interface
+static ssize_t run_store(struct kobject *kobj, struct kobj_attribute *attr,
+                         const char *buf, size_t count) {
+    unsigned long mhz = 0;
+    int ret;
+
+    if (!sysfs_streq(buf, "current")) {
+        ret = kstrtoul(buf, 10, &mhz);
+        if (ret)
+            return ret;
+        if (mhz && !g_data->hold)
+            return -EOPNOTSUPP;
+    }
+
+    ret = memtest_start(mhz * 1000000);
+    return ret ? ret : count;
+}
+
+static ssize_t status_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%s\n", READ_ONCE(g_data->running) ? "running" : "idle");
+}
+
+static ssize_t last_run_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    ssize_t len;
+    int p;
+
+    mutex_lock(&g_data->lock);
+    if (!g_data->runs) {
+        mutex_unlock(&g_data->lock);
+        return sprintf(buf, "none\n");
+    }
+    len = sprintf(buf, "freq_mhz: %lu\nmib: %llu\nthreads: %d\n",
+                  g_data->last_freq_hz / 1000000,
+                  g_data->last_bytes >> 20, g_data->last_threads);
+    for (p = 0; p < NR_PATTERNS; p++)
+        len += sprintf(buf + len, "%s: %llu MB/s, %lu errors\n", pattern_names[p],
+                       g_data->pattern_ns[p] ?
+                       div64_u64(g_data->pattern_bytes[p] * 1000, g_data->pattern_ns[p]) : 0,
+                       g_data->pattern_errors[p]);
+    mutex_unlock(&g_data->lock);
+    return len;
+}
+
+static ssize_t errors_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    ssize_t len;
+    int i;
+
+    mutex_lock(&g_data->lock);
+    len = sprintf(buf, "%lu\n", g_data->total_errors);
+    for (i = 0; i < g_data->nr_errors; i++)
+        len += sprintf(buf + len, "%pa %s expected 0x%08x got 0x%08x\n",
+                       &g_data->errors[i].addr, pattern_names[g_data->errors[i].pattern],
+                       g_data->errors[i].expected, g_data->errors[i].actual);
+    mutex_unlock(&g_data->lock);
+    return len;
+}
+
+static ssize_t results_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    ssize_t len = 0;
+    int i;
+
+    mutex_lock(&g_data->lock);
+    for (i = 0; i < g_data->nr_freqs; i++)
+        len += sprintf(buf + len, "%lu MHz: %s, %u runs, %lu errors\n",
+                       g_data->freqs[i].freq_hz / 1000000,
+                       g_data->freqs[i].errors ? "fail" : "pass",
+                       g_data->freqs[i].runs, g_data->freqs[i].errors);
+    mutex_unlock(&g_data->lock);
+    return len;
+}
+
+// Forget all results, so every frequency gets tested again
+static ssize_t results_store(struct kobject *kobj, struct kobj_attribute *attr,
+                             const char *buf, size_t count) {
+    mutex_lock(&g_data->lock);
+    g_data->nr_freqs = 0;
+    mutex_unlock(&g_data->lock);
+    return count;
+}
+
+RADXA_TUNABLE_ATTR(mem_percent, 1, 75);
+RADXA_TUNABLE_ATTR(threads, 0, NR_CPUS);
+RADXA_TUNABLE_ATTR(on_transition, 0, 1);
+RADXA_TUNABLE_ATTR(hammer_count, 0, 10000000);
+RADXA_TUNABLE_ATTR(hammer_rows, 0, 65536);
+
+static struct kobj_attribute run_attr = __ATTR_WO(run);
+static struct kobj_attribute status_attr = __ATTR_RO(status);
+static struct kobj_attribute last_run_attr = __ATTR_RO(last_run);
+static struct kobj_attribute errors_attr = __ATTR_RO(errors);
+static struct kobj_attribute results_attr = __ATTR_RW(results);
+
+static struct attribute *memtest_attrs[] = {
+    &run_attr.attr,
+    &status_attr.attr,
+    &last_run_attr.attr,
+    &errors_attr.attr,
+    &results_attr.attr,
+    &mem_percent_attr.attr.attr,
+    &threads_attr.attr.attr,
+    &on_transition_attr.attr.attr,
+    &hammer_count_attr.attr.attr,
+    &hammer_rows_attr.attr.attr,
+    NULL,
+};
+
+static const struct attribute_group memtest_group = {
+    .attrs = memtest_attrs,
+};
+
+static void put_hooks(void) {
+    if (g_data->register_nb) symbol_put(ram_overclock_register_notifier);
+    if (g_data->unregister_nb) symbol_put(ram_overclock_unregister_notifier);
+    if (g_data->hold) symbol_put(ram_overclock_hold);
+    if (g_data->cur_freq) symbol_put(ram_overclock_cur_freq);
+}
+
+static int __init ram_memtest_init(void) {
+    int ret;
+
+    pr_info("MEMTEST: Loading DDR pattern test...\n");
+
+    g_data = kzalloc(sizeof(*g_data), GFP_KERNEL);
+    if (!g_data)
+        return -ENOMEM;
+
+    g_data->mem_percent = 10;
+    g_data->threads = 0;
+    g_data->on_transition = 0;
+    g_data->hammer_count = 20000;
+    g_data->hammer_rows = 64;
+    mem_percent_attr.value = &g_data->mem_percent;
+    threads_attr.value = &g_data->threads;
+    on_transition_attr.value = &g_data->on_transition;
+    hammer_count_attr.value = &g_data->hammer_count;
+    hammer_rows_attr.value = &g_data->hammer_rows;
+    mutex_init(&g_data->lock);
+    INIT_WORK(&g_data->work, memtest_work);
+
+    g_data->kobj = kobject_create_and_add("ram_memtest", kernel_kobj);
+    if (!g_data->kobj) {
+        ret = -ENOMEM;
+        goto err_free;
+    }
+    ret = sysfs_create_group(g_data->kobj, &memtest_group);
+    if (ret)
+        goto err_kobj;
+
+    // Tests on demand on its own; ram_overclock adds holding DDR at the
+    // tested frequency and the transition trigger
+    g_data->register_nb = symbol_get(ram_overclock_register_notifier);
+    g_data->unregister_nb = symbol_get(ram_overclock_unregister_notifier);
+    g_data->hold = symbol_get(ram_overclock_hold);
+    g_data->cur_freq = symbol_get(ram_overclock_cur_freq);
+    if (g_data->register_nb && g_data->unregister_nb) {
+        g_data->transition_nb.notifier_call = memtest_transition;
+        g_data->register_nb(&g_data->transition_nb);
+    } else {
+        pr_warn("MEMTEST: ram_overclock not loaded, DDR frequency neither held nor followed\n");
+    }
+
+    pr_info("MEMTEST: Control interface at /sys/kernel/ram_memtest/\n");
+    return 0;
+
+err_kobj:
+    kobject_put(g_data->kobj);
+err_free:
+    kfree(g_data);
+    return ret;
+}
+
+static void __exit ram_memtest_exit(void) {
+    pr_info("MEMTEST: Unloading module...\n");
+
+    if (g_data) {
+        if (g_data->register_nb && g_data->unregister_nb)
+            g_data->unregister_nb(&g_data->transition_nb);
+        WRITE_ONCE(g_data->abort, true);
+        cancel_work_sync(&g_data->work);
+        put_hooks();
+
+        sysfs_remove_group(g_data->kobj, &memtest_group);
+        kobject_put(g_data->kobj);
+        kfree(g_data);
+    }
+
+    pr_info("MEMTEST: Module unloaded\n");
+}
+
+module_init(ram_memtest_init);
+module_exit(ram_memtest_exit);
+
+MODULE_AUTHOR("Radxa Performance Team");
+MODULE_DESCRIPTION("Multithreaded DDR pattern test at the applied frequency for A733 SoC");
+MODULE_LICENSE("GPL v2");
+MODULE_VERSION("1.0");
@@ -0,0 +1,116 @@
+// NEON half of ram_memtest, built without -mgeneral-regs-only
+#include <linux/types.h>
+#include <asm/neon-intrinsics.h>
+
+#include "ram_memtest.h"
+
+#define VECS (MEMTEST_BLOCK_WORDS / 4)
+
+// Slow path: find the words of a block that differ
+static size_t scan_block(const u32 *addr, const uint32x4_t *got, const u32 *expect,
+                         struct memtest_errors *err) {
+    u32 words[MEMTEST_BLOCK_WORDS];
+    size_t errors = 0;
+    int i;
+
+    for (i = 0; i < VECS; i++)
+        vst1q_u32(words + 4 * i, got[i]);
+    for (i = 0; i < MEMTEST_BLOCK_WORDS; i++) {
+        if (words[i] != expect[i]) {
+            memtest_record(err, addr + i, expect[i], words[i]);
+            errors++;
+        }
+    }
+    return errors;
+}
+
+void memtest_neon_fill(u32 *buf, size_t words, const u32 *tmpl) {
+    uint32x4_t t[VECS];
+    size_t b;
+    int i;
+
+    for (i = 0; i < VECS; i++)
+        t[i] = vld1q_u32(tmpl + 4 * i);
+
+    for (b = 0; b + MEMTEST_BLOCK_WORDS <= words; b += MEMTEST_BLOCK_WORDS)
+        for (i = 0; i < VECS; i++)
+            vst1q_u32(buf + b + 4 * i, t[i]);
+}
+
+size_t memtest_neon_check(u32 *buf, size_t words, const u32 *expect, const u32 *next,
+                          bool down, struct memtest_errors *err) {
+    size_t nr_blocks = words / MEMTEST_BLOCK_WORDS, b, errors = 0;
+    uint32x4_t e[VECS], n[VECS], got[VECS];
+    int i;
+
+    for (i = 0; i < VECS; i++) {
+        e[i] = vld1q_u32(expect + 4 * i);
+        if (next)
+            n[i] = vld1q_u32(next + 4 * i);
+    }
+
+    for (b = 0; b < nr_blocks; b++) {
+        u32 *p = buf + (down ? nr_blocks - 1 - b : b) * MEMTEST_BLOCK_WORDS;
+        uint32x4_t diff = vdupq_n_u32(0);
+
+        for (i = 0; i < VECS; i++) {
+            got[i] = vld1q_u32(p + 4 * i);
+            diff = vorrq_u32(diff, veorq_u32(got[i], e[i]));
+        }
+        if (vmaxvq_u32(diff))
+            errors += scan_block(p, got, expect, err);
+        if (next)
+            for (i = 0; i < VECS; i++)
+                vst1q_u32(p + 4 * i, n[i]);
+    }
+    return errors;
+}
+
+// xorshift32 never leaves 0, so every lane starts odd
+static uint32x4_t random_seed(u32 seed) {
+    const u32 lanes[4] = { seed | 1, (seed ^ 0x9e3779b9) | 1,
+                           (seed * 3 + 0x7f4a7c15) | 1, ~seed | 1 };
+
+    return vld1q_u32(lanes);
+}
+
+static inline uint32x4_t random_next(uint32x4_t s) {
+    s = veorq_u32(s, vshlq_n_u32(s, 13));
+    s = veorq_u32(s, vshrq_n_u32(s, 17));
+    return veorq_u32(s, vshlq_n_u32(s, 5));
+}
+
+void memtest_neon_random_fill(u32 *buf, size_t words, u32 seed) {
+    uint32x4_t s = random_seed(seed);
+    size_t i;
+
+    for (i = 0; i + 4 <= words; i += 4) {
+        s = random_next(s);
+        vst1q_u32(buf + i, s);
+    }
+}
+
+size_t memtest_neon_random_check(const u32 *buf, size_t words, u32 seed,
+                                 struct memtest_errors *err) {
+    uint32x4_t s = random_seed(seed), e[VECS], got[VECS];
+    u32 expect[MEMTEST_BLOCK_WORDS];
+    size_t b, errors = 0;
+    int i;
+
+    for (b = 0; b + MEMTEST_BLOCK_WORDS <= words; b += MEMTEST_BLOCK_WORDS) {
+        uint32x4_t diff = vdupq_n_u32(0);
+
+        for (i = 0; i < VECS; i++) {
+            s = random_next(s);
+            e[i] = s;
+            got[i] = vld1q_u32(buf + b + 4 * i);
+            diff = vorrq_u32(diff, veorq_u32(got[i], e[i]));
+        }
+        if (vmaxvq_u32(diff)) {
+            for (i = 0; i < VECS; i++)
+                vst1q_u32(expect + 4 * i, e[i]);
+            errors += scan_block(buf + b, got, expect, err);
+        }
+    }
+    return errors;
+}
@@ -6,25 +6,170 @@
 #include <linux/clk.h>
 #include <linux/clk-provider.h>
 #include <linux/devfreq.h>
+#include <linux/pm_opp.h>
+#include <linux/pm_qos.h>
+#include <linux/io.h>
+#include <linux/workqueue.h>
+#include <linux/mutex.h>
+#include <linux/seqlock.h>
 #include <linux/sysfs.h>
 #include <linux/kobject.h>
 #include <linux/delay.h>
 #include <linux/regulator/consumer.h>
+#include <linux/ktime.h>
+#include <linux/suspend.h>
+
+#include "radxa_overclock_uapi.h"
+#include "radxa_clk_watch.h"
+#include "radxa_freq_stats.h"
+#include "radxa_overclock_hooks.h"
+#include "radxa_overclock_try.h"
 
 #define MODULE_NAME "ram_overclock"
+#define DMC_DEVICE_NAME "a020000.dmcfreq"
+#define DDR_STOCK_MAX_HZ 1800000000UL
+#define MCU_CCU_COMPATIBLE "allwinner,sun55i-a523-mcu-ccu"
+
+// MBUS PMU bandwidth counters, same layout as sun8i-a33-mbus
+#define MBUS_PMU_CFG            0x009c
+#define MBUS_PMU_BWCR(n)        (0x00a0 + (0x04 * (n)))
+#define MBUS_PMU_CFG_UNIT_KB    (0x1 << 1)
+#define MBUS_PMU_CFG_ENABLE     (0x1 << 0)
+#define MBUS_REG_SIZE           0x100
+
+// Physical base of the MBUS registers; 0 uses the load statistics of the
+// dmcfreq devfreq instead of the PMU counters. The counters are only used
+// when no other driver claimed the registers.
+static unsigned long mbus_base;
+module_param(mbus_base, ulong, 0444);
+MODULE_PARM_DESC(mbus_base, "MBUS register base for bandwidth counters (0 = use dmcfreq stats)");
+
+static unsigned int mbus_total_bwcr = 13;
+module_param(mbus_total_bwcr, uint, 0444);
+MODULE_PARM_DESC(mbus_total_bwcr, "Index of the total bandwidth counter register");
+
+// DRAM bytes moved per controller clock (32-bit bus, double data rate)
+static unsigned int bus_bytes_per_cycle = 8;
+module_param(bus_bytes_per_cycle, uint, 0444);
+MODULE_PARM_DESC(bus_bytes_per_cycle, "DRAM bytes transferred per clock cycle");
+
+// MBUS sits on the system rail, shared with the GPU; the regulator core
+// keeps the highest of the consumers' requests
+static char *mbus_supply_name = "vdd-gpu-sys";
+module_param(mbus_supply_name, charp, 0444);
+MODULE_PARM_DESC(mbus_supply_name, "Regulator feeding the MBUS interconnect");
+
+// Last committed "FREQ_MHZ" or "auto", applied at load (see radxa_overclock_try.h)
+static char *lkg;
+module_param(lkg, charp, 0444);
+MODULE_PARM_DESC(lkg, "Last-known-good setting, applied at load");
+
+static unsigned int try_timeout_s = 30;
+module_param(try_timeout_s, uint, 0644);
+MODULE_PARM_DESC(try_timeout_s, "Seconds a tried setting has to be committed");
+
+// What to do when someone else changes the DDR or MBUS clock we set
+RADXA_CW_POLICY_PARAM(drift_policy);
+MODULE_PARM_DESC(drift_policy, "On external clock changes: log or reassert");
+
+// Applied state as the sysfs readers see it, copied under state_lock so
+// monitoring never takes the clock framework's global prepare lock
+struct ddr_state {
+    unsigned long cur_hz;
+    unsigned long target_hz;
+    int voltage_uv;
+    bool overclocked;
+    unsigned long mbus_hz;
+};
 
 struct ram_overclock_data {
     struct clk *ddr_clk;
     struct clk *pll_ddr;
     struct regulator *ddr_supply;
     struct kobject *kobj;
+    struct device *dmc_dev;
     struct devfreq *devfreq_dev;
-    unsigned long target_freq;
+    bool own_opp_notifier;      // dmcfreq did not register one itself
+    unsigned long added[16];    // OPPs registered by this module
+    int nr_added;
+    struct mutex ddr_lock;  // Serializes DDR changes and the fields below
+    unsigned long target_freq;  // With devfreq: the higher of the two floors
+    unsigned long manual_floor; // ram_overclock echo, 0 for auto
+    unsigned long bw_target;    // Bandwidth governor's request, 0 for none
+    int voltage_uv;         // Last voltage applied to the DDR rail, 0 under devfreq
+    unsigned int rate_misses; // Applied rate differs from the request
     bool overclocked;
+    struct kobject *stats_kobj;         // freq_stats/
+    struct radxa_freq_stats *stats;     // Residency, only without devfreq
+    struct radxa_clk_watch ddr_watch;   // External rate changes, only without devfreq
+    struct radxa_clk_watch mbus_watch;
+    struct notifier_block pm_nb;
+
+    // Bandwidth governor: raises the devfreq floor while traffic needs it
+    struct dev_pm_qos_request manual_req;   // ram_overclock echo
+    struct dev_pm_qos_request bw_req;       // Bandwidth governor
+    struct dev_pm_qos_request stall_req;    // mem_stall_governor
+    struct dev_pm_qos_request hold_min_req; // ram_memtest holds DDR still
+    struct dev_pm_qos_request hold_max_req;
+    unsigned long stall_floor;
+    struct delayed_work bw_work;
+    void __iomem *mbus;
+    ktime_t bw_last;
+    struct devfreq_dev_status bw_last_status;   // Last devfreq load seen
+    bool bw_governor;
+    unsigned int bw_poll_ms;
+    unsigned int bw_up_threshold;       // % of peak bandwidth
+    unsigned int bw_down_threshold;
+    unsigned long bandwidth_kbps;       // Last measured, kB/s
+    unsigned int bw_util;               // Last measured, % of peak
+
+    // MBUS interconnect, coupled to the DDR frequency
+    struct clk *mbus_clk;
+    struct regulator *mbus_supply;
+    struct notifier_block ddr_transition_nb;
+    struct mutex mbus_lock;
+    bool mbus_coupling;
+    unsigned long mbus_stock_hz;        // Restored on unload
+    unsigned long mbus_target_hz;
+    int mbus_voltage_uv;
+
+    seqlock_t state_lock;
+    struct ddr_state state;
+
+    struct radxa_oc_try try;
 };
 
 static struct ram_overclock_data *g_data;
 
+// Told about every DDR frequency that takes effect (ram_memtest)
+static BLOCKING_NOTIFIER_HEAD(ram_overclock_chain);
+
+// Writers hold ddr_lock; cur_hz is the rate the DDR runs at now
+static void publish_ddr(unsigned long cur_hz) {
+    write_seqlock(&g_data->state_lock);
+    g_data->state.cur_hz = cur_hz;
+    g_data->state.target_hz = g_data->target_freq;
+    g_data->state.voltage_uv = g_data->voltage_uv;
+    g_data->state.overclocked = g_data->overclocked;
+    write_sequnlock(&g_data->state_lock);
+}
+
+// Writers hold mbus_lock
+static void publish_mbus(unsigned long hz) {
+    write_seqlock(&g_data->state_lock);
+    g_data->state.mbus_hz = hz;
+    write_sequnlock(&g_data->state_lock);
+}
+
+static void read_state(struct ddr_state *st) {
+    unsigned int seq;
+
+    do {
+        seq = read_seqbegin(&g_data->state_lock);
+        *st = g_data->state;
+    } while (read_seqretry(&g_data->state_lock, seq));
+}
+
 // Extended frequency table beyond the standard 1800MHz limit
 static unsigned long extended_ram_freqs[] = {
     400000000,   // 400MHz  - Ultra low power
@@ -41,27 +186,156 @@ static unsigned long extended_ram_freqs[] = {
 // Voltage mapping for DDR overclocking
 static int get_ddr_voltage_for_freq(unsigned long freq_hz) {
     unsigned long freq_mhz = freq_hz / 1000000;
-    
+
     if (freq_mhz <= 1200) return 1200000;      // 1.2V
     else if (freq_mhz <= 1800) return 1350000; // 1.35V (JEDEC standard)
-    else if (freq_mhz <= 2000) return 1400000; // 1.4V  
+    else if (freq_mhz <= 2000) return 1400000; // 1.4V
     else if (freq_mhz <= 2200) return 1450000; // 1.45V
     else if (freq_mhz <= 2400) return 1500000; // 1.5V
     else return 1550000;                       // 1.55V (extreme)
 }
 
+// Interconnect point for each DDR range. Without a faster MBUS the NPU
+// and GPU never see the extra DDR bandwidth.
+struct mbus_point {
+    unsigned long ddr_max_hz;
+    unsigned long mbus_hz;
+    int voltage_uv;
+};
+
+static const struct mbus_point mbus_coupling_table[] = {
+    { 1200000000,  400000000,  900000 },
+    { 1800000000,  600000000,  920000 },  // Stock
+    { 2200000000,  700000000,  960000 },
+    { 2600000000,  800000000, 1000000 },
+    { 0 }
+};
+
+static const struct mbus_point *mbus_point_for(unsigned long ddr_hz) {
+    const struct mbus_point *p = mbus_coupling_table;
+
+    while (p[1].ddr_max_hz && ddr_hz > p->ddr_max_hz)
+        p++;
+    return p;
+}
+
+// Raising: rail, then MBUS, before DDR moves. Lowering: MBUS, then rail,
+// after DDR has moved.
+static void set_mbus_point(const struct mbus_point *p, bool raising) {
+    unsigned long actual;
+    int ret;
+
+    mutex_lock(&g_data->mbus_lock);
+
+    if (raising && g_data->mbus_supply) {
+        ret = regulator_set_voltage(g_data->mbus_supply, p->voltage_uv, p->voltage_uv + 50000);
+        if (ret)
+            pr_warn("RAM_OVERCLOCK: Failed to set MBUS voltage to %duV: %d\n", p->voltage_uv, ret);
+        else
+            g_data->mbus_voltage_uv = p->voltage_uv;
+    }
+
+    radxa_cw_begin(&g_data->mbus_watch);
+    ret = clk_set_rate(g_data->mbus_clk, p->mbus_hz);
+    radxa_cw_end(&g_data->mbus_watch, ret ? 0 : p->mbus_hz);
+    actual = clk_get_rate(g_data->mbus_clk);
+    if (ret || abs((long)(actual - p->mbus_hz)) > p->mbus_hz / 100) {
+        g_data->rate_misses++;
+        pr_warn("RAM_OVERCLOCK: MBUS runs at %lu MHz, requested %lu MHz (%d)\n",
+                actual / 1000000, p->mbus_hz / 1000000, ret);
+        sysfs_notify(g_data->kobj, NULL, "rate_misses");
+    }
+    g_data->mbus_target_hz = p->mbus_hz;
+    publish_mbus(actual);
+
+    if (!raising && g_data->mbus_supply) {
+        ret = regulator_set_voltage(g_data->mbus_supply, p->voltage_uv, p->voltage_uv + 50000);
+        if (!ret)
+            g_data->mbus_voltage_uv = p->voltage_uv;
+    }
+
+    mutex_unlock(&g_data->mbus_lock);
+
+    sysfs_notify(g_data->kobj, NULL, "mbus_freq_hz");
+    sysfs_notify(g_data->kobj, NULL, "mbus_voltage_uv");
+}
+
+// Called around every DDR change, before (pre) and after it
+static void couple_mbus(unsigned long old_hz, unsigned long new_hz, bool pre) {
+    const struct mbus_point *p;
+
+    if (!g_data->mbus_clk || !g_data->mbus_coupling)
+        return;
+
+    p = mbus_point_for(new_hz);
+    if (p->mbus_hz == g_data->mbus_target_hz)
+        return;
+    if (pre && new_hz > old_hz)
+        set_mbus_point(p, true);
+    else if (!pre && new_hz < old_hz)
+        set_mbus_point(p, false);
+}
+
+// devfreq switches DDR on its own schedule; follow it
+static int ddr_transition_notifier(struct notifier_block *nb, unsigned long event, void *data) {
+    struct devfreq_freqs *freqs = data;
+
+    if (event == DEVFREQ_PRECHANGE)
+        couple_mbus(freqs->old, freqs->new, true);
+    else if (event == DEVFREQ_POSTCHANGE) {
+        couple_mbus(freqs->old, freqs->new, false);
+        mutex_lock(&g_data->ddr_lock);
+        // The hardware rate, not the floor that was asked for
+        g_data->overclocked = freqs->new > DDR_STOCK_MAX_HZ;
+        publish_ddr(freqs->new);
+        mutex_unlock(&g_data->ddr_lock);
+        if (freqs->new != freqs->old)
+            blocking_notifier_call_chain(&ram_overclock_chain, RAM_OVERCLOCK_APPLIED,
+                                         &freqs->new);
+    }
+    return NOTIFY_OK;
+}
+
+// From the hardware, for the writers
+static unsigned long ddr_hw_freq(void) {
+    if (g_data->ddr_clk)
+        return clk_get_rate(g_data->ddr_clk);
+    return g_data->devfreq_dev ? g_data->devfreq_dev->previous_freq : 0;
+}
+
+// As last published, for everyone else
+static unsigned long ddr_cur_freq(void) {
+    struct ddr_state st;
+
+    read_state(&st);
+    return st.cur_hz;
+}
+
+// Wake up poll()ers on the per-value files
+static void notify_ddr_change(void) {
+    sysfs_notify(g_data->kobj, NULL, "cur_freq_hz");
+    sysfs_notify(g_data->kobj, NULL, "target_freq_hz");
+    sysfs_notify(g_data->kobj, NULL, "voltage_uv");
+    sysfs_notify(g_data->kobj, NULL, "overclocked");
+}
+
 static int set_ddr_frequency(unsigned long freq) {
     int ret;
     unsigned long actual_freq;
+    unsigned long old_freq;
     int voltage;
-    
+
     if (!g_data->ddr_clk) {
         pr_err("RAM_OVERCLOCK: DDR clock not available\n");
         return -EINVAL;
     }
-    
+
     pr_info("RAM_OVERCLOCK: Attempting to set DDR frequency to %lu MHz\n", freq / 1000000);
-    
+
+    mutex_lock(&g_data->ddr_lock);
+    old_freq = clk_get_rate(g_data->ddr_clk);
+    couple_mbus(old_freq, freq, true);
+
     // Set voltage first if we have regulator
     if (g_data->ddr_supply) {
         voltage = get_ddr_voltage_for_freq(freq);
@@ -70,119 +344,939 @@ static int set_ddr_frequency(unsigned long freq) {
             pr_warn("RAM_OVERCLOCK: Failed to set DDR voltage to %duV: %d\n", voltage, ret);
         } else {
             pr_info("RAM_OVERCLOCK: Set DDR voltage to %duV\n", voltage);
+            g_data->voltage_uv = voltage;
             msleep(20); // Allow voltage to stabilize
         }
     }
-    
+
     // Try to set the frequency
+    radxa_cw_begin(&g_data->ddr_watch);
     ret = clk_set_rate(g_data->ddr_clk, freq);
+    radxa_cw_end(&g_data->ddr_watch, ret ? 0 : freq);
     if (ret) {
         pr_err("RAM_OVERCLOCK: Failed to set DDR frequency: %d\n", ret);
+        radxa_fs_failed(g_data->stats);
+        mutex_unlock(&g_data->ddr_lock);
         return ret;
     }
-    
+
     actual_freq = clk_get_rate(g_data->ddr_clk);
-    pr_info("RAM_OVERCLOCK: DDR frequency set to %lu MHz (requested %lu MHz)\n", 
+    radxa_fs_update(g_data->stats, actual_freq);
+    couple_mbus(old_freq, actual_freq, false);
+    pr_info("RAM_OVERCLOCK: DDR frequency set to %lu MHz (requested %lu MHz)\n",
             actual_freq / 1000000, freq / 1000000);
-    
+
     // Update our tracking
     g_data->target_freq = actual_freq;
-    g_data->overclocked = (actual_freq > 1800000000);
-    
+    g_data->overclocked = (actual_freq > DDR_STOCK_MAX_HZ);
+
+    // Tolerate PLL rounding, flag anything beyond 1%
+    if (abs((long)(actual_freq - freq)) > freq / 100) {
+        g_data->rate_misses++;
+        pr_warn("RAM_OVERCLOCK: DDR runs at %lu MHz, requested %lu MHz\n",
+                actual_freq / 1000000, freq / 1000000);
+        sysfs_notify(g_data->kobj, NULL, "rate_misses");
+    }
+
+    publish_ddr(actual_freq);
+    mutex_unlock(&g_data->ddr_lock);
+    notify_ddr_change();
+    blocking_notifier_call_chain(&ram_overclock_chain, RAM_OVERCLOCK_APPLIED, &actual_freq);
+    return 0;
+}
+
+// Under devfreq the effective target is the higher of the user's floor and
+// the bandwidth governor's request. dmcfreq sets the rail itself, so there
+// is no voltage of ours to report. Overclocked follows the rate devfreq
+// runs at; the transition notifier updates it once the floor takes effect.
+// Caller holds ddr_lock.
+static void publish_ddr_floor(void) {
+    unsigned long hz = ddr_hw_freq();
+
+    g_data->target_freq = max(g_data->manual_floor, g_data->bw_target);
+    g_data->voltage_uv = 0;
+    g_data->overclocked = hz > DDR_STOCK_MAX_HZ;
+    publish_ddr(hz);
+}
+
+// With dmcfreq present the echo sets a floor; devfreq does the switch
+// and the bandwidth governor may still go higher
+static int set_ddr_floor(unsigned long freq) {
+    int ret;
+
+    ret = dev_pm_qos_update_request(&g_data->manual_req,
+                                    freq ? freq / 1000 : PM_QOS_MIN_FREQUENCY_DEFAULT_VALUE);
+    if (ret < 0) {
+        pr_err("RAM_OVERCLOCK: Failed to update DDR floor: %d\n", ret);
+        return ret;
+    }
+
+    mutex_lock(&g_data->ddr_lock);
+    g_data->manual_floor = freq;
+    publish_ddr_floor();
+    mutex_unlock(&g_data->ddr_lock);
+
+    if (freq) {
+        pr_info("RAM_OVERCLOCK: DDR floor set to %lu MHz via devfreq\n", freq / 1000000);
+    } else {
+        pr_info("RAM_OVERCLOCK: DDR floor removed, bandwidth governor in control\n");
+    }
+
+    notify_ddr_change();
     return 0;
 }
 
+// Measured bandwidth as % of what the current frequency can deliver.
+// Without the PMU that is devfreq's busy ratio, which is no bandwidth:
+// bandwidth_kbps then reads 0.
+static unsigned int sample_bandwidth(unsigned long cur_freq) {
+    ktime_t now = ktime_get();
+    u64 elapsed_us = ktime_us_delta(now, g_data->bw_last);
+    unsigned long peak_kbps = cur_freq / 1000 * bus_bytes_per_cycle;
+
+    g_data->bw_last = now;
+    if (!elapsed_us || !peak_kbps)
+        return 0;
+
+    if (g_data->mbus) {
+        u32 total_kb = readl(g_data->mbus + MBUS_PMU_BWCR(mbus_total_bwcr));
+
+        // Restart the counters for the next period; the region is ours
+        writel_relaxed(0, g_data->mbus + MBUS_PMU_CFG);
+        writel_relaxed(MBUS_PMU_CFG_UNIT_KB | MBUS_PMU_CFG_ENABLE,
+                       g_data->mbus + MBUS_PMU_CFG);
+
+        g_data->bandwidth_kbps = div64_u64((u64)total_kb * USEC_PER_SEC, elapsed_us);
+        return min_t(u64, div64_u64((u64)g_data->bandwidth_kbps * 100, peak_kbps), 100);
+    } else {
+        struct devfreq *df = g_data->devfreq_dev;
+        struct devfreq_dev_status stat;
+        bool fresh;
+
+        // What the devfreq governor last sampled. Calling get_dev_status()
+        // here would reset dmcfreq's counters under that governor.
+        mutex_lock(&df->lock);
+        stat = df->last_status;
+        mutex_unlock(&df->lock);
+        fresh = stat.total_time && (stat.total_time != g_data->bw_last_status.total_time ||
+                                    stat.busy_time != g_data->bw_last_status.busy_time);
+        g_data->bw_last_status = stat;
+        g_data->bandwidth_kbps = 0;
+        if (!fresh)
+            return g_data->bw_util;
+        return min_t(u64, div64_u64((u64)stat.busy_time * 100, stat.total_time), 100);
+    }
+}
+
+// Lowest OPP that keeps utilisation at the middle of the threshold band
+static unsigned long bw_target_freq(unsigned long cur_freq, unsigned int util) {
+    unsigned int mid = (g_data->bw_up_threshold + g_data->bw_down_threshold) / 2;
+    unsigned long freq = div_u64((u64)cur_freq * util, mid);
+    struct dev_pm_opp *opp;
+
+    // Always step at least one OPP up when over the threshold
+    if (util >= g_data->bw_up_threshold && freq <= cur_freq)
+        freq = cur_freq + 1;
+
+    opp = dev_pm_opp_find_freq_ceil(g_data->dmc_dev, &freq);
+    if (IS_ERR(opp)) {
+        freq = ULONG_MAX;
+        opp = dev_pm_opp_find_freq_floor(g_data->dmc_dev, &freq);
+        if (IS_ERR(opp))
+            return cur_freq;
+    }
+    dev_pm_opp_put(opp);
+    return freq;
+}
+
+static void bw_governor_work(struct work_struct *work) {
+    unsigned long cur_freq = ddr_cur_freq();
+    unsigned long target = g_data->bw_target;
+    unsigned int util = sample_bandwidth(cur_freq);
+
+    g_data->bw_util = util;
+    sysfs_notify(g_data->kobj, NULL, "bandwidth_kbps");
+
+    if (util >= g_data->bw_up_threshold || util <= g_data->bw_down_threshold)
+        target = bw_target_freq(cur_freq, util);
+
+    if (target != g_data->bw_target) {
+        dev_pm_qos_update_request(&g_data->bw_req, target / 1000);
+        mutex_lock(&g_data->ddr_lock);
+        g_data->bw_target = target;
+        publish_ddr_floor();
+        mutex_unlock(&g_data->ddr_lock);
+        notify_ddr_change();
+    }
+
+    queue_delayed_work(system_power_efficient_wq, &g_data->bw_work,
+                       msecs_to_jiffies(g_data->bw_poll_ms));
+}
+
+static void bw_governor_start(void) {
+    if (!g_data->devfreq_dev || !g_data->bw_governor)
+        return;
+    if (g_data->mbus)
+        writel_relaxed(MBUS_PMU_CFG_UNIT_KB | MBUS_PMU_CFG_ENABLE,
+                       g_data->mbus + MBUS_PMU_CFG);
+    g_data->bw_last = ktime_get();
+    queue_delayed_work(system_power_efficient_wq, &g_data->bw_work,
+                       msecs_to_jiffies(g_data->bw_poll_ms));
+}
+
+static void bw_governor_stop(void) {
+    if (!g_data->devfreq_dev)
+        return;
+    cancel_delayed_work_sync(&g_data->bw_work);
+    dev_pm_qos_update_request(&g_data->bw_req, PM_QOS_MIN_FREQUENCY_DEFAULT_VALUE);
+    mutex_lock(&g_data->ddr_lock);
+    g_data->bw_target = 0;
+    publish_ddr_floor();
+    mutex_unlock(&g_data->ddr_lock);
+}
+
+// Memory-bound CPUs: step the floor up one OPP at a time while the stall
+// persists, independent of the bandwidth governor's own request
+int ram_overclock_stall_boost(bool stalled) {
+    unsigned long freq;
+    struct dev_pm_opp *opp;
+    int ret;
+
+    if (!g_data->devfreq_dev)
+        return -ENODEV;
+
+    if (!stalled) {
+        if (!g_data->stall_floor)
+            return 0;
+        g_data->stall_floor = 0;
+        ret = dev_pm_qos_update_request(&g_data->stall_req, PM_QOS_MIN_FREQUENCY_DEFAULT_VALUE);
+        return ret < 0 ? ret : 0;
+    }
+
+    freq = max(g_data->stall_floor, ddr_cur_freq()) + 1;
+    opp = dev_pm_opp_find_freq_ceil(g_data->dmc_dev, &freq);
+    if (IS_ERR(opp))
+        return 0;   // Already at the top
+    dev_pm_opp_put(opp);
+
+    g_data->stall_floor = freq;
+    ret = dev_pm_qos_update_request(&g_data->stall_req, freq / 1000);
+    return ret < 0 ? ret : 0;
+}
+EXPORT_SYMBOL_GPL(ram_overclock_stall_boost);
+
+int ram_overclock_register_notifier(struct notifier_block *nb) {
+    return blocking_notifier_chain_register(&ram_overclock_chain, nb);
+}
+EXPORT_SYMBOL_GPL(ram_overclock_register_notifier);
+
+int ram_overclock_unregister_notifier(struct notifier_block *nb) {
+    return blocking_notifier_chain_unregister(&ram_overclock_chain, nb);
+}
+EXPORT_SYMBOL_GPL(ram_overclock_unregister_notifier);
+
+// Pin devfreq to freq between a minimum and a maximum request so neither
+// the bandwidth governor nor the test's own traffic moves DDR away
+int ram_overclock_hold(unsigned long freq) {
+    s32 min_khz = freq ? freq / 1000 : PM_QOS_MIN_FREQUENCY_DEFAULT_VALUE;
+    s32 max_khz = freq ? freq / 1000 : PM_QOS_MAX_FREQUENCY_DEFAULT_VALUE;
+    int ret;
+
+    // Without devfreq the clock only moves on an echo
+    if (!g_data->devfreq_dev)
+        return 0;
+
+    // Order matters: the range must never be empty in between
+    if (freq && freq / 1000 < ddr_cur_freq() / 1000) {
+        ret = dev_pm_qos_update_request(&g_data->hold_max_req, max_khz);
+        if (ret >= 0)
+            ret = dev_pm_qos_update_request(&g_data->hold_min_req, min_khz);
+    } else {
+        ret = dev_pm_qos_update_request(&g_data->hold_min_req, min_khz);
+        if (ret >= 0)
+            ret = dev_pm_qos_update_request(&g_data->hold_max_req, max_khz);
+    }
+    return ret < 0 ? ret : 0;
+}
+EXPORT_SYMBOL_GPL(ram_overclock_hold);
+
+unsigned long ram_overclock_cur_freq(void) {
+    return ddr_cur_freq();
+}
+EXPORT_SYMBOL_GPL(ram_overclock_cur_freq);
+
 // Sysfs interface for RAM frequency control
 static ssize_t ram_overclock_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
-    unsigned long current_freq = g_data->ddr_clk ? clk_get_rate(g_data->ddr_clk) : 0;
-    
-    return sprintf(buf, "DDR: %lu MHz\nOverclocked: %s\nAvailable frequencies: 400, 800, 1200, 1800, 2000, 2200, 2400, 2600\nUsage: echo FREQ_MHZ > ram_overclock\nExample: echo 2000 > ram_overclock\nWarning: Frequencies above 1800MHz are overclocked!\n",
-           current_freq / 1000000, g_data->overclocked ? "YES" : "NO");
+    struct ddr_state st;
+
+    read_state(&st);
+    return sprintf(buf, "DDR: %lu MHz\nMBUS: %lu MHz (coupling %s)\nOverclocked: %s\nBandwidth governor: %s (%lu kB/s, %u%%)\nAvailable frequencies: 400, 800, 1200, 1800, 2000, 2200, 2400, 2600\nUsage: echo FREQ_MHZ > ram_overclock\nExample: echo 2000 > ram_overclock\nUse 'echo auto > ram_overclock' to let bandwidth decide\nWarning: Frequencies above 1800MHz are overclocked!\n",
+           st.cur_hz / 1000000, st.mbus_hz / 1000000,
+           g_data->mbus_clk && g_data->mbus_coupling ? "on" : "off",
+           st.overclocked ? "YES" : "NO",
+           g_data->devfreq_dev && g_data->bw_governor ? "on" : "off",
+           g_data->bandwidth_kbps, g_data->bw_util);
 }
 
-static ssize_t ram_overclock_store(struct kobject *kobj, struct kobj_attribute *attr,
-                                  const char *buf, size_t count) {
+static int apply_ram_setting(const char *buf) {
     unsigned long freq_mhz;
     unsigned long freq_hz;
     int ret;
-    
+
+    if (sysfs_streq(buf, "auto")) {
+        if (!g_data->devfreq_dev)
+            return -ENODEV;
+        return set_ddr_floor(0);
+    }
+
     ret = kstrtoul(buf, 10, &freq_mhz);
     if (ret) {
         pr_err("RAM_OVERCLOCK: Invalid frequency value\n");
         return ret;
     }
-    
+
     freq_hz = freq_mhz * 1000000;
-    
+
     // Validate frequency range
     if (freq_hz < 400000000 || freq_hz > 2600000000) {
         pr_err("RAM_OVERCLOCK: Frequency out of range (400-2600 MHz)\n");
         return -EINVAL;
     }
-    
-    if (freq_hz > 1800000000) {
+
+    if (freq_hz > DDR_STOCK_MAX_HZ) {
         pr_warn("RAM_OVERCLOCK: ⚠️  OVERCLOCKING WARNING: %lu MHz exceeds specification!\n", freq_mhz);
         pr_warn("RAM_OVERCLOCK: Monitor system stability and temperature!\n");
     }
-    
-    ret = set_ddr_frequency(freq_hz);
+
+    if (g_data->devfreq_dev)
+        ret = set_ddr_floor(freq_hz);
+    else
+        ret = set_ddr_frequency(freq_hz);
     if (ret) {
         pr_err("RAM_OVERCLOCK: Failed to set DDR frequency\n");
         return ret;
     }
-    
+
     pr_info("RAM_OVERCLOCK: ✅ DDR frequency successfully set to %lu MHz\n", freq_mhz);
-    return count;
+    return 0;
+}
+
+static ssize_t ram_overclock_store(struct kobject *kobj, struct kobj_attribute *attr,
+                                  const char *buf, size_t count) {
+    int ret = apply_ram_setting(buf);
+
+    return ret ? ret : count;
 }
 
 static struct kobj_attribute ram_overclock_attr = __ATTR(ram_overclock, 0664, ram_overclock_show, ram_overclock_store);
 
+// Machine-readable interface: one value per file
+static ssize_t cur_freq_hz_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%lu\n", ddr_cur_freq());
+}
+
+static ssize_t target_freq_hz_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    struct ddr_state st;
+
+    read_state(&st);
+    return sprintf(buf, "%lu\n", st.target_hz);
+}
+
+static ssize_t voltage_uv_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    struct ddr_state st;
+
+    read_state(&st);
+    return sprintf(buf, "%d\n", st.voltage_uv);
+}
+
+static ssize_t overclocked_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    struct ddr_state st;
+
+    read_state(&st);
+    return sprintf(buf, "%d\n", st.overclocked);
+}
+
+static ssize_t rate_misses_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%u\n", g_data->rate_misses);
+}
+
+// Rate changes made behind our back, and who made the last one
+static ssize_t drift_count_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%u\n", radxa_cw_drift_count(&g_data->ddr_watch));
+}
+
+static ssize_t last_drift_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return radxa_cw_offender_show(&g_data->ddr_watch, buf);
+}
+
+static ssize_t mbus_drift_count_show(struct kobject *kobj, struct kobj_attribute *attr,
+                                     char *buf) {
+    return sprintf(buf, "%u\n", radxa_cw_drift_count(&g_data->mbus_watch));
+}
+
+static ssize_t mbus_last_drift_show(struct kobject *kobj, struct kobj_attribute *attr,
+                                    char *buf) {
+    return radxa_cw_offender_show(&g_data->mbus_watch, buf);
+}
+
+static ssize_t bandwidth_kbps_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%lu\n", g_data->bandwidth_kbps);
+}
+
+static ssize_t bw_governor_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%d\n", g_data->bw_governor ? 1 : 0);
+}
+
+static ssize_t bw_governor_store(struct kobject *kobj, struct kobj_attribute *attr,
+                                 const char *buf, size_t count) {
+    bool enable;
+    int ret;
+
+    ret = kstrtobool(buf, &enable);
+    if (ret)
+        return ret;
+    if (!g_data->devfreq_dev)
+        return -ENODEV;
+
+    if (enable != g_data->bw_governor) {
+        g_data->bw_governor = enable;
+        if (enable) {
+            bw_governor_start();
+        } else {
+            bw_governor_stop();
+            notify_ddr_change();
+        }
+    }
+    return count;
+}
+
+static ssize_t bw_poll_ms_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%u\n", g_data->bw_poll_ms);
+}
+
+static ssize_t bw_poll_ms_store(struct kobject *kobj, struct kobj_attribute *attr,
+                                const char *buf, size_t count) {
+    unsigned int value;
+    int ret;
+
+    ret = kstrtouint(buf, 10, &value);
+    if (ret)
+        return ret;
+    if (value < 10 || value > 10000)
+        return -EINVAL;
+
+    g_data->bw_poll_ms = value;
+    return count;
+}
+
+static ssize_t bw_threshold_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    bool up = !strcmp(attr->attr.name, "bw_up_threshold");
+
+    return sprintf(buf, "%u\n", up ? g_data->bw_up_threshold : g_data->bw_down_threshold);
+}
+
+static ssize_t bw_threshold_store(struct kobject *kobj, struct kobj_attribute *attr,
+                                  const char *buf, size_t count) {
+    bool up = !strcmp(attr->attr.name, "bw_up_threshold");
+    unsigned int value;
+    int ret;
+
+    ret = kstrtouint(buf, 10, &value);
+    if (ret)
+        return ret;
+
+    // Keep a band between the two, or the governor would oscillate
+    if (value > 100 ||
+        (up && value <= g_data->bw_down_threshold) ||
+        (!up && value >= g_data->bw_up_threshold))
+        return -EINVAL;
+
+    if (up)
+        g_data->bw_up_threshold = value;
+    else
+        g_data->bw_down_threshold = value;
+    return count;
+}
+
+static ssize_t mbus_freq_hz_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    struct ddr_state st;
+
+    read_state(&st);
+    return sprintf(buf, "%lu\n", st.mbus_hz);
+}
+
+static ssize_t mbus_voltage_uv_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%d\n", g_data->mbus_voltage_uv);
+}
+
+static ssize_t mbus_coupling_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return sprintf(buf, "%d\n", g_data->mbus_coupling ? 1 : 0);
+}
+
+// Switching coupling on brings MBUS in line with the current DDR rate,
+// switching it off returns MBUS to its stock rate
+static ssize_t mbus_coupling_store(struct kobject *kobj, struct kobj_attribute *attr,
+                                   const char *buf, size_t count) {
+    bool enable;
+    int ret;
+
+    ret = kstrtobool(buf, &enable);
+    if (ret)
+        return ret;
+    if (!g_data->mbus_clk)
+        return -ENODEV;
+
+    if (enable && !g_data->mbus_coupling) {
+        const struct mbus_point *p = mbus_point_for(ddr_cur_freq());
+
+        g_data->mbus_coupling = true;
+        set_mbus_point(p, p->mbus_hz > g_data->mbus_target_hz);
+    } else if (!enable && g_data->mbus_coupling) {
+        g_data->mbus_coupling = false;
+        mutex_lock(&g_data->mbus_lock);
+        clk_set_rate(g_data->mbus_clk, g_data->mbus_stock_hz);
+        g_data->mbus_target_hz = g_data->mbus_stock_hz;
+        publish_mbus(clk_get_rate(g_data->mbus_clk));
+        mutex_unlock(&g_data->mbus_lock);
+        sysfs_notify(g_data->kobj, NULL, "mbus_freq_hz");
+    }
+    return count;
+}
+
+static struct kobj_attribute cur_freq_hz_attr = __ATTR_RO(cur_freq_hz);
+static struct kobj_attribute target_freq_hz_attr = __ATTR_RO(target_freq_hz);
+static struct kobj_attribute voltage_uv_attr = __ATTR_RO(voltage_uv);
+static struct kobj_attribute overclocked_attr = __ATTR_RO(overclocked);
+static struct kobj_attribute rate_misses_attr = __ATTR_RO(rate_misses);
+static struct kobj_attribute drift_count_attr = __ATTR_RO(drift_count);
+static struct kobj_attribute last_drift_attr = __ATTR_RO(last_drift);
+static struct kobj_attribute bandwidth_kbps_attr = __ATTR_RO(bandwidth_kbps);
+static struct kobj_attribute bw_governor_attr = __ATTR_RW(bw_governor);
+static struct kobj_attribute bw_poll_ms_attr = __ATTR_RW(bw_poll_ms);
+static struct kobj_attribute bw_up_threshold_attr =
+    __ATTR(bw_up_threshold, 0664, bw_threshold_show, bw_threshold_store);
+static struct kobj_attribute bw_down_threshold_attr =
+    __ATTR(bw_down_threshold, 0664, bw_threshold_show, bw_threshold_store);
+static struct kobj_attribute mbus_freq_hz_attr = __ATTR_RO(mbus_freq_hz);
+static struct kobj_attribute mbus_voltage_uv_attr = __ATTR_RO(mbus_voltage_uv);
+static struct kobj_attribute mbus_coupling_attr = __ATTR_RW(mbus_coupling);
+static struct kobj_attribute mbus_drift_count_attr = __ATTR_RO(mbus_drift_count);
+static struct kobj_attribute mbus_last_drift_attr = __ATTR_RO(mbus_last_drift);
+
+// Speculative settings: try, then commit before try_timeout_s runs out
+static ssize_t try_store(struct kobject *kobj, struct kobj_attribute *attr,
+                         const char *buf, size_t count) {
+    int ret = radxa_oc_try_start(&g_data->try, buf, try_timeout_s);
+
+    return ret ? ret : count;
+}
+
+static ssize_t commit_store(struct kobject *kobj, struct kobj_attribute *attr,
+                            const char *buf, size_t count) {
+    int ret = radxa_oc_try_commit(&g_data->try);
+
+    return ret ? ret : count;
+}
+
+static ssize_t try_state_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return radxa_oc_try_state_show(&g_data->try, buf);
+}
+
+static ssize_t lkg_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf) {
+    return radxa_oc_try_lkg_show(&g_data->try, buf);
+}
+
+static struct kobj_attribute try_attr = __ATTR_WO(try);
+static struct kobj_attribute commit_attr = __ATTR_WO(commit);
+static struct kobj_attribute try_state_attr = __ATTR_RO(try_state);
+static struct kobj_attribute lkg_attr = __ATTR_RO(lkg);
+
+static struct attribute *ram_overclock_attrs[] = {
+    &cur_freq_hz_attr.attr,
+    &target_freq_hz_attr.attr,
+    &voltage_uv_attr.attr,
+    &overclocked_attr.attr,
+    &rate_misses_attr.attr,
+    &drift_count_attr.attr,
+    &last_drift_attr.attr,
+    &bandwidth_kbps_attr.attr,
+    &bw_governor_attr.attr,
+    &bw_poll_ms_attr.attr,
+    &bw_up_threshold_attr.attr,
+    &bw_down_threshold_attr.attr,
+    &mbus_freq_hz_attr.attr,
+    &mbus_voltage_uv_attr.attr,
+    &mbus_coupling_attr.attr,
+    &mbus_drift_count_attr.attr,
+    &mbus_last_drift_attr.attr,
+    &try_attr.attr,
+    &commit_attr.attr,
+    &try_state_attr.attr,
+    &lkg_attr.attr,
+    NULL,
+};
+
+static const struct attribute_group ram_overclock_group = {
+    .attrs = ram_overclock_attrs,
+};
+
+// Binary snapshot of the DDR domain in a single read
+struct ram_overclock_snapshot {
+    struct radxa_oc_snapshot_header hdr;
+    struct radxa_oc_domain_state dom;
+} __attribute__((packed));
+
+static ssize_t snapshot_read(struct file *filp, struct kobject *kobj,
+                             struct bin_attribute *attr, char *buf,
+                             loff_t off, size_t count) {
+    struct ram_overclock_snapshot snap = {};
+    struct ddr_state st;
+
+    read_state(&st);
+    snap.hdr.magic = RADXA_OC_SNAPSHOT_MAGIC;
+    snap.hdr.version = RADXA_OC_SNAPSHOT_VERSION;
+    snap.hdr.nr_domains = 1;
+    snap.hdr.header_size = sizeof(snap.hdr);
+    snap.hdr.domain_size = sizeof(snap.dom);
+    snap.hdr.timestamp_ns = ktime_get_ns();
+
+    snap.dom.domain = RADXA_OC_DOMAIN_DDR;
+    snap.dom.flags = g_data->ddr_clk || g_data->devfreq_dev ? RADXA_OC_F_PRESENT : 0;
+    if (st.overclocked)
+        snap.dom.flags |= RADXA_OC_F_OVERCLOCKED;
+    snap.dom.cur_freq_hz = st.cur_hz;
+    snap.dom.target_freq_hz = st.target_hz;
+    snap.dom.voltage_uv = st.voltage_uv;
+
+    return memory_read_from_buffer(buf, count, &off, &snap, sizeof(snap));
+}
+
+static struct bin_attribute snapshot_attr = __BIN_ATTR_RO(snapshot, sizeof(struct ram_overclock_snapshot));
+
+// Add the extended points to dmcfreq's OPP table. devfreq only recomputes
+// its frequency range from OPP notifications, so register its notifier
+// ourselves if the driver did not.
+static void add_ddr_opps(void) {
+    struct device *dev = g_data->dmc_dev;
+    struct devfreq *df = g_data->devfreq_dev;
+    struct dev_pm_opp *opp;
+    int i, ret;
+
+    for (i = 0; extended_ram_freqs[i] && g_data->nr_added < ARRAY_SIZE(g_data->added); i++) {
+        unsigned long freq = extended_ram_freqs[i];
+
+        opp = dev_pm_opp_find_freq_exact(dev, freq, true);
+        if (!IS_ERR(opp)) {
+            dev_pm_opp_put(opp);
+            continue;
+        }
+
+        ret = dev_pm_opp_add(dev, freq, get_ddr_voltage_for_freq(freq));
+        if (ret) {
+            pr_warn("RAM_OVERCLOCK: Could not add %lu MHz DDR OPP: %d\n", freq / 1000000, ret);
+            continue;
+        }
+        g_data->added[g_data->nr_added++] = freq;
+
+        // The add above notified devfreq if it listens; otherwise listen
+        // now and replay the event so the new maximum is picked up
+        if (!g_data->own_opp_notifier && df->scaling_max_freq < freq) {
+            ret = devfreq_register_opp_notifier(dev, df);
+            if (ret) {
+                pr_warn("RAM_OVERCLOCK: devfreq will not see new OPPs: %d\n", ret);
+                continue;
+            }
+            g_data->own_opp_notifier = true;
+            dev_pm_opp_disable(dev, freq);
+            dev_pm_opp_enable(dev, freq);
+        }
+    }
+
+    pr_info("RAM_OVERCLOCK: %d DDR OPPs added, devfreq max %lu MHz\n",
+            g_data->nr_added, df->scaling_max_freq / 1000000);
+}
+
+static void remove_ddr_opps(void) {
+    while (g_data->nr_added)
+        dev_pm_opp_remove(g_data->dmc_dev, g_data->added[--g_data->nr_added]);
+    if (g_data->own_opp_notifier)
+        devfreq_unregister_opp_notifier(g_data->dmc_dev, g_data->devfreq_dev);
+}
+
+static int setup_devfreq(void) {
+    int ret;
+
+    g_data->devfreq_dev = devfreq_get_devfreq_by_node(g_data->dmc_dev->of_node);
+    if (IS_ERR(g_data->devfreq_dev)) {
+        g_data->devfreq_dev = NULL;
+        return -ENODEV;
+    }
+
+    ret = dev_pm_qos_add_request(g_data->dmc_dev, &g_data->manual_req,
+                                 DEV_PM_QOS_MIN_FREQUENCY, PM_QOS_MIN_FREQUENCY_DEFAULT_VALUE);
+    if (ret < 0)
+        goto err;
+    ret = dev_pm_qos_add_request(g_data->dmc_dev, &g_data->bw_req,
+                                 DEV_PM_QOS_MIN_FREQUENCY, PM_QOS_MIN_FREQUENCY_DEFAULT_VALUE);
+    if (ret < 0)
+        goto err_manual;
+    ret = dev_pm_qos_add_request(g_data->dmc_dev, &g_data->stall_req,
+                                 DEV_PM_QOS_MIN_FREQUENCY, PM_QOS_MIN_FREQUENCY_DEFAULT_VALUE);
+    if (ret < 0)
+        goto err_bw;
+    ret = dev_pm_qos_add_request(g_data->dmc_dev, &g_data->hold_min_req,
+                                 DEV_PM_QOS_MIN_FREQUENCY, PM_QOS_MIN_FREQUENCY_DEFAULT_VALUE);
+    if (ret < 0)
+        goto err_stall;
+    ret = dev_pm_qos_add_request(g_data->dmc_dev, &g_data->hold_max_req,
+                                 DEV_PM_QOS_MAX_FREQUENCY, PM_QOS_MAX_FREQUENCY_DEFAULT_VALUE);
+    if (ret < 0)
+        goto err_hold;
+
+    add_ddr_opps();
+
+    // MBUS coupling and ram_memtest follow every switch devfreq makes
+    g_data->ddr_transition_nb.notifier_call = ddr_transition_notifier;
+    ret = devfreq_register_notifier(g_data->devfreq_dev, &g_data->ddr_transition_nb,
+                                    DEVFREQ_TRANSITION_NOTIFIER);
+    if (ret) {
+        pr_warn("RAM_OVERCLOCK: Cannot follow devfreq transitions: %d\n", ret);
+        g_data->ddr_transition_nb.notifier_call = NULL;
+    }
+
+    // Resetting the PMU counters is only safe while no driver uses them
+    if (mbus_base && !request_mem_region(mbus_base, MBUS_REG_SIZE, MODULE_NAME)) {
+        pr_warn("RAM_OVERCLOCK: MBUS at 0x%lx belongs to another driver, using dmcfreq stats\n",
+                mbus_base);
+    } else if (mbus_base) {
+        g_data->mbus = ioremap(mbus_base, MBUS_REG_SIZE);
+        if (!g_data->mbus) {
+            release_mem_region(mbus_base, MBUS_REG_SIZE);
+            pr_warn("RAM_OVERCLOCK: Could not map MBUS at 0x%lx, using dmcfreq stats\n", mbus_base);
+        }
+    }
+
+    pr_info("RAM_OVERCLOCK: Using devfreq %s, bandwidth from %s\n",
+            dev_name(g_data->dmc_dev), g_data->mbus ? "MBUS PMU" : "dmcfreq stats");
+    return 0;
+
+err_hold:
+    dev_pm_qos_remove_request(&g_data->hold_min_req);
+err_stall:
+    dev_pm_qos_remove_request(&g_data->stall_req);
+err_bw:
+    dev_pm_qos_remove_request(&g_data->bw_req);
+err_manual:
+    dev_pm_qos_remove_request(&g_data->manual_req);
+err:
+    g_data->devfreq_dev = NULL;
+    return ret;
+}
+
+static void teardown_devfreq(void) {
+    if (!g_data->devfreq_dev)
+        return;
+    bw_governor_stop();
+    if (g_data->ddr_transition_nb.notifier_call)
+        devfreq_unregister_notifier(g_data->devfreq_dev, &g_data->ddr_transition_nb,
+                                    DEVFREQ_TRANSITION_NOTIFIER);
+    dev_pm_qos_remove_request(&g_data->hold_max_req);
+    dev_pm_qos_remove_request(&g_data->hold_min_req);
+    dev_pm_qos_remove_request(&g_data->stall_req);
+    dev_pm_qos_remove_request(&g_data->bw_req);
+    dev_pm_qos_remove_request(&g_data->manual_req);
+    remove_ddr_opps();
+    if (g_data->mbus) {
+        iounmap(g_data->mbus);
+        release_mem_region(mbus_base, MBUS_REG_SIZE);
+    }
+}
+
+// MBUS is the "mbus" input of the MCU CCU, which is how we reach the
+// main CCU's interconnect clock without a DT phandle of our own
+static void setup_mbus(void) {
+    struct device_node *np;
+
+    np = of_find_compatible_node(NULL, NULL, MCU_CCU_COMPATIBLE);
+    if (!np) {
+        pr_warn("RAM_OVERCLOCK: No MCU CCU, MBUS stays at stock\n");
+        return;
+    }
+    g_data->mbus_clk = of_clk_get_by_name(np, "mbus");
+    of_node_put(np);
+    if (IS_ERR(g_data->mbus_clk)) {
+        pr_warn("RAM_OVERCLOCK: Could not get MBUS clock, MBUS stays at stock\n");
+        g_data->mbus_clk = NULL;
+        return;
+    }
+    g_data->mbus_stock_hz = clk_get_rate(g_data->mbus_clk);
+    g_data->mbus_target_hz = g_data->mbus_stock_hz;
+
+    g_data->mbus_supply = regulator_get(NULL, mbus_supply_name);
+    if (IS_ERR(g_data->mbus_supply)) {
+        pr_warn("RAM_OVERCLOCK: Could not get MBUS regulator %s\n", mbus_supply_name);
+        g_data->mbus_supply = NULL;
+    } else {
+        g_data->mbus_voltage_uv = regulator_get_voltage(g_data->mbus_supply);
+    }
+
+    pr_info("RAM_OVERCLOCK: MBUS at %lu MHz, coupled to DDR\n", g_data->mbus_stock_hz / 1000000);
+}
+
+static void teardown_mbus(void) {
+    if (!g_data->mbus_clk)
+        return;
+    clk_set_rate(g_data->mbus_clk, g_data->mbus_stock_hz);
+    if (g_data->mbus_supply) regulator_put(g_data->mbus_supply);
+    clk_put(g_data->mbus_clk);
+}
+
+// Someone else moved the DDR clock: Overclocked follows the hardware
+static void ddr_drifted(struct radxa_clk_watch *w, unsigned long hz) {
+    mutex_lock(&g_data->ddr_lock);
+    radxa_fs_update(g_data->stats, hz);
+    g_data->overclocked = hz > DDR_STOCK_MAX_HZ;
+    publish_ddr(hz);
+    mutex_unlock(&g_data->ddr_lock);
+    notify_ddr_change();
+    sysfs_notify(g_data->kobj, NULL, "drift_count");
+}
+
+static int ddr_reassert(struct radxa_clk_watch *w, unsigned long hz) {
+    return set_ddr_frequency(hz);
+}
+
+static void mbus_drifted(struct radxa_clk_watch *w, unsigned long hz) {
+    mutex_lock(&g_data->mbus_lock);
+    publish_mbus(hz);
+    mutex_unlock(&g_data->mbus_lock);
+    sysfs_notify(g_data->kobj, NULL, "mbus_freq_hz");
+    sysfs_notify(g_data->kobj, NULL, "mbus_drift_count");
+}
+
+// Back to the point for the DDR rate, voltage first
+static int mbus_reassert(struct radxa_clk_watch *w, unsigned long hz) {
+    if (!g_data->mbus_coupling)
+        return 0;
+    set_mbus_point(mbus_point_for(ddr_cur_freq()), true);
+    return 0;
+}
+
+// The DRAM controller comes out of suspend at the firmware's rate while
+// the clock framework still caches ours. Raise in the usual order: MBUS
+// rail and clock, then DDR rail and clock. With dmcfreq the floor request
+// survives and devfreq restores the DDR itself.
+static int ram_overclock_pm_notify(struct notifier_block *nb, unsigned long action,
+                                   void *data) {
+    unsigned long hz;
+    int ret;
+
+    if (action != PM_POST_SUSPEND && action != PM_POST_HIBERNATION && action != PM_POST_RESTORE)
+        return NOTIFY_OK;
+
+    if (g_data->mbus_clk && g_data->mbus_target_hz != g_data->mbus_stock_hz) {
+        mutex_lock(&g_data->mbus_lock);
+        if (g_data->mbus_supply)
+            regulator_sync_voltage(g_data->mbus_supply);
+        ret = radxa_cw_reprogram(&g_data->mbus_watch, g_data->mbus_clk, g_data->mbus_target_hz);
+        publish_mbus(clk_get_rate(g_data->mbus_clk));
+        mutex_unlock(&g_data->mbus_lock);
+        if (ret)
+            pr_err("RAM_OVERCLOCK: Failed to restore MBUS to %lu MHz: %d\n",
+                   g_data->mbus_target_hz / 1000000, ret);
+        sysfs_notify(g_data->kobj, NULL, "mbus_freq_hz");
+    }
+
+    if (g_data->ddr_clk && !g_data->devfreq_dev && g_data->target_freq) {
+        mutex_lock(&g_data->ddr_lock);
+        if (g_data->ddr_supply)
+            regulator_sync_voltage(g_data->ddr_supply);
+        ret = radxa_cw_reprogram(&g_data->ddr_watch, g_data->ddr_clk, g_data->target_freq);
+        if (ret) {
+            pr_err("RAM_OVERCLOCK: Failed to restore DDR to %lu MHz: %d\n",
+                   g_data->target_freq / 1000000, ret);
+            radxa_fs_failed(g_data->stats);
+        } else {
+            pr_info("RAM_OVERCLOCK: Restored DDR to %lu MHz\n", g_data->target_freq / 1000000);
+        }
+        hz = clk_get_rate(g_data->ddr_clk);
+        radxa_fs_update(g_data->stats, hz);
+        g_data->overclocked = hz > DDR_STOCK_MAX_HZ;
+        publish_ddr(hz);
+        mutex_unlock(&g_data->ddr_lock);
+        notify_ddr_change();
+    }
+    return NOTIFY_OK;
+}
+
+// devfreq owns the DDR clock when it is there; MBUS is always ours
+static void drift_watch_init(void) {
+    if (g_data->ddr_clk && !g_data->devfreq_dev) {
+        g_data->ddr_watch.drifted = ddr_drifted;
+        g_data->ddr_watch.reassert = ddr_reassert;
+        if (radxa_cw_register(&g_data->ddr_watch, g_data->ddr_clk, "DDR", &drift_policy))
+            pr_warn("RAM_OVERCLOCK: Cannot watch the DDR clock for changes\n");
+    }
+    if (g_data->mbus_clk) {
+        g_data->mbus_watch.drifted = mbus_drifted;
+        g_data->mbus_watch.reassert = mbus_reassert;
+        if (radxa_cw_register(&g_data->mbus_watch, g_data->mbus_clk, "MBUS", &drift_policy))
+            pr_warn("RAM_OVERCLOCK: Cannot watch the MBUS clock for changes\n");
+    }
+}
+
 static int __init ram_overclock_init(void) {
     struct device_node *np;
     int ret;
-    
+
     pr_info("RAM_OVERCLOCK: Loading DDR overclocking module...\n");
-    
+
     g_data = kzalloc(sizeof(*g_data), GFP_KERNEL);
     if (!g_data)
         return -ENOMEM;
-    
-    // Try to find DDR clock
-    np = of_find_compatible_node(NULL, NULL, "allwinner,sun50i-h616-ccu");
-    if (!np) {
-        np = of_find_node_by_path("/soc/ccu@3001000");
-    }
-    
-    if (np) {
-        // Try to get DDR clock
-        g_data->ddr_clk = of_clk_get_by_name(np, "ddr");
-        if (IS_ERR(g_data->ddr_clk)) {
-            g_data->ddr_clk = of_clk_get(np, 0); // Try index 0
-            if (IS_ERR(g_data->ddr_clk)) {
-                pr_warn("RAM_OVERCLOCK: Could not get DDR clock from CCU\n");
-                g_data->ddr_clk = NULL;
-            }
-        }
-        of_node_put(np);
+
+    g_data->bw_governor = true;
+    g_data->bw_poll_ms = 50;
+    g_data->bw_up_threshold = 70;
+    g_data->bw_down_threshold = 30;
+    g_data->mbus_coupling = true;
+    mutex_init(&g_data->mbus_lock);
+    mutex_init(&g_data->ddr_lock);
+    seqlock_init(&g_data->state_lock);
+    INIT_DELAYED_WORK(&g_data->bw_work, bw_governor_work);
+
+    // The DRAM controller's devfreq device owns the DDR clock
+    g_data->dmc_dev = bus_find_device_by_name(&platform_bus_type, NULL, DMC_DEVICE_NAME);
+    if (g_data->dmc_dev) {
+        g_data->ddr_clk = clk_get(g_data->dmc_dev, NULL);
+        if (IS_ERR(g_data->ddr_clk))
+            g_data->ddr_clk = NULL;
+
+        ret = setup_devfreq();
+        if (ret)
+            pr_warn("RAM_OVERCLOCK: %s has no devfreq (%d), setting the clock directly\n",
+                    DMC_DEVICE_NAME, ret);
     }
-    
-    // Alternative: try to find DDR clock directly
+
+    // Try to find DDR clock
     if (!g_data->ddr_clk) {
-        np = of_find_node_by_path("/soc/clk_ddr@2002000");
+        np = of_find_compatible_node(NULL, NULL, "allwinner,sun55i-a523-ccu");
+        if (!np)
+            np = of_find_node_by_path("/soc/ccu@2001000");
+
         if (np) {
-            g_data->ddr_clk = of_clk_get(np, 0);
+            // Try to get DDR clock
+            g_data->ddr_clk = of_clk_get_by_name(np, "ddr");
             if (IS_ERR(g_data->ddr_clk)) {
-                pr_warn("RAM_OVERCLOCK: Could not get DDR clock directly\n");
+                pr_warn("RAM_OVERCLOCK: Could not get DDR clock from CCU\n");
                 g_data->ddr_clk = NULL;
-            } else {
-                pr_info("RAM_OVERCLOCK: Found DDR clock controller\n");
             }
             of_node_put(np);
         }
     }
-    
+
     // Try to get DDR voltage regulator
-    g_data->ddr_supply = regulator_get(NULL, "vdd-sys");
+    g_data->ddr_supply = regulator_get(NULL, "vdd-dram");
     if (IS_ERR(g_data->ddr_supply)) {
         g_data->ddr_supply = regulator_get(NULL, "ddr");
         if (IS_ERR(g_data->ddr_supply)) {
@@ -190,40 +1284,78 @@ static int __init ram_overclock_init(void) {
             g_data->ddr_supply = NULL;
         }
     }
-    
+
     if (g_data->ddr_supply) {
         pr_info("RAM_OVERCLOCK: Found DDR voltage regulator\n");
     }
-    
-    if (!g_data->ddr_clk) {
-        pr_warn("RAM_OVERCLOCK: No DDR clock found - will work with devfreq fallback\n");
+
+    setup_mbus();
+    publish_ddr(ddr_hw_freq());
+    if (g_data->mbus_clk)
+        publish_mbus(g_data->mbus_stock_hz);
+
+    // Stock is whatever devfreq picks when it has the DDR to itself
+    radxa_oc_try_init(&g_data->try, apply_ram_setting,
+                      g_data->devfreq_dev ? "auto" : "1800", lkg);
+
+    if (!g_data->ddr_clk && !g_data->devfreq_dev) {
+        pr_warn("RAM_OVERCLOCK: No DDR clock or devfreq device found\n");
     } else {
-        unsigned long current_freq = clk_get_rate(g_data->ddr_clk);
-        pr_info("RAM_OVERCLOCK: Current DDR frequency: %lu MHz\n", current_freq / 1000000);
+        pr_info("RAM_OVERCLOCK: Current DDR frequency: %lu MHz\n", ddr_cur_freq() / 1000000);
     }
-    
+
     // Create sysfs interface
     g_data->kobj = kobject_create_and_add("ram_overclock", kernel_kobj);
     if (!g_data->kobj) {
         ret = -ENOMEM;
         goto err_clk;
     }
-    
+
     ret = sysfs_create_file(g_data->kobj, &ram_overclock_attr.attr);
     if (ret) {
         pr_err("RAM_OVERCLOCK: Failed to create sysfs file\n");
         goto err_kobj;
     }
-    
+
+    ret = sysfs_create_group(g_data->kobj, &ram_overclock_group);
+    if (ret)
+        goto err_file;
+    ret = sysfs_create_bin_file(g_data->kobj, &snapshot_attr);
+    if (ret)
+        goto err_group;
+
+    // devfreq keeps its own trans_stat when it owns the clock
+    if (g_data->ddr_clk && !g_data->devfreq_dev) {
+        g_data->stats_kobj = kobject_create_and_add("freq_stats", g_data->kobj);
+        g_data->stats = radxa_fs_create(g_data->stats_kobj, "ddr",
+                                        clk_get_rate(g_data->ddr_clk));
+        if (!g_data->stats)
+            pr_warn("RAM_OVERCLOCK: No DDR frequency statistics\n");
+    }
+
+    drift_watch_init();
+    g_data->pm_nb.notifier_call = ram_overclock_pm_notify;
+    register_pm_notifier(&g_data->pm_nb);
+    radxa_oc_try_restore(&g_data->try, g_data->kobj, "try_state");
+
+    bw_governor_start();
+
     pr_info("RAM_OVERCLOCK: Module loaded successfully!\n");
     pr_info("RAM_OVERCLOCK: Control interface at /sys/kernel/ram_overclock/ram_overclock\n");
     pr_info("RAM_OVERCLOCK: ⚠️  WARNING: Overclocking DDR beyond 1800MHz may cause instability!\n");
-    
+
     return 0;
-    
+
+err_group:
+    sysfs_remove_group(g_data->kobj, &ram_overclock_group);
+err_file:
+    sysfs_remove_file(g_data->kobj, &ram_overclock_attr.attr);
 err_kobj:
     kobject_put(g_data->kobj);
 err_clk:
+    teardown_devfreq();
+    teardown_mbus();
+    if (g_data->dmc_dev) put_device(g_data->dmc_dev);
     if (g_data->ddr_clk) clk_put(g_data->ddr_clk);
     if (g_data->ddr_supply) regulator_put(g_data->ddr_supply);
     kfree(g_data);
@@ -232,19 +1364,33 @@ err_clk:
 
 static void __exit ram_overclock_exit(void) {
     pr_info("RAM_OVERCLOCK: Unloading module...\n");
-    
+
     if (g_data) {
+        radxa_oc_try_exit(&g_data->try);
+        unregister_pm_notifier(&g_data->pm_nb);
+        // teardown_mbus() puts MBUS back to stock, that is no drift
+        radxa_cw_unregister(&g_data->ddr_watch);
+        radxa_cw_unregister(&g_data->mbus_watch);
+        // Stop the governor before its attributes go away
+        teardown_devfreq();
+        teardown_mbus();
+
         if (g_data->kobj) {
+            radxa_fs_destroy(g_data->stats);
+            kobject_put(g_data->stats_kobj);
+            sysfs_remove_bin_file(g_data->kobj, &snapshot_attr);
+            sysfs_remove_group(g_data->kobj, &ram_overclock_group);
             sysfs_remove_file(g_data->kobj, &ram_overclock_attr.attr);
             kobject_put(g_data->kobj);
         }
-        
+
+        if (g_data->dmc_dev) put_device(g_data->dmc_dev);
         if (g_data->ddr_clk) clk_put(g_data->ddr_clk);
         if (g_data->ddr_supply) regulator_put(g_data->ddr_supply);
-        
+
         kfree(g_data);
     }
-    
+
     pr_info("RAM_OVERCLOCK: Module unloaded\n");
 }
 
@@ -254,4 +1400,4 @@ module_exit(ram_overclock_exit);
 MODULE_AUTHOR("Radxa Performance Team");
 MODULE_DESCRIPTION("RAM/DDR Overclocking Module for A733 SoC");
 MODULE_LICENSE("GPL v2");
-MODULE_VERSION("1.0");
\ No newline at end of file
+MODULE_VERSION("1.0");